@@ -1,13 +1,19 @@
 #include "CameraManager.h"
 #include "../Main.h"
 #include "../Util/ImGuiEXT.h"
-#include "../inih/cpp/INIReader.h"
 
 #include <boost/filesystem.hpp>
 #include <boost/range/iterator_range.hpp>
 #include <iostream>
 #include <Windows.h>
 
+// Rotation per mouse count, in the same units as the other rotation
+// deltas after they've been scaled by dt. The mouse used to be scaled
+// by the Main::Run tick, which sleeps 10 ms and so wakes up on the next
+// 15.625 ms tick of the default Windows timer. With a raised timer
+// resolution the old ticks were closer to 10 ms and the mouse slower.
+static const float g_mouseRotationScale = 1.f / 64.f;
+
 // Helper for ImGui combo
 static auto ProfileNameGetter = [](void* vec, int idx, const char** out_text)
 {
@@ -43,60 +49,35 @@ CameraManager::~CameraManager()
 
 }
 
-void CameraManager::HotkeyUpdate()
+void CameraManager::RegisterHotkeys()
 {
   InputSystem* pInput = g_mainHandle->GetInputSystem();
 
-  if (pInput->IsActionDown(Action::ToggleCamera))
-  {
-    ToggleCamera();
-    while (pInput->IsActionDown(Action::ToggleCamera))
-      Sleep(100);
-  }
-
-  if (pInput->IsActionDown(Action::ToggleHUD))
-  {
-    ToggleHUD();
-
-    while (pInput->IsActionDown(Action::ToggleHUD))
-      Sleep(100);
-  }
-
-  if (pInput->IsActionDown(Action::ToggleFreezeTime))
+  pInput->Subscribe(Action::ToggleCamera, ActionEventType::Pressed, [this] { ToggleCamera(); });
+  pInput->Subscribe(Action::ToggleHUD, ActionEventType::Pressed, [this] { ToggleHUD(); });
+  pInput->Subscribe(Action::ToggleFreezeTime, ActionEventType::Pressed, []
   {
-    bool* pFreezeTime = (bool*)(*(bool**)util::offsets::GetOffset("OFFSET_FREEZETIME"));
+    bool* pFreezeTime = (bool*)(*(bool**)util::offsets::Get(util::offsets::OFFSET_FREEZETIME));
     *pFreezeTime = !*pFreezeTime;
+  });
 
-    while (pInput->IsActionDown(Action::ToggleFreezeTime))
-      Sleep(100);
-  }
-
-  if (m_CameraEnabled)
+  pInput->Subscribe(Action::Track_CreateNode, ActionEventType::Pressed, [this]
   {
-    if (pInput->IsActionDown(Action::Track_CreateNode))
-    {
+    if (m_CameraEnabled)
       m_TrackPlayer.CreateNode(m_Camera);
+  });
 
-      while (pInput->IsActionDown(Action::Track_CreateNode))
-        Sleep(100);
-    }
-
-    if (pInput->IsActionDown(Action::Track_DeleteNode))
-    {
+  pInput->Subscribe(Action::Track_DeleteNode, ActionEventType::Pressed, [this]
+  {
+    if (m_CameraEnabled)
       m_TrackPlayer.DeleteNode();
+  });
 
-      while (pInput->IsActionDown(Action::Track_DeleteNode))
-        Sleep(100);
-    }
-
-    if (pInput->IsActionDown(Action::Track_Play))
-    {
+  pInput->Subscribe(Action::Track_Play, ActionEventType::Pressed, [this]
+  {
+    if (m_CameraEnabled)
       m_TrackPlayer.Toggle();
-
-      while (pInput->IsActionDown(Action::Track_Play))
-        Sleep(100);
-    }
-  }
+  });
 }
 
 XMFLOAT4 savedRotations[3];
@@ -245,7 +226,7 @@ void CameraManager::DrawUI()
       m_TimeScale = 0;
   }
 
-  double* pTimescale = reinterpret_cast<double*>(util::offsets::GetOffset("OFFSET_TIMESCALE"));
+  double* pTimescale = reinterpret_cast<double*>(util::offsets::Get(util::offsets::OFFSET_TIMESCALE));
   *pTimescale = static_cast<double>(m_TimeScale);
 
 
@@ -310,7 +291,7 @@ void CameraManager::DrawUI()
     g_mainHandle->OnConfigChanged();
 }
 
-void CameraManager::ReadConfig(INIReader* pReader)
+void CameraManager::ReadConfig(util::IniFile* pReader)
 {
   LoadProfiles();
   m_AutoReset = pReader->GetBoolean("Camera", "AutoReset", false);
@@ -342,8 +323,11 @@ const std::string CameraManager::GetConfig()
 
 void CameraManager::UpdateCamera(float dt)
 {
-  XMVECTOR qPitch = XMQuaternionRotationRollPitchYaw(-m_Camera.dPitch * dt * m_Camera.Profile.RotationSpeed, 0, 0);
-  XMVECTOR qYaw = XMQuaternionRotationRollPitchYaw(0, -m_Camera.dYaw* dt * m_Camera.Profile.RotationSpeed, 0);
+  float pitch = m_Camera.dPitch * dt + m_Camera.MousePitch;
+  float yaw = m_Camera.dYaw * dt + m_Camera.MouseYaw;
+
+  XMVECTOR qPitch = XMQuaternionRotationRollPitchYaw(-pitch * m_Camera.Profile.RotationSpeed, 0, 0);
+  XMVECTOR qYaw = XMQuaternionRotationRollPitchYaw(0, -yaw * m_Camera.Profile.RotationSpeed, 0);
   XMVECTOR qRoll = XMQuaternionRotationRollPitchYaw(0, 0, m_Camera.dRoll* dt * m_Camera.Profile.RollSpeed);
   
   XMVECTOR qRotation = XMLoadFloat4(&m_Camera.Rotation);
@@ -412,40 +396,46 @@ void CameraManager::UpdateCamera(float dt)
   m_Camera.dFocus = 0;
   m_Camera.dDofScale = 0;
   m_Camera.dDofStrength = 0;
+  m_Camera.MousePitch = 0;
+  m_Camera.MouseYaw = 0;
 }
 
 void CameraManager::UpdateInput(float dt)
 {
   InputSystem* pInput = g_mainHandle->GetInputSystem();
-  if (!g_hasFocus || g_mainHandle->GetUI()->HasKeyboardFocus())
+  if (!pInput->IsPlayingBack() && (!g_hasFocus || g_mainHandle->GetUI()->HasKeyboardFocus()))
     return;
 
+  // Use the snapshot latched for this frame, so all axes come from the
+  // same input tick and recorded input can be played back.
+  InputSnapshot const& input = pInput->GetFrameSnapshot();
+
   // These need to be changed according to the right/left-handness of game camera
   if (m_KbmDisabled)
   {
-    m_Camera.dX = pInput->GetActionState(Camera_Right) - pInput->GetActionState(Camera_Left);
-    m_Camera.dY = pInput->GetActionState(Camera_Up) - pInput->GetActionState(Camera_Down);
-    m_Camera.dZ = pInput->GetActionState(Camera_Backward) - pInput->GetActionState(Camera_Forward);
+    m_Camera.dX = input.GetActionState(Camera_Right) - input.GetActionState(Camera_Left);
+    m_Camera.dY = input.GetActionState(Camera_Up) - input.GetActionState(Camera_Down);
+    m_Camera.dZ = input.GetActionState(Camera_Backward) - input.GetActionState(Camera_Forward);
   }
   else
   {
-    m_Camera.dX = pInput->GetActionState(Camera_RightSecondary) - pInput->GetActionState(Camera_LeftSecondary);
-    m_Camera.dY = pInput->GetActionState(Camera_UpSecondary) - pInput->GetActionState(Camera_DownSecondary);
-    m_Camera.dZ = pInput->GetActionState(Camera_BackwardSecondary) - pInput->GetActionState(Camera_ForwardSecondary);
+    m_Camera.dX = input.GetActionState(Camera_RightSecondary) - input.GetActionState(Camera_LeftSecondary);
+    m_Camera.dY = input.GetActionState(Camera_UpSecondary) - input.GetActionState(Camera_DownSecondary);
+    m_Camera.dZ = input.GetActionState(Camera_BackwardSecondary) - input.GetActionState(Camera_ForwardSecondary);
   }
 
-  m_Camera.dPitch = pInput->GetActionState(Camera_PitchUp) - pInput->GetActionState(Camera_PitchDown);
-  m_Camera.dYaw = pInput->GetActionState(Camera_YawLeft) - pInput->GetActionState(Camera_YawRight);
-  m_Camera.dRoll = pInput->GetActionState(Camera_RollLeft) - pInput->GetActionState(Camera_RollRight);
-  m_Camera.dFov = pInput->GetActionState(Camera_IncFov) - pInput->GetActionState(Camera_DecFov);
-  m_Camera.dFocus = pInput->GetActionState(Visuals_IncFocusDist) - pInput->GetActionState(Visuals_DecFocusDist);
-  m_Camera.dDofScale = pInput->GetActionState(Visuals_IncDofScale) - pInput->GetActionState(Visuals_DecDofScale);
-  m_Camera.dDofStrength = pInput->GetActionState(Visuals_IncDofStrength) - pInput->GetActionState(Visuals_DecDofStrength);
+  m_Camera.dPitch = input.GetActionState(Camera_PitchUp) - input.GetActionState(Camera_PitchDown);
+  m_Camera.dYaw = input.GetActionState(Camera_YawLeft) - input.GetActionState(Camera_YawRight);
+  m_Camera.dRoll = input.GetActionState(Camera_RollLeft) - input.GetActionState(Camera_RollRight);
+  m_Camera.dFov = input.GetActionState(Camera_IncFov) - input.GetActionState(Camera_DecFov);
+  m_Camera.dFocus = input.GetActionState(Visuals_IncFocusDist) - input.GetActionState(Visuals_DecFocusDist);
+  m_Camera.dDofScale = input.GetActionState(Visuals_IncDofScale) - input.GetActionState(Visuals_DecDofScale);
+  m_Camera.dDofStrength = input.GetActionState(Visuals_IncDofStrength) - input.GetActionState(Visuals_DecDofStrength);
 
   // Gamepad controls for movement & rotation speed
   // Hardcoded for now
-  m_Camera.Profile.RotationSpeed += (pInput->GetPadKeyState(GamepadKey::DPad_Up) - pInput->GetPadKeyState(GamepadKey::DPad_Down)) * dt;
-  m_Camera.Profile.MovementSpeed += (pInput->GetPadKeyState(GamepadKey::Button3) - pInput->GetPadKeyState(GamepadKey::Button4)) * dt;
+  m_Camera.Profile.RotationSpeed += (input.GetPadKeyState(GamepadKey::DPad_Up) - input.GetPadKeyState(GamepadKey::DPad_Down)) * dt;
+  m_Camera.Profile.MovementSpeed += (input.GetPadKeyState(GamepadKey::Button3) - input.GetPadKeyState(GamepadKey::Button4)) * dt;
 
   if (m_Camera.Profile.RotationSpeed < 0.01f)
     m_Camera.Profile.RotationSpeed = 0.01f;
@@ -453,7 +443,7 @@ void CameraManager::UpdateInput(float dt)
   if (m_Camera.Profile.MovementSpeed < 0.1f)
     m_Camera.Profile.MovementSpeed = 0.1f;
 
-  if (m_KbmDisabled && !g_mainHandle->GetUI()->IsEnabled())
+  if (m_KbmDisabled && pInput->IsMouseLookActive())
   {
     XMFLOAT3 state = pInput->GetMouseState();
     float sensitivity = pInput->GetMouseSensitivity();
@@ -464,8 +454,11 @@ void CameraManager::UpdateInput(float dt)
     if (m_SmoothMouse)
       state = smoothState;
 
-    m_Camera.dPitch -= state.y * sensitivity;
-    m_Camera.dYaw -= state.x * sensitivity;
+    // Mouse counts are turned into rotation directly instead of being
+    // multiplied by dt, so the result only depends on how far the mouse
+    // moved and not on update timing or polling rate.
+    m_Camera.MousePitch -= state.y * sensitivity * g_mouseRotationScale;
+    m_Camera.MouseYaw -= state.x * sensitivity * g_mouseRotationScale;
     m_Camera.dFov += smoothState.z;
   }
 }
@@ -522,11 +515,23 @@ void CameraManager::ChangeCamRelativity()
 void CameraManager::LoadProfiles()
 {
   boost::filesystem::path profileDir("./Cinematic Tools/Profiles/");
+
+  // One reader for every profile, so its buffers are only allocated once
+  util::IniFile reader;
+  std::vector<boost::filesystem::path> staleFiles;
   for (auto& entry : boost::make_iterator_range(boost::filesystem::directory_iterator(profileDir), {}))
   {
     const boost::filesystem::path &profilePath = entry.path();
-    
-    INIReader reader(profilePath.generic_string().c_str());
+
+    // Profiles are saved as <name>.ini. A <name>.ini.tmp is what's left
+    // of a save that didn't finish, the .ini next to it is still intact.
+    std::string extension = profilePath.extension().string();
+    if (extension == ".tmp")
+      staleFiles.push_back(profilePath);
+    if (extension != ".ini")
+      continue;
+
+    reader.Load(profilePath.generic_string());
 
     // Make sure the opened file is actually a camera profile
     if (!reader.GetBoolean("CameraProfile", "IsProfile", false))
@@ -546,6 +551,15 @@ void CameraManager::LoadProfiles()
     m_Profiles.emplace_back(profile);
   }
 
+  for (auto const& stalePath : staleFiles)
+  {
+    boost::system::error_code error;
+    if (boost::filesystem::remove(stalePath, error))
+      util::log::Warning("Removed %s, left over from a save that didn't finish", stalePath.generic_string().c_str());
+    else
+      util::log::Warning("Could not remove %s, left over from a save that didn't finish", stalePath.generic_string().c_str());
+  }
+
   // If there were no profiles, save current one as default
   if (m_Profiles.size() == 0)
     m_Profiles.emplace_back(m_Camera.Profile);
@@ -565,31 +579,24 @@ void CameraManager::CreateProfile()
 
 void CameraManager::SaveProfiles()
 {
+  // Profiles that didn't change are skipped by the config writer
   for (auto& profile : m_Profiles)
   {
     std::string path = "./Cinematic Tools/Profiles/" + profile.Name + ".ini";
-    std::fstream file;
-
-    file.open(path.c_str(), std::ios_base::out | std::ios_base::trunc);
-    if (!file.is_open())
-    {
-      util::log::Error("Could not open file to save profile %s", path.c_str());
-      continue;
-    }
 
-    file << "[CameraProfile]" << std::endl;
-    file << "Name = " << profile.Name << std::endl;
-    file << "FieldOfView = " << std::to_string(profile.FieldOfView) << std::endl;
-    file << "MovementSpeed = " << std::to_string(profile.MovementSpeed) << std::endl;
-    file << "RotationSpeed = " << std::to_string(profile.RotationSpeed) << std::endl;
-    file << "RollSpeed = " << std::to_string(profile.RollSpeed) << std::endl;
-    file << "FovSpeed = " << std::to_string(profile.FovSpeed) << std::endl;
-    file << "DofScale = " << std::to_string(profile.DofScale) << std::endl;
-    file << "DofStrength = " << std::to_string(profile.DofStrength) << std::endl;
-    file << "FocusDistance = " << std::to_string(profile.FocusDistance) << std::endl;
-    file << "IsProfile = true" << std::endl;
-
-    file.close();
+    std::string content = "[CameraProfile]\n";
+    content += "Name = " + profile.Name + "\n";
+    content += "FieldOfView = " + std::to_string(profile.FieldOfView) + "\n";
+    content += "MovementSpeed = " + std::to_string(profile.MovementSpeed) + "\n";
+    content += "RotationSpeed = " + std::to_string(profile.RotationSpeed) + "\n";
+    content += "RollSpeed = " + std::to_string(profile.RollSpeed) + "\n";
+    content += "FovSpeed = " + std::to_string(profile.FovSpeed) + "\n";
+    content += "DofScale = " + std::to_string(profile.DofScale) + "\n";
+    content += "DofStrength = " + std::to_string(profile.DofStrength) + "\n";
+    content += "FocusDistance = " + std::to_string(profile.FocusDistance) + "\n";
+    content += "IsProfile = true\n";
+
+    g_mainHandle->GetConfigWriter()->Queue(path, std::move(content));
   }
 }
 
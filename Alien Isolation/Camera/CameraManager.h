@@ -1,7 +1,7 @@
 #pragma once
 #include "TrackPlayer.h"
-#include "../inih/cpp/INIReader.h"
 #include "../AlienIsolation.h"
+#include "../Util/IniFile.h"
 
 #include <array>
 #include <boost/chrono/chrono.hpp>
@@ -48,7 +48,8 @@ public:
   void OnPostProcessUpdate(CATHODE::PostProcess* pPostProcess);
   void OnMapChange();
 
-  void HotkeyUpdate();
+  // Subscribes camera hotkeys to the input system
+  void RegisterHotkeys();
   void Update(float dt);
   void DrawUI();
   void DrawTrack() { if(m_CameraEnabled) m_TrackPlayer.DrawNodes(); }
@@ -57,7 +58,7 @@ public:
   bool IsGamepadDisabled() { return m_CameraEnabled && m_GamepadDisabled; };
   bool IsKbmDisabled() { return m_CameraEnabled && m_KbmDisabled; };
 
-  void ReadConfig(INIReader* pReader);
+  void ReadConfig(util::IniFile* pReader);
   const std::string GetConfig();
 
   Camera const& GetCamera() { return m_Camera; }
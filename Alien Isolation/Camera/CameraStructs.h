@@ -49,6 +49,11 @@ struct Camera
   float dDofStrength{ 0 };
   float dDofScale{ 0 };
 
+  // Mouse rotation for this update. Unlike the other deltas it's
+  // already integrated over the input window, so it isn't scaled by dt.
+  float MousePitch{ 0 };
+  float MouseYaw{ 0 };
+
   DirectX::XMFLOAT3 AbsolutePosition{ 0,0,0 };
   DirectX::XMFLOAT4 AbsoluteRotation{ 0,0,0,1 };
   DirectX::XMFLOAT4X4 TargetMatrix{ 1,0,0,0,
@@ -161,6 +161,6 @@ void OSCReceiver::ParseMessage(tosc_message& msg)
       func();
     }
     else
-      util::log::Warning("OSC received a message with an unknown address %s", address.c_str());
+      CT_LOG_LIMITED(Warning, "OSC received a message with an unknown address %s", address.c_str());
   }
 }
\ No newline at end of file
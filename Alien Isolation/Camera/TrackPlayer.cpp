@@ -96,8 +96,8 @@ CatmullRomNode TrackPlayer::PlayForwardSmooth(float dt, bool ignoreManual /*= fa
     m_CurrentTime += dt;
   else
   {
-    float controlMultiplier = g_mainHandle->GetInputSystem()->GetActionState(Action::Camera_Up);
-    controlMultiplier -= g_mainHandle->GetInputSystem()->GetActionState(Action::Camera_Down);
+    InputSnapshot const& input = g_mainHandle->GetInputSystem()->GetFrameSnapshot();
+    float controlMultiplier = input.GetActionState(Action::Camera_Up) - input.GetActionState(Action::Camera_Down);
     m_CurrentTime += dt * controlMultiplier;
   }
 
@@ -216,8 +216,8 @@ CatmullRomNode TrackPlayer::PlayForward(float dt, bool ignoreManual /*= false*/)
     m_CurrentTime += dt * timeMultiplier;
   else
   {
-    float controlMultiplier = g_mainHandle->GetInputSystem()->GetActionState(Action::Camera_Up);
-    controlMultiplier -= g_mainHandle->GetInputSystem()->GetActionState(Action::Camera_Down);
+    InputSnapshot const& input = g_mainHandle->GetInputSystem()->GetFrameSnapshot();
+    float controlMultiplier = input.GetActionState(Action::Camera_Up) - input.GetActionState(Action::Camera_Down);
     m_CurrentTime += dt * timeMultiplier * controlMultiplier;
   }
 
@@ -12,6 +12,7 @@ DWORD WINAPI RunCT(LPVOID arg)
     g_mainHandle->Run();
 
   delete g_mainHandle;
+  util::log::Shutdown();
 
   FreeLibraryAndExitThread(g_dllHandle, 0);
 }
@@ -1,91 +1,9 @@
 #pragma once
+#include "ActionIds.h"
 #include <map>
 #include <boost/assign.hpp>
 #include <Windows.h>
 
-enum Action
-{
-  ToggleUI,
-
-  ToggleCamera,
-  ToggleHUD,
-  ToggleFreezeTime,
-
-  Camera_Forward,
-  Camera_Backward,
-  Camera_Left,
-  Camera_Right,
-  Camera_Up,
-  Camera_Down,
-
-  Camera_ForwardSecondary,
-  Camera_BackwardSecondary,
-  Camera_LeftSecondary,
-  Camera_RightSecondary,
-  Camera_UpSecondary,
-  Camera_DownSecondary,
-
-  Camera_PitchUp,
-  Camera_PitchDown,
-  Camera_YawLeft,
-  Camera_YawRight,
-  Camera_RollLeft,
-  Camera_RollRight,
-
-  Camera_IncFov,
-  Camera_DecFov,
-
-  Track_CreateNode,
-  Track_DeleteNode,
-  Track_Play,
-
-  Object_PickUp,
-  Object_Rotate,
-  Object_Remove,
-
-  Visuals_IncDofScale,
-  Visuals_DecDofScale,
-  Visuals_IncDofStrength,
-  Visuals_DecDofStrength,
-  Visuals_IncFocusDist,
-  Visuals_DecFocusDist,
-
-  ToggleInvisibility,
-  FreezeCharacters,
-
-  ActionCount
-};
-
-enum GamepadKey
-{
-  None,
-  LeftThumb_XPos,
-  LeftThumb_XNeg,
-  LeftThumb_YPos,
-  LeftThumb_YNeg,
-  RightThumb_XPos,
-  RightThumb_XNeg,
-  RightThumb_YPos,
-  RightThumb_YNeg,
-  LeftTrigger,
-  RightTrigger,
-  LeftThumb,
-  RightThumb,
-  LeftShoulder,
-  RightShoulder,
-  DPad_Left,
-  DPad_Right,
-  DPad_Up,
-  DPad_Down,
-  Button1,
-  Button2,
-  Button3,
-  Button4,
-  Button5,
-  Button6,
-  GamepadKey_Count
-};
-
 static const std::map<GamepadKey, std::string> GamepadKeyStrings = boost::assign::map_list_of
 (None, "")
 (LeftThumb_XPos, "LeftThumb_XPos")
@@ -151,7 +69,8 @@ static const std::map<Action, std::string> ActionStringMap = boost::assign::map_
 (Visuals_IncFocusDist, "Visuals_IncFocusDist")
 (Visuals_DecFocusDist, "Visuals_DecFocusDist")
 (ToggleInvisibility, "ToggleInvisibility")
-(FreezeCharacters, "FreezeCharacters");
+(FreezeCharacters, "FreezeCharacters")
+(TogglePerfOverlay, "TogglePerfOverlay");
 
 
 static const std::map<Action, std::string> ActionUIStringMap = boost::assign::map_list_of
@@ -192,7 +111,8 @@ static const std::map<Action, std::string> ActionUIStringMap = boost::assign::ma
 (Visuals_IncFocusDist, "Increase focus distance")
 (Visuals_DecFocusDist, "Decrease focus distance")
 (ToggleInvisibility, "Toggle invisibility")
-(FreezeCharacters, "Freeze characters");
+(FreezeCharacters, "Freeze characters")
+(TogglePerfOverlay, "Performance overlay");
 
 
 static const std::map<Action, int> DefaultKeyboardMap = boost::assign::map_list_of
@@ -233,7 +153,8 @@ static const std::map<Action, int> DefaultKeyboardMap = boost::assign::map_list_
 (Visuals_IncFocusDist, VK_NUMPAD6)
 (Visuals_DecFocusDist, VK_NUMPAD5)
 (ToggleInvisibility, 'I')
-(FreezeCharacters, VK_F7);
+(FreezeCharacters, VK_F7)
+(TogglePerfOverlay, VK_F8);
 
 static const std::map<Action, GamepadKey> DefaultGamepadMap = boost::assign::map_list_of
 (ToggleUI, GamepadKey::None)
@@ -273,4 +194,5 @@ static const std::map<Action, GamepadKey> DefaultGamepadMap = boost::assign::map
 (Visuals_IncFocusDist, GamepadKey::None)
 (Visuals_DecFocusDist, GamepadKey::None)
 (ToggleInvisibility, GamepadKey::None)
-(FreezeCharacters, GamepadKey::None);
\ No newline at end of file
+(FreezeCharacters, GamepadKey::None)
+(TogglePerfOverlay, GamepadKey::None);
\ No newline at end of file
@@ -0,0 +1,88 @@
+#pragma once
+
+// Kept free of Windows headers so the action pipeline builds anywhere
+
+enum Action
+{
+  ToggleUI,
+
+  ToggleCamera,
+  ToggleHUD,
+  ToggleFreezeTime,
+
+  Camera_Forward,
+  Camera_Backward,
+  Camera_Left,
+  Camera_Right,
+  Camera_Up,
+  Camera_Down,
+
+  Camera_ForwardSecondary,
+  Camera_BackwardSecondary,
+  Camera_LeftSecondary,
+  Camera_RightSecondary,
+  Camera_UpSecondary,
+  Camera_DownSecondary,
+
+  Camera_PitchUp,
+  Camera_PitchDown,
+  Camera_YawLeft,
+  Camera_YawRight,
+  Camera_RollLeft,
+  Camera_RollRight,
+
+  Camera_IncFov,
+  Camera_DecFov,
+
+  Track_CreateNode,
+  Track_DeleteNode,
+  Track_Play,
+
+  Object_PickUp,
+  Object_Rotate,
+  Object_Remove,
+
+  Visuals_IncDofScale,
+  Visuals_DecDofScale,
+  Visuals_IncDofStrength,
+  Visuals_DecDofStrength,
+  Visuals_IncFocusDist,
+  Visuals_DecFocusDist,
+
+  ToggleInvisibility,
+  FreezeCharacters,
+
+  TogglePerfOverlay,
+
+  ActionCount
+};
+
+enum GamepadKey
+{
+  None,
+  LeftThumb_XPos,
+  LeftThumb_XNeg,
+  LeftThumb_YPos,
+  LeftThumb_YNeg,
+  RightThumb_XPos,
+  RightThumb_XNeg,
+  RightThumb_YPos,
+  RightThumb_YNeg,
+  LeftTrigger,
+  RightTrigger,
+  LeftThumb,
+  RightThumb,
+  LeftShoulder,
+  RightShoulder,
+  DPad_Left,
+  DPad_Right,
+  DPad_Up,
+  DPad_Down,
+  Button1,
+  Button2,
+  Button3,
+  Button4,
+  Button5,
+  Button6,
+  GamepadKey_Count
+};
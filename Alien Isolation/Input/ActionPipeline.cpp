@@ -0,0 +1,167 @@
+#include "ActionPipeline.h"
+#include <algorithm>
+#include <cmath>
+
+// How long it takes for state of action to go from 1 to 0
+static const float g_actionClearTime = 0.2f;
+// Held actions produce a Repeat event after the delay and then on every interval
+static const float g_actionRepeatDelay = 0.5f;
+static const float g_actionRepeatInterval = 0.1f;
+
+static void ShapeStick(float x, float y, AxisResponse const* pResponses, float* pPadKeyStates,
+  GamepadKey xPos, GamepadKey xNeg, GamepadKey yPos, GamepadKey yNeg)
+{
+  // Deadzone is radial, so the curve is applied to how far the stick
+  // is pushed and then split into the axes by direction.
+  float magnitude = sqrtf(x * x + y * y);
+  if (magnitude <= 0.f)
+    return;
+
+  float dirX = x / magnitude;
+  float dirY = y / magnitude;
+  magnitude = (std::min)(magnitude, 1.f);
+
+  if (dirX > 0)
+    pPadKeyStates[xPos] = dirX * pResponses[xPos].Apply(magnitude);
+  else
+    pPadKeyStates[xNeg] = -dirX * pResponses[xNeg].Apply(magnitude);
+
+  if (dirY > 0)
+    pPadKeyStates[yPos] = dirY * pResponses[yPos].Apply(magnitude);
+  else
+    pPadKeyStates[yNeg] = -dirY * pResponses[yNeg].Apply(magnitude);
+}
+
+ActionPipeline::ActionPipeline() :
+  m_WantedStates(),
+  m_SmoothStates(),
+  m_RepeatTimers()
+{
+  m_Events.reserve(Action::ActionCount);
+}
+
+void ActionPipeline::ShapeGamepad(GamepadState const& state, AxisResponse const* pResponses, float* pPadKeyStates)
+{
+  ShapeStick(state.LeftX, state.LeftY, pResponses, pPadKeyStates,
+    GamepadKey::LeftThumb_XPos, GamepadKey::LeftThumb_XNeg, GamepadKey::LeftThumb_YPos, GamepadKey::LeftThumb_YNeg);
+  ShapeStick(state.RightX, state.RightY, pResponses, pPadKeyStates,
+    GamepadKey::RightThumb_XPos, GamepadKey::RightThumb_XNeg, GamepadKey::RightThumb_YPos, GamepadKey::RightThumb_YNeg);
+
+  // Triggers cancel each other out
+  if (state.Triggers > 0)
+    pPadKeyStates[GamepadKey::RightTrigger] = pResponses[GamepadKey::RightTrigger].Apply(state.Triggers);
+  else
+    pPadKeyStates[GamepadKey::LeftTrigger] = pResponses[GamepadKey::LeftTrigger].Apply(-state.Triggers);
+
+  for (int i = GamepadKey::LeftThumb; i < GamepadKey::GamepadKey_Count; ++i)
+    pPadKeyStates[i] = state.IsButtonDown(static_cast<GamepadKey>(i)) ? 1.0f : 0.f;
+}
+
+void ActionPipeline::ReadKeyboard(InputBackend& backend, KeyMask const& usedKeys, uint32_t const* pLatched, KeyMask& down)
+{
+  // Only the keys some binding uses are polled
+  for (int word = 0; word < 8; ++word)
+  {
+    uint32_t keys = usedKeys.Words[word];
+    down.Words[word] |= keys & pLatched[word];
+
+    for (keys &= ~pLatched[word]; keys; keys &= keys - 1)
+    {
+      int bit = 0;
+      while (!(keys & (1u << bit)))
+        ++bit;
+
+      int vkey = (word << 5) | bit;
+      if (backend.IsKeyDown(vkey))
+        down.Set(vkey);
+    }
+  }
+}
+
+void ActionPipeline::AddPadKeys(float const* pPadKeyStates, KeyMask& down)
+{
+  for (int i = GamepadKey::None + 1; i < GamepadKey::GamepadKey_Count; ++i)
+  {
+    if (pPadKeyStates[i] > 0.5f)
+      down.Set(KeyMask::PadKeyBase + i);
+  }
+}
+
+bool ActionPipeline::Update(float dt, BindingTable const& bindings, KeyMask const& down, GamepadKey const* pPadBindings, float const* pPadKeyStates)
+{
+  std::array<float, Action::ActionCount> newWantedStates{ 0 };
+  bindings.Evaluate(down, newWantedStates.data());
+
+  // Gamepad bindings from [GamepadMap] stay analog
+  if (pPadBindings && pPadKeyStates)
+  {
+    for (int i = 0; i < Action::ActionCount; ++i)
+      newWantedStates[i] += pPadKeyStates[pPadBindings[i]];
+  }
+
+  PushEvents(newWantedStates, dt);
+
+  // Copy new values and perform smoothing
+  m_WantedStates = newWantedStates;
+  bool isActive = false;
+  for (int i = 0; i < Action::ActionCount; ++i)
+  {
+    float& currentState = m_SmoothStates[i];
+    float& wantedState = m_WantedStates[i];
+
+    if (currentState != wantedState)
+    {
+      if (wantedState > 0)
+      {
+        currentState += dt / g_actionClearTime;
+        if (currentState > wantedState)
+          currentState = wantedState;
+      }
+      else
+      {
+        currentState -= dt / g_actionClearTime;
+        if (currentState < 0)
+          currentState = 0;
+      }
+    }
+
+    isActive |= (wantedState != 0.f || currentState != 0.f);
+  }
+
+  return isActive;
+}
+
+void ActionPipeline::PushEvents(std::array<float, Action::ActionCount> const& newWantedStates, float dt)
+{
+  // Compares new action states to the previous update and
+  // records an event for every edge.
+  m_Events.clear();
+
+  for (int i = 0; i < Action::ActionCount; ++i)
+  {
+    bool isDown = newWantedStates[i] != 0.f;
+    bool wasDown = m_WantedStates[i] != 0.f;
+
+    ActionEvent actionEvent{ static_cast<Action>(i), ActionEventType::Pressed };
+    if (isDown && !wasDown)
+    {
+      actionEvent.Type = ActionEventType::Pressed;
+      m_RepeatTimers[i] = g_actionRepeatDelay;
+    }
+    else if (!isDown && wasDown)
+      actionEvent.Type = ActionEventType::Released;
+    else if (isDown)
+    {
+      m_RepeatTimers[i] -= dt;
+      if (m_RepeatTimers[i] > 0)
+        continue;
+
+      m_RepeatTimers[i] += g_actionRepeatInterval;
+      actionEvent.Type = ActionEventType::Repeat;
+    }
+    else
+      continue;
+
+    m_Events.push_back(actionEvent);
+  }
+}
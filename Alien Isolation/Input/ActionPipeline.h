@@ -0,0 +1,63 @@
+#pragma once
+#include "ActionIds.h"
+#include "AxisResponse.h"
+#include "BindingTable.h"
+#include "InputBackend.h"
+
+#include <array>
+#include <vector>
+
+enum class ActionEventType
+{
+  Pressed,
+  Released,
+  Repeat
+};
+
+struct ActionEvent
+{
+  Action ActionId;
+  ActionEventType Type;
+};
+
+// Device independent part of the action update: matching bindings,
+// producing Pressed/Released/Repeat edges and smoothing the action
+// states. InputSystem feeds it from Win32InputBackend, but it runs
+// just as well on a VirtualInputBackend without a game or window,
+// which is how Tests/ checks it on Linux.
+class ActionPipeline
+{
+public:
+  ActionPipeline();
+
+  // Turns raw gamepad values into per GamepadKey states using the
+  // response curve of each key, pPadKeyStates has to start zeroed
+  static void ShapeGamepad(GamepadState const& state, AxisResponse const* pResponses, float* pPadKeyStates);
+
+  // Sets every key of usedKeys that's down on the backend or in
+  // pLatched, which holds 256 bits of keys pressed since the last tick
+  static void ReadKeyboard(InputBackend& backend, KeyMask const& usedKeys, uint32_t const* pLatched, KeyMask& down);
+
+  // Adds the pad keys pushed past halfway to down
+  static void AddPadKeys(float const* pPadKeyStates, KeyMask& down);
+
+  // Runs one tick. pPadBindings and pPadKeyStates may be null when the
+  // gamepad isn't used. Returns true while any action is held or still
+  // fading out.
+  bool Update(float dt, BindingTable const& bindings, KeyMask const& down, GamepadKey const* pPadBindings, float const* pPadKeyStates);
+
+  // Edges produced by the last Update()
+  std::vector<ActionEvent> const& GetEvents() const { return m_Events; }
+
+  std::array<float, Action::ActionCount> const& GetWantedStates() const { return m_WantedStates; }
+  std::array<float, Action::ActionCount> const& GetSmoothStates() const { return m_SmoothStates; }
+
+private:
+  void PushEvents(std::array<float, Action::ActionCount> const& newWantedStates, float dt);
+
+private:
+  std::array<float, Action::ActionCount> m_WantedStates;
+  std::array<float, Action::ActionCount> m_SmoothStates;
+  std::array<float, Action::ActionCount> m_RepeatTimers;
+  std::vector<ActionEvent> m_Events;
+};
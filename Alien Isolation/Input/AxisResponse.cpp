@@ -0,0 +1,65 @@
+#include "AxisResponse.h"
+#include <algorithm>
+#include <cmath>
+
+bool AxisResponseSettings::operator==(AxisResponseSettings const& other) const
+{
+  return Deadzone == other.Deadzone &&
+    AntiDeadzone == other.AntiDeadzone &&
+    Exponent == other.Exponent &&
+    SCurve == other.SCurve &&
+    Sensitivity == other.Sensitivity;
+}
+
+AxisResponse::AxisResponse()
+{
+  Build(AxisResponseSettings());
+}
+
+AxisResponse::AxisResponse(AxisResponseSettings const& settings)
+{
+  Build(settings);
+}
+
+void AxisResponse::Build(AxisResponseSettings const& settings)
+{
+  // Keep the values in a range where the curve stays well behaved,
+  // the config file is hand edited.
+  m_Settings = settings;
+  m_Settings.Deadzone = (std::min)((std::max)(m_Settings.Deadzone, 0.f), 0.99f);
+  m_Settings.AntiDeadzone = (std::min)((std::max)(m_Settings.AntiDeadzone, 0.f), 1.f);
+  m_Settings.Exponent = (std::min)((std::max)(m_Settings.Exponent, 0.1f), 10.f);
+  m_Settings.SCurve = (std::min)((std::max)(m_Settings.SCurve, 0.f), 1.f);
+
+  float range = 1.f - m_Settings.Deadzone;
+  m_Scale = SegmentCount / range;
+  m_UseTable = m_Settings.Exponent >= 1.f;
+
+  for (int i = 0; i <= SegmentCount; ++i)
+  {
+    float input = m_Settings.Deadzone + range * i / SegmentCount;
+    m_Table[i] = Evaluate(m_Settings, input);
+  }
+
+  // Anything just outside the deadzone should already give
+  // the anti-deadzone output, not a ramp up to it.
+  m_Table[0] = m_Settings.AntiDeadzone * m_Settings.Sensitivity;
+}
+
+float AxisResponse::Evaluate(AxisResponseSettings const& settings, float input)
+{
+  // Written so NaN counts as inside the deadzone, like in Apply()
+  if (!(input > settings.Deadzone))
+    return 0.f;
+
+  // Rescale what's left after the deadzone to 0 - 1
+  float t = (std::min)((input - settings.Deadzone) / (1.f - settings.Deadzone), 1.f);
+
+  t = powf(t, settings.Exponent);
+  // Blended as a lerp, t + (s - t) * SCurve cancels out near zero and
+  // makes the curve jitter right outside the deadzone
+  t = t * (1.f - settings.SCurve) + t * t * (3.f - 2.f * t) * settings.SCurve;
+  t = settings.AntiDeadzone + (1.f - settings.AntiDeadzone) * t;
+
+  return t * settings.Sensitivity;
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <array>
+
+// Shaping applied to an analog input, all values are relative to
+// the full range of the input (0 - 1).
+struct AxisResponseSettings
+{
+  // Inputs below this are ignored, the rest is rescaled to 0 - 1
+  float Deadzone{ 0.f };
+  // Smallest output once the input leaves the deadzone, cancels out
+  // the game's own deadzone when it's stacked on top of ours
+  float AntiDeadzone{ 0.f };
+  // Response curve, 1 is linear and higher values give finer control
+  // near the center
+  float Exponent{ 1.f };
+  // Blends the curve towards a smoothstep, 0 - 1
+  float SCurve{ 0.f };
+  // Final multiplier
+  float Sensitivity{ 1.f };
+
+  bool operator==(AxisResponseSettings const& other) const;
+  bool operator!=(AxisResponseSettings const& other) const { return !(*this == other); }
+};
+
+// Response curve baked into a small lookup table, so shaping an input
+// is a single table read with linear interpolation. The table only
+// covers the range outside the deadzone, so the edge of the deadzone
+// (and the anti-deadzone step there) stays exact.
+//
+// Exponents below 1 make the curve vertical at the deadzone edge, which
+// no table of this size follows, so those are evaluated directly.
+class AxisResponse
+{
+public:
+  static const int SegmentCount = 64;
+
+  AxisResponse();
+  explicit AxisResponse(AxisResponseSettings const& settings);
+
+  void Build(AxisResponseSettings const& settings);
+  AxisResponseSettings const& GetSettings() const { return m_Settings; }
+
+  // Evaluates the curve directly without the table
+  static float Evaluate(AxisResponseSettings const& settings, float input);
+
+  // Input is clamped to 0 - 1
+  float Apply(float input) const
+  {
+    if (!m_UseTable)
+      return Evaluate(m_Settings, input);
+    if (!(input > m_Settings.Deadzone))
+      return 0.f;
+    if (input >= 1.f)
+      return m_Table[SegmentCount];
+
+    float position = (input - m_Settings.Deadzone) * m_Scale;
+    int index = static_cast<int>(position);
+    if (index >= SegmentCount)
+      return m_Table[SegmentCount];
+
+    float fraction = position - index;
+    return m_Table[index] + (m_Table[index + 1] - m_Table[index]) * fraction;
+  }
+
+private:
+  AxisResponseSettings m_Settings;
+  // SegmentCount / (1 - Deadzone)
+  float m_Scale;
+  bool m_UseTable;
+  std::array<float, SegmentCount + 1> m_Table;
+};
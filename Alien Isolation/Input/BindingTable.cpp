@@ -0,0 +1,160 @@
+#include "BindingTable.h"
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define BINDINGTABLE_SSE2
+#endif
+
+static_assert(KeyMask::WordCount % 4 == 0, "KeyMask has to be a whole number of 128-bit lanes");
+
+bool KeyMask::IsEmpty() const
+{
+  for (uint32_t word : Words)
+  {
+    if (word)
+      return false;
+  }
+  return true;
+}
+
+int KeyMask::Count() const
+{
+  int count = 0;
+  for (uint32_t word : Words)
+  {
+    for (; word; word &= word - 1)
+      ++count;
+  }
+  return count;
+}
+
+bool KeyMask::IsSubsetOf(KeyMask const& other) const
+{
+  for (int i = 0; i < WordCount; ++i)
+  {
+    if ((Words[i] & other.Words[i]) != Words[i])
+      return false;
+  }
+  return true;
+}
+
+KeyMask& KeyMask::operator|=(KeyMask const& other)
+{
+  for (int i = 0; i < WordCount; ++i)
+    Words[i] |= other.Words[i];
+  return *this;
+}
+
+BindingTable::BindingTable(int actionCount) :
+  m_ActionCount(actionCount),
+  m_BindingCounts(actionCount, 0)
+{
+}
+
+bool BindingTable::Add(int action, KeyMask const& keys)
+{
+  if (keys.IsEmpty() || m_BindingCounts[action] >= MaxBindingsPerAction)
+    return false;
+
+  // Same binding twice on one action doesn't do anything
+  for (size_t i = 0; i < m_Masks.size(); ++i)
+  {
+    if (m_Actions[i] == action && m_Masks[i] == keys)
+      return true;
+  }
+
+  m_Masks.push_back(keys);
+  m_Actions.push_back(action);
+  m_BindingCounts[action] += 1;
+  m_UsedKeys |= keys;
+  return true;
+}
+
+std::vector<BindingConflict> BindingTable::Finalize()
+{
+  std::vector<BindingConflict> conflicts;
+  size_t count = m_Masks.size();
+
+  m_SupersetStart.assign(1, 0);
+  m_Supersets.clear();
+  m_Matched.assign(count, 0);
+
+  for (size_t i = 0; i < count; ++i)
+  {
+    for (size_t j = 0; j < count; ++j)
+    {
+      if (i == j || m_Actions[i] == m_Actions[j])
+        continue;
+
+      if (m_Masks[i] == m_Masks[j])
+      {
+        // Report each pair once
+        if (i < j)
+          conflicts.push_back({ m_Actions[i], m_Actions[j], m_Masks[i] });
+      }
+      else if (m_Masks[i].IsSubsetOf(m_Masks[j]))
+        m_Supersets.push_back(static_cast<int>(j));
+    }
+    m_SupersetStart.push_back(static_cast<int>(m_Supersets.size()));
+  }
+
+  return conflicts;
+}
+
+void BindingTable::Evaluate(KeyMask const& down, float* actionStates) const
+{
+  size_t count = m_Masks.size();
+  if (count == 0)
+    return;
+
+  // A binding matches when (mask & down) == mask
+#ifdef BINDINGTABLE_SSE2
+  __m128i down0 = _mm_load_si128(reinterpret_cast<__m128i const*>(&down.Words[0]));
+  __m128i down1 = _mm_load_si128(reinterpret_cast<__m128i const*>(&down.Words[4]));
+  __m128i down2 = _mm_load_si128(reinterpret_cast<__m128i const*>(&down.Words[8]));
+
+  for (size_t i = 0; i < count; ++i)
+  {
+    // Vector storage isn't guaranteed to be 16 byte aligned on x86
+    __m128i const* pMask = reinterpret_cast<__m128i const*>(m_Masks[i].Words.data());
+    __m128i mask0 = _mm_loadu_si128(pMask);
+    __m128i mask1 = _mm_loadu_si128(pMask + 1);
+    __m128i mask2 = _mm_loadu_si128(pMask + 2);
+
+    __m128i eq = _mm_and_si128(
+      _mm_and_si128(
+        _mm_cmpeq_epi32(_mm_and_si128(mask0, down0), mask0),
+        _mm_cmpeq_epi32(_mm_and_si128(mask1, down1), mask1)),
+      _mm_cmpeq_epi32(_mm_and_si128(mask2, down2), mask2));
+
+    m_Matched[i] = _mm_movemask_epi8(eq) == 0xFFFF;
+  }
+#else
+  for (size_t i = 0; i < count; ++i)
+  {
+    uint32_t missing = 0;
+    for (int w = 0; w < KeyMask::WordCount; ++w)
+      missing |= m_Masks[i].Words[w] & ~down.Words[w];
+    m_Matched[i] = missing == 0;
+  }
+#endif
+
+  for (size_t i = 0; i < count; ++i)
+  {
+    if (!m_Matched[i])
+      continue;
+
+    bool suppressed = false;
+    for (int s = m_SupersetStart[i]; s < m_SupersetStart[i + 1]; ++s)
+    {
+      if (m_Matched[m_Supersets[s]])
+      {
+        suppressed = true;
+        break;
+      }
+    }
+
+    if (!suppressed)
+      actionStates[m_Actions[i]] = 1.0f;
+  }
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// Set of key codes. Codes 0 - 255 are virtual keys and
+// PadKeyBase + GamepadKey are gamepad keys.
+struct KeyMask
+{
+  static const int PadKeyBase = 256;
+  static const int KeyCodeCount = 384;
+  static const int WordCount = KeyCodeCount / 32;
+
+  alignas(16) std::array<uint32_t, WordCount> Words{};
+
+  void Set(int code) { Words[code >> 5] |= (1u << (code & 31)); }
+  bool Test(int code) const { return (Words[code >> 5] & (1u << (code & 31))) != 0; }
+  bool IsEmpty() const;
+  int Count() const;
+
+  // True if every key in this mask is also in `other`
+  bool IsSubsetOf(KeyMask const& other) const;
+  bool operator==(KeyMask const& other) const { return Words == other.Words; }
+
+  KeyMask& operator|=(KeyMask const& other);
+};
+
+// Two actions bound to the exact same set of keys
+struct BindingConflict
+{
+  int ActionA;
+  int ActionB;
+  KeyMask Keys;
+};
+
+// All key bindings of all actions in one flat table. Every binding is a
+// mask of keys that all have to be down, and an action can have up to
+// MaxBindingsPerAction of them.
+//
+// Evaluate() matches every binding against the keys that are down with
+// one AND/compare sweep. A binding whose keys are a strict subset of
+// another action's matched binding is suppressed, so holding
+// Ctrl + W doesn't also trigger an action bound to plain W. The subset
+// relations are worked out once in Finalize().
+class BindingTable
+{
+public:
+  static const int MaxBindingsPerAction = 4;
+
+  explicit BindingTable(int actionCount);
+
+  // Returns false if the action already has MaxBindingsPerAction
+  // bindings or the mask is empty
+  bool Add(int action, KeyMask const& keys);
+
+  // Call after the last Add(), returns bindings shared by two actions
+  std::vector<BindingConflict> Finalize();
+
+  // Every key used by any binding, so only those need to be polled
+  KeyMask const& GetUsedKeys() const { return m_UsedKeys; }
+
+  // Sets actionStates[action] to 1 for every action with a matched
+  // binding and leaves the others untouched
+  void Evaluate(KeyMask const& down, float* actionStates) const;
+
+  int GetBindingCount(int action) const { return m_BindingCounts[action]; }
+
+private:
+  int m_ActionCount;
+  std::vector<KeyMask> m_Masks;
+  std::vector<int> m_Actions;
+  std::vector<int> m_BindingCounts;
+  KeyMask m_UsedKeys;
+
+  // Bindings that suppress binding i are
+  // m_Supersets[m_SupersetStart[i]] .. m_Supersets[m_SupersetStart[i + 1] - 1]
+  std::vector<int> m_SupersetStart;
+  std::vector<int> m_Supersets;
+
+  // Scratch space for Evaluate, sized in Finalize()
+  mutable std::vector<uint8_t> m_Matched;
+};
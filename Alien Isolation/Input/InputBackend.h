@@ -0,0 +1,47 @@
+#pragma once
+#include "ActionIds.h"
+#include <cstdint>
+
+// Raw gamepad state as read from the device
+struct GamepadState
+{
+  // Sticks are -1 - 1, right and up are positive
+  float LeftX{ 0 };
+  float LeftY{ 0 };
+  float RightX{ 0 };
+  float RightY{ 0 };
+
+  // Right trigger minus left trigger, -1 - 1
+  float Triggers{ 0 };
+
+  // Digital buttons, bit n is GamepadKey n
+  uint32_t Buttons{ 0 };
+
+  void SetButton(GamepadKey key, bool isDown)
+  {
+    if (isDown)
+      Buttons |= (1u << key);
+    else
+      Buttons &= ~(1u << key);
+  }
+
+  bool IsButtonDown(GamepadKey key) const { return (Buttons & (1u << key)) != 0; }
+};
+
+// Device layer under the action pipeline. The game uses
+// Win32InputBackend, VirtualInputBackend plays back scripted
+// input without any devices for the tests in Tests/.
+class InputBackend
+{
+public:
+  virtual ~InputBackend() {}
+
+  virtual bool IsKeyDown(int vkey) = 0;
+
+  // Looks for a gamepad. With forcedId >= 0 only that
+  // controller slot is accepted.
+  virtual bool FindGamepad(int forcedId) = 0;
+
+  // Returns false once the gamepad has been lost
+  virtual bool PollGamepad(GamepadState& state) = 0;
+};
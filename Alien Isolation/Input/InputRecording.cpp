@@ -0,0 +1,244 @@
+#include "InputRecording.h"
+#include <cstring>
+
+namespace
+{
+  enum RecordType : uint8_t
+  {
+    Record_End = 0x00,
+    Record_Frame = 0x01,
+    Record_Repeat = 0x02
+  };
+
+  uint32_t ZigZag(int32_t value)
+  {
+    return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+  }
+
+  int32_t UnZigZag(uint32_t value)
+  {
+    return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+  }
+}
+
+InputRecordWriter::InputRecordWriter() :
+  m_PrevDt(0),
+  m_FrameCount(0),
+  m_HasFrame(false)
+{
+}
+
+void InputRecordWriter::Begin(uint16_t valueCount)
+{
+  m_Data.clear();
+  m_RepeatDeltas.clear();
+  m_Values.assign(valueCount, 0);
+  m_PrevDt = 0;
+  m_FrameCount = 0;
+  m_HasFrame = false;
+
+  m_Data.insert(m_Data.end(), { 'C', 'T', 'I', 'R' });
+  m_Data.push_back(g_inputRecordVersion & 0xFF);
+  m_Data.push_back(g_inputRecordVersion >> 8);
+  m_Data.push_back(valueCount & 0xFF);
+  m_Data.push_back(valueCount >> 8);
+  WriteU32(0); // Frame count, filled in by Finish()
+  WriteU32(0);
+}
+
+void InputRecordWriter::AddFrame(uint32_t dtMicros, uint32_t const* pValues)
+{
+  int32_t dtDelta = static_cast<int32_t>(dtMicros - m_PrevDt);
+  m_PrevDt = dtMicros;
+  m_FrameCount += 1;
+
+  uint32_t changes = 0;
+  for (size_t i = 0; i < m_Values.size(); ++i)
+    changes += (m_Values[i] != pValues[i]);
+
+  // The first frame is always written in full so a reader
+  // doesn't have to assume anything about the initial state.
+  if (changes == 0 && m_HasFrame)
+  {
+    m_RepeatDeltas.push_back(dtDelta);
+    return;
+  }
+
+  FlushRepeats();
+
+  m_Data.push_back(Record_Frame);
+  WriteVarint(ZigZag(dtDelta));
+  WriteVarint(changes);
+
+  int lastIndex = -1;
+  for (size_t i = 0; i < m_Values.size(); ++i)
+  {
+    if (m_Values[i] == pValues[i])
+      continue;
+
+    WriteVarint(static_cast<uint32_t>(i - lastIndex - 1));
+    WriteU32(pValues[i]);
+    m_Values[i] = pValues[i];
+    lastIndex = static_cast<int>(i);
+  }
+
+  m_HasFrame = true;
+}
+
+std::vector<uint8_t> const& InputRecordWriter::Finish()
+{
+  FlushRepeats();
+  m_Data.push_back(Record_End);
+
+  if (m_Data.size() >= g_inputRecordHeaderSize)
+  {
+    for (int i = 0; i < 4; ++i)
+      m_Data[8 + i] = static_cast<uint8_t>(m_FrameCount >> (i * 8));
+  }
+
+  return m_Data;
+}
+
+void InputRecordWriter::FlushRepeats()
+{
+  if (m_RepeatDeltas.empty())
+    return;
+
+  m_Data.push_back(Record_Repeat);
+  WriteVarint(static_cast<uint32_t>(m_RepeatDeltas.size()));
+  for (int32_t delta : m_RepeatDeltas)
+    WriteVarint(ZigZag(delta));
+
+  m_RepeatDeltas.clear();
+}
+
+void InputRecordWriter::WriteVarint(uint32_t value)
+{
+  while (value >= 0x80)
+  {
+    m_Data.push_back(static_cast<uint8_t>(value | 0x80));
+    value >>= 7;
+  }
+  m_Data.push_back(static_cast<uint8_t>(value));
+}
+
+void InputRecordWriter::WriteU32(uint32_t value)
+{
+  for (int i = 0; i < 4; ++i)
+    m_Data.push_back(static_cast<uint8_t>(value >> (i * 8)));
+}
+
+InputRecordReader::InputRecordReader() :
+  m_Position(0),
+  m_RepeatsLeft(0),
+  m_PrevDt(0),
+  m_FrameCount(0),
+  m_FramesRead(0)
+{
+}
+
+bool InputRecordReader::Open(std::vector<uint8_t> data, uint16_t valueCount)
+{
+  m_Data = std::move(data);
+  m_Position = 0;
+  m_RepeatsLeft = 0;
+  m_PrevDt = 0;
+  m_FrameCount = 0;
+  m_FramesRead = 0;
+  m_Values.assign(valueCount, 0);
+
+  if (m_Data.size() < g_inputRecordHeaderSize || memcmp(m_Data.data(), "CTIR", 4) != 0)
+    return false;
+
+  uint16_t version = m_Data[4] | (m_Data[5] << 8);
+  uint16_t count = m_Data[6] | (m_Data[7] << 8);
+  if (version != g_inputRecordVersion || count != valueCount)
+    return false;
+
+  m_Position = 8;
+  ReadU32(m_FrameCount);
+  m_Position = g_inputRecordHeaderSize;
+  return true;
+}
+
+bool InputRecordReader::NextFrame(uint32_t& dtMicros, uint32_t* pValues)
+{
+  uint32_t dtCode = 0;
+
+  if (m_RepeatsLeft == 0)
+  {
+    if (m_Position >= m_Data.size())
+      return false;
+
+    uint8_t type = m_Data[m_Position++];
+    if (type == Record_Repeat)
+    {
+      if (!ReadVarint(m_RepeatsLeft) || m_RepeatsLeft == 0)
+        return false;
+    }
+    else if (type == Record_Frame)
+    {
+      uint32_t changes = 0;
+      if (!ReadVarint(dtCode) || !ReadVarint(changes))
+        return false;
+
+      size_t index = static_cast<size_t>(-1);
+      for (uint32_t i = 0; i < changes; ++i)
+      {
+        uint32_t gap = 0;
+        uint32_t value = 0;
+        if (!ReadVarint(gap) || !ReadU32(value))
+          return false;
+
+        index += static_cast<size_t>(gap) + 1;
+        if (index >= m_Values.size())
+          return false;
+        m_Values[index] = value;
+      }
+    }
+    else
+      return false;
+  }
+
+  if (m_RepeatsLeft > 0)
+  {
+    if (!ReadVarint(dtCode))
+      return false;
+    m_RepeatsLeft -= 1;
+  }
+
+  m_PrevDt += static_cast<uint32_t>(UnZigZag(dtCode));
+  dtMicros = m_PrevDt;
+  if (!m_Values.empty())
+    memcpy(pValues, m_Values.data(), m_Values.size() * sizeof(uint32_t));
+
+  m_FramesRead += 1;
+  return true;
+}
+
+bool InputRecordReader::ReadVarint(uint32_t& value)
+{
+  value = 0;
+  for (int shift = 0; shift < 35; shift += 7)
+  {
+    if (m_Position >= m_Data.size())
+      return false;
+
+    uint8_t byte = m_Data[m_Position++];
+    value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+    if (!(byte & 0x80))
+      return true;
+  }
+  return false;
+}
+
+bool InputRecordReader::ReadU32(uint32_t& value)
+{
+  if (m_Position + 4 > m_Data.size())
+    return false;
+
+  value = 0;
+  for (int i = 0; i < 4; ++i)
+    value |= static_cast<uint32_t>(m_Data[m_Position++]) << (i * 8);
+  return true;
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+static const uint16_t g_inputRecordVersion = 1;
+static const size_t g_inputRecordHeaderSize = 16;
+
+// Compact binary log of per-frame input.
+//
+// A frame is a frame time in microseconds and a fixed number of 32-bit
+// values. Frames are stored as the values that changed since the
+// previous frame, and a run of frames where nothing changed is stored
+// as one repeat record holding only the frame times. All numbers except
+// the changed values are variable length, so an idle frame costs about
+// one byte.
+//
+// Layout
+//   Header   "CTIR", uint16 version, uint16 value count, uint32 frame count, uint32 reserved
+//   0x01     Frame: zigzag dt delta, change count, then (index gap, uint32 value) pairs
+//   0x02     Repeat: frame count, then one zigzag dt delta per frame
+//   0x00     End
+class InputRecordWriter
+{
+public:
+  InputRecordWriter();
+
+  void Begin(uint16_t valueCount);
+  void AddFrame(uint32_t dtMicros, uint32_t const* pValues);
+
+  // Closes the log and returns the encoded data
+  std::vector<uint8_t> const& Finish();
+
+  uint32_t GetFrameCount() const { return m_FrameCount; }
+  size_t GetSize() const { return m_Data.size(); }
+
+private:
+  void FlushRepeats();
+  void WriteVarint(uint32_t value);
+  void WriteU32(uint32_t value);
+
+private:
+  std::vector<uint8_t> m_Data;
+  std::vector<uint32_t> m_Values;
+  std::vector<int32_t> m_RepeatDeltas;
+  uint32_t m_PrevDt;
+  uint32_t m_FrameCount;
+  bool m_HasFrame;
+};
+
+class InputRecordReader
+{
+public:
+  InputRecordReader();
+
+  // Returns false if the data isn't a log or has the wrong value count
+  bool Open(std::vector<uint8_t> data, uint16_t valueCount);
+
+  // Returns false at the end of the log or if it's corrupted,
+  // pValues has to hold the value count given to Open()
+  bool NextFrame(uint32_t& dtMicros, uint32_t* pValues);
+
+  uint32_t GetFrameCount() const { return m_FrameCount; }
+  uint32_t GetFramesRead() const { return m_FramesRead; }
+
+private:
+  bool ReadVarint(uint32_t& value);
+  bool ReadU32(uint32_t& value);
+
+private:
+  std::vector<uint8_t> m_Data;
+  size_t m_Position;
+  std::vector<uint32_t> m_Values;
+  uint32_t m_RepeatsLeft;
+  uint32_t m_PrevDt;
+  uint32_t m_FrameCount;
+  uint32_t m_FramesRead;
+};
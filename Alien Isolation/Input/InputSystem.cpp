@@ -1,52 +1,181 @@
 #include "InputSystem.h"
+#include "Win32InputBackend.h"
 #include "../Main.h"
 #include "../Util/Util.h"
 #include "../Util/ImGuiEXT.h"
+#include <algorithm>
 #include <boost/chrono.hpp>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
 #include <thread>
 
-#pragma comment(lib, "dinput8.lib")
-#pragma comment(lib, "dxguid.lib")
-#pragma comment(lib, "XInput9_1_0.lib")
-
-// How long it takes for state of action to go from 1 to 0
-static const float g_actionClearTime = 0.2f;
 static const float g_mouseSensitivity = 1.0f;
 
+// Input thread timers. Actions are polled every g_actionUpdateMs while
+// something is held or a gamepad is connected, otherwise the thread
+// sleeps until WndProc wakes it up.
+enum InputTimer
+{
+  InputTimer_ActionUpdate,
+  InputTimer_ControllerScan
+};
+
+// Recorded frame layout: mouse xyz, wanted and smooth action states
+// and gamepad key states, all as raw float bits, then the hotkey edges
+// dispatched since the previous frame as one action bitmask per
+// ActionEventType, and last the RecordFlags
+static const int g_recordMouseOffset = 0;
+static const int g_recordWantedOffset = 3;
+static const int g_recordSmoothOffset = g_recordWantedOffset + Action::ActionCount;
+static const int g_recordPadOffset = g_recordSmoothOffset + Action::ActionCount;
+static const int g_recordEventOffset = g_recordPadOffset + GamepadKey::GamepadKey_Count;
+static const int g_recordEventWords = (Action::ActionCount + 31) / 32;
+static const int g_recordFlagsOffset = g_recordEventOffset + 3 * g_recordEventWords;
+static const int g_recordValueCount = g_recordFlagsOffset + 1;
+
+enum RecordFlags : uint32_t
+{
+  RecordFlag_MouseLook = 1 << 0
+};
+
+// Replayed in this order, so a press and release within one frame
+// comes back as a press followed by a release
+static const ActionEventType g_replayOrder[] = { ActionEventType::Pressed, ActionEventType::Repeat, ActionEventType::Released };
+
+static const char* g_recordingDir = "./Cinematic Tools/Recordings/";
+
+// Recording names become file names inside g_recordingDir, so they can't
+// have separators or characters Windows doesn't allow in a file name
+static bool IsValidRecordingName(std::string const& name)
+{
+  // Windows drops a trailing dot or space from file names
+  if (name.empty() || name.back() == '.' || name.back() == ' ')
+    return false;
+
+  for (char c : name)
+  {
+    if (static_cast<unsigned char>(c) < 0x20 || strchr("/\\:*?\"<>|", c))
+      return false;
+  }
+  return true;
+}
+
+static uint32_t FloatBits(float value)
+{
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+static float BitsFloat(uint32_t bits)
+{
+  float value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+static const unsigned int g_timerTickMs = 5;
+static const unsigned int g_actionUpdateMs = 10;
+static const unsigned int g_minScanBackoffMs = 1000;
+static const unsigned int g_maxScanBackoffMs = 30000;
+
+static bool IsAnalogKey(GamepadKey key)
+{
+  return key >= GamepadKey::LeftThumb_XPos && key <= GamepadKey::RightTrigger;
+}
+
+// Defaults match the XInput recommended deadzones with a squared
+// curve on the sticks and a linear one on the triggers.
+static AxisResponseSettings DefaultAxisResponse(GamepadKey key)
+{
+  AxisResponseSettings settings;
+  if (key >= GamepadKey::LeftThumb_XPos && key <= GamepadKey::LeftThumb_YNeg)
+  {
+    settings.Deadzone = XINPUT_GAMEPAD_LEFT_THUMB_DEADZONE / 32767.f;
+    settings.Exponent = 2.f;
+  }
+  else if (key >= GamepadKey::RightThumb_XPos && key <= GamepadKey::RightThumb_YNeg)
+  {
+    settings.Deadzone = XINPUT_GAMEPAD_RIGHT_THUMB_DEADZONE / 32767.f;
+    settings.Exponent = 2.f;
+  }
+  else if (key == GamepadKey::LeftTrigger || key == GamepadKey::RightTrigger)
+    settings.Deadzone = (XINPUT_GAMEPAD_TRIGGER_THRESHOLD / 2) / 255.f;
+
+  return settings;
+}
+
 InputSystem::InputSystem() :
-  m_DInputInterface(NULL),
-  m_WantedActionStates(),
-  m_SmoothActionStates(),
+  m_GamepadPresent(false),
   m_GamepadKeyStates(),
-  m_MouseBuffer(),
+  m_Tick(0),
+  m_Snapshots(),
+  m_PublishedSnapshot(0),
+  m_RawInputArena(),
+  m_LastPresentTime(0),
+  m_MouseWindowEnd(0),
+  m_ResampleMouseToFrame(false),
+  m_MouseState(),
   m_KeyboardKeyNames(),
   m_ShowUI(false),
   m_SelectedID(0),
   m_ForceXInputID(false),
-  m_MouseSensitivity(0.5f)
+  m_MouseSensitivity(0.5f),
+  m_BindingTable(std::make_shared<BindingTable>(Action::ActionCount)),
+  m_RecordState(RecordState::Idle),
+  m_RecordRequest(RecordRequest::None),
+  m_FrameSnapshot(),
+  m_MouseLook(true),
+  m_RecordingName("take"),
+  m_RecordFrames(0),
+  m_RecordBytes(0),
+  m_PlaybackFrames(0),
+  m_RecordingNameInput("take"),
+  m_RequestedName("take"),
+  m_WakeSignal(NULL),
+  m_Timers(g_timerTickMs),
+  m_DeviceChanged(false),
+  m_ScanBackoffMs(g_minScanBackoffMs),
+  m_Wakeups(0),
+  m_WakeupsSampled(0),
+  m_WakeupsSampleTime(0),
+  m_WakeupsPerSecond(0)
 {
-
+  for (auto& word : m_KeyLatch)
+    word = 0;
+  for (auto& seq : m_SnapshotSeq)
+    seq = 0;
+  for (int i = 0; i < GamepadKey::GamepadKey_Count; ++i)
+    m_AxisResponses[i].Build(DefaultAxisResponse(static_cast<GamepadKey>(i)));
+
+  LARGE_INTEGER now;
+  QueryPerformanceCounter(&now);
+  m_MouseWindowEnd = now.QuadPart;
+
+  // Auto-reset, so every SetEvent wakes the input thread once
+  m_WakeSignal = CreateEvent(NULL, FALSE, FALSE, NULL);
 }
 
 InputSystem::~InputSystem()
 {
-  // Wait for threads to exit before destructing
-  m_ActionThread.join();
-  m_ControllerThread.join();
-  m_HotkeyThread.join();
+  // Wake up the input thread so it notices the shutdown
+  Wake();
 
-  if (m_DInputInterface)
-    m_DInputInterface->Release();
+  // Wait for the thread to exit before destructing
+  if (m_InputThread.joinable())
+    m_InputThread.join();
+
+  if (m_WakeSignal)
+    CloseHandle(m_WakeSignal);
 }
 
 void InputSystem::Initialize()
 {
-  HRESULT hr = DirectInput8Create(GetModuleHandle(NULL), DIRECTINPUT_VERSION, IID_IDirectInput8A, (LPVOID*)&m_DInputInterface, NULL);
-  if (FAILED(hr))
-  {
-    util::log::Error("Unable to create DirectInput interface. HRESULT 0x%X", hr);
-    util::log::Warning("DirectInput controllers unavailable");
-  }
+  std::unique_ptr<Win32InputBackend> pBackend(new Win32InputBackend());
+  pBackend->Initialize();
+  m_pBackend = std::move(pBackend);
 
   RAWINPUTDEVICE Rid;
   Rid.usUsagePage = 0x01;
@@ -57,27 +186,48 @@ void InputSystem::Initialize()
   if (RegisterRawInputDevices(&Rid, 1, sizeof(Rid)) == FALSE)
     util::log::Error("RegisterRawInputDevices failed");
 
-  m_ActionThread = std::thread(&InputSystem::ActionUpdate, this);
-  m_ControllerThread = std::thread(&InputSystem::ControllerUpdate, this);
-  m_HotkeyThread = std::thread(&InputSystem::HotkeyUpdate, this);
+  Subscribe(Action::ToggleUI, ActionEventType::Pressed, [] { g_mainHandle->GetUI()->Toggle(); });
+
+  m_InputThread = std::thread(&InputSystem::InputThread, this);
+}
+
+void InputSystem::Wake()
+{
+  if (m_WakeSignal)
+    SetEvent(m_WakeSignal);
+}
+
+void InputSystem::HandleDeviceChange()
+{
+  // WM_DEVICECHANGE, something was plugged in or out
+  m_DeviceChanged = true;
+  Wake();
 }
 
 void InputSystem::HandleRawInput(LPARAM lParam)
 {
-  UINT dwSize = 0;
-  GetRawInputData((HRAWINPUT)lParam, RID_INPUT, NULL, &dwSize, sizeof(RAWINPUTHEADER));
-  //printf("WM_INPUT 0x%X\n", dwSize);
+  // Only the mouse is registered, so a RAWINPUT is always big enough
+  // and there's no need to ask for the size first.
+  UINT dwSize = sizeof(m_RawInputArena);
+  if (GetRawInputData((HRAWINPUT)lParam, RID_INPUT, &m_RawInputArena, &dwSize, sizeof(RAWINPUTHEADER)) == (UINT)-1)
+    return;
 
-  BYTE* lpb = new BYTE[dwSize];
-  GetRawInputData((HRAWINPUT)lParam, RID_INPUT, lpb, &dwSize, sizeof(RAWINPUTHEADER));
+  if (m_RawInputArena.header.dwType != RIM_TYPEMOUSE)
+    return;
 
-  RAWINPUT* raw = (RAWINPUT*)lpb;
-  if (raw->header.dwType == RIM_TYPEMOUSE)
-  {
-    m_MouseBuffer.x += raw->data.mouse.lLastX;
-    m_MouseBuffer.y += raw->data.mouse.lLastY;
-    m_MouseBuffer.z += static_cast<short>(raw->data.mouse.usButtonData);
-  }
+  RAWMOUSE const& mouse = m_RawInputArena.data.mouse;
+  bool isRelative = !(mouse.usFlags & MOUSE_MOVE_ABSOLUTE);
+
+  LARGE_INTEGER timestamp;
+  QueryPerformanceCounter(&timestamp);
+
+  MouseEvent mouseEvent;
+  mouseEvent.Timestamp = timestamp.QuadPart;
+  // Absolute positions (tablets, remote desktop) aren't deltas
+  mouseEvent.X = isRelative ? mouse.lLastX : 0;
+  mouseEvent.Y = isRelative ? mouse.lLastY : 0;
+  mouseEvent.Z = (mouse.usButtonFlags & RI_MOUSE_WHEEL) ? static_cast<short>(mouse.usButtonData) : 0;
+  m_MouseEvents.Push(mouseEvent);
 }
 
 void InputSystem::HandleMouseMsg(LPARAM lParam)
@@ -85,8 +235,19 @@ void InputSystem::HandleMouseMsg(LPARAM lParam)
 
 }
 
+void InputSystem::LatchKey(WPARAM vkey)
+{
+  // The action thread sees the key even if it's released again
+  // before the next update.
+  if (vkey < 256)
+    m_KeyLatch[vkey >> 5].fetch_or(1u << (vkey & 31));
+  Wake();
+}
+
 bool InputSystem::HandleKeyMsg(WPARAM wParam, LPARAM lParam)
 {
+  LatchKey(wParam);
+
   if (wParam == VK_ESCAPE || !g_mainHandle->GetUI()->IsEnabled())
   {
     m_CaptureState.CaptureKb = false;
@@ -113,6 +274,7 @@ bool InputSystem::HandleKeyMsg(WPARAM wParam, LPARAM lParam)
     m_KeyboardKeyNames[m_CaptureState.ActionIndex] = m_CaptureState.CapturedKbName;
     m_KeyboardBindings[m_CaptureState.ActionIndex] = m_CaptureState.CapturedKbKey;
     m_CaptureState.CaptureKb = false;
+    RebuildBindings();
 
     g_mainHandle->OnConfigChanged();
   }
@@ -120,11 +282,226 @@ bool InputSystem::HandleKeyMsg(WPARAM wParam, LPARAM lParam)
   return true;
 }
 
-void InputSystem::Update()
+void InputSystem::OnPresent()
 {
-  // Copy buffer to mouse state, set buffer to zero
-  m_MouseState = m_MouseBuffer;
-  m_MouseBuffer = DirectX::XMFLOAT3(0, 0, 0);
+  LARGE_INTEGER now;
+  QueryPerformanceCounter(&now);
+  m_LastPresentTime.store(now.QuadPart, std::memory_order_relaxed);
+}
+
+float InputSystem::Update(float dt)
+{
+  LARGE_INTEGER now;
+  QueryPerformanceCounter(&now);
+
+  // Pick the end of this update's window. When resampling to the frame,
+  // events made after the last Present are left for the next update so
+  // the motion is applied to the frame it was made during. Fall back to
+  // now if there hasn't been a new frame since the last window.
+  int64_t windowEnd = now.QuadPart;
+  if (m_ResampleMouseToFrame)
+  {
+    int64_t presentTime = m_LastPresentTime.load(std::memory_order_relaxed);
+    if (presentTime > m_MouseWindowEnd)
+      windowEnd = presentTime;
+  }
+
+  MouseDelta delta = m_MouseEvents.Drain(windowEnd);
+  m_MouseState.x = static_cast<float>(delta.X);
+  m_MouseState.y = static_cast<float>(delta.Y);
+  m_MouseState.z = static_cast<float>(delta.Z);
+
+  m_MouseWindowEnd = windowEnd;
+
+  RecordRequest request = m_RecordRequest.exchange(RecordRequest::None);
+  switch (request)
+  {
+  case RecordRequest::Record:
+  case RecordRequest::Play:
+    // A take that's still running is saved under its own name before
+    // the new one is taken over
+    StopRecording();
+    StopPlayback();
+    {
+      std::lock_guard<std::mutex> lock(m_RequestedNameMutex);
+      m_RecordingName = m_RequestedName;
+    }
+    if (request == RecordRequest::Record)
+      StartRecording();
+    else
+      StartPlayback();
+    break;
+  case RecordRequest::Stop:
+    StopRecording();
+    StopPlayback();
+    break;
+  default:
+    break;
+  }
+
+  std::array<uint32_t, g_recordValueCount> values;
+  uint32_t dtMicros = 0;
+
+  if (m_RecordState == RecordState::Playing)
+  {
+    if (m_RecordReader.NextFrame(dtMicros, values.data()))
+    {
+      // Replace live input with the recorded frame
+      m_MouseState.x = BitsFloat(values[g_recordMouseOffset + 0]);
+      m_MouseState.y = BitsFloat(values[g_recordMouseOffset + 1]);
+      m_MouseState.z = BitsFloat(values[g_recordMouseOffset + 2]);
+      for (int i = 0; i < Action::ActionCount; ++i)
+      {
+        m_FrameSnapshot.WantedActionStates[i] = BitsFloat(values[g_recordWantedOffset + i]);
+        m_FrameSnapshot.SmoothActionStates[i] = BitsFloat(values[g_recordSmoothOffset + i]);
+      }
+      for (int i = 0; i < GamepadKey::GamepadKey_Count; ++i)
+        m_FrameSnapshot.GamepadKeyStates[i] = BitsFloat(values[g_recordPadOffset + i]);
+      m_FrameSnapshot.Tick = m_RecordReader.GetFramesRead();
+      m_MouseLook = (values[g_recordFlagsOffset] & RecordFlag_MouseLook) != 0;
+      m_RecordFrames.store(m_RecordReader.GetFramesRead(), std::memory_order_relaxed);
+
+      // The recorded edges are dispatched here rather than handed to the
+      // input thread, so they take effect before the camera sees this
+      // frame, the same as when they were recorded
+      for (int type = 0; type < 3; ++type)
+      {
+        uint32_t const* pBits = &values[g_recordEventOffset + static_cast<int>(g_replayOrder[type]) * g_recordEventWords];
+        for (int i = 0; i < Action::ActionCount; ++i)
+        {
+          if (pBits[i >> 5] & (1u << (i & 31)))
+            DispatchActionEvent(ActionEvent{ static_cast<Action>(i), g_replayOrder[type] });
+        }
+      }
+
+      return dtMicros / 1000000.f;
+    }
+
+    util::log::Write("Input playback finished after %u frames", m_RecordReader.GetFramesRead());
+    StopPlayback();
+  }
+
+  m_FrameSnapshot = GetSnapshot();
+  m_MouseLook = !g_mainHandle->GetUI()->IsEnabled();
+  if (m_RecordState != RecordState::Recording)
+    return dt;
+
+  // Recorded in whole microseconds, and the live camera uses the
+  // rounded dt as well so playback matches the original exactly.
+  dtMicros = static_cast<uint32_t>(dt * 1000000.f + 0.5f);
+
+  values[g_recordMouseOffset + 0] = FloatBits(m_MouseState.x);
+  values[g_recordMouseOffset + 1] = FloatBits(m_MouseState.y);
+  values[g_recordMouseOffset + 2] = FloatBits(m_MouseState.z);
+  for (int i = 0; i < Action::ActionCount; ++i)
+  {
+    values[g_recordWantedOffset + i] = FloatBits(m_FrameSnapshot.WantedActionStates[i]);
+    values[g_recordSmoothOffset + i] = FloatBits(m_FrameSnapshot.SmoothActionStates[i]);
+  }
+  for (int i = 0; i < GamepadKey::GamepadKey_Count; ++i)
+    values[g_recordPadOffset + i] = FloatBits(m_FrameSnapshot.GamepadKeyStates[i]);
+
+  // Edges the input thread dispatched since the last frame
+  std::fill(values.begin() + g_recordEventOffset, values.end(), 0u);
+  ActionEvent actionEvent;
+  while (m_RecordedEvents.pop(actionEvent))
+  {
+    int word = g_recordEventOffset + static_cast<int>(actionEvent.Type) * g_recordEventWords + (actionEvent.ActionId >> 5);
+    values[word] |= 1u << (actionEvent.ActionId & 31);
+  }
+  values[g_recordFlagsOffset] = m_MouseLook ? RecordFlag_MouseLook : 0;
+
+  m_RecordWriter.AddFrame(dtMicros, values.data());
+  m_RecordFrames.store(m_RecordWriter.GetFrameCount(), std::memory_order_relaxed);
+  m_RecordBytes.store(static_cast<uint32_t>(m_RecordWriter.GetSize()), std::memory_order_relaxed);
+  return dtMicros / 1000000.f;
+}
+
+bool InputSystem::GetRecordingPath(std::string& path)
+{
+  if (!IsValidRecordingName(m_RecordingName))
+  {
+    util::log::Error("\"%s\" can't be used as a recording name, it has to be a plain file name", m_RecordingName.c_str());
+    return false;
+  }
+
+  path = std::string(g_recordingDir) + m_RecordingName + ".ctir";
+  return true;
+}
+
+void InputSystem::StartRecording()
+{
+  std::string path;
+  if (!GetRecordingPath(path))
+    return;
+
+  // Edges from before the recording started
+  m_RecordedEvents.consume_all([](ActionEvent const&) {});
+
+  m_RecordWriter.Begin(g_recordValueCount);
+  m_RecordFrames = 0;
+  m_RecordBytes = 0;
+  m_RecordState = RecordState::Recording;
+  util::log::Write("Recording input to %s", path.c_str());
+}
+
+void InputSystem::StopRecording()
+{
+  if (m_RecordState != RecordState::Recording)
+    return;
+
+  m_RecordState = RecordState::Idle;
+  std::vector<uint8_t> const& data = m_RecordWriter.Finish();
+
+  std::string path;
+  if (!GetRecordingPath(path))
+    return;
+
+  std::fstream file;
+  file.open(path.c_str(), std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+  if (!file.is_open())
+  {
+    util::log::Error("Could not save input recording, failed to open %s for writing", path.c_str());
+    return;
+  }
+
+  file.write(reinterpret_cast<const char*>(data.data()), data.size());
+  file.close();
+
+  util::log::Ok("Saved %u frames of input (%u bytes) to %s", m_RecordWriter.GetFrameCount(), (unsigned int)data.size(), path.c_str());
+}
+
+void InputSystem::StartPlayback()
+{
+  std::string path;
+  if (!GetRecordingPath(path))
+    return;
+
+  std::fstream file;
+  file.open(path.c_str(), std::ios_base::in | std::ios_base::binary);
+  if (!file.is_open())
+  {
+    util::log::Error("Could not open input recording %s", path.c_str());
+    return;
+  }
+
+  std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  if (!m_RecordReader.Open(std::move(data), g_recordValueCount))
+  {
+    util::log::Error("%s is not an input recording or was made with a different version", path.c_str());
+    return;
+  }
+
+  m_RecordFrames = 0;
+  m_PlaybackFrames = m_RecordReader.GetFrameCount();
+  m_RecordState = RecordState::Playing;
+  util::log::Write("Playing back %u frames of input from %s", m_RecordReader.GetFrameCount(), path.c_str());
+}
+
+void InputSystem::StopPlayback()
+{
+  if (m_RecordState == RecordState::Playing)
+    m_RecordState = RecordState::Idle;
 }
 
 void InputSystem::ShowUI()
@@ -176,6 +553,8 @@ void InputSystem::DrawUI()
       GamepadKey padKey = m_GamepadBindings[i];
 
       std::string kbString = m_KeyboardKeyNames[i];
+      if (!m_ChordBindings[i].empty())
+        kbString += " (+" + std::to_string(m_ChordBindings[i].size()) + ")";
       if (m_CaptureState.CaptureKb && m_CaptureState.ActionIndex == i)
       {
         kbString = m_CaptureState.CapturedKbName;
@@ -198,6 +577,11 @@ void InputSystem::DrawUI()
     }
 
     ImGui::SliderFloat("Mouse Sensitivity", &m_MouseSensitivity, 0, 1.0f);
+    if (ImGui::IsItemHovered())
+      ImGui::SetTooltip("Rotation per mouse count, no longer scaled by the update time.\n"
+        "Same speed as before with the default 15.6 ms Windows timer. If the\n"
+        "timer resolution was raised, mouse look is now up to 1.5x faster.");
+    ImGui::Checkbox("Sync mouse to rendered frames", &m_ResampleMouseToFrame);
 
     if (ImGui::InputInt("Controller ID", (int*)&m_SelectedID, 1, 0))
     {
@@ -207,6 +591,45 @@ void InputSystem::DrawUI()
         m_SelectedID = 3;
     }
     ImGui::Checkbox("Force controller ID", &m_ForceXInputID);
+    ImGui::Text("Input thread wakeups: %.0f/s", GetWakeupsPerSecond());
+
+    ImGui::Dummy(ImVec2(0, 10));
+    ImGui::Text("Input recording");
+    ImGui::InputText("Name##Recording", m_RecordingNameInput, sizeof(m_RecordingNameInput));
+
+    // The writer and reader belong to the main loop thread, only the
+    // counts it publishes are read here
+    RecordState recordState = m_RecordState;
+    if (recordState == RecordState::Recording)
+    {
+      if (ImGui::Button("Stop recording"))
+        m_RecordRequest = RecordRequest::Stop;
+      ImGui::SameLine();
+      ImGui::Text("%u frames, %u bytes", m_RecordFrames.load(std::memory_order_relaxed), m_RecordBytes.load(std::memory_order_relaxed));
+    }
+    else if (recordState == RecordState::Playing)
+    {
+      if (ImGui::Button("Stop playback"))
+        m_RecordRequest = RecordRequest::Stop;
+      ImGui::SameLine();
+      ImGui::Text("Frame %u / %u", m_RecordFrames.load(std::memory_order_relaxed), m_PlaybackFrames.load(std::memory_order_relaxed));
+    }
+    else
+    {
+      RecordRequest request = RecordRequest::None;
+      if (ImGui::Button("Record"))
+        request = RecordRequest::Record;
+      ImGui::SameLine();
+      if (ImGui::Button("Play"))
+        request = RecordRequest::Play;
+
+      if (request != RecordRequest::None)
+      {
+        std::lock_guard<std::mutex> lock(m_RequestedNameMutex);
+        m_RequestedName = m_RecordingNameInput;
+        m_RecordRequest = request;
+      }
+    }
 
     ImGui::Dummy(ImVec2(0, 10));
     ImGui::PopFont();
@@ -215,29 +638,50 @@ void InputSystem::DrawUI()
 
 }
 
-bool InputSystem::IsActionDown(Action action)
+void InputSystem::Subscribe(Action action, ActionEventType type, std::function<void()> const& callback)
 {
-  return m_WantedActionStates[action] != 0.f;
+  std::lock_guard<std::mutex> lock(m_SubscriberMutex);
+  m_Subscribers[action].push_back({ type, callback });
 }
 
-bool InputSystem::IsPadKeyDown(GamepadKey key)
+InputSnapshot InputSystem::GetSnapshot()
 {
-  return m_GamepadKeyStates[key] != 0.f;
+  InputSnapshot snapshot;
+  while (true)
+  {
+    int index = m_PublishedSnapshot.load(std::memory_order_acquire);
+    uint32_t seq = m_SnapshotSeq[index].load(std::memory_order_acquire);
+    if (seq & 1)
+      continue;
+
+    snapshot = m_Snapshots[index];
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    // The slot is only rewritten two publishes later, so this
+    // practically never retries.
+    if (m_SnapshotSeq[index].load(std::memory_order_relaxed) == seq)
+      return snapshot;
+  }
 }
 
-float InputSystem::GetActionState(Action action)
+DirectX::XMFLOAT3 InputSystem::GetMouseState()
 {
-  return m_SmoothActionStates[action];
+  return m_MouseState;
 }
 
-float InputSystem::GetPadKeyState(GamepadKey key)
+float InputSystem::GetWakeupsPerSecond()
 {
-  return m_GamepadKeyStates[key];
-}
+  ULONGLONG now = GetTickCount64();
+  ULONGLONG elapsed = now - m_WakeupsSampleTime;
+  if (elapsed >= 1000)
+  {
+    uint32_t wakeups = m_Wakeups.load();
+    m_WakeupsPerSecond = (wakeups - m_WakeupsSampled) * 1000.f / elapsed;
+    m_WakeupsSampled = wakeups;
+    m_WakeupsSampleTime = now;
+  }
 
-DirectX::XMFLOAT3 InputSystem::GetMouseState()
-{
-  return m_MouseState;
+  return m_WakeupsPerSecond;
 }
 
 float InputSystem::GetMouseSensitivity()
@@ -245,7 +689,7 @@ float InputSystem::GetMouseSensitivity()
   return m_MouseSensitivity;
 }
 
-void InputSystem::ReadConfig(INIReader* pReader)
+void InputSystem::ReadConfig(util::IniFile* pReader)
 {
   for (int i = 0; i < Action::ActionCount; ++i)
   {
@@ -257,8 +701,30 @@ void InputSystem::ReadConfig(INIReader* pReader)
 
     m_KeyboardBindings[action] = vkey;
     m_GamepadBindings[action] = padKey;
+
+    // Extra bindings, e.g. Camera_Up = 32, 17+87, 275
+    m_ChordBindings[action].clear();
+    std::string chords = pReader->Get("ChordMap", name, "");
+    size_t start = 0;
+    while (start < chords.size())
+    {
+      size_t end = chords.find(',', start);
+      if (end == std::string::npos)
+        end = chords.size();
+
+      std::string chord = chords.substr(start, end - start);
+      KeyMask keys;
+      if (ParseChord(chord, keys))
+        m_ChordBindings[action].push_back(keys);
+      else if (chord.find_first_not_of(" \t") != std::string::npos)
+        util::log::Warning("Invalid binding \"%s\" for %s in [ChordMap]", chord.c_str(), name.c_str());
+
+      start = end + 1;
+    }
   }
 
+  RebuildBindings();
+
   for (int i = 0; i < Action::ActionCount; ++i)
   {
     std::string sHotkey = "";
@@ -272,12 +738,32 @@ void InputSystem::ReadConfig(INIReader* pReader)
 
     m_KeyboardKeyNames[i] = sHotkey;
   }
+
+  // Response curves, e.g. RightThumb_XPos.Deadzone = 0.25
+  for (int i = 0; i < GamepadKey::GamepadKey_Count; ++i)
+  {
+    GamepadKey key = static_cast<GamepadKey>(i);
+    if (!IsAnalogKey(key))
+      continue;
+
+    std::string name = GamepadKeyStrings.at(key);
+    AxisResponseSettings settings = DefaultAxisResponse(key);
+
+    settings.Deadzone = (float)pReader->GetReal("GamepadMap", name + ".Deadzone", settings.Deadzone);
+    settings.AntiDeadzone = (float)pReader->GetReal("GamepadMap", name + ".AntiDeadzone", settings.AntiDeadzone);
+    settings.Exponent = (float)pReader->GetReal("GamepadMap", name + ".Exponent", settings.Exponent);
+    settings.SCurve = (float)pReader->GetReal("GamepadMap", name + ".SCurve", settings.SCurve);
+    settings.Sensitivity = (float)pReader->GetReal("GamepadMap", name + ".Sensitivity", settings.Sensitivity);
+
+    m_AxisResponses[i].Build(settings);
+  }
 }
 
 const std::string InputSystem::GetConfig()
 {
   std::string kbConfig = "[KeyboardMap]\n";
   std::string padConfig = "[GamepadMap]\n";
+  std::string chordConfig = "[ChordMap]\n";
 
   for (auto& actionInfo : ActionStringMap)
   {
@@ -286,468 +772,319 @@ const std::string InputSystem::GetConfig()
 
     kbConfig += name + " = " + std::to_string(m_KeyboardBindings[action]) + "\n";
     padConfig += name + " = " + std::to_string(m_GamepadBindings[action]) + "\n";
+
+    if (!m_ChordBindings[action].empty())
+    {
+      std::string chords;
+      for (KeyMask const& chord : m_ChordBindings[action])
+        chords += (chords.empty() ? "" : ", ") + ChordToString(chord);
+      chordConfig += name + " = " + chords + "\n";
+    }
+  }
+
+  for (int i = 0; i < GamepadKey::GamepadKey_Count; ++i)
+  {
+    GamepadKey key = static_cast<GamepadKey>(i);
+    if (!IsAnalogKey(key))
+      continue;
+
+    std::string name = GamepadKeyStrings.at(key);
+    AxisResponseSettings const& settings = m_AxisResponses[i].GetSettings();
+
+    padConfig += name + ".Deadzone = " + std::to_string(settings.Deadzone) + "\n";
+    padConfig += name + ".AntiDeadzone = " + std::to_string(settings.AntiDeadzone) + "\n";
+    padConfig += name + ".Exponent = " + std::to_string(settings.Exponent) + "\n";
+    padConfig += name + ".SCurve = " + std::to_string(settings.SCurve) + "\n";
+    padConfig += name + ".Sensitivity = " + std::to_string(settings.Sensitivity) + "\n";
   }
 
-  return kbConfig + "\n" + padConfig;
+  return kbConfig + "\n" + padConfig + "\n" + chordConfig;
 }
 
-void InputSystem::ActionUpdate()
+void InputSystem::InputThread()
 {
-  // Action Update thread
-  // Processes keyboard + gamepad input and updates
-  // action states based on bindings.
+  // Input thread
+  // Everything input related runs here: action polling, hotkey
+  // dispatch and gamepad detection. Work is scheduled on a timer
+  // wheel and the thread waits on m_WakeSignal in between, so it
+  // doesn't wake up at all while nothing is pressed and no gamepad
+  // is connected.
+
+  ULONGLONG now = GetTickCount64();
+  auto lastActionUpdate = boost::chrono::high_resolution_clock::now();
 
-  auto lastUpdate = boost::chrono::high_resolution_clock::now();
+  m_Timers.Start(now);
+  m_Timers.Schedule(InputTimer_ControllerScan, 0, now);
 
   while (!g_shutdown)
   {
-    boost::chrono::duration<float> dt = boost::chrono::high_resolution_clock::now() - lastUpdate;
-    lastUpdate = boost::chrono::high_resolution_clock::now();
+    DWORD waitResult = WaitForSingleObject(m_WakeSignal, m_Timers.TimeUntilNext(GetTickCount64()));
+    m_Wakeups++;
 
-    std::array<float, Action::ActionCount> newWantedStates{ 0 };
-    m_GamepadKeyStates.fill(0.f);
+    if (g_shutdown)
+      break;
 
-    if (g_hasFocus)
+    now = GetTickCount64();
+    if (m_DeviceChanged.exchange(false) && !m_GamepadPresent)
     {
-      if (m_Gamepad.IsPresent)
-      {
-        if (m_Gamepad.Type == GamepadType::XInput)
-          UpdateXInput();
-        else
-          UpdateDInput();
+      m_ScanBackoffMs = g_minScanBackoffMs;
+      m_Timers.Schedule(InputTimer_ControllerScan, 0, now);
+    }
 
-        if (m_CaptureState.CaptureGamepad)
-        {
-          for (int i = 0; i < GamepadKey::GamepadKey_Count; ++i)
-          {
-            float keyState = m_GamepadKeyStates[i];
-            if (keyState > 0.5f)
-            {
-              m_CaptureState.CaptureGamepad = false;
-              m_GamepadBindings[m_CaptureState.ActionIndex] = static_cast<GamepadKey>(i);
-              g_mainHandle->OnConfigChanged();
-            }
-          }
-        }
+    // Woken up by WndProc or a device change, make sure the
+    // actions get polled right away.
+    if (waitResult == WAIT_OBJECT_0 && !m_Timers.IsScheduled(InputTimer_ActionUpdate))
+      m_Timers.Schedule(InputTimer_ActionUpdate, 0, now);
 
-        if (g_mainHandle->GetCameraManager()->IsGamepadDisabled())
-        {
-          for (int i = 0; i < Action::ActionCount; ++i)
-          {
-            GamepadKey key = m_GamepadBindings[i];
-            newWantedStates[i] += m_GamepadKeyStates[key];
-          }
-        }
-      }
-
-      if (!g_mainHandle->GetUI()->HasKeyboardFocus())
+    m_Timers.Advance(now, [&](int timer)
+    {
+      switch (timer)
       {
-        for (int i = 0; i < Action::ActionCount; ++i)
-        {
-          int key = m_KeyboardBindings[i];
+      case InputTimer_ActionUpdate:
+      {
+        boost::chrono::duration<float> dt = boost::chrono::high_resolution_clock::now() - lastActionUpdate;
+        lastActionUpdate = boost::chrono::high_resolution_clock::now();
 
-          //if (!g_mainHandle->GetCameraManager()->IsKbmDisabled() &&
-          //  i >= Camera_Forward && i <= Camera_Down)
-          //  key = pInputMgr->m_keyboardMap[i + 14];
+        // After sleeping the elapsed time can be seconds, which would
+        // make the smoothing jump straight to the wanted state.
+        float actionDt = (std::min)(dt.count(), g_actionUpdateMs * 2 / 1000.f);
+        bool isActive = ActionUpdate(actionDt);
+        HotkeyUpdate();
 
-          if (key >> 8)
-          {
-            if (GetKeyState(key >> 8) & 0x8000 && GetKeyState(key & 0xFF) & 0x8000)
-              newWantedStates[i] += 1.0f;
-          }
-          else if (GetKeyState(key) & 0x8000)
-            newWantedStates[i] += 1.0f;
-        }
-      }
-    }
-
-    // Copy new values and perform smoothing
-    m_WantedActionStates = newWantedStates;
-    for (int i = 0; i < Action::ActionCount; ++i)
-    {
-      float& currentState = m_SmoothActionStates[i];
-      float& wantedState = m_WantedActionStates[i];
+        if (isActive)
+          m_Timers.Schedule(InputTimer_ActionUpdate, g_actionUpdateMs, now);
 
-      if (currentState != wantedState)
-      {
-        if (wantedState > 0)
+        // Controller was lost during the update, start looking for it again
+        if (!m_GamepadPresent && !m_Timers.IsScheduled(InputTimer_ControllerScan))
         {
-          currentState += dt.count() / g_actionClearTime;
-          if (currentState > wantedState)
-            currentState = wantedState;
+          m_ScanBackoffMs = g_minScanBackoffMs;
+          m_Timers.Schedule(InputTimer_ControllerScan, m_ScanBackoffMs, now);
         }
+        break;
+      }
+      case InputTimer_ControllerScan:
+        if (ControllerUpdate())
+          m_Timers.Schedule(InputTimer_ActionUpdate, 0, now);
         else
         {
-          currentState -= dt.count() / g_actionClearTime;
-          if (currentState < 0)
-            currentState = 0;
+          // Nothing found, back off until the next try. A device
+          // change notification resets the backoff.
+          m_Timers.Schedule(InputTimer_ControllerScan, m_ScanBackoffMs, now);
+          m_ScanBackoffMs = (std::min)(m_ScanBackoffMs * 2, g_maxScanBackoffMs);
         }
+        break;
       }
-    }
-
-    Sleep(10);
+    });
   }
 }
 
-void InputSystem::ControllerUpdate()
+bool InputSystem::ActionUpdate(float dt)
 {
-  // Gamepad detection
-  // For some people gamepad scanning seemed to block
-  // the update/input threads, so that's why it's placed
-  // in its own thread.
+  // Processes keyboard + gamepad input and updates
+  // action states based on bindings.
 
-  while (!g_shutdown)
+  m_GamepadKeyStates.fill(0.f);
+
+  // Always consume the latch, otherwise presses made while the
+  // game is unfocused would fire when focus returns.
+  std::array<uint32_t, 8> latched;
+  for (int i = 0; i < 8; ++i)
+    latched[i] = m_KeyLatch[i].exchange(0);
+
+  std::shared_ptr<const BindingTable> bindings = std::atomic_load(&m_BindingTable);
+  KeyMask down;
+  bool useGamepad = false;
+
+  if (g_hasFocus)
   {
-    Sleep(1000);
-    if (!m_Gamepad.IsPresent)
+    useGamepad = g_mainHandle->GetCameraManager()->IsGamepadDisabled();
+
+    if (m_GamepadPresent)
     {
-      // Scan for XInput controllers first so they don't get
-      // detected as DInput controllers.
-      if (m_ForceXInputID)
-      {
-        DWORD dwResult = XInputGetState(m_SelectedID, &m_Gamepad.XInputState);
-        if (dwResult == ERROR_SUCCESS)
-        {
-          m_Gamepad.XInputId = m_SelectedID;
-          m_Gamepad.Type = GamepadType::XInput;
-          util::log::Write("Found a XInput controller ID %i");
-          m_Gamepad.IsPresent = true;
-        }
-      }
-      else
+      GamepadState gamepad;
+      m_GamepadPresent = m_pBackend->PollGamepad(gamepad);
+      if (m_GamepadPresent)
+        ActionPipeline::ShapeGamepad(gamepad, m_AxisResponses.data(), m_GamepadKeyStates.data());
+
+      if (m_CaptureState.CaptureGamepad)
       {
-        for (DWORD i = 0; i < XUSER_MAX_COUNT; i++)
+        for (int i = 0; i < GamepadKey::GamepadKey_Count; ++i)
         {
-          DWORD dwResult = XInputGetState(i, &m_Gamepad.XInputState);
-          if (dwResult == ERROR_SUCCESS)
+          float keyState = m_GamepadKeyStates[i];
+          if (keyState > 0.5f)
           {
-            m_Gamepad.XInputId = i;
-            m_Gamepad.Type = GamepadType::XInput;
-            util::log::Write("Found a XInput controller ID %i");
-            m_Gamepad.IsPresent = true;
-            break;
+            m_CaptureState.CaptureGamepad = false;
+            m_GamepadBindings[m_CaptureState.ActionIndex] = static_cast<GamepadKey>(i);
+            g_mainHandle->OnConfigChanged();
           }
         }
       }
 
-//       if (m_Gamepad.IsPresent) continue;
-// 
-//       // And then lets search for DInput controllers
-//       if (m_DInputInterface == NULL) continue;
-//       HRESULT hr = m_DInputInterface->EnumDevices(DI8DEVCLASS_GAMECTRL, (LPDIENUMDEVICESCALLBACKA)DIEnumDevicesCallback, this, DIEDFL_ATTACHEDONLY);
-//       if (FAILED(hr)) continue;
-// 
-//       if (m_Gamepad.DInputGamepad == NULL) continue;
-//       hr = m_Gamepad.DInputGamepad->SetDataFormat(&c_dfDIJoystick2);
-//       if (FAILED(hr)) continue;
-//       hr = m_Gamepad.DInputGamepad->Acquire();
-//       if (FAILED(hr)) continue;
-// 
-//       m_Gamepad.IsPresent = true;
-//       m_Gamepad.Type = GamepadType::DirectInput;
-//       util::log::Write("Found a DirectInput controller");
+      // Pad keys take part in chords once they're pushed past halfway
+      if (useGamepad)
+        ActionPipeline::AddPadKeys(m_GamepadKeyStates.data(), down);
     }
+
+    if (!g_mainHandle->GetUI()->HasKeyboardFocus())
+      ActionPipeline::ReadKeyboard(*m_pBackend, bindings->GetUsedKeys(), latched.data(), down);
   }
-}
 
-void InputSystem::HotkeyUpdate()
-{
-  // Hotkey thread
-  // This is in its own thread so when you press and hold
-  // for example HUD Toggle, you can still move the camera
-  // and it doesn't block other updates until you lift the
-  // key up again.
+  bool usePadBindings = g_hasFocus && m_GamepadPresent && useGamepad;
+  bool isActive = m_Pipeline.Update(dt, *bindings, down,
+    usePadBindings ? m_GamepadBindings.data() : nullptr, m_GamepadKeyStates.data());
 
-  while (!g_shutdown)
+  for (ActionEvent const& actionEvent : m_Pipeline.GetEvents())
   {
-    if (g_hasFocus)
-    {
-      if (IsActionDown(ToggleUI))
-      {
-        g_mainHandle->GetUI()->Toggle();
-        while (IsActionDown(ToggleUI))
-          Sleep(10);
-      }
-
-      g_mainHandle->GetCameraManager()->HotkeyUpdate();
-      g_mainHandle->GetCharacterController()->OnHotkeyUpdate();
-    }
-    Sleep(10);
+    if (!m_ActionEvents.push(actionEvent))
+      util::log::Warning("Action event queue is full, dropping %s", ActionStringMap.at(actionEvent.ActionId).c_str());
   }
+
+  PublishSnapshot();
+
+  // Keep polling while anything is held, still fading out or
+  // while a gamepad is connected.
+  return m_GamepadPresent || isActive;
 }
 
-void InputSystem::UpdateXInput()
+bool InputSystem::ControllerUpdate()
 {
-  XINPUT_STATE xiState{ 0 };
-  DWORD dwResult = XInputGetState(m_ForceXInputID ? m_SelectedID : m_Gamepad.XInputId, &xiState);
-  if (dwResult != ERROR_SUCCESS)
-  {
-    m_Gamepad.IsPresent = false;
-    util::log::Warning("Xbox controller lost");
-    return;
-  }
+  // Gamepad detection, only runs with a backoff or after WM_DEVICECHANGE
+  m_GamepadPresent = m_pBackend->FindGamepad(m_ForceXInputID ? static_cast<int>(m_SelectedID) : -1);
+  return m_GamepadPresent;
+}
 
+void InputSystem::HotkeyUpdate()
+{
+  // Runs the subscribed callbacks for every edge queued by
+  // ActionUpdate. Holding one key down doesn't block the others,
+  // since nothing here waits for a key to be released.
+  //
+  // ToggleUI is left out of recordings and always comes from live
+  // input, it's how the UI gets opened to stop them. During playback
+  // the other live edges are dropped in favour of the recorded ones.
+  RecordState recordState = m_RecordState;
+
+  ActionEvent actionEvent;
+  while (m_ActionEvents.pop(actionEvent))
   {
-    // Left thumb
-    float LX = static_cast<float>(xiState.Gamepad.sThumbLX);
-    float LY = static_cast<float>(xiState.Gamepad.sThumbLY);
-
-    //determine how far the controller is pushed
-    float magnitude = sqrtf(LX*LX + LY * LY);
-
-    //determine the direction the controller is pushed
-    float normalizedLX = LX / magnitude;
-    float normalizedLY = LY / magnitude;
-
-    float normalizedMagnitude = 0;
+    bool isToggleUI = actionEvent.ActionId == Action::ToggleUI;
+    if (recordState == RecordState::Playing && !isToggleUI)
+      continue;
 
-    //check if the controller is outside a circular dead zone
-    if (magnitude > XINPUT_GAMEPAD_LEFT_THUMB_DEADZONE)
-    {
-      //clip the magnitude at its expected maximum value
-      if (magnitude > 32767) magnitude = 32767;
-
-      //adjust magnitude relative to the end of the dead zone
-      magnitude -= XINPUT_GAMEPAD_LEFT_THUMB_DEADZONE;
+    DispatchActionEvent(actionEvent);
 
-      //optionally normalize the magnitude with respect to its expected range
-      //giving a magnitude value of 0.0 to 1.0
-      normalizedMagnitude = magnitude / (32767 - XINPUT_GAMEPAD_LEFT_THUMB_DEADZONE);
-    }
-    else //if the controller is in the deadzone zero out the magnitude
-    {
-      magnitude = 0.0;
-      normalizedMagnitude = 0.0;
-    }
-    if (magnitude > 0.0) {
-      normalizedMagnitude *= normalizedMagnitude;
-      // Determine the direction the controller is pushed
-      float NormalizedLX = LX / magnitude;
-      float NormalizedLY = LY / magnitude;
-
-      if (NormalizedLX > 0)
-        m_GamepadKeyStates[GamepadKey::LeftThumb_XPos] = NormalizedLX * normalizedMagnitude;
-      else
-        m_GamepadKeyStates[GamepadKey::LeftThumb_XNeg] = -NormalizedLX * normalizedMagnitude;
-
-      if (NormalizedLY > 0)
-        m_GamepadKeyStates[GamepadKey::LeftThumb_YPos] = NormalizedLY * normalizedMagnitude;
-      else
-        m_GamepadKeyStates[GamepadKey::LeftThumb_YNeg] = -NormalizedLY * normalizedMagnitude;
-    }
+    if (recordState == RecordState::Recording && !isToggleUI && !m_RecordedEvents.push(actionEvent))
+      util::log::Warning("Recorded event queue is full, dropping %s", ActionStringMap.at(actionEvent.ActionId).c_str());
   }
+}
 
-  {
-    // Right thumb
-    float RX = static_cast<float>(xiState.Gamepad.sThumbRX);
-    float RY = static_cast<float>(xiState.Gamepad.sThumbRY);
-
-    // Determine how far the controller is pushed
-    float magnitude = sqrtf(RX*RX + RY * RY);
-
-    float normalizedMagnitude = 0;
-
-    // Check if the controller is outside a circular dead zone
-    if (magnitude > XINPUT_GAMEPAD_RIGHT_THUMB_DEADZONE)
-    {
-      // Clip the magnitude at its expected maximum value
-      if (magnitude > 32767) magnitude = 32767;
-
-      // Adjust magnitude relative to the end of the dead zone
-      magnitude -= XINPUT_GAMEPAD_RIGHT_THUMB_DEADZONE;
-
-      // Optionally normalize the magnitude with respect to its expected range
-      // Giving a magnitude value of 0.0 to 1.0
-      normalizedMagnitude = magnitude / (32767 - XINPUT_GAMEPAD_RIGHT_THUMB_DEADZONE);
-    }
-    else {
-      // If the controller is in the deadzone zero out the magnitude
-      magnitude = 0.0;
-      normalizedMagnitude = 0.0;
-    }
+void InputSystem::RebuildBindings()
+{
+  // Builds a new table and swaps it in, the input thread keeps using
+  // the old one until its current update is done.
+  std::shared_ptr<BindingTable> bindings = std::make_shared<BindingTable>(Action::ActionCount);
 
-    if (magnitude > 0.0)
+  for (int i = 0; i < Action::ActionCount; ++i)
+  {
+    // [KeyboardMap] binding, optional modifier in the high byte
+    int key = m_KeyboardBindings[i];
+    KeyMask keys;
+    if (key & 0xFF)
+      keys.Set(key & 0xFF);
+    if ((key >> 8) & 0xFF)
+      keys.Set((key >> 8) & 0xFF);
+    bindings->Add(i, keys);
+
+    for (KeyMask const& chord : m_ChordBindings[i])
     {
-      normalizedMagnitude *= normalizedMagnitude;
-      // Determine the direction the controller is pushed
-      float NormalizedRX = RX / magnitude;
-      float NormalizedRY = RY / magnitude;
-
-      if (NormalizedRX > 0)
-        m_GamepadKeyStates[GamepadKey::RightThumb_XPos] = NormalizedRX * normalizedMagnitude;
-      else
-        m_GamepadKeyStates[GamepadKey::RightThumb_XNeg] = -NormalizedRX * normalizedMagnitude;
-
-      if (NormalizedRY > 0)
-        m_GamepadKeyStates[GamepadKey::RightThumb_YPos] = NormalizedRY * normalizedMagnitude;
-      else
-        m_GamepadKeyStates[GamepadKey::RightThumb_YNeg] = -NormalizedRY * normalizedMagnitude;
+      if (!bindings->Add(i, chord))
+        util::log::Warning("%s has more than %d bindings, ignoring the rest", ActionStringMap.at(static_cast<Action>(i)).c_str(), BindingTable::MaxBindingsPerAction);
     }
   }
 
+  for (BindingConflict const& conflict : bindings->Finalize())
   {
-    // Triggers
-    int delta = -(int)(xiState.Gamepad.bLeftTrigger) + (int)(xiState.Gamepad.bRightTrigger);
-    if (delta < XINPUT_GAMEPAD_TRIGGER_THRESHOLD / 2 && delta >(-XINPUT_GAMEPAD_TRIGGER_THRESHOLD / 2)) {
-      delta = 0;
-    }
-    else if (delta < 0) {
-      delta += XINPUT_GAMEPAD_TRIGGER_THRESHOLD / 2;
-    }
-    else {
-      delta -= XINPUT_GAMEPAD_TRIGGER_THRESHOLD / 2;
-    }
-    float trigger = (static_cast<float>(delta)) / (255.0f - XINPUT_GAMEPAD_TRIGGER_THRESHOLD / 2);
-    if (trigger > 0)
-      m_GamepadKeyStates[GamepadKey::RightTrigger] = trigger;
-    else
-      m_GamepadKeyStates[GamepadKey::LeftTrigger] = -trigger;
+    util::log::Warning("%s and %s have the same binding %s", ActionStringMap.at(static_cast<Action>(conflict.ActionA)).c_str(),
+      ActionStringMap.at(static_cast<Action>(conflict.ActionB)).c_str(), ChordToString(conflict.Keys).c_str());
   }
 
-  m_GamepadKeyStates[GamepadKey::LeftThumb] = (xiState.Gamepad.wButtons & XINPUT_GAMEPAD_LEFT_THUMB) ? 1.0f : 0.f;
-  m_GamepadKeyStates[GamepadKey::RightThumb] = (xiState.Gamepad.wButtons & XINPUT_GAMEPAD_RIGHT_THUMB) ? 1.0f : 0.f;
-  m_GamepadKeyStates[GamepadKey::LeftShoulder] = (xiState.Gamepad.wButtons & XINPUT_GAMEPAD_LEFT_SHOULDER) ? 1.0f : 0.f;
-  m_GamepadKeyStates[GamepadKey::RightShoulder] = (xiState.Gamepad.wButtons & XINPUT_GAMEPAD_RIGHT_SHOULDER) ? 1.0f : 0.f;
-
-  m_GamepadKeyStates[GamepadKey::DPad_Left] = (xiState.Gamepad.wButtons & XINPUT_GAMEPAD_DPAD_LEFT) ? 1.0f : 0.f;
-  m_GamepadKeyStates[GamepadKey::DPad_Right] = (xiState.Gamepad.wButtons & XINPUT_GAMEPAD_DPAD_RIGHT) ? 1.0f : 0.f;
-  m_GamepadKeyStates[GamepadKey::DPad_Up] = (xiState.Gamepad.wButtons & XINPUT_GAMEPAD_DPAD_UP) ? 1.0f : 0.f;
-  m_GamepadKeyStates[GamepadKey::DPad_Down] = (xiState.Gamepad.wButtons & XINPUT_GAMEPAD_DPAD_DOWN) ? 1.0f : 0.f;
-
-  m_GamepadKeyStates[GamepadKey::Button1] = (xiState.Gamepad.wButtons & XINPUT_GAMEPAD_X) ? 1.0f : 0.f;
-  m_GamepadKeyStates[GamepadKey::Button2] = (xiState.Gamepad.wButtons & XINPUT_GAMEPAD_A) ? 1.0f : 0.f;
-  m_GamepadKeyStates[GamepadKey::Button3] = (xiState.Gamepad.wButtons & XINPUT_GAMEPAD_B) ? 1.0f : 0.f;
-  m_GamepadKeyStates[GamepadKey::Button4] = (xiState.Gamepad.wButtons & XINPUT_GAMEPAD_Y) ? 1.0f : 0.f;
-  m_GamepadKeyStates[GamepadKey::Button5] = (xiState.Gamepad.wButtons & XINPUT_GAMEPAD_BACK) ? 1.0f : 0.f;
-  m_GamepadKeyStates[GamepadKey::Button6] = (xiState.Gamepad.wButtons & XINPUT_GAMEPAD_START) ? 1.0f : 0.f;
+  std::atomic_store(&m_BindingTable, std::shared_ptr<const BindingTable>(bindings));
 }
 
-void InputSystem::UpdateDInput()
+std::string InputSystem::ChordToString(KeyMask const& keys)
 {
-  DIJOYSTATE2 diState{ 0 };
-  HRESULT result = m_Gamepad.DInputGamepad->GetDeviceState(sizeof(DIJOYSTATE2), &diState);
-  if (result != S_OK)
+  std::string result;
+  for (int code = 0; code < KeyMask::KeyCodeCount; ++code)
   {
-    m_Gamepad.DInputGamepad->Release();
-    m_Gamepad.DInputGamepad = nullptr;
-    util::log::Warning("DirectInput controller lost");
-    m_Gamepad.IsPresent = false;
-    return;
-  }
-
-  // Left Stick
-  {
-    float lX = static_cast<float>(diState.lX) - 32767;
-    float lY = static_cast<float>(diState.lY) - 32767;
-
-    float Magnitude = sqrtf(lX*lX + lY * lY);
-    float NormalizedMagnitude = 0;
+    if (!keys.Test(code))
+      continue;
 
-    if (Magnitude > XINPUT_GAMEPAD_LEFT_THUMB_DEADZONE)
-    {
-      if (Magnitude > 32767) Magnitude = 32767;
-      Magnitude -= XINPUT_GAMEPAD_LEFT_THUMB_DEADZONE;
-      NormalizedMagnitude = Magnitude / (32767 - XINPUT_GAMEPAD_LEFT_THUMB_DEADZONE);
-    }
-    else
-    {
-      Magnitude = 0;
-      NormalizedMagnitude = 0;
-    }
-
-    if (Magnitude > 0.0)
-    {
-      NormalizedMagnitude *= NormalizedMagnitude;
-      float NormalizedLX = lX / Magnitude;
-      float NormalizedLY = lY / Magnitude;
-
-      if (NormalizedLX > 0)
-        m_GamepadKeyStates[GamepadKey::LeftThumb_XPos] = NormalizedLX * NormalizedMagnitude;
-      else
-        m_GamepadKeyStates[GamepadKey::LeftThumb_XNeg] = -NormalizedLX * NormalizedMagnitude;
-
-      if (NormalizedLY < 0)
-        m_GamepadKeyStates[GamepadKey::LeftThumb_YPos] = -NormalizedLY * NormalizedMagnitude;
-      else
-        m_GamepadKeyStates[GamepadKey::LeftThumb_YNeg] = NormalizedLY * NormalizedMagnitude;
-    }
+    if (!result.empty())
+      result += "+";
+    result += std::to_string(code);
   }
+  return result;
+}
 
-  // Right Stick
+bool InputSystem::ParseChord(std::string const& text, KeyMask& keys)
+{
+  // "17+87" is Ctrl + W, pad keys are KeyMask::PadKeyBase + GamepadKey
+  keys = KeyMask();
+  size_t start = 0;
+  while (start <= text.size())
   {
-    float lX = static_cast<float>(diState.lZ) - 32767;
-    float lY = static_cast<float>(diState.lRz) - 32767;
-
-    float Magnitude = sqrt(lX*lX + lY * lY);
-    float NormalizedMagnitude = 0;
-
-    if (Magnitude > XINPUT_GAMEPAD_LEFT_THUMB_DEADZONE)
-    {
-      if (Magnitude > 32767) Magnitude = 32767;
-      Magnitude -= XINPUT_GAMEPAD_LEFT_THUMB_DEADZONE;
-      NormalizedMagnitude = Magnitude / (32767 - XINPUT_GAMEPAD_LEFT_THUMB_DEADZONE);
-    }
-    else
-    {
-      Magnitude = 0;
-      NormalizedMagnitude = 0;
-    }
-
-    if (Magnitude > 0.0)
-    {
-      NormalizedMagnitude *= NormalizedMagnitude;
-      float NormalizedLX = lX / Magnitude;
-      float NormalizedLY = lY / Magnitude;
-
-      if (NormalizedLX > 0)
-        m_GamepadKeyStates[GamepadKey::RightThumb_XPos] = NormalizedLX * NormalizedMagnitude;
-      else
-        m_GamepadKeyStates[GamepadKey::RightThumb_XNeg] = -NormalizedLX * NormalizedMagnitude;
+    size_t end = text.find('+', start);
+    if (end == std::string::npos)
+      end = text.size();
+
+    std::string token = text.substr(start, end - start);
+    char* pEnd = nullptr;
+    long code = strtol(token.c_str(), &pEnd, 10);
+    while (pEnd && (*pEnd == ' ' || *pEnd == '\t'))
+      ++pEnd;
+
+    if (token.find_first_not_of(" \t") == std::string::npos || *pEnd != '\0' ||
+        code <= 0 || code >= KeyMask::KeyCodeCount)
+      return false;
+
+    keys.Set(static_cast<int>(code));
+    start = end + 1;
+  }
 
-      if (NormalizedLY < 0)
-        m_GamepadKeyStates[GamepadKey::RightThumb_YPos] = -NormalizedLY * NormalizedMagnitude;
-      else
-        m_GamepadKeyStates[GamepadKey::RightThumb_YNeg] = NormalizedLY * NormalizedMagnitude;
+  return !keys.IsEmpty();
+}
 
-    }
-  }
+void InputSystem::DispatchActionEvent(ActionEvent const& actionEvent)
+{
+  if (!g_hasFocus)
+    return;
 
-  // Triggers
+  std::lock_guard<std::mutex> lock(m_SubscriberMutex);
+  for (ActionSubscriber const& subscriber : m_Subscribers[actionEvent.ActionId])
   {
-    int delta = -(int)(diState.lRx) + (int)(diState.lRy);
-    if (delta < 6553 / 2 && delta >(-6553 / 2)) {
-      delta = 0;
-    }
-    else if (delta < 0) {
-      delta += 6553 / 2;
-    }
-    else {
-      delta -= 6553 / 2;
-    }
-
-    float trigger = ((float)delta) / (65535.f - 6553 / 2);
-    if (trigger > 0)
-      m_GamepadKeyStates[GamepadKey::LeftTrigger] = trigger;
-    else
-      m_GamepadKeyStates[GamepadKey::RightTrigger] = -trigger;
+    if (subscriber.Type == actionEvent.Type)
+      subscriber.Callback();
   }
+}
 
-  m_GamepadKeyStates[GamepadKey::LeftThumb] = (diState.rgbButtons[10] == 128) ? 1.0f : 0.f;
-  m_GamepadKeyStates[GamepadKey::RightThumb] = (diState.rgbButtons[11] == 128) ? 1.0f : 0.f;
-  m_GamepadKeyStates[GamepadKey::LeftShoulder] = (diState.rgbButtons[4] == 128) ? 1.0f : 0.f;
-  m_GamepadKeyStates[GamepadKey::RightShoulder] = (diState.rgbButtons[5] == 128) ? 1.0f : 0.f;
-
-  m_GamepadKeyStates[GamepadKey::DPad_Left] = (diState.rgdwPOV[0] == 27000) ? 1.0f : 0.f;
-  m_GamepadKeyStates[GamepadKey::DPad_Right] = (diState.rgdwPOV[0] == 9000) ? 1.0f : 0.f;
-  m_GamepadKeyStates[GamepadKey::DPad_Up] = (diState.rgdwPOV[0] == 0) ? 1.0f : 0.f;
-  m_GamepadKeyStates[GamepadKey::DPad_Down] = (diState.rgdwPOV[0] == 18000) ? 1.0f : 0.f;
-
-  m_GamepadKeyStates[GamepadKey::Button1] = (diState.rgbButtons[0] == 128) ? 1.0f : 0.f;
-  m_GamepadKeyStates[GamepadKey::Button2] = (diState.rgbButtons[1] == 128) ? 1.0f : 0.f;
-  m_GamepadKeyStates[GamepadKey::Button3] = (diState.rgbButtons[2] == 128) ? 1.0f : 0.f;
-  m_GamepadKeyStates[GamepadKey::Button4] = (diState.rgbButtons[3] == 128) ? 1.0f : 0.f;
-  m_GamepadKeyStates[GamepadKey::Button5] = (diState.rgbButtons[8] == 128) ? 1.0f : 0.f;
-  m_GamepadKeyStates[GamepadKey::Button6] = (diState.rgbButtons[9] == 128) ? 1.0f : 0.f;
+void InputSystem::PublishSnapshot()
+{
+  // Only the input thread publishes, so the back slot is always the
+  // one not pointed at by m_PublishedSnapshot.
+  int index = m_PublishedSnapshot.load(std::memory_order_relaxed) ^ 1;
+  uint32_t seq = m_SnapshotSeq[index].load(std::memory_order_relaxed);
+
+  m_SnapshotSeq[index].store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  InputSnapshot& snapshot = m_Snapshots[index];
+  snapshot.Tick = ++m_Tick;
+  snapshot.WantedActionStates = m_Pipeline.GetWantedStates();
+  snapshot.SmoothActionStates = m_Pipeline.GetSmoothStates();
+  snapshot.GamepadKeyStates = m_GamepadKeyStates;
+
+  m_SnapshotSeq[index].store(seq + 2, std::memory_order_release);
+  m_PublishedSnapshot.store(index, std::memory_order_release);
 }
 
 void InputSystem::StartGamepadCapture(int index)
@@ -767,17 +1104,3 @@ void InputSystem::StartKeyboardCapture(int index)
   m_CaptureState.CapturedKbName = "";
   m_CaptureState.CapturedKbKey = 0;
 }
-
-BOOL InputSystem::DIEnumDevicesCallback(LPCDIDEVICEINSTANCE lpddi, LPVOID pvRef)
-{
-  InputSystem* pInputSystem = static_cast<InputSystem*>(pvRef);
-
-  HRESULT hr = pInputSystem->m_DInputInterface->CreateDevice(lpddi->guidInstance, &pInputSystem->m_Gamepad.DInputGamepad, NULL);
-  if (FAILED(hr))
-  {
-    util::log::Error("Failed to create DirectInput device. HRESULT 0x%X", hr);
-    return DIENUM_CONTINUE;
-  }
-
-  return DIENUM_STOP;
-}
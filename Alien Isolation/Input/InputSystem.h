@@ -1,29 +1,64 @@
 #pragma once
 #include "ActionDefs.h"
-#include "../inih/cpp/INIReader.h"
+#include "ActionPipeline.h"
+#include "AxisResponse.h"
+#include "BindingTable.h"
+#include "InputBackend.h"
+#include "InputRecording.h"
+#include "MouseEventQueue.h"
+#include "TimerWheel.h"
+#include "../Util/IniFile.h"
 
 #include <array>
+#include <atomic>
+#include <boost/lockfree/spsc_queue.hpp>
 #include <dinput.h>
 #include <DirectXMath.h>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <thread>
-#include <Xinput.h>
+#include <vector>
 
-enum GamepadType
+struct ActionSubscriber
 {
-  XInput,
-  DirectInput
+  ActionEventType Type;
+  std::function<void()> Callback;
 };
 
-struct GamepadInfo
+// Immutable copy of the action states from one input thread tick.
+// Take one per frame with InputSystem::GetSnapshot() so every value
+// read during the frame comes from the same update. The main loop
+// uses InputSystem::GetFrameSnapshot() instead, which can be recorded
+// and played back.
+struct InputSnapshot
 {
-  bool IsPresent{ false };
-  GamepadType Type;
+  uint32_t Tick{ 0 };
 
-  int XInputId{ 0 };
-  LPDIRECTINPUTDEVICE8 DInputGamepad{ NULL };
+  std::array<float, Action::ActionCount>            WantedActionStates{};
+  std::array<float, Action::ActionCount>            SmoothActionStates{};
+  std::array<float, GamepadKey::GamepadKey_Count>   GamepadKeyStates{};
 
-  XINPUT_STATE XInputState{ 0 };
-  DIJOYSTATE2 DInputState{ 0 };
+  bool IsActionDown(Action action) const { return WantedActionStates[action] != 0.f; }
+  bool IsPadKeyDown(GamepadKey key) const { return GamepadKeyStates[key] != 0.f; }
+  float GetActionState(Action action) const { return SmoothActionStates[action]; }
+  float GetPadKeyState(GamepadKey key) const { return GamepadKeyStates[key]; }
+};
+
+enum class RecordState
+{
+  Idle,
+  Recording,
+  Playing
+};
+
+// Set from the UI, applied by Update() on the main loop thread
+enum class RecordRequest
+{
+  None,
+  Record,
+  Play,
+  Stop
 };
 
 struct CaptureInfo
@@ -46,43 +81,87 @@ public:
   void HandleMouseMsg(LPARAM lParam);
   void HandleRawInput(LPARAM lParam);
   bool HandleKeyMsg(WPARAM wParam, LPARAM lParam);
+  void HandleDeviceChange();
+
+  // Remembers that vkey went down and wakes the input thread, so a
+  // press shorter than one update still reaches the bindings. Used for
+  // keys, system keys and mouse buttons.
+  void LatchKey(WPARAM vkey);
 
-  void Update();
+  // Wakes up the input thread if it's sleeping
+  void Wake();
+
+  // Called from the Present hook, marks the end of a rendered frame
+  void OnPresent();
+
+  // Latches the input for this frame and records or plays it back.
+  // Returns the dt the camera should use, during playback it's the
+  // recorded one so the move comes out the same every time.
+  float Update(float dt);
 
   void ShowUI();
   void DrawUI();
 
-  bool IsActionDown(Action action);
-  bool IsPadKeyDown(GamepadKey key);
-  float GetActionState(Action action);
-  float GetPadKeyState(GamepadKey key);
+  // Callbacks are run on the hotkey thread whenever the action
+  // produces an edge of the given type, or on the main loop thread
+  // while a recording is played back. Subscribing from inside a
+  // callback is not allowed.
+  void Subscribe(Action action, ActionEventType type, std::function<void()> const& callback);
+
+  // Latest state published by the input thread, safe to call from any thread
+  InputSnapshot GetSnapshot();
+  // Snapshot latched by Update(), only for the main loop thread
+  InputSnapshot const& GetFrameSnapshot() const { return m_FrameSnapshot; }
+  bool IsPlayingBack() const { return m_RecordState == RecordState::Playing; }
+  // Whether mouse motion turns the camera this frame. Latched by Update()
+  // while the UI is closed, or taken from the recording being played back.
+  bool IsMouseLookActive() const { return m_MouseLook; }
+  // Mouse counts integrated over the window between the last two Update() calls
   DirectX::XMFLOAT3 GetMouseState();
   float GetMouseSensitivity();
 
-  void ReadConfig(INIReader* pReader);
+  void ReadConfig(util::IniFile* pReader);
   const std::string GetConfig();
 
   bool IsUsingSecondPad() { return m_ForceXInputID; }
 
+  // Input thread wakeups per second, sampled at most once a second.
+  // Only call this from the render thread.
+  float GetWakeupsPerSecond();
+  uint32_t GetWakeups() const { return m_Wakeups.load(); }
+
 private:
-  void ActionUpdate();
-  void ControllerUpdate();
+  void InputThread();
+
+  // Returns true while there's input that needs to be polled
+  bool ActionUpdate(float dt);
+  // Returns true if a gamepad is connected after the scan
+  bool ControllerUpdate();
   void HotkeyUpdate();
 
-  void UpdateXInput();
-  void UpdateDInput();
+  void RebuildBindings();
+
+  static std::string ChordToString(KeyMask const& keys);
+  static bool ParseChord(std::string const& text, KeyMask& keys);
+  void DispatchActionEvent(ActionEvent const& actionEvent);
+  void PublishSnapshot();
+
+  void StartRecording();
+  void StopRecording();
+  void StartPlayback();
+  void StopPlayback();
+  bool GetRecordingPath(std::string& path);
 
   void StartKeyboardCapture(int index);
   void StartGamepadCapture(int index);
 
-  static BOOL DIEnumDevicesCallback(LPCDIDEVICEINSTANCE lpddi, LPVOID pvRef);
-
 private:
   bool m_ShowUI;
 
   RAWINPUTDEVICE m_RawInput;
-  LPDIRECTINPUT8 m_DInputInterface;
-  GamepadInfo m_Gamepad;
+  // Win32InputBackend in the game, everything below it is device independent
+  std::unique_ptr<InputBackend> m_pBackend;
+  bool m_GamepadPresent;
 
   unsigned int m_SelectedID;
   bool m_ForceXInputID;
@@ -90,24 +169,88 @@ private:
   std::array<int, Action::ActionCount>              m_KeyboardBindings;
   std::array<GamepadKey, Action::ActionCount>       m_GamepadBindings;
   std::array<std::string, Action::ActionCount>      m_KeyboardKeyNames;
+  // Bindings from [ChordMap] on top of the [KeyboardMap] one
+  std::array<std::vector<KeyMask>, Action::ActionCount> m_ChordBindings;
+  // Rebuilt whenever bindings change and swapped in atomically
+  std::shared_ptr<const BindingTable> m_BindingTable;
+  std::array<AxisResponse, GamepadKey::GamepadKey_Count> m_AxisResponses;
 
-  std::array<float, Action::ActionCount>            m_WantedActionStates;
-  std::array<float, Action::ActionCount>            m_SmoothActionStates;
+  // Working state, only touched by the input thread
+  ActionPipeline m_Pipeline;
   std::array<float, GamepadKey::GamepadKey_Count>   m_GamepadKeyStates;
+  uint32_t m_Tick;
 
-  DirectX::XMFLOAT2 m_PrevMousePos;
-  DirectX::XMFLOAT3 m_MouseBuffer;
+  // Published copies of the working state. The input thread writes the
+  // slot readers aren't pointed at, and each slot has a sequence number
+  // that is odd while it's being written so a reader can detect a torn copy.
+  std::array<InputSnapshot, 2> m_Snapshots;
+  std::array<std::atomic<uint32_t>, 2> m_SnapshotSeq;
+  std::atomic<int> m_PublishedSnapshot;
+
+  // WM_INPUT is read into a reused buffer and queued with its QPC
+  // timestamp, Update() drains all events since the last frame at once.
+  RAWINPUT m_RawInputArena;
+  MouseEventQueue<4096> m_MouseEvents;
   DirectX::XMFLOAT3 m_MouseState;
+
+  // Each Update() takes the events between the end of the previous
+  // window and either now or the last Present, so every event is
+  // counted exactly once and lands in the frame it was made for.
+  std::atomic<int64_t> m_LastPresentTime;
+  int64_t m_MouseWindowEnd;
+  bool m_ResampleMouseToFrame;
   LPDIRECTINPUTDEVICE8 m_DIMouse;
 
   CaptureInfo m_CaptureState;
 
-  std::thread m_ActionThread;
-  std::thread m_ControllerThread;
-  std::thread m_HotkeyThread;
+  // Keys that went down since the last action update, set from WndProc
+  // so presses shorter than one update still produce an edge.
+  std::array<std::atomic<uint32_t>, 8> m_KeyLatch;
+
+  boost::lockfree::spsc_queue<ActionEvent, boost::lockfree::capacity<256>> m_ActionEvents;
+
+  std::mutex m_SubscriberMutex;
+  std::array<std::vector<ActionSubscriber>, Action::ActionCount> m_Subscribers;
+
+  std::thread m_InputThread;
+  HANDLE m_WakeSignal;
+  TimerWheel m_Timers;
+  std::atomic<bool> m_DeviceChanged;
+  unsigned int m_ScanBackoffMs;
+
+  std::atomic<uint32_t> m_Wakeups;
+  uint32_t m_WakeupsSampled;
+  ULONGLONG m_WakeupsSampleTime;
+  float m_WakeupsPerSecond;
 
   float m_MouseSensitivity;
 
+  std::atomic<RecordState> m_RecordState;
+  std::atomic<RecordRequest> m_RecordRequest;
+  InputSnapshot m_FrameSnapshot;
+  bool m_MouseLook;
+
+  // Only touched by the main loop thread
+  InputRecordWriter m_RecordWriter;
+  InputRecordReader m_RecordReader;
+  std::string m_RecordingName;
+
+  // Published by Update() for the UI: frames recorded or played back so
+  // far, the size of the recording and the length of the one playing
+  std::atomic<uint32_t> m_RecordFrames;
+  std::atomic<uint32_t> m_RecordBytes;
+  std::atomic<uint32_t> m_PlaybackFrames;
+
+  // The name field belongs to the render thread. Pressing Record or Play
+  // copies it here, and Update() takes the copy with the request.
+  char m_RecordingNameInput[64];
+  std::mutex m_RequestedNameMutex;
+  std::string m_RequestedName;
+
+  // Hotkey edges dispatched while recording, from the input thread to
+  // Update()
+  boost::lockfree::spsc_queue<ActionEvent, boost::lockfree::capacity<256>> m_RecordedEvents;
+
 public:
   InputSystem(InputSystem const&) = delete;
   void operator=(InputSystem const&) = delete;
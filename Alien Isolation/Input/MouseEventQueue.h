@@ -0,0 +1,150 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+// One raw mouse report, Timestamp is in QueryPerformanceCounter ticks
+struct MouseEvent
+{
+  int64_t Timestamp;
+  int32_t X;
+  int32_t Y;
+  int32_t Z;
+};
+
+// Sum of all events drained in one go
+struct MouseDelta
+{
+  int64_t X{ 0 };
+  int64_t Y{ 0 };
+  int64_t Z{ 0 };
+
+  uint32_t Count{ 0 };
+  int64_t FirstTimestamp{ 0 };
+  int64_t LastTimestamp{ 0 };
+
+  void Add(MouseEvent const& mouseEvent)
+  {
+    if (Count++ == 0)
+      FirstTimestamp = mouseEvent.Timestamp;
+    LastTimestamp = mouseEvent.Timestamp;
+
+    X += mouseEvent.X;
+    Y += mouseEvent.Y;
+    Z += mouseEvent.Z;
+  }
+};
+
+// Fixed size single producer / single consumer ring of mouse events.
+// The window thread pushes one event per WM_INPUT and the consumer
+// drains everything queued since its last call in one batch. Nothing is
+// allocated after construction.
+//
+// If the consumer falls behind and the ring fills up, events are folded
+// into an overflow sum that's added to the next drain, so motion is
+// never dropped, only its timing gets coarser.
+template <size_t Capacity>
+class MouseEventQueue
+{
+  static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+  MouseEventQueue() :
+    m_Events(),
+    m_Head(0),
+    m_Tail(0),
+    m_OverflowX(0),
+    m_OverflowY(0),
+    m_OverflowZ(0),
+    m_OverflowCount(0),
+    m_OverflowTimestamp(0)
+  {
+  }
+
+  // Producer side
+  void Push(MouseEvent const& mouseEvent)
+  {
+    uint32_t head = m_Head.load(std::memory_order_relaxed);
+    uint32_t tail = m_Tail.load(std::memory_order_acquire);
+
+    if (head - tail >= Capacity)
+    {
+      m_OverflowX.fetch_add(mouseEvent.X, std::memory_order_relaxed);
+      m_OverflowY.fetch_add(mouseEvent.Y, std::memory_order_relaxed);
+      m_OverflowZ.fetch_add(mouseEvent.Z, std::memory_order_relaxed);
+      m_OverflowTimestamp.store(mouseEvent.Timestamp, std::memory_order_relaxed);
+      m_OverflowCount.fetch_add(1, std::memory_order_release);
+      return;
+    }
+
+    m_Events[head & (Capacity - 1)] = mouseEvent;
+    m_Head.store(head + 1, std::memory_order_release);
+  }
+
+  // Consumer side, calls onEvent(MouseEvent const&) in order for every
+  // queued event with a timestamp up to and including `until` and
+  // returns their sum. Later events stay queued for the next window.
+  template <typename F>
+  MouseDelta Drain(int64_t until, F&& onEvent)
+  {
+    MouseDelta delta;
+
+    uint32_t tail = m_Tail.load(std::memory_order_relaxed);
+    uint32_t head = m_Head.load(std::memory_order_acquire);
+
+    for (; tail != head; ++tail)
+    {
+      MouseEvent const& mouseEvent = m_Events[tail & (Capacity - 1)];
+      if (mouseEvent.Timestamp > until)
+        break;
+
+      onEvent(mouseEvent);
+      delta.Add(mouseEvent);
+    }
+    m_Tail.store(tail, std::memory_order_release);
+
+    // Overflowed events are newer than anything in the ring, so they
+    // are only taken once the ring has been emptied. Taking the count
+    // first means a push racing with this is at worst split across two
+    // drains, but never lost.
+    if (tail == head && m_OverflowCount.load(std::memory_order_acquire) &&
+        m_OverflowTimestamp.load(std::memory_order_relaxed) <= until)
+    {
+      m_OverflowCount.exchange(0, std::memory_order_acquire);
+
+      MouseEvent overflow;
+      overflow.Timestamp = m_OverflowTimestamp.load(std::memory_order_relaxed);
+      overflow.X = m_OverflowX.exchange(0, std::memory_order_relaxed);
+      overflow.Y = m_OverflowY.exchange(0, std::memory_order_relaxed);
+      overflow.Z = m_OverflowZ.exchange(0, std::memory_order_relaxed);
+
+      onEvent(overflow);
+      delta.Add(overflow);
+    }
+
+    return delta;
+  }
+
+  MouseDelta Drain(int64_t until)
+  {
+    return Drain(until, [](MouseEvent const&) {});
+  }
+
+  MouseDelta Drain()
+  {
+    return Drain((std::numeric_limits<int64_t>::max)());
+  }
+
+private:
+  std::array<MouseEvent, Capacity> m_Events;
+  std::atomic<uint32_t> m_Head;
+  std::atomic<uint32_t> m_Tail;
+
+  std::atomic<int32_t> m_OverflowX;
+  std::atomic<int32_t> m_OverflowY;
+  std::atomic<int32_t> m_OverflowZ;
+  std::atomic<uint32_t> m_OverflowCount;
+  std::atomic<int64_t> m_OverflowTimestamp;
+};
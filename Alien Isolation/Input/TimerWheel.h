@@ -0,0 +1,131 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <Windows.h>
+
+// Small hashed timer wheel used by the input thread.
+// Timers are identified by an index below MaxTimers and fire at most
+// once per Schedule(). Each slot covers one tick, timers further away
+// than a full revolution simply stay in their slot until their due
+// time has been reached.
+class TimerWheel
+{
+public:
+  static const int MaxTimers = 32;
+  static const int SlotCount = 64;
+
+  explicit TimerWheel(unsigned int tickMs) :
+    m_TickMs(tickMs ? tickMs : 1),
+    m_CurrentTick(0),
+    m_Active(0),
+    m_Slots(),
+    m_DueTimes()
+  {
+  }
+
+  void Start(ULONGLONG now)
+  {
+    m_CurrentTick = now / m_TickMs;
+  }
+
+  // (Re)schedules a timer to fire `delayMs` milliseconds from now
+  void Schedule(int id, unsigned int delayMs, ULONGLONG now)
+  {
+    Cancel(id);
+
+    ULONGLONG due = now + delayMs;
+    m_DueTimes[id] = due;
+    m_Slots[(due / m_TickMs) % SlotCount] |= (1u << id);
+    m_Active |= (1u << id);
+  }
+
+  void Cancel(int id)
+  {
+    if (!IsScheduled(id))
+      return;
+
+    m_Slots[(m_DueTimes[id] / m_TickMs) % SlotCount] &= ~(1u << id);
+    m_Active &= ~(1u << id);
+  }
+
+  bool IsScheduled(int id) const
+  {
+    return (m_Active & (1u << id)) != 0;
+  }
+
+  // Milliseconds until the next timer is due, INFINITE if none are scheduled
+  DWORD TimeUntilNext(ULONGLONG now) const
+  {
+    if (!m_Active)
+      return INFINITE;
+
+    ULONGLONG next = ~0ULL;
+    for (int id = 0; id < MaxTimers; ++id)
+    {
+      if (IsScheduled(id) && m_DueTimes[id] < next)
+        next = m_DueTimes[id];
+    }
+
+    return next <= now ? 0 : static_cast<DWORD>(next - now);
+  }
+
+  // Walks the slots between the previous call and `now` and calls
+  // onExpired(id) for every timer that is due. Timers are unscheduled
+  // before the callback runs so it can schedule them again.
+  template <typename F>
+  void Advance(ULONGLONG now, F&& onExpired)
+  {
+    ULONGLONG nowTick = now / m_TickMs;
+    ULONGLONG ticks = nowTick - m_CurrentTick + 1;
+    if (ticks > SlotCount)
+      ticks = SlotCount;
+
+    uint32_t expired = 0;
+    for (ULONGLONG i = 0; i < ticks; ++i)
+    {
+      uint32_t& slot = m_Slots[(nowTick - i) % SlotCount];
+      uint32_t candidates = slot;
+      while (candidates)
+      {
+        int id = LowestBit(candidates);
+        candidates &= candidates - 1;
+
+        if (m_DueTimes[id] <= now)
+        {
+          slot &= ~(1u << id);
+          expired |= (1u << id);
+        }
+      }
+    }
+
+    m_Active &= ~expired;
+    m_CurrentTick = nowTick;
+
+    while (expired)
+    {
+      int id = LowestBit(expired);
+      expired &= expired - 1;
+      onExpired(id);
+    }
+  }
+
+private:
+  static int LowestBit(uint32_t mask)
+  {
+    int index = 0;
+    while (!(mask & 1))
+    {
+      mask >>= 1;
+      ++index;
+    }
+    return index;
+  }
+
+private:
+  ULONGLONG m_TickMs;
+  ULONGLONG m_CurrentTick;
+  uint32_t m_Active;
+
+  std::array<uint32_t, SlotCount> m_Slots;
+  std::array<ULONGLONG, MaxTimers> m_DueTimes;
+};
@@ -0,0 +1,82 @@
+#include "VirtualInputBackend.h"
+
+VirtualInputBackend::VirtualInputBackend() :
+  m_Tick(0),
+  m_Keys(),
+  m_GamepadConnected(false),
+  m_Gamepad()
+{
+}
+
+bool VirtualInputBackend::IsKeyDown(int vkey)
+{
+  if (vkey <= 0 || vkey > 0xFF)
+    return false;
+
+  return m_Keys[vkey];
+}
+
+bool VirtualInputBackend::FindGamepad(int forcedId)
+{
+  // There's only one virtual pad, in slot 0
+  return m_GamepadConnected && forcedId <= 0;
+}
+
+bool VirtualInputBackend::PollGamepad(GamepadState& state)
+{
+  if (!m_GamepadConnected)
+    return false;
+
+  state = m_Gamepad;
+  return true;
+}
+
+void VirtualInputBackend::SetKey(int vkey, bool isDown)
+{
+  if (vkey > 0 && vkey <= 0xFF)
+    m_Keys[vkey] = isDown;
+}
+
+void VirtualInputBackend::SetGamepadConnected(bool isConnected)
+{
+  m_GamepadConnected = isConnected;
+}
+
+void VirtualInputBackend::SetGamepad(GamepadState const& state)
+{
+  m_Gamepad = state;
+}
+
+void VirtualInputBackend::At(uint32_t tick, Step const& step)
+{
+  m_Script.emplace(tick, step);
+}
+
+void VirtualInputBackend::PressKey(uint32_t tick, int vkey)
+{
+  At(tick, [vkey](VirtualInputBackend& backend) { backend.SetKey(vkey, true); });
+}
+
+void VirtualInputBackend::ReleaseKey(uint32_t tick, int vkey)
+{
+  At(tick, [vkey](VirtualInputBackend& backend) { backend.SetKey(vkey, false); });
+}
+
+void VirtualInputBackend::SetGamepadAt(uint32_t tick, GamepadState const& state)
+{
+  At(tick, [state](VirtualInputBackend& backend)
+  {
+    backend.SetGamepadConnected(true);
+    backend.SetGamepad(state);
+  });
+}
+
+void VirtualInputBackend::Advance()
+{
+  auto range = m_Script.equal_range(m_Tick);
+  for (auto it = range.first; it != range.second; ++it)
+    it->second(*this);
+
+  m_Script.erase(range.first, range.second);
+  m_Tick += 1;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include "InputBackend.h"
+
+#include <array>
+#include <functional>
+#include <map>
+#include <vector>
+
+// Scripted input device. Steps are scheduled on tick numbers and
+// applied by Advance(), so a run is fully deterministic and needs no
+// window, keyboard or gamepad. Only built into Tests/, not the DLL.
+class VirtualInputBackend : public InputBackend
+{
+public:
+  typedef std::function<void(VirtualInputBackend&)> Step;
+
+  VirtualInputBackend();
+
+  bool IsKeyDown(int vkey) override;
+  bool FindGamepad(int forcedId) override;
+  bool PollGamepad(GamepadState& state) override;
+
+  // Direct control
+  void SetKey(int vkey, bool isDown);
+  void SetGamepadConnected(bool isConnected);
+  void SetGamepad(GamepadState const& state);
+
+  // Scripted control, the step runs when Advance() reaches the tick
+  void At(uint32_t tick, Step const& step);
+  void PressKey(uint32_t tick, int vkey);
+  void ReleaseKey(uint32_t tick, int vkey);
+  void SetGamepadAt(uint32_t tick, GamepadState const& state);
+
+  // Runs the steps scheduled on the current tick and moves to
+  // the next one, call once before every pipeline update
+  void Advance();
+  uint32_t GetTick() const { return m_Tick; }
+
+private:
+  uint32_t m_Tick;
+  std::array<bool, 256> m_Keys;
+  bool m_GamepadConnected;
+  GamepadState m_Gamepad;
+  std::multimap<uint32_t, Step> m_Script;
+};
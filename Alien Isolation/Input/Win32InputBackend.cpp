@@ -0,0 +1,195 @@
+#include "Win32InputBackend.h"
+#include "../Util/Util.h"
+
+#pragma comment(lib, "dinput8.lib")
+#pragma comment(lib, "dxguid.lib")
+#pragma comment(lib, "XInput9_1_0.lib")
+
+Win32InputBackend::Win32InputBackend() :
+  m_DInputInterface(NULL)
+{
+}
+
+Win32InputBackend::~Win32InputBackend()
+{
+  if (m_Gamepad.DInputGamepad)
+    m_Gamepad.DInputGamepad->Release();
+
+  if (m_DInputInterface)
+    m_DInputInterface->Release();
+}
+
+void Win32InputBackend::Initialize()
+{
+  HRESULT hr = DirectInput8Create(GetModuleHandle(NULL), DIRECTINPUT_VERSION, IID_IDirectInput8A, (LPVOID*)&m_DInputInterface, NULL);
+  if (FAILED(hr))
+  {
+    util::log::Error("Unable to create DirectInput interface. HRESULT 0x%X", hr);
+    util::log::Warning("DirectInput controllers unavailable");
+  }
+}
+
+bool Win32InputBackend::IsKeyDown(int vkey)
+{
+  return (GetKeyState(vkey) & 0x8000) != 0;
+}
+
+bool Win32InputBackend::FindGamepad(int forcedId)
+{
+  // Scanning for disconnected XInput pads can take a while, which
+  // is why InputSystem only calls this with a backoff or after
+  // WM_DEVICECHANGE.
+
+  if (m_Gamepad.IsPresent)
+    return true;
+
+  // Scan for XInput controllers first so they don't get
+  // detected as DInput controllers.
+  if (forcedId >= 0)
+  {
+    DWORD dwResult = XInputGetState(forcedId, &m_Gamepad.XInputState);
+    if (dwResult == ERROR_SUCCESS)
+    {
+      m_Gamepad.XInputId = forcedId;
+      m_Gamepad.Type = GamepadType::XInput;
+      util::log::Write("Found a XInput controller ID %i", m_Gamepad.XInputId);
+      m_Gamepad.IsPresent = true;
+    }
+  }
+  else
+  {
+    for (DWORD i = 0; i < XUSER_MAX_COUNT; i++)
+    {
+      DWORD dwResult = XInputGetState(i, &m_Gamepad.XInputState);
+      if (dwResult == ERROR_SUCCESS)
+      {
+        m_Gamepad.XInputId = i;
+        m_Gamepad.Type = GamepadType::XInput;
+        util::log::Write("Found a XInput controller ID %i", m_Gamepad.XInputId);
+        m_Gamepad.IsPresent = true;
+        break;
+      }
+    }
+  }
+
+//   if (m_Gamepad.IsPresent) return true;
+// 
+//   // And then lets search for DInput controllers
+//   if (m_DInputInterface == NULL) return false;
+//   HRESULT hr = m_DInputInterface->EnumDevices(DI8DEVCLASS_GAMECTRL, (LPDIENUMDEVICESCALLBACKA)DIEnumDevicesCallback, this, DIEDFL_ATTACHEDONLY);
+//   if (FAILED(hr)) return false;
+// 
+//   if (m_Gamepad.DInputGamepad == NULL) return false;
+//   hr = m_Gamepad.DInputGamepad->SetDataFormat(&c_dfDIJoystick2);
+//   if (FAILED(hr)) return false;
+//   hr = m_Gamepad.DInputGamepad->Acquire();
+//   if (FAILED(hr)) return false;
+// 
+//   m_Gamepad.IsPresent = true;
+//   m_Gamepad.Type = GamepadType::DirectInput;
+//   util::log::Write("Found a DirectInput controller");
+
+  return m_Gamepad.IsPresent;
+}
+
+bool Win32InputBackend::PollGamepad(GamepadState& state)
+{
+  if (!m_Gamepad.IsPresent)
+    return false;
+
+  if (m_Gamepad.Type == GamepadType::XInput)
+    return PollXInput(state);
+  else
+    return PollDInput(state);
+}
+
+bool Win32InputBackend::PollXInput(GamepadState& state)
+{
+  XINPUT_STATE xiState{ 0 };
+  DWORD dwResult = XInputGetState(m_Gamepad.XInputId, &xiState);
+  if (dwResult != ERROR_SUCCESS)
+  {
+    m_Gamepad.IsPresent = false;
+    util::log::Warning("Xbox controller lost");
+    return false;
+  }
+
+  state.LeftX = xiState.Gamepad.sThumbLX / 32767.f;
+  state.LeftY = xiState.Gamepad.sThumbLY / 32767.f;
+  state.RightX = xiState.Gamepad.sThumbRX / 32767.f;
+  state.RightY = xiState.Gamepad.sThumbRY / 32767.f;
+  state.Triggers = (-(int)(xiState.Gamepad.bLeftTrigger) + (int)(xiState.Gamepad.bRightTrigger)) / 255.f;
+
+  WORD buttons = xiState.Gamepad.wButtons;
+  state.SetButton(GamepadKey::LeftThumb, (buttons & XINPUT_GAMEPAD_LEFT_THUMB) != 0);
+  state.SetButton(GamepadKey::RightThumb, (buttons & XINPUT_GAMEPAD_RIGHT_THUMB) != 0);
+  state.SetButton(GamepadKey::LeftShoulder, (buttons & XINPUT_GAMEPAD_LEFT_SHOULDER) != 0);
+  state.SetButton(GamepadKey::RightShoulder, (buttons & XINPUT_GAMEPAD_RIGHT_SHOULDER) != 0);
+
+  state.SetButton(GamepadKey::DPad_Left, (buttons & XINPUT_GAMEPAD_DPAD_LEFT) != 0);
+  state.SetButton(GamepadKey::DPad_Right, (buttons & XINPUT_GAMEPAD_DPAD_RIGHT) != 0);
+  state.SetButton(GamepadKey::DPad_Up, (buttons & XINPUT_GAMEPAD_DPAD_UP) != 0);
+  state.SetButton(GamepadKey::DPad_Down, (buttons & XINPUT_GAMEPAD_DPAD_DOWN) != 0);
+
+  state.SetButton(GamepadKey::Button1, (buttons & XINPUT_GAMEPAD_X) != 0);
+  state.SetButton(GamepadKey::Button2, (buttons & XINPUT_GAMEPAD_A) != 0);
+  state.SetButton(GamepadKey::Button3, (buttons & XINPUT_GAMEPAD_B) != 0);
+  state.SetButton(GamepadKey::Button4, (buttons & XINPUT_GAMEPAD_Y) != 0);
+  state.SetButton(GamepadKey::Button5, (buttons & XINPUT_GAMEPAD_BACK) != 0);
+  state.SetButton(GamepadKey::Button6, (buttons & XINPUT_GAMEPAD_START) != 0);
+  return true;
+}
+
+bool Win32InputBackend::PollDInput(GamepadState& state)
+{
+  DIJOYSTATE2 diState{ 0 };
+  HRESULT result = m_Gamepad.DInputGamepad->GetDeviceState(sizeof(DIJOYSTATE2), &diState);
+  if (result != S_OK)
+  {
+    m_Gamepad.DInputGamepad->Release();
+    m_Gamepad.DInputGamepad = nullptr;
+    util::log::Warning("DirectInput controller lost");
+    m_Gamepad.IsPresent = false;
+    return false;
+  }
+
+  // Axes are 0 - 65535 with Y pointing down
+  state.LeftX = (diState.lX - 32767) / 32767.f;
+  state.LeftY = -(diState.lY - 32767) / 32767.f;
+  state.RightX = (diState.lZ - 32767) / 32767.f;
+  state.RightY = -(diState.lRz - 32767) / 32767.f;
+  // lRx is the right trigger and lRy the left one
+  state.Triggers = ((int)(diState.lRx) - (int)(diState.lRy)) / 65535.f;
+
+  state.SetButton(GamepadKey::LeftThumb, diState.rgbButtons[10] == 128);
+  state.SetButton(GamepadKey::RightThumb, diState.rgbButtons[11] == 128);
+  state.SetButton(GamepadKey::LeftShoulder, diState.rgbButtons[4] == 128);
+  state.SetButton(GamepadKey::RightShoulder, diState.rgbButtons[5] == 128);
+
+  state.SetButton(GamepadKey::DPad_Left, diState.rgdwPOV[0] == 27000);
+  state.SetButton(GamepadKey::DPad_Right, diState.rgdwPOV[0] == 9000);
+  state.SetButton(GamepadKey::DPad_Up, diState.rgdwPOV[0] == 0);
+  state.SetButton(GamepadKey::DPad_Down, diState.rgdwPOV[0] == 18000);
+
+  state.SetButton(GamepadKey::Button1, diState.rgbButtons[0] == 128);
+  state.SetButton(GamepadKey::Button2, diState.rgbButtons[1] == 128);
+  state.SetButton(GamepadKey::Button3, diState.rgbButtons[2] == 128);
+  state.SetButton(GamepadKey::Button4, diState.rgbButtons[3] == 128);
+  state.SetButton(GamepadKey::Button5, diState.rgbButtons[8] == 128);
+  state.SetButton(GamepadKey::Button6, diState.rgbButtons[9] == 128);
+  return true;
+}
+
+BOOL Win32InputBackend::DIEnumDevicesCallback(LPCDIDEVICEINSTANCE lpddi, LPVOID pvRef)
+{
+  Win32InputBackend* pBackend = static_cast<Win32InputBackend*>(pvRef);
+
+  HRESULT hr = pBackend->m_DInputInterface->CreateDevice(lpddi->guidInstance, &pBackend->m_Gamepad.DInputGamepad, NULL);
+  if (FAILED(hr))
+  {
+    util::log::Error("Failed to create DirectInput device. HRESULT 0x%X", hr);
+    return DIENUM_CONTINUE;
+  }
+
+  return DIENUM_STOP;
+}
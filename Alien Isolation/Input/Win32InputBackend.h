@@ -0,0 +1,51 @@
+#pragma once
+#include "InputBackend.h"
+
+#include <dinput.h>
+#include <Xinput.h>
+
+enum GamepadType
+{
+  XInput,
+  DirectInput
+};
+
+struct GamepadInfo
+{
+  bool IsPresent{ false };
+  GamepadType Type;
+
+  int XInputId{ 0 };
+  LPDIRECTINPUTDEVICE8 DInputGamepad{ NULL };
+
+  XINPUT_STATE XInputState{ 0 };
+  DIJOYSTATE2 DInputState{ 0 };
+};
+
+// Keyboard through GetKeyState and gamepads through XInput or DirectInput
+class Win32InputBackend : public InputBackend
+{
+public:
+  Win32InputBackend();
+  ~Win32InputBackend();
+
+  void Initialize();
+
+  bool IsKeyDown(int vkey) override;
+  bool FindGamepad(int forcedId) override;
+  bool PollGamepad(GamepadState& state) override;
+
+private:
+  bool PollXInput(GamepadState& state);
+  bool PollDInput(GamepadState& state);
+
+  static BOOL DIEnumDevicesCallback(LPCDIDEVICEINSTANCE lpddi, LPVOID pvRef);
+
+private:
+  LPDIRECTINPUT8 m_DInputInterface;
+  GamepadInfo m_Gamepad;
+
+public:
+  Win32InputBackend(Win32InputBackend const&) = delete;
+  void operator=(Win32InputBackend const&) = delete;
+};
@@ -5,7 +5,6 @@
 #include <algorithm>
 #include <boost/filesystem.hpp>
 #include <boost/chrono.hpp>
-#include <fstream>
 #include <string>
 #include <Psapi.h>
 #pragma comment(lib, "Psapi.lib")
@@ -14,6 +13,8 @@ static const char* g_gameName = "Alien: Isolation";
 static const char* g_moduleName = "AI.exe";
 static const char* g_className = "Alien: Isolation";
 static const char* g_configFile = "./Cinematic Tools/config.ini";
+// How long the config has to stay unchanged before it's saved
+static const ULONGLONG g_configSaveDelayMs = 1000;
 
 Main* g_mainHandle = nullptr;
 HINSTANCE g_dllHandle = NULL;
@@ -31,8 +32,7 @@ IDXGISwapChain* g_dxgiSwapChain = nullptr;
 
 Main::Main() :
   m_Initialized(false),
-  m_ConfigChanged(false),
-  m_dtConfigCheck(0)
+  m_ConfigChangedAt(0)
 {
 
 }
@@ -41,8 +41,9 @@ Main::~Main()
 {
   util::log::Write("~Main()");
 
-  // Save config and disable hooks before exit
-  if (m_ConfigChanged)
+  // Save config and disable hooks before exit, the config writer
+  // finishes writing when it's destroyed
+  if (m_ConfigChangedAt)
     SaveConfig();
 
   util::hooks::SetHookState(false);
@@ -53,6 +54,7 @@ bool Main::Initialize()
 {
   boost::filesystem::path mainDir("./Cinematic Tools/");
   boost::filesystem::path profileDir("./Cinematic Tools/Profiles");
+  boost::filesystem::path recordingDir("./Cinematic Tools/Recordings");
 
   if (!boost::filesystem::exists(mainDir))
     boost::filesystem::create_directory(mainDir);
@@ -60,6 +62,9 @@ bool Main::Initialize()
   if (!boost::filesystem::exists(profileDir))
     boost::filesystem::create_directory(profileDir);
 
+  if (!boost::filesystem::exists(recordingDir))
+    boost::filesystem::create_directory(recordingDir);
+
   util::log::Init();
   util::log::Write("Cinematic Tools for %s\n", g_gameName);
 
@@ -98,6 +103,9 @@ bool Main::Initialize()
     return false;
   }
 
+  // Everything below reads offsets, so they're resolved first
+  util::offsets::Scan();
+
   if (!util::hooks::Init())
     return false;
 
@@ -112,7 +120,7 @@ bool Main::Initialize()
     if (!GetModuleInformation(GetCurrentProcess(), g_gameHandle, &modInfo, sizeof(modInfo)))
       util::log::Warning("GetModuleInformation failed, GetLastError 0x%X", GetLastError());
 
-    int d3dSingletonAddr = util::offsets::GetRelOffset("OFFSET_D3D");
+    int d3dSingletonAddr = static_cast<int>(util::offsets::GetRel(util::offsets::OFFSET_D3D));
     uintptr_t d3dSingletonAbs = (uintptr_t)g_gameHandle + (uintptr_t)d3dSingletonAddr;
 
     if (!util::IsAddressInModule(g_gameHandle, reinterpret_cast<void*>(d3dSingletonAbs), sizeof(void*)))
@@ -215,7 +223,7 @@ bool Main::Initialize()
 
   // Make timescale writable
   {
-    int tsAddr = util::offsets::GetOffset("OFFSET_TIMESCALE");
+    int tsAddr = static_cast<int>(util::offsets::Get(util::offsets::OFFSET_TIMESCALE));
     if (util::IsAddressInModule(g_gameHandle, (void*)tsAddr, sizeof(double)))
     {
       DWORD dwOld = 0;
@@ -228,21 +236,23 @@ bool Main::Initialize()
     }
   }
 
-  // Retrieve game version and make a const variable for whatever version
-  // the tools support. If versions mismatch, scan for offsets.
-  util::offsets::Scan();
-
   m_pRenderer = std::make_unique<CTRenderer>();
   if (!m_pRenderer->Initialize())
     return false;
 
+  m_pConfigWriter = std::make_unique<util::ConfigWriter>();
   m_pCameraManager = std::make_unique<CameraManager>();
   m_pCharacterController = std::make_unique<CharacterController>();
   m_pInputSystem = std::make_unique<InputSystem>();
   m_pVisualsController = std::make_unique<VisualsController>();
+  m_pPerfOverlay = std::make_unique<PerfOverlay>();
   m_pUI = std::make_unique<UI>();
 
   m_pInputSystem->Initialize();
+  m_pCameraManager->RegisterHotkeys();
+  m_pCharacterController->RegisterHotkeys();
+  m_pPerfOverlay->RegisterHotkeys();
+
   if (!m_pUI->Initialize())
     return false;
 
@@ -270,23 +280,22 @@ void Main::Run()
     boost::chrono::duration<float> dt = boost::chrono::high_resolution_clock::now() - lastUpdate;
     lastUpdate = boost::chrono::high_resolution_clock::now();
 
-    m_pInputSystem->Update();
-    m_pCameraManager->Update(dt.count());
+    // During input playback the camera runs on the recorded frame times
+    float inputDt = m_pInputSystem->Update(dt.count());
+    m_pCameraManager->Update(inputDt);
     m_pCharacterController->Update();
     m_pVisualsController->Update();
     m_pUI->Update(dt.count());
 
-    // Check if config has been affected, if so, save it
-    m_dtConfigCheck += dt.count();
-    if (m_dtConfigCheck > 10.f)
-    {
-      m_dtConfigCheck = 0;
-      if (m_ConfigChanged)
-      {
-        m_ConfigChanged = false;
-        SaveConfig();
-      }
-    }
+    // Save the config once it has settled, so dragging a slider saves
+    // once at the end rather than every frame
+    ULONGLONG changedAt = m_ConfigChangedAt;
+    if (changedAt && GetTickCount64() - changedAt > g_configSaveDelayMs
+      && m_ConfigChangedAt.compare_exchange_strong(changedAt, 0))
+      SaveConfig();
+
+    boost::chrono::duration<float, boost::milli> tick = boost::chrono::high_resolution_clock::now() - lastUpdate;
+    m_pPerfOverlay->OnMainTick(tick.count());
 
     Sleep(10);
   }
@@ -294,48 +303,42 @@ void Main::Run()
 
 void Main::OnConfigChanged()
 {
-  m_ConfigChanged = true;
+  m_ConfigChangedAt = GetTickCount64();
 }
 
 void Main::LoadConfig()
 {
-  // Read config.ini using inih by Ben Hoyt
-  // https://github.com/benhoyt/inih
+  // Read config.ini, see Util/IniFile.h for the format
 
-  m_pConfig = std::make_unique<INIReader>(g_configFile);
+  m_pConfig = std::make_unique<util::IniFile>(g_configFile);
   int parseResult = m_pConfig->ParseError();
 
   // If there's problems reading the file, notify the user.
   // Code-wise it should be safe to just continue,
-  // since you can still request variables from INIReader.
+  // since you can still request variables from IniFile.
   // They'll just return the specified default value.
   if (parseResult != 0)
   {
     util::log::Warning("Config file could not be loaded, using default settings");
-    m_ConfigChanged = true; // Mark config as dirty so defaults get saved in the file
+    m_ConfigChangedAt = GetTickCount64(); // Mark config as dirty so defaults get saved in the file
   }
 
   m_pCameraManager->ReadConfig(m_pConfig.get());
   m_pInputSystem->ReadConfig(m_pConfig.get());
+
+  util::log::SetBinarySink(m_pConfig->GetBoolean("Log", "Binary", false));
 }
 
 void Main::SaveConfig()
 {
-  util::log::Write("Saving current config...");
-
-  std::fstream file;
-  file.open(g_configFile, std::ios_base::out | std::ios_base::trunc);
-
-  if (!file.is_open())
-  {
-    util::log::Error("Could not save config, failed to open file for writing. GetLastError 0x%X", GetLastError());
-    return;
-  }
-
-  file << m_pCameraManager->GetConfig();
-  file << m_pInputSystem->GetConfig();
-  
-  file.close();
+  // Only building the text happens here, the writer thread compares it
+  // with the file and writes it if it changed
+  std::string config = m_pCameraManager->GetConfig();
+  config += m_pInputSystem->GetConfig();
+  config += "[Log]\n";
+  config += "Binary = " + std::to_string(util::log::IsBinarySinkEnabled()) + "\n";
+
+  m_pConfigWriter->Queue(g_configFile, std::move(config));
 }
 
 void Main::OnMapChange()
@@ -370,6 +373,10 @@ LRESULT CALLBACK Main::WndProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lPara
   case WM_ACTIVATE:
     // Focus event
     g_hasFocus = (wParam != WA_INACTIVE);
+    g_mainHandle->m_pInputSystem->Wake();
+    break;
+  case WM_DEVICECHANGE:
+    g_mainHandle->m_pInputSystem->HandleDeviceChange();
     break;
   case WM_INPUT:
     if (!g_mainHandle->m_pUI->IsEnabled())
@@ -383,6 +390,28 @@ LRESULT CALLBACK Main::WndProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lPara
         (g_mainHandle->GetCameraManager()->IsCameraEnabled() && g_mainHandle->GetCameraManager()->IsKbmDisabled()))
       return TRUE;
     break;
+  case WM_SYSKEYDOWN:
+    // Alt, Alt + key and F10. Only swallowed while a binding is being
+    // captured, so Alt + F4 and the window menu keep working.
+    if (g_mainHandle->m_pInputSystem->HandleKeyMsg(wParam, lParam))
+      return TRUE;
+    break;
+  case WM_LBUTTONDOWN:
+  case WM_LBUTTONDBLCLK:
+    g_mainHandle->m_pInputSystem->LatchKey(VK_LBUTTON);
+    break;
+  case WM_RBUTTONDOWN:
+  case WM_RBUTTONDBLCLK:
+    g_mainHandle->m_pInputSystem->LatchKey(VK_RBUTTON);
+    break;
+  case WM_MBUTTONDOWN:
+  case WM_MBUTTONDBLCLK:
+    g_mainHandle->m_pInputSystem->LatchKey(VK_MBUTTON);
+    break;
+  case WM_XBUTTONDOWN:
+  case WM_XBUTTONDBLCLK:
+    g_mainHandle->m_pInputSystem->LatchKey(GET_XBUTTON_WPARAM(wParam) == XBUTTON1 ? VK_XBUTTON1 : VK_XBUTTON2);
+    break;
   case WM_MOUSEMOVE:
     g_mainHandle->m_pInputSystem->HandleMouseMsg(lParam);
     break;
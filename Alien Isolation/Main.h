@@ -2,11 +2,14 @@
 #include "Camera/CameraManager.h"
 #include "Input/InputSystem.h"
 #include "Rendering/CTRenderer.h"
+#include "Rendering/PerfOverlay.h"
 #include "Tools/CharacterController.h"
 #include "Tools/VisualsController.h"
 #include "UI.h"
+#include "Util/ConfigWriter.h"
+#include "Util/IniFile.h"
 
-#include "inih/cpp/INIReader.h"
+#include <atomic>
 #include <memory>
 #include <Windows.h>
 
@@ -22,7 +25,9 @@ public:
   CameraManager* GetCameraManager() { return m_pCameraManager.get(); }
   CharacterController* GetCharacterController() { return m_pCharacterController.get(); }
   CTRenderer* GetRenderer() { return m_pRenderer.get(); }
+  util::ConfigWriter* GetConfigWriter() { return m_pConfigWriter.get(); }
   InputSystem* GetInputSystem() { return m_pInputSystem.get(); }
+  PerfOverlay* GetPerfOverlay() { return m_pPerfOverlay.get(); }
   UI* GetUI() { return m_pUI.get(); }
   VisualsController* GetVisualsController() { return m_pVisualsController.get(); }
 
@@ -37,18 +42,20 @@ private:
   static LRESULT CALLBACK WndProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
 
 private:
-  std::unique_ptr<INIReader> m_pConfig;
+  std::unique_ptr<util::IniFile> m_pConfig;
+  std::unique_ptr<util::ConfigWriter> m_pConfigWriter;
 
   std::unique_ptr<CameraManager> m_pCameraManager;
   std::unique_ptr<CharacterController> m_pCharacterController;
   std::unique_ptr<InputSystem> m_pInputSystem;
   std::unique_ptr<VisualsController> m_pVisualsController;
   std::unique_ptr<CTRenderer> m_pRenderer;
+  std::unique_ptr<PerfOverlay> m_pPerfOverlay;
   std::unique_ptr<UI> m_pUI;
 
   bool m_Initialized;
-  bool m_ConfigChanged;
-  float m_dtConfigCheck;
+  // GetTickCount64 of the latest unsaved change, 0 if there's none
+  std::atomic<ULONGLONG> m_ConfigChangedAt;
 
 public:
   Main(Main const&) = delete;
@@ -0,0 +1,186 @@
+#include "PerfOverlay.h"
+#include "../Main.h"
+#include "../imgui/imgui.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <Windows.h>
+
+static const char* g_sectionNames[] = {
+  "Matrices",
+  "UI"
+};
+
+static_assert(sizeof(g_sectionNames) / sizeof(g_sectionNames[0]) == PerfSectionCount,
+  "g_sectionNames has to have an entry for every PerfSection");
+
+// Frame time graph range, grows when a frame takes longer
+static const float g_graphMinMs = 33.4f;
+
+PerfOverlay::Section::Section(PerfOverlay* pOverlay, PerfSection section) :
+  m_pOverlay(pOverlay),
+  m_Section(section),
+  m_Start(PerfOverlay::Now())
+{
+}
+
+PerfOverlay::Section::~Section()
+{
+  m_pOverlay->m_SectionTicks[m_Section] += PerfOverlay::Now() - m_Start;
+}
+
+PerfOverlay::PerfOverlay() :
+  m_Visible(false),
+  m_MsPerTick(0),
+  m_LastPresent(0),
+  m_FrameStart(0),
+  m_SectionTicks(),
+  m_MainTickMaxUs(0),
+  m_MainTicks(0),
+  m_LastMainTickMs(0),
+  m_LastWakeups(0),
+  m_Scratch()
+{
+  LARGE_INTEGER frequency;
+  QueryPerformanceFrequency(&frequency);
+  m_MsPerTick = 1000.0 / frequency.QuadPart;
+}
+
+void PerfOverlay::RegisterHotkeys()
+{
+  InputSystem* pInput = g_mainHandle->GetInputSystem();
+  pInput->Subscribe(Action::TogglePerfOverlay, ActionEventType::Pressed, [this] { Toggle(); });
+}
+
+void PerfOverlay::Toggle()
+{
+  bool wasVisible = m_Visible.load();
+  while (!m_Visible.compare_exchange_weak(wasVisible, !wasVisible))
+    ;
+  util::log::Write("Performance overlay: %s", wasVisible ? "Off" : "On");
+}
+
+void PerfOverlay::BeginFrame()
+{
+  m_FrameStart = Now();
+  if (m_LastPresent != 0)
+    m_FrameMs.Push(ToMs(m_FrameStart - m_LastPresent));
+  m_LastPresent = m_FrameStart;
+
+  m_SectionTicks.fill(0);
+}
+
+void PerfOverlay::EndFrame()
+{
+  m_ToolsMs.Push(ToMs(Now() - m_FrameStart));
+  for (int i = 0; i < PerfSectionCount; ++i)
+    m_SectionMs[i].Push(ToMs(m_SectionTicks[i]));
+
+  // The main loop sleeps 10ms between ticks, so most frames see one
+  // tick or none, in which case the last one is repeated
+  if (m_MainTicks.exchange(0) != 0)
+    m_LastMainTickMs = m_MainTickMaxUs.exchange(0) / 1000.f;
+  m_MainTickMs.Push(m_LastMainTickMs);
+
+  uint32_t wakeups = g_mainHandle->GetInputSystem()->GetWakeups();
+  m_InputWakeups.Push(wakeups - m_LastWakeups);
+  m_LastWakeups = wakeups;
+}
+
+void PerfOverlay::OnMainTick(float tickMs)
+{
+  uint32_t tickUs = static_cast<uint32_t>(tickMs * 1000.f);
+  uint32_t maxUs = m_MainTickMaxUs.load(std::memory_order_relaxed);
+  while (tickUs > maxUs && !m_MainTickMaxUs.compare_exchange_weak(maxUs, tickUs))
+    ;
+
+  m_MainTicks.fetch_add(1);
+}
+
+void PerfOverlay::Draw()
+{
+  if (!m_Visible || m_FrameMs.IsEmpty())
+    return;
+
+  size_t count = m_FrameMs.Count();
+  float frameSum = 0, frameMax = 0, toolsSum = 0, toolsMax = 0, tickMax = 0;
+  std::array<float, PerfSectionCount> sectionSums{};
+  uint32_t wakeups = 0;
+
+  for (size_t i = 0; i < count; ++i)
+  {
+    frameSum += m_FrameMs[i];
+    frameMax = std::max(frameMax, m_FrameMs[i]);
+  }
+
+  // The other series start a frame earlier than frame times
+  size_t toolsCount = m_ToolsMs.Count();
+  for (size_t i = 0; i < toolsCount; ++i)
+  {
+    toolsSum += m_ToolsMs[i];
+    toolsMax = std::max(toolsMax, m_ToolsMs[i]);
+    tickMax = std::max(tickMax, m_MainTickMs[i]);
+    wakeups += m_InputWakeups[i];
+    for (int s = 0; s < PerfSectionCount; ++s)
+      sectionSums[s] += m_SectionMs[s][i];
+  }
+
+  float frameMean = frameSum / count;
+  float toolsMean = toolsSum / toolsCount;
+  float seconds = frameSum / 1000.f;
+
+  ImGui::SetNextWindowPos(ImVec2(10, 10), ImGuiCond_FirstUseEver);
+  ImGui::SetNextWindowBgAlpha(0.6f);
+  ImGui::Begin("Performance", nullptr, ImGuiWindowFlags_NoTitleBar | ImGuiWindowFlags_AlwaysAutoResize
+    | ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_NoFocusOnAppearing | ImGuiWindowFlags_NoInputs);
+  {
+    ImGui::Text("Frame %6.2f ms  (%.0f fps)", frameMean, 1000.f / frameMean);
+    ImGui::Text("p50 %.2f  p99 %.2f  max %.2f ms",
+      Percentile(m_FrameMs, 0.5f), Percentile(m_FrameMs, 0.99f), frameMax);
+    DrawGraph("##frameTimes", m_FrameMs, std::max(g_graphMinMs, frameMax));
+
+    ImGui::Separator();
+    ImGui::Text("Tools %6.3f ms/frame  (%.1f%%)  max %.3f", toolsMean, toolsMean / frameMean * 100.f, toolsMax);
+    for (int s = 0; s < PerfSectionCount; ++s)
+    {
+      ImGui::Text("  %-8s %6.3f ms", g_sectionNames[s], sectionSums[s] / toolsCount);
+      ImGui::SameLine(0, 16);
+    }
+    ImGui::NewLine();
+    DrawGraph("##toolsTimes", m_ToolsMs, std::max(1.f, toolsMax));
+
+    ImGui::Separator();
+    ImGui::Text("Main tick %6.3f ms  max %.3f", m_MainTickMs.Last(), tickMax);
+    ImGui::Text("Input wakeups %.0f/s", seconds > 0 ? wakeups / seconds : 0.f);
+  } ImGui::End();
+}
+
+int64_t PerfOverlay::Now()
+{
+  LARGE_INTEGER now;
+  QueryPerformanceCounter(&now);
+  return now.QuadPart;
+}
+
+float PerfOverlay::ToMs(int64_t ticks) const
+{
+  return static_cast<float>(ticks * m_MsPerTick);
+}
+
+void PerfOverlay::DrawGraph(const char* label, RingBuffer<float, HistorySize> const& values, float scaleMax)
+{
+  ImGui::PlotLines(label, values.Data(), static_cast<int>(values.Count()), static_cast<int>(values.Offset()),
+    nullptr, 0.f, scaleMax, ImVec2(360, 50));
+}
+
+float PerfOverlay::Percentile(RingBuffer<float, HistorySize> const& values, float fraction)
+{
+  size_t count = values.Count();
+  if (count == 0)
+    return 0;
+
+  std::copy(values.Data(), values.Data() + count, m_Scratch.begin());
+  size_t index = std::min(count - 1, static_cast<size_t>(count * fraction));
+  std::nth_element(m_Scratch.begin(), m_Scratch.begin() + index, m_Scratch.begin() + count);
+  return m_Scratch[index];
+}
@@ -0,0 +1,132 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Parts of the tools' own Present work the overlay breaks down
+enum PerfSection
+{
+  PerfSection_UpdateMatrices,
+  PerfSection_DrawUI,
+
+  PerfSectionCount
+};
+
+// Fixed size history of the last Capacity values, the oldest value is
+// overwritten once it's full
+template <typename T, size_t Capacity>
+class RingBuffer
+{
+public:
+  RingBuffer() :
+    m_Values(),
+    m_Next(0),
+    m_Count(0)
+  {
+  }
+
+  void Push(T value)
+  {
+    m_Values[m_Next] = value;
+    m_Next = (m_Next + 1) % Capacity;
+    if (m_Count < Capacity)
+      m_Count += 1;
+  }
+
+  // 0 is the oldest value
+  T const& operator[](size_t index) const { return m_Values[(m_Next + Capacity - m_Count + index) % Capacity]; }
+  T const& Last() const { return (*this)[m_Count - 1]; }
+
+  size_t Count() const { return m_Count; }
+  bool IsEmpty() const { return m_Count == 0; }
+
+  // Raw storage and the index of the oldest value, for ImGui::PlotLines
+  T const* Data() const { return m_Values.data(); }
+  size_t Offset() const { return m_Count < Capacity ? 0 : m_Next; }
+
+private:
+  std::array<T, Capacity> m_Values;
+  size_t m_Next;
+  size_t m_Count;
+};
+
+// Frame time overlay, drawn over the game even while the tools UI is
+// hidden, to show whether the tools are behind a stutter.
+//
+// The Present hook brackets its own work with BeginFrame/EndFrame and
+// times the parts of it with Section. The main loop reports its tick
+// time from its own thread with OnMainTick. Everything is kept in fixed
+// size ring buffers, nothing is allocated per frame.
+class PerfOverlay
+{
+public:
+  static const size_t HistorySize = 512;
+
+  class Section
+  {
+  public:
+    Section(PerfOverlay* pOverlay, PerfSection section);
+    ~Section();
+
+    Section(Section const&) = delete;
+    void operator=(Section const&) = delete;
+
+  private:
+    PerfOverlay* m_pOverlay;
+    PerfSection m_Section;
+    int64_t m_Start;
+  };
+
+public:
+  PerfOverlay();
+
+  void RegisterHotkeys();
+  void Toggle();
+  bool IsVisible() const { return m_Visible; }
+
+  // Render thread, around the tools' work in Present
+  void BeginFrame();
+  void EndFrame();
+
+  // Main loop thread, once per tick
+  void OnMainTick(float tickMs);
+
+  void Draw();
+
+private:
+  static int64_t Now();
+  float ToMs(int64_t ticks) const;
+
+  void DrawGraph(const char* label, RingBuffer<float, HistorySize> const& values, float scaleMax);
+  float Percentile(RingBuffer<float, HistorySize> const& values, float fraction);
+
+private:
+  // Toggled from the input and render threads, read by the render thread
+  std::atomic<bool> m_Visible;
+  double m_MsPerTick;
+
+  int64_t m_LastPresent;
+  int64_t m_FrameStart;
+  std::array<int64_t, PerfSectionCount> m_SectionTicks;
+
+  RingBuffer<float, HistorySize> m_FrameMs;
+  RingBuffer<float, HistorySize> m_ToolsMs;
+  std::array<RingBuffer<float, HistorySize>, PerfSectionCount> m_SectionMs;
+  RingBuffer<float, HistorySize> m_MainTickMs;
+  RingBuffer<uint32_t, HistorySize> m_InputWakeups;
+
+  // Longest main loop tick since the last frame in microseconds, and
+  // how many ticks there were
+  std::atomic<uint32_t> m_MainTickMaxUs;
+  std::atomic<uint32_t> m_MainTicks;
+  float m_LastMainTickMs;
+  uint32_t m_LastWakeups;
+
+  // Sorted copy for percentiles
+  std::array<float, HistorySize> m_Scratch;
+
+public:
+  PerfOverlay(PerfOverlay const&) = delete;
+  void operator=(PerfOverlay const&) = delete;
+};
@@ -65,24 +65,16 @@ void CharacterController::Update()
   }
 }
 
-void CharacterController::OnHotkeyUpdate()
+void CharacterController::RegisterHotkeys()
 {
   InputSystem* pInput = g_mainHandle->GetInputSystem();
 
-  if (pInput->IsActionDown(Action::ToggleInvisibility))
-  {
-    ToggleInvisibility();
-
-    while (pInput->IsActionDown(Action::ToggleInvisibility))
-      Sleep(100);
-  }
-
-  if (pInput->IsActionDown(FreezeCharacters))
+  pInput->Subscribe(Action::ToggleInvisibility, ActionEventType::Pressed, [this] { ToggleInvisibility(); });
+  pInput->Subscribe(Action::FreezeCharacters, ActionEventType::Pressed, [this]
   {
     m_FreezeCharacters = !m_FreezeCharacters;
     util::log::Write("Freeze characters: %s", m_FreezeCharacters ? "On" : "Off");
 
-    Sleep(100);
     CATHODE::CharacterManager* pChrMgr = CATHODE::Main::Singleton()->m_CharacterManager;
     for (unsigned int i = 0; i < pChrMgr->m_NPCCharacterCount; ++i)
     {
@@ -90,11 +82,7 @@ void CharacterController::OnHotkeyUpdate()
       pChr->m_Active = !m_FreezeCharacters;
       pChr->m_Animate = !m_FreezeCharacters;
     }
-
-    while (pInput->IsActionDown(FreezeCharacters))
-      Sleep(100);
-  }
-
+  });
 }
 
 void CharacterController::DrawUI()
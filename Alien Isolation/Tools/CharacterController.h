@@ -15,7 +15,7 @@ public:
   ~CharacterController();
 
   void Update();
-  void OnHotkeyUpdate();
+  void RegisterHotkeys();
 
   void ShowUI() { m_ShowUI = true; }
   void DrawUI();
@@ -2,6 +2,7 @@
 #include "Main.h"
 #include "Util/Util.h"
 #include "Util/ImGuiEXT.h"
+#include "Util/Profiler.h"
 #include "imgui/imgui_impl_dx11.h"
 #include "resource.h"
 
@@ -25,6 +26,7 @@ UI::UI() :
   m_HasMouseFocus(false),
   m_IsResizing(false),
   m_pRTV(nullptr),
+  m_ShowHookProfiler(false),
   m_IsInitialized(false)
 {
 }
@@ -144,7 +146,10 @@ static ImVec2 ScaledImVec2(float x, float y)
 void UI::Draw()
 {
   if (!m_IsInitialized) return;
-  if (!m_Enabled) return;
+
+  // The performance overlay is drawn with the tools UI hidden too
+  PerfOverlay* pOverlay = g_mainHandle->GetPerfOverlay();
+  if (!m_Enabled && !pOverlay->IsVisible()) return;
   if (m_IsResizing)
   {
     // I think it's a good idea to skip some frames after a resize
@@ -161,9 +166,23 @@ void UI::Draw()
 
   g_d3d11Context->OMSetRenderTargets(1, m_pRTV.GetAddressOf(), nullptr);
 
-  ImGuiIO& io = ImGui::GetIO();
   ImGui_ImplDX11_NewFrame();
 
+  if (m_Enabled)
+    DrawTools();
+  pOverlay->Draw();
+
+  ImGui::Render();
+  ImGui_ImplDX11_RenderDrawData(ImGui::GetDrawData());
+
+  m_HasKeyboardFocus = ImGui::GetIO().WantCaptureKeyboard;
+  m_HasMouseFocus = ImGui::GetIO().WantCaptureMouse;
+}
+
+void UI::DrawTools()
+{
+  ImGuiIO& io = ImGui::GetIO();
+
   ImGui::SetNextWindowSize(ScaledImVec2(800, 460));
   ImGui::Begin("Cinematic Tools", nullptr, ImGuiWindowFlags_NoResize);
   {
@@ -231,6 +250,20 @@ void UI::Draw()
 
         });
 
+        ImGui::Dummy(ImVec2(0, 5));
+        ImGui::DrawWithBorders([this]
+        {
+          if (ImGui::Button("Hook timings", ImVec2(158, 33)))
+            m_ShowHookProfiler = true;
+        });
+
+        ImGui::Dummy(ImVec2(0, 5));
+        ImGui::DrawWithBorders([=]
+        {
+          if (ImGui::Button("Perf overlay", ImVec2(158, 33)))
+            g_mainHandle->GetPerfOverlay()->Toggle();
+        });
+
         ImGui::PopStyleColor();
         ImGui::PopFont();
         
@@ -252,12 +285,7 @@ void UI::Draw()
   } ImGui::End();
 
   g_mainHandle->GetInputSystem()->DrawUI();
-
-  ImGui::Render();
-  ImGui_ImplDX11_RenderDrawData(ImGui::GetDrawData());
-
-  m_HasKeyboardFocus = ImGui::GetIO().WantCaptureKeyboard;
-  m_HasMouseFocus = ImGui::GetIO().WantCaptureMouse;
+  util::profiler::DrawUI(&m_ShowHookProfiler);
 }
 
 void UI::OnResize()
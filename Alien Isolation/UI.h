@@ -36,6 +36,7 @@ public:
 
 private:
   bool CreateRenderTarget();
+  void DrawTools();
 
 private:
   bool m_Enabled;
@@ -54,6 +55,7 @@ private:
   bool m_HasKeyboardFocus;
   bool m_HasSeenWarning;
   bool m_ShowUpdateNotes;
+  bool m_ShowHookProfiler;
   bool m_IsInitialized;
 
 public:
@@ -0,0 +1,111 @@
+#include "ConfigWriter.h"
+#include "Util.h"
+
+#include <fstream>
+#include <iterator>
+
+util::ConfigWriter::ConfigWriter() :
+  m_Wake(CreateEvent(NULL, FALSE, FALSE, NULL)),
+  m_Running(true)
+{
+  m_Thread = std::thread(&ConfigWriter::Run, this);
+}
+
+util::ConfigWriter::~ConfigWriter()
+{
+  m_Running = false;
+  SetEvent(m_Wake);
+  if (m_Thread.joinable())
+    m_Thread.join();
+
+  CloseHandle(m_Wake);
+  WritePending();
+}
+
+void util::ConfigWriter::Queue(std::string const& path, std::string content)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_QueueMutex);
+    m_Pending[path] = std::move(content);
+  }
+  SetEvent(m_Wake);
+}
+
+void util::ConfigWriter::Run()
+{
+  while (m_Running.load(std::memory_order_acquire))
+  {
+    WaitForSingleObject(m_Wake, INFINITE);
+    WritePending();
+  }
+}
+
+void util::ConfigWriter::WritePending()
+{
+  std::lock_guard<std::mutex> writeLock(m_WriteMutex);
+
+  std::unordered_map<std::string, std::string> pending;
+  {
+    std::lock_guard<std::mutex> lock(m_QueueMutex);
+    pending.swap(m_Pending);
+  }
+
+  for (auto& file : pending)
+  {
+    if (IsUnchanged(file.first, file.second))
+      continue;
+
+    if (WriteAtomic(file.first, file.second))
+      m_Written[file.first] = std::move(file.second);
+  }
+}
+
+bool util::ConfigWriter::IsUnchanged(std::string const& path, std::string const& content)
+{
+  auto it = m_Written.find(path);
+  if (it == m_Written.end())
+  {
+    // First time this file is saved, so compare with what's on disk
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+      return false;
+
+    std::string existing((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    it = m_Written.emplace(path, std::move(existing)).first;
+  }
+
+  return it->second == content;
+}
+
+bool util::ConfigWriter::WriteAtomic(std::string const& path, std::string const& content)
+{
+  std::string tempPath = path + ".tmp";
+
+  HANDLE hFile = CreateFileA(tempPath.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (hFile == INVALID_HANDLE_VALUE)
+  {
+    util::log::Error("Could not save %s, failed to create %s. GetLastError 0x%X", path.c_str(), tempPath.c_str(), GetLastError());
+    return false;
+  }
+
+  DWORD written = 0;
+  bool ok = WriteFile(hFile, content.data(), static_cast<DWORD>(content.size()), &written, NULL)
+    && written == content.size()
+    && FlushFileBuffers(hFile);
+  DWORD error = GetLastError();
+  CloseHandle(hFile);
+
+  // The old file is only replaced once the new one is fully on disk
+  if (ok && !MoveFileExA(tempPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+  {
+    ok = false;
+    error = GetLastError();
+  }
+
+  if (!ok)
+  {
+    util::log::Error("Could not save %s, GetLastError 0x%X", path.c_str(), error);
+    DeleteFileA(tempPath.c_str());
+  }
+  return ok;
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <Windows.h>
+
+namespace util
+{
+  // Writes the config and camera profiles on a thread of its own, so
+  // saving never stalls the update thread on the disk.
+  //
+  // Queuing a file replaces whatever was still queued for the same path.
+  // Each file is written to a temporary next to it and moved over the
+  // old one, so a crash mid-save leaves either the old file or the new
+  // one and never half of each. Files whose content didn't change since
+  // they were last written or read aren't touched.
+  class ConfigWriter
+  {
+  public:
+    ConfigWriter();
+    // Writes out anything still queued
+    ~ConfigWriter();
+
+    void Queue(std::string const& path, std::string content);
+
+  private:
+    void Run();
+    void WritePending();
+    bool IsUnchanged(std::string const& path, std::string const& content);
+    bool WriteAtomic(std::string const& path, std::string const& content);
+
+  private:
+    // Guards m_Pending
+    std::mutex m_QueueMutex;
+    std::unordered_map<std::string, std::string> m_Pending;
+
+    // Held while writing, guards m_Written
+    std::mutex m_WriteMutex;
+    std::unordered_map<std::string, std::string> m_Written;
+
+    HANDLE m_Wake;
+    std::atomic<bool> m_Running;
+    std::thread m_Thread;
+
+  public:
+    ConfigWriter(ConfigWriter const&) = delete;
+    void operator=(ConfigWriter const&) = delete;
+  };
+}
@@ -1,4 +1,5 @@
 #include "Util.h"
+#include "Profiler.h"
 #include "../Main.h"
 
 #include "../AlienIsolation.h"
@@ -95,16 +96,28 @@ namespace
 
     if (!g_shutdown && g_mainHandle)
     {
+      if (InputSystem* pInput = g_mainHandle->GetInputSystem())
+        pInput->OnPresent();
+
       CTRenderer* pRenderer = g_mainHandle->GetRenderer();
       UI* pUI = g_mainHandle->GetUI();
       CameraManager* pCameraManager = g_mainHandle->GetCameraManager();
+      PerfOverlay* pOverlay = g_mainHandle->GetPerfOverlay();
 
-      if (pRenderer && pRenderer->IsReady() && pUI && pUI->IsReady() && pCameraManager)
+      if (pRenderer && pRenderer->IsReady() && pUI && pUI->IsReady() && pCameraManager && pOverlay)
       {
+        pOverlay->BeginFrame();
         pUI->BindRenderTarget();
-        pRenderer->UpdateMatrices();
+        {
+          PerfOverlay::Section section(pOverlay, PerfSection_UpdateMatrices);
+          pRenderer->UpdateMatrices();
+        }
         //g_mainHandle->GetCameraManager()->DrawTrack();
-        pUI->Draw();
+        {
+          PerfOverlay::Section section(pOverlay, PerfSection_DrawUI);
+          pUI->Draw();
+        }
+        pOverlay->EndFrame();
       }
     }
   }
@@ -112,13 +125,21 @@ namespace
 
 HRESULT __stdcall hIDXGISwapChain_Present(IDXGISwapChain* pSwapchain, UINT SyncInterval, UINT Flags)
 {
-  HandlePresent(pSwapchain, SyncInterval, Flags);
+  {
+    CT_PROFILE_HOOK(Hook_Present);
+    HandlePresent(pSwapchain, SyncInterval, Flags);
+  }
+  util::profiler::Update();
   return oIDXGISwapChain_Present ? oIDXGISwapChain_Present(pSwapchain, SyncInterval, Flags) : S_OK;
 }
 
 HRESULT __stdcall hIDXGISwapChain1_Present1(IDXGISwapChain1* pSwapchain, UINT SyncInterval, UINT Flags, const DXGI_PRESENT_PARAMETERS* pPresentParameters)
 {
-  HandlePresent(pSwapchain, SyncInterval, Flags);
+  {
+    CT_PROFILE_HOOK(Hook_Present);
+    HandlePresent(pSwapchain, SyncInterval, Flags);
+  }
+  util::profiler::Update();
   return oIDXGISwapChain1_Present1 ? oIDXGISwapChain1_Present1(pSwapchain, SyncInterval, Flags, pPresentParameters) : S_OK;
 }
 
@@ -136,8 +157,9 @@ tCameraUpdate oCameraUpdate = nullptr;
 
 int __fastcall hCameraUpdate(CATHODE::AICameraManager* pCameraManager, void* /*edx*/)
 {
+  CT_PROFILE_HOOK(Hook_CameraUpdate);
   g_mainHandle->GetCameraManager()->OnCameraUpdateBegin();
-  int result = oCameraUpdate ? oCameraUpdate(pCameraManager) : 0;
+  int result = CT_PROFILE_ORIGINAL(oCameraUpdate ? oCameraUpdate(pCameraManager) : 0);
   g_mainHandle->GetCameraManager()->OnCameraUpdateEnd();
   return result;
 }
@@ -153,15 +175,17 @@ tSetCursorPos oSetCursorPos = nullptr;
 
 int __fastcall hInputUpdate(void* _this, void* /*edx*/)
 {
+  CT_PROFILE_HOOK(Hook_InputUpdate);
   CameraManager* pCameraManager = g_mainHandle->GetCameraManager();
   if (pCameraManager->IsCameraEnabled() && pCameraManager->IsKbmDisabled())
     return 0;
 
-  return oInputUpdate ? oInputUpdate(_this) : 0;
+  return CT_PROFILE_ORIGINAL(oInputUpdate ? oInputUpdate(_this) : 0);
 }
 
 int __fastcall hGamepadUpdate(void* _this, void* /*edx*/)
 {
+  CT_PROFILE_HOOK(Hook_GamepadUpdate);
   CameraManager* pCameraManager = g_mainHandle->GetCameraManager();
   InputSystem* pInputSystem = g_mainHandle->GetInputSystem();
 
@@ -170,16 +194,17 @@ int __fastcall hGamepadUpdate(void* _this, void* /*edx*/)
     && !pInputSystem->IsUsingSecondPad())
     return 0;
   
-  return oGamepadUpdate ? oGamepadUpdate(_this) : 0;
+  return CT_PROFILE_ORIGINAL(oGamepadUpdate ? oGamepadUpdate(_this) : 0);
 }
 
 BOOL WINAPI hSetCursorPos(int x, int y)
 {
+  CT_PROFILE_HOOK(Hook_SetCursorPos);
   UI* pUI = g_mainHandle ? g_mainHandle->GetUI() : nullptr;
   if (pUI && pUI->IsEnabled())
     return TRUE;
 
-  return oSetCursorPos ? oSetCursorPos(x, y) : TRUE;
+  return CT_PROFILE_ORIGINAL(oSetCursorPos ? oSetCursorPos(x, y) : TRUE);
 }
 
 
@@ -197,9 +222,9 @@ tPostProcessUpdate oPostProcessUpdate = nullptr;
 tCombatManagerUpdate oCombatManagerUpdate = nullptr;
 tTonemapUpdate oTonemapUpdate = nullptr;
 
-int __fastcall hPostProcessUpdate(int _this, void* /*edx*/)
+// __try can't share a function with the hook timer's destructor
+static void UpdatePostProcess(int _this)
 {
-  int result = oPostProcessUpdate ? oPostProcessUpdate(_this) : 0;
   __try {
     auto* pPostProcess = reinterpret_cast<CATHODE::PostProcess*>(_this + 0x1918);
     if (util::IsPtrReadable(pPostProcess, sizeof(void*)))
@@ -209,13 +234,21 @@ int __fastcall hPostProcessUpdate(int _this, void* /*edx*/)
     }
   } __except(EXCEPTION_EXECUTE_HANDLER) {
     // skip on bad offset
-    util::log::Warning("Exception in hPostProcessUpdate, likely bad offset for PostProcess struct. Skipping update.");
+    CT_LOG_LIMITED(Warning, "Exception in hPostProcessUpdate, likely bad offset for PostProcess struct. Skipping update.");
   }
+}
+
+int __fastcall hPostProcessUpdate(int _this, void* /*edx*/)
+{
+  CT_PROFILE_HOOK(Hook_PostProcessUpdate);
+  int result = CT_PROFILE_ORIGINAL(oPostProcessUpdate ? oPostProcessUpdate(_this) : 0);
+  UpdatePostProcess(_this);
   return result;
 }
 
 bool __fastcall hCombatManagerUpdate(void* _this, void* _EDX, CATHODE::Character* pTargetChr)
 {
+  CT_PROFILE_HOOK(Hook_CombatManagerUpdate);
   if (g_mainHandle->GetCharacterController()->IsPlayerInvisible())
   {
     CATHODE::Character* pPlayer = CATHODE::Main::Singleton()->m_CharacterManager->m_PlayerCharacters[0];
@@ -223,12 +256,13 @@ bool __fastcall hCombatManagerUpdate(void* _this, void* _EDX, CATHODE::Character
       return false;
   }
 
-  return oCombatManagerUpdate ? oCombatManagerUpdate(_this, pTargetChr) : false;
+  return CT_PROFILE_ORIGINAL(oCombatManagerUpdate ? oCombatManagerUpdate(_this, pTargetChr) : false);
 }
 
 char __stdcall hTonemapSettings(CATHODE::DayToneMapSettings* pTonemapSettings, int a2)
 {
-  char result = oTonemapUpdate ? oTonemapUpdate(pTonemapSettings, a2) : 0;
+  CT_PROFILE_HOOK(Hook_TonemapUpdate);
+  char result = CT_PROFILE_ORIGINAL(oTonemapUpdate ? oTonemapUpdate(pTonemapSettings, a2) : 0);
   g_mainHandle->GetVisualsController()->OnTonemapUpdate();
 
   return result;
@@ -480,9 +514,9 @@ void util::hooks::InstallGameHooks()
 
   const bool isSteamBuild = util::IsSteamBuild();
 
-  auto safeCreate = [](const char* name, const char* key, auto hook, auto original)
+  auto safeCreate = [](const char* name, util::offsets::OffsetId id, auto hook, auto original)
   {
-    int addr = util::offsets::GetOffset(key);
+    int addr = static_cast<int>(util::offsets::Get(id));
     if (!util::IsAddressInModule(g_gameHandle, (void*)addr, 16))
     {
       util::log::Warning("Skipping hook %s: address 0x%X outside module image", name, addr);
@@ -514,12 +548,12 @@ void util::hooks::InstallGameHooks()
   if (isSteamBuild)
   {
     util::log::Write("Steam build detected, installing all gameplay hooks...");
-    safeCreate("CameraUpdate", "OFFSET_CAMERAUPDATE", hCameraUpdate, &oCameraUpdate);
-    //safeCreate("InputUpdate", "OFFSET_INPUTUPDATE", hInputUpdate, &oInputUpdate);
-    safeCreate("GamepadUpdate", "OFFSET_GAMEPADUPDATE", hGamepadUpdate, &oGamepadUpdate);
-    safeCreate("PostProcessUpdate", "OFFSET_POSTPROCESSUPDATE", hPostProcessUpdate, &oPostProcessUpdate);
-    safeCreate("TonemapUpdate", "OFFSET_TONEMAPUPDATE", hTonemapSettings, &oTonemapUpdate);
-    //CreateHook("AICombatManagerUpdate", util::offsets::GetOffset("OFFSET_COMBATMANAGERUPDATE"), hCombatManagerUpdate, &oCombatManagerUpdate);
+    safeCreate("CameraUpdate", util::offsets::OFFSET_CAMERAUPDATE, hCameraUpdate, &oCameraUpdate);
+    //safeCreate("InputUpdate", util::offsets::OFFSET_INPUTUPDATE, hInputUpdate, &oInputUpdate);
+    safeCreate("GamepadUpdate", util::offsets::OFFSET_GAMEPADUPDATE, hGamepadUpdate, &oGamepadUpdate);
+    safeCreate("PostProcessUpdate", util::offsets::OFFSET_POSTPROCESSUPDATE, hPostProcessUpdate, &oPostProcessUpdate);
+    safeCreate("TonemapUpdate", util::offsets::OFFSET_TONEMAPUPDATE, hTonemapSettings, &oTonemapUpdate);
+    //CreateHook("AICombatManagerUpdate", util::offsets::Get(util::offsets::OFFSET_COMBATMANAGERUPDATE), hCombatManagerUpdate, &oCombatManagerUpdate);
   }
   else
   {
@@ -554,7 +588,7 @@ void util::hooks::SetHookState(bool enable, std::string const& name)
         hook.Enabled = enable;
       }
       else
-        util::log::Warning("VTable hook %s is already %s", name.c_str(), enable ? "enabled" : "disabled");
+        CT_LOG_LIMITED(Warning, "VTable hook %s is already %s", entry.first.c_str(), enable ? "enabled" : "disabled");
     }
   }
   else
@@ -581,7 +615,7 @@ void util::hooks::SetHookState(bool enable, std::string const& name)
         hook.Enabled = enable;
       }
       else
-        util::log::Warning("VTable hook %s is already %s", name.c_str(), enable ? "enabled" : "disabled");
+        CT_LOG_LIMITED(Warning, "VTable hook %s is already %s", name.c_str(), enable ? "enabled" : "disabled");
     }
   }
 }
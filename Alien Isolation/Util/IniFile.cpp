@@ -0,0 +1,317 @@
+#include "IniFile.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+  const size_t g_minSlots = 16;
+
+  // Names are matched without regard to case, like INIReader, but only
+  // for ASCII so it doesn't depend on the locale
+  inline char Fold(char c)
+  {
+    return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+  }
+
+  bool EqualsFolded(boost::string_view a, boost::string_view b)
+  {
+    if (a.size() != b.size())
+      return false;
+    for (size_t i = 0; i < a.size(); ++i)
+    {
+      if (Fold(a[i]) != Fold(b[i]))
+        return false;
+    }
+    return true;
+  }
+
+  // FNV-1a of the folded "section=name"
+  uint32_t HashKey(boost::string_view section, boost::string_view name)
+  {
+    uint32_t hash = 2166136261u;
+    for (char c : section)
+      hash = (hash ^ static_cast<uint8_t>(Fold(c))) * 16777619u;
+    hash = (hash ^ static_cast<uint8_t>('=')) * 16777619u;
+    for (char c : name)
+      hash = (hash ^ static_cast<uint8_t>(Fold(c))) * 16777619u;
+    return hash;
+  }
+
+  inline bool IsSpace(char c)
+  {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+  }
+
+  char* SkipSpace(char* p, char* end)
+  {
+    while (p != end && IsSpace(*p))
+      ++p;
+    return p;
+  }
+
+  char* TrimEnd(char* begin, char* end)
+  {
+    while (end != begin && IsSpace(end[-1]))
+      --end;
+    return end;
+  }
+
+  // The first of chars or the start of a comment, like inih's
+  // find_chars_or_comment. A ';' only starts a comment after whitespace.
+  char* FindCharOrComment(char* p, char* end, const char* chars)
+  {
+    bool afterSpace = false;
+    for (; p != end; ++p)
+    {
+      if ((*p && strchr(chars, *p)) || (*p == ';' && afterSpace))
+        return p;
+      afterSpace = IsSpace(*p);
+    }
+    return end;
+  }
+
+  boost::string_view View(char* begin, char* end)
+  {
+    return boost::string_view(begin, static_cast<size_t>(end - begin));
+  }
+}
+
+util::IniFile::IniFile() :
+  m_Error(-1)
+{
+}
+
+util::IniFile::IniFile(std::string const& path) :
+  m_Error(-1)
+{
+  Load(path);
+}
+
+bool util::IniFile::Load(std::string const& path)
+{
+  m_Buffer.clear();
+  m_Entries.clear();
+  m_Error = 0;
+
+  std::ifstream file(path, std::ios::binary);
+  std::streamoff size = -1;
+  if (file.is_open())
+  {
+    file.seekg(0, std::ios::end);
+    size = file.tellg();
+    file.seekg(0, std::ios::beg);
+  }
+
+  if (size < 0)
+  {
+    m_Error = -1;
+    BuildIndex();
+    return false;
+  }
+
+  m_Buffer.resize(static_cast<size_t>(size));
+  if (size > 0)
+    file.read(&m_Buffer[0], size);
+  m_Buffer.resize(static_cast<size_t>(file.gcount()));
+
+  Parse();
+  BuildIndex();
+  return true;
+}
+
+std::string util::IniFile::Get(boost::string_view section, boost::string_view name, boost::string_view defaultValue) const
+{
+  Entry const* pEntry = Find(section, name);
+  return (pEntry ? pEntry->Value : defaultValue).to_string();
+}
+
+long util::IniFile::GetInteger(boost::string_view section, boost::string_view name, long defaultValue) const
+{
+  Entry const* pEntry = Find(section, name);
+  if (!pEntry)
+    return defaultValue;
+
+  if (!(pEntry->Parsed & TypedInteger))
+  {
+    char* end;
+    pEntry->Integer = strtol(pEntry->Value.data(), &end, 0);
+    if (end > pEntry->Value.data())
+      pEntry->Valid |= TypedInteger;
+    pEntry->Parsed |= TypedInteger;
+  }
+
+  return pEntry->Valid & TypedInteger ? pEntry->Integer : defaultValue;
+}
+
+double util::IniFile::GetReal(boost::string_view section, boost::string_view name, double defaultValue) const
+{
+  Entry const* pEntry = Find(section, name);
+  if (!pEntry)
+    return defaultValue;
+
+  if (!(pEntry->Parsed & TypedReal))
+  {
+    char* end;
+    pEntry->Real = strtod(pEntry->Value.data(), &end);
+    if (end > pEntry->Value.data())
+      pEntry->Valid |= TypedReal;
+    pEntry->Parsed |= TypedReal;
+  }
+
+  return pEntry->Valid & TypedReal ? pEntry->Real : defaultValue;
+}
+
+bool util::IniFile::GetBoolean(boost::string_view section, boost::string_view name, bool defaultValue) const
+{
+  static const char* trueValues[] = { "true", "yes", "on", "1" };
+  static const char* falseValues[] = { "false", "no", "off", "0" };
+
+  Entry const* pEntry = Find(section, name);
+  if (!pEntry)
+    return defaultValue;
+
+  if (!(pEntry->Parsed & TypedBoolean))
+  {
+    for (const char* value : trueValues)
+    {
+      if (EqualsFolded(pEntry->Value, value))
+      {
+        pEntry->Boolean = true;
+        pEntry->Valid |= TypedBoolean;
+      }
+    }
+    for (const char* value : falseValues)
+    {
+      if (EqualsFolded(pEntry->Value, value))
+      {
+        pEntry->Boolean = false;
+        pEntry->Valid |= TypedBoolean;
+      }
+    }
+    pEntry->Parsed |= TypedBoolean;
+  }
+
+  return pEntry->Valid & TypedBoolean ? pEntry->Boolean : defaultValue;
+}
+
+void util::IniFile::Parse()
+{
+  char* buffer = m_Buffer.empty() ? nullptr : &m_Buffer[0];
+  char* bufferEnd = buffer + m_Buffer.size();
+  char* p = buffer;
+
+  // UTF-8 byte order mark
+  if (m_Buffer.compare(0, 3, "\xEF\xBB\xBF") == 0)
+    p += 3;
+
+  boost::string_view section;
+  int lineNumber = 0;
+  while (p < bufferEnd)
+  {
+    ++lineNumber;
+    char* lineEnd = std::find(p, bufferEnd, '\n');
+    char* start = SkipSpace(p, lineEnd);
+    char* end = TrimEnd(start, lineEnd);
+    p = lineEnd == bufferEnd ? bufferEnd : lineEnd + 1;
+
+    if (start == end || *start == ';' || *start == '#')
+      continue;
+
+    if (*start == '[')
+    {
+      char* close = FindCharOrComment(start + 1, end, "]");
+      if (close == end || *close != ']')
+      {
+        if (!m_Error)
+          m_Error = lineNumber;
+        continue;
+      }
+
+      section = View(start + 1, close);
+      continue;
+    }
+
+    // name = value or name : value
+    char* separator = FindCharOrComment(start, end, "=:");
+    if (separator == end || *separator == ';')
+    {
+      if (!m_Error)
+        m_Error = lineNumber;
+      continue;
+    }
+
+    // The comment is looked for before the value's leading whitespace is
+    // skipped, so "name = ; comment" is an empty value
+    char* valueEnd = FindCharOrComment(separator + 1, end, "");
+    char* value = SkipSpace(separator + 1, valueEnd);
+    valueEnd = TrimEnd(value, valueEnd);
+    AddEntry(section, View(start, TrimEnd(start, separator)), View(value, valueEnd));
+
+    // Terminated in place so strtol and strtod can read it directly. The
+    // byte after the value is whitespace, a comment or the line's end,
+    // all of which have been looked at already.
+    if (valueEnd != bufferEnd)
+      *valueEnd = '\0';
+  }
+}
+
+void util::IniFile::AddEntry(boost::string_view section, boost::string_view name, boost::string_view value)
+{
+  Entry entry;
+  entry.Hash = HashKey(section, name);
+  entry.Section = section;
+  entry.Name = name;
+  entry.Value = value;
+  entry.Parsed = 0;
+  entry.Valid = 0;
+  entry.Boolean = false;
+  entry.Integer = 0;
+  entry.Real = 0;
+  m_Entries.push_back(entry);
+}
+
+void util::IniFile::BuildIndex()
+{
+  size_t slotCount = g_minSlots;
+  while (slotCount < m_Entries.size() * 2)
+    slotCount *= 2;
+  m_Slots.assign(slotCount, 0);
+
+  size_t mask = slotCount - 1;
+  for (size_t i = 0; i < m_Entries.size(); ++i)
+  {
+    Entry const& entry = m_Entries[i];
+    for (size_t slot = entry.Hash & mask;; slot = (slot + 1) & mask)
+    {
+      uint32_t& index = m_Slots[slot];
+      if (index)
+      {
+        // A repeated name, the later value wins
+        Entry const& other = m_Entries[index - 1];
+        if (other.Hash != entry.Hash || !EqualsFolded(other.Section, entry.Section) || !EqualsFolded(other.Name, entry.Name))
+          continue;
+      }
+
+      index = static_cast<uint32_t>(i + 1);
+      break;
+    }
+  }
+}
+
+util::IniFile::Entry const* util::IniFile::Find(boost::string_view section, boost::string_view name) const
+{
+  if (m_Slots.empty())
+    return nullptr;
+
+  uint32_t hash = HashKey(section, name);
+  size_t mask = m_Slots.size() - 1;
+  for (size_t slot = hash & mask; m_Slots[slot]; slot = (slot + 1) & mask)
+  {
+    Entry const& entry = m_Entries[m_Slots[slot] - 1];
+    if (entry.Hash == hash && EqualsFolded(entry.Section, section) && EqualsFolded(entry.Name, name))
+      return &entry;
+  }
+  return nullptr;
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include <boost/utility/string_view.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Kept free of Windows headers so it can be benchmarked against
+// INIReader anywhere, see IniBench/
+
+namespace util
+{
+  // Reads an INI file the way INIReader does, for the config and the
+  // camera profiles, without a std::map of lowercased copies.
+  //
+  // The whole file is read into one buffer and parsed in place. Entries
+  // are views into that buffer, found through an open addressing table
+  // keyed by a case insensitive hash of "section=name" that's computed
+  // once while parsing. Integer, real and boolean values are parsed the
+  // first time they're asked for and kept, so the getters aren't safe
+  // to call from more than one thread at a time.
+  //
+  // Differences from inih: lines have no length limit, a repeated name
+  // replaces the earlier value instead of being appended to it, and
+  // indented continuation lines aren't supported.
+  class IniFile
+  {
+  public:
+    IniFile();
+    explicit IniFile(std::string const& path);
+
+    // Replaces what was loaded before. Memory is kept, so one IniFile
+    // can read many files without allocating for each. Returns false if
+    // the file couldn't be opened, lines with errors are skipped.
+    bool Load(std::string const& path);
+
+    // Like INIReader: 0 on success, -1 if the file couldn't be opened,
+    // otherwise the line number of the first error
+    int ParseError() const { return m_Error; }
+
+    std::string Get(boost::string_view section, boost::string_view name, boost::string_view defaultValue) const;
+    // Decimal "1234", "-1234" or hex "0x4d2", like strtol
+    long GetInteger(boost::string_view section, boost::string_view name, long defaultValue) const;
+    double GetReal(boost::string_view section, boost::string_view name, double defaultValue) const;
+    // "true", "yes", "on", "1", "false", "no", "off" or "0" in any case
+    bool GetBoolean(boost::string_view section, boost::string_view name, bool defaultValue) const;
+
+  private:
+    enum TypedValue : uint8_t
+    {
+      TypedInteger = 1 << 0,
+      TypedReal = 1 << 1,
+      TypedBoolean = 1 << 2
+    };
+
+    struct Entry
+    {
+      uint32_t Hash;
+      boost::string_view Section;
+      boost::string_view Name;
+      // Null terminated in the buffer
+      boost::string_view Value;
+
+      // TypedValue flags of what's been parsed, and of what was valid
+      mutable uint8_t Parsed;
+      mutable uint8_t Valid;
+      mutable bool Boolean;
+      mutable long Integer;
+      mutable double Real;
+    };
+
+    void Parse();
+    void AddEntry(boost::string_view section, boost::string_view name, boost::string_view value);
+    void BuildIndex();
+    Entry const* Find(boost::string_view section, boost::string_view name) const;
+
+  private:
+    std::string m_Buffer;
+    std::vector<Entry> m_Entries;
+    // Index + 1 into m_Entries, 0 for an empty slot. The size is a power
+    // of two at least twice the entry count.
+    std::vector<uint32_t> m_Slots;
+    int m_Error;
+  };
+}
@@ -1,40 +1,242 @@
 #include "Util.h"
-#include <boost/date_time/posix_time/posix_time.hpp>
+#include "LogBinary.h"
+#include <atomic>
+#include <cstring>
 #include <mutex>
 #include <stdio.h>
+#include <string>
+#include <thread>
 
-using namespace boost::posix_time;
 using namespace util;
 
-std::mutex g_logMutex;
-
 namespace
 {
+  // Messages the log thread can fall behind by before new ones are
+  // dropped
+  const size_t g_logQueueSize = 1024;
+  // How long the log thread waits between writing out what's queued,
+  // errors wake it up right away
+  const DWORD g_logFlushMs = 20;
+
+  struct LevelStyle
+  {
+    WORD Color;
+    const char* Prefix;
+  };
+
+  const LevelStyle g_levelStyles[] = {
+    { FOREGROUND_BLUE | FOREGROUND_GREEN | FOREGROUND_RED | FOREGROUND_INTENSITY, "" },
+    { FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_INTENSITY, "[WARNING] " },
+    { FOREGROUND_RED | FOREGROUND_INTENSITY, "[ERROR] " },
+    { FOREGROUND_GREEN | FOREGROUND_INTENSITY, "[OK] " }
+  };
+
+  const char* g_monthNames[] = {
+    "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
+  };
+
   HANDLE hstdin, hstdout;
   FILE* pfstdin;
   FILE* pfstdout;
   FILE* pfileout;
 
-  static void PrintTimeStamp()
+  log::LogQueue<g_logQueueSize> g_logQueue;
+  std::thread g_logThread;
+  HANDLE g_logWake = NULL;
+  std::atomic<bool> g_logRunning{ false };
+
+  // Held while writing, by the log thread or by callers while it isn't
+  // running
+  std::mutex g_logMutex;
+
+  // Binary sink, replaces the text in pfileout while it's open. Also
+  // guarded by g_logMutex.
+  FILE* g_pBinaryOut = nullptr;
+  log::BinaryLogWriter g_binaryWriter;
+  std::string g_binaryBuffer;
+
+  // Every RateLimit that has suppressed something
+  std::atomic<log::RateLimit*> g_rateLimits{ nullptr };
+
+  // Where the tick count was when the log started and what local time
+  // that was, so messages can be stamped with the counter alone
+  log::BinaryLogHeader const& GetClock()
+  {
+    static const log::BinaryLogHeader clock = []
+    {
+      LARGE_INTEGER frequency, ticks;
+      QueryPerformanceFrequency(&frequency);
+      QueryPerformanceCounter(&ticks);
+
+      FILETIME utc, local;
+      GetSystemTimeAsFileTime(&utc);
+      FileTimeToLocalFileTime(&utc, &local);
+
+      log::BinaryLogHeader header;
+      header.TicksPerSecond = frequency.QuadPart;
+      header.BaseTicks = ticks.QuadPart;
+      header.BaseLocalTime = (static_cast<int64_t>(local.dwHighDateTime) << 32) | local.dwLowDateTime;
+      return header;
+    }();
+    return clock;
+  }
+
+  int64_t Now()
   {
-    ptime now = second_clock::local_time();
-    std::string sTimeStamp = "[" + to_simple_string(now) + "] ";
+    LARGE_INTEGER ticks;
+    QueryPerformanceCounter(&ticks);
+    return ticks.QuadPart;
+  }
+
+  void PrintTimeStamp(int64_t time, FILE* pTextOut)
+  {
+    int64_t localTime = log::TicksToLocalTime(GetClock(), time);
+    FILETIME local;
+    local.dwLowDateTime = static_cast<DWORD>(localTime);
+    local.dwHighDateTime = static_cast<DWORD>(localTime >> 32);
+
+    SYSTEMTIME st;
+    FileTimeToSystemTime(&local, &st);
+
+    char timeStamp[32];
+    snprintf(timeStamp, sizeof(timeStamp), "[%04u-%s-%02u %02u:%02u:%02u.%03u] ",
+      st.wYear, g_monthNames[(st.wMonth + 11) % 12], st.wDay, st.wHour, st.wMinute, st.wSecond, st.wMilliseconds);
+
     SetConsoleTextAttribute(hstdout, FOREGROUND_RED | FOREGROUND_INTENSITY);
-    printf(sTimeStamp.c_str());
-    fprintf(pfileout, sTimeStamp.c_str());
+    fputs(timeStamp, stdout);
+    if (pTextOut)
+      fputs(timeStamp, pTextOut);
+  }
+
+  // To the console and pTextOut, if any
+  void PrintText(log::LogRecord const& record, std::string& line, FILE* pTextOut)
+  {
+    LevelStyle const& style = g_levelStyles[static_cast<int>(record.Level)];
+
+    line = style.Prefix;
+    log::FormatRecord(record, line);
+    line += '\n';
+
+    PrintTimeStamp(record.Time, pTextOut);
+    SetConsoleTextAttribute(hstdout, style.Color);
+    fputs(line.c_str(), stdout);
+    if (pTextOut)
+      fputs(line.c_str(), pTextOut);
+  }
+
+  void PrintRecord(log::LogRecord const& record, std::string& line)
+  {
+    if (g_pBinaryOut)
+    {
+      g_binaryWriter.Write(record, g_binaryBuffer);
+      PrintText(record, line, nullptr);
+    }
+    else
+      PrintText(record, line, pfileout);
+  }
+
+  void PrintDropped(uint32_t dropped, std::string& line)
+  {
+    char message[96];
+    snprintf(message, sizeof(message), "%u log messages were dropped, the log thread fell behind", dropped);
+
+    log::LogRecord record;
+    record.Format = nullptr;
+    record.Time = Now();
+    record.Level = log::LogLevel::Warning;
+    record.TextUsed = static_cast<uint16_t>(strlen(message));
+    memcpy(record.Text, message, record.TextUsed);
+
+    // The binary log has an entry of its own for this
+    if (g_pBinaryOut)
+    {
+      g_binaryWriter.WriteDropped(record.Time, dropped, g_binaryBuffer);
+      PrintText(record, line, nullptr);
+    }
+    else
+      PrintText(record, line, pfileout);
+  }
+
+  void Flush()
+  {
+    if (g_pBinaryOut)
+    {
+      if (g_binaryBuffer.empty())
+        return;
+      fwrite(g_binaryBuffer.data(), 1, g_binaryBuffer.size(), g_pBinaryOut);
+      fflush(g_pBinaryOut);
+      g_binaryBuffer.clear();
+    }
+    else if (pfileout)
+      fflush(pfileout);
   }
 
-  static void PrintMessage(WORD color, const char* type, const char* format, va_list args)
+  // Writes out everything queued, with one flush for the whole batch
+  void Drain(std::string& line)
   {
-    // Block other threads from writing at the same time
     std::lock_guard<std::mutex> lock(g_logMutex);
 
-    PrintTimeStamp();
-    SetConsoleTextAttribute(hstdout, color);
-    std::string finalFormat = std::string(type) + format + "\n";
-    vfprintf(stdout, finalFormat.c_str(), args);
-    vfprintf(pfileout, finalFormat.c_str(), args);
-    fflush(pfileout);
+    bool wrote = false;
+    while (log::LogRecord* pRecord = g_logQueue.Peek())
+    {
+      PrintRecord(*pRecord, line);
+      g_logQueue.Pop();
+      wrote = true;
+    }
+
+    if (uint32_t dropped = g_logQueue.TakeDropped())
+    {
+      PrintDropped(dropped, line);
+      wrote = true;
+    }
+
+    if (wrote)
+      Flush();
+  }
+
+  void LogThread()
+  {
+    std::string line;
+    while (g_logRunning.load(std::memory_order_acquire))
+    {
+      WaitForSingleObject(g_logWake, g_logFlushMs);
+      Drain(line);
+    }
+
+    // Whatever was queued before Shutdown
+    Drain(line);
+  }
+
+  void PrintMessage(log::LogLevel level, const char* format, va_list args)
+  {
+    if (!g_logRunning.load(std::memory_order_acquire))
+    {
+      // Before Init and after Shutdown there's no log thread, so the
+      // message is written right away
+      log::LogRecord record;
+      record.Time = Now();
+      record.Level = level;
+      log::Capture(record, format, args);
+
+      std::string line;
+      std::lock_guard<std::mutex> lock(g_logMutex);
+      PrintRecord(record, line);
+      Flush();
+      return;
+    }
+
+    size_t position;
+    log::LogRecord* pRecord = g_logQueue.Claim(position);
+    if (!pRecord)
+      return;
+
+    pRecord->Time = Now();
+    pRecord->Level = level;
+    log::Capture(*pRecord, format, args);
+    g_logQueue.Commit(position);
+
+    if (level == log::LogLevel::Error)
+      SetEvent(g_logWake);
   }
 }
 
@@ -46,14 +248,83 @@ void log::Init()
   freopen_s(&pfstdin, "CONIN$", "r", stdin);
   hstdin = GetStdHandle(STD_INPUT_HANDLE);
   hstdout = GetStdHandle(STD_OUTPUT_HANDLE);
-  fopen_s(&pfileout, ".\\Cinematic Tools\\CT.log", "w");
+
+  {
+    std::lock_guard<std::mutex> lock(g_logMutex);
+    fopen_s(&pfileout, ".\\Cinematic Tools\\CT.log", "w");
+  }
+
+  // Init runs again once the tools' folder exists, in case the log
+  // file couldn't be opened the first time
+  if (g_logRunning)
+    return;
+
+  g_logWake = CreateEvent(NULL, FALSE, FALSE, NULL);
+  g_logRunning = true;
+  g_logThread = std::thread(&LogThread);
+}
+
+void log::Shutdown()
+{
+  RateLimit::ReportSuppressed();
+
+  if (g_logRunning.exchange(false))
+  {
+    SetEvent(g_logWake);
+    if (g_logThread.joinable())
+      g_logThread.join();
+
+    CloseHandle(g_logWake);
+    g_logWake = NULL;
+  }
+
+  SetBinarySink(false);
+}
+
+void log::SetBinarySink(bool enable)
+{
+  {
+    std::lock_guard<std::mutex> lock(g_logMutex);
+    if (enable == (g_pBinaryOut != nullptr))
+      return;
+
+    if (!enable)
+    {
+      Flush();
+      fclose(g_pBinaryOut);
+      g_pBinaryOut = nullptr;
+      return;
+    }
+
+    fopen_s(&g_pBinaryOut, ".\\Cinematic Tools\\CT.ctlog", "wb");
+    if (g_pBinaryOut)
+    {
+      g_binaryWriter.Begin(GetClock(), g_binaryBuffer);
+      Flush();
+
+      if (pfileout)
+      {
+        fputs("The rest of the log is in CT.ctlog, LogDecoder turns it into text\n", pfileout);
+        fflush(pfileout);
+      }
+      return;
+    }
+  }
+
+  Warning("Could not open CT.ctlog, logging to CT.log instead");
+}
+
+bool log::IsBinarySinkEnabled()
+{
+  std::lock_guard<std::mutex> lock(g_logMutex);
+  return g_pBinaryOut != nullptr;
 }
 
 void log::Write(const char* format, ...)
 {
   va_list args;
   va_start(args, format);
-  PrintMessage(FOREGROUND_BLUE | FOREGROUND_GREEN | FOREGROUND_RED | FOREGROUND_INTENSITY, "", format, args);
+  PrintMessage(LogLevel::Info, format, args);
   va_end(args);
 }
 
@@ -61,7 +332,7 @@ void log::Warning(const char* format, ...)
 {
   va_list args;
   va_start(args, format);
-  PrintMessage(FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_INTENSITY, "[WARNING] ", format, args);
+  PrintMessage(LogLevel::Warning, format, args);
   va_end(args);
 }
 
@@ -69,7 +340,7 @@ void log::Error(const char* format, ...)
 {
   va_list args;
   va_start(args, format);
-  PrintMessage(FOREGROUND_RED | FOREGROUND_INTENSITY, "[ERROR] ", format, args);
+  PrintMessage(LogLevel::Error, format, args);
   va_end(args);
 }
 
@@ -77,6 +348,25 @@ void log::Ok(const char* format, ...)
 {
   va_list args;
   va_start(args, format);
-  PrintMessage(FOREGROUND_GREEN | FOREGROUND_INTENSITY, "[OK] ", format, args);
+  PrintMessage(LogLevel::Ok, format, args);
   va_end(args);
-}
\ No newline at end of file
+}
+
+void log::RateLimit::Register(RateLimit* pLimit)
+{
+  RateLimit* pHead = g_rateLimits.load();
+  do
+  {
+    pLimit->m_pNext = pHead;
+  } while (!g_rateLimits.compare_exchange_weak(pHead, pLimit));
+}
+
+void log::RateLimit::ReportSuppressed()
+{
+  for (RateLimit* pLimit = g_rateLimits.load(); pLimit; pLimit = pLimit->m_pNext)
+  {
+    uint32_t suppressed = pLimit->m_Suppressed.exchange(0);
+    if (suppressed)
+      Write("%u more \"%s\" messages were suppressed", suppressed, pLimit->m_Format);
+  }
+}
@@ -0,0 +1,368 @@
+#include "LogBinary.h"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+  const char g_binaryLogMagic[4] = { 'C', 'T', 'B', 'L' };
+  const size_t g_headerSize = 4 + 2 + 2 + 8 * 3;
+
+  void PutVarint(uint64_t value, std::string& out)
+  {
+    while (value >= 0x80)
+    {
+      out += static_cast<char>((value & 0x7F) | 0x80);
+      value >>= 7;
+    }
+    out += static_cast<char>(value);
+  }
+
+  void PutSigned(int64_t value, std::string& out)
+  {
+    PutVarint((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63), out);
+  }
+
+  void PutFixed(uint64_t value, size_t bytes, std::string& out)
+  {
+    for (size_t i = 0; i < bytes; ++i)
+      out += static_cast<char>((value >> (i * 8)) & 0xFF);
+  }
+
+  uint64_t GetFixed(uint8_t const* p, size_t bytes)
+  {
+    uint64_t value = 0;
+    for (size_t i = 0; i < bytes; ++i)
+      value |= static_cast<uint64_t>(p[i]) << (i * 8);
+    return value;
+  }
+}
+
+int64_t util::log::TicksToLocalTime(BinaryLogHeader const& clock, int64_t ticks)
+{
+  // Split so hours of ticks don't overflow when scaled to 100ns units
+  const int64_t fileTimePerSecond = 10000000;
+  int64_t elapsed = ticks - clock.BaseTicks;
+  int64_t seconds = elapsed / clock.TicksPerSecond;
+  int64_t remainder = elapsed % clock.TicksPerSecond;
+  return clock.BaseLocalTime + seconds * fileTimePerSecond + remainder * fileTimePerSecond / clock.TicksPerSecond;
+}
+
+util::log::BinaryLogWriter::BinaryLogWriter() :
+  m_LastTime(0)
+{
+}
+
+void util::log::BinaryLogWriter::Begin(BinaryLogHeader const& header, std::string& out)
+{
+  m_FormatIds.clear();
+  m_LastTime = header.BaseTicks;
+
+  out.append(g_binaryLogMagic, sizeof(g_binaryLogMagic));
+  PutFixed(g_binaryLogVersion, 2, out);
+  PutFixed(0, 2, out);
+  PutFixed(static_cast<uint64_t>(header.TicksPerSecond), 8, out);
+  PutFixed(static_cast<uint64_t>(header.BaseTicks), 8, out);
+  PutFixed(static_cast<uint64_t>(header.BaseLocalTime), 8, out);
+}
+
+void util::log::BinaryLogWriter::Write(LogRecord const& record, std::string& out)
+{
+  if (!record.Format)
+  {
+    out += static_cast<char>(EntryType::Text);
+    out += static_cast<char>(record.Level);
+    WriteTime(record.Time, out);
+    PutVarint(record.TextUsed, out);
+    out.append(record.Text, record.TextUsed);
+    return;
+  }
+
+  auto it = m_FormatIds.find(record.Format);
+  if (it == m_FormatIds.end())
+  {
+    uint32_t id = static_cast<uint32_t>(m_FormatIds.size());
+    it = m_FormatIds.emplace(record.Format, id).first;
+
+    size_t length = strlen(record.Format);
+    out += static_cast<char>(EntryType::Format);
+    PutVarint(id, out);
+    PutVarint(length, out);
+    out.append(record.Format, length);
+  }
+
+  out += static_cast<char>(EntryType::Message);
+  out += static_cast<char>(record.Level);
+  WriteTime(record.Time, out);
+  PutVarint(it->second, out);
+  out += static_cast<char>(record.ArgCount);
+
+  for (uint8_t i = 0; i < record.ArgCount; ++i)
+  {
+    LogArg const& arg = record.Args[i];
+    out += static_cast<char>(arg.Type);
+    switch (arg.Type)
+    {
+    case ArgType::Double:
+    {
+      uint64_t bits;
+      memcpy(&bits, &arg.Double, sizeof(bits));
+      PutFixed(bits, 8, out);
+      break;
+    }
+    case ArgType::Pointer:
+      PutVarint(reinterpret_cast<uintptr_t>(arg.Pointer), out);
+      break;
+    case ArgType::String:
+    {
+      const char* s = record.Text + arg.StringOffset;
+      size_t length = strlen(s);
+      PutVarint(length, out);
+      out.append(s, length);
+      break;
+    }
+    default:
+      PutSigned(arg.Integer, out);
+      break;
+    }
+  }
+}
+
+void util::log::BinaryLogWriter::WriteDropped(int64_t time, uint32_t count, std::string& out)
+{
+  out += static_cast<char>(EntryType::Dropped);
+  WriteTime(time, out);
+  PutVarint(count, out);
+}
+
+void util::log::BinaryLogWriter::WriteTime(int64_t time, std::string& out)
+{
+  PutSigned(time - m_LastTime, out);
+  m_LastTime = time;
+}
+
+util::log::BinaryLogReader::BinaryLogReader() :
+  m_Position(0),
+  m_LastTime(0),
+  m_Header(),
+  m_Corrupt(false)
+{
+}
+
+bool util::log::BinaryLogReader::Open(std::vector<uint8_t> data)
+{
+  m_Data = std::move(data);
+  m_Formats.clear();
+  m_Corrupt = false;
+
+  if (m_Data.size() < g_headerSize || memcmp(m_Data.data(), g_binaryLogMagic, sizeof(g_binaryLogMagic)) != 0)
+    return false;
+
+  uint8_t const* p = m_Data.data();
+  if (GetFixed(p + 4, 2) != g_binaryLogVersion)
+    return false;
+
+  m_Header.TicksPerSecond = static_cast<int64_t>(GetFixed(p + 8, 8));
+  m_Header.BaseTicks = static_cast<int64_t>(GetFixed(p + 16, 8));
+  m_Header.BaseLocalTime = static_cast<int64_t>(GetFixed(p + 24, 8));
+  if (m_Header.TicksPerSecond <= 0)
+    return false;
+
+  m_Position = g_headerSize;
+  m_LastTime = m_Header.BaseTicks;
+  return true;
+}
+
+bool util::log::BinaryLogReader::Next(BinaryLogEntry& entry)
+{
+  while (m_Position < m_Data.size())
+  {
+    size_t entryStart = m_Position;
+    uint8_t type = 0;
+    ReadByte(type);
+
+    bool ok = false;
+    switch (static_cast<EntryType>(type))
+    {
+    case EntryType::Format:
+    {
+      uint64_t id, length;
+      ok = ReadVarint(id) && ReadVarint(length) && id == m_Formats.size()
+        && length <= m_Data.size() - m_Position;
+      if (ok)
+      {
+        m_Formats.emplace_back(reinterpret_cast<const char*>(m_Data.data() + m_Position), static_cast<size_t>(length));
+        m_Position += static_cast<size_t>(length);
+        continue;
+      }
+      break;
+    }
+    case EntryType::Message:
+      entry.Type = EntryType::Message;
+      ok = ReadMessage(entry);
+      break;
+    case EntryType::Text:
+    {
+      uint8_t level = 0;
+      size_t length = 0;
+      entry.Type = EntryType::Text;
+      ok = ReadByte(level) && level <= static_cast<uint8_t>(LogLevel::Ok) && ReadTime(entry.Time)
+        && ReadString(entry.Record.Text, g_maxRecordText, length);
+      entry.Record.Format = nullptr;
+      entry.Record.Level = static_cast<LogLevel>(level);
+      entry.Record.ArgCount = 0;
+      entry.Record.TextUsed = static_cast<uint16_t>(std::min(length, g_maxRecordText - 1));
+      break;
+    }
+    case EntryType::Dropped:
+    {
+      uint64_t count = 0;
+      entry.Type = EntryType::Dropped;
+      ok = ReadTime(entry.Time) && ReadVarint(count);
+      entry.Dropped = static_cast<uint32_t>(count);
+      break;
+    }
+    default:
+      break;
+    }
+
+    if (!ok)
+    {
+      // A log the game was killed in the middle of writing ends with a
+      // partial entry, anything else is corrupt
+      m_Corrupt = true;
+      m_Position = entryStart;
+      return false;
+    }
+
+    entry.Record.Time = entry.Time;
+    return true;
+  }
+
+  return false;
+}
+
+bool util::log::BinaryLogReader::ReadByte(uint8_t& value)
+{
+  if (m_Position >= m_Data.size())
+    return false;
+  value = m_Data[m_Position++];
+  return true;
+}
+
+bool util::log::BinaryLogReader::ReadVarint(uint64_t& value)
+{
+  value = 0;
+  for (int shift = 0; shift < 64; shift += 7)
+  {
+    uint8_t byte;
+    if (!ReadByte(byte))
+      return false;
+
+    value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+    if (!(byte & 0x80))
+      return true;
+  }
+  return false;
+}
+
+bool util::log::BinaryLogReader::ReadSigned(int64_t& value)
+{
+  uint64_t encoded;
+  if (!ReadVarint(encoded))
+    return false;
+
+  value = static_cast<int64_t>(encoded >> 1) ^ -static_cast<int64_t>(encoded & 1);
+  return true;
+}
+
+bool util::log::BinaryLogReader::ReadTime(int64_t& time)
+{
+  int64_t delta;
+  if (!ReadSigned(delta))
+    return false;
+
+  m_LastTime += delta;
+  time = m_LastTime;
+  return true;
+}
+
+bool util::log::BinaryLogReader::ReadString(char* pOut, size_t capacity, size_t& length)
+{
+  uint64_t fullLength;
+  if (!ReadVarint(fullLength) || fullLength > m_Data.size() - m_Position)
+    return false;
+
+  // Never longer than the writer's own record, but cut off just in case
+  length = std::min(static_cast<size_t>(fullLength), capacity - 1);
+  memcpy(pOut, m_Data.data() + m_Position, length);
+  pOut[length] = '\0';
+  m_Position += static_cast<size_t>(fullLength);
+  return true;
+}
+
+bool util::log::BinaryLogReader::ReadMessage(BinaryLogEntry& entry)
+{
+  LogRecord& record = entry.Record;
+  uint8_t level = 0, argCount = 0;
+  uint64_t formatId = 0;
+  if (!ReadByte(level) || level > static_cast<uint8_t>(LogLevel::Ok) || !ReadTime(entry.Time)
+    || !ReadVarint(formatId) || formatId >= m_Formats.size()
+    || !ReadByte(argCount) || argCount > g_maxRecordArgs)
+    return false;
+
+  entry.FormatId = static_cast<uint32_t>(formatId);
+  record.Format = m_Formats[entry.FormatId].c_str();
+  record.Level = static_cast<LogLevel>(level);
+  record.ArgCount = argCount;
+  record.TextUsed = 0;
+
+  for (uint8_t i = 0; i < argCount; ++i)
+  {
+    LogArg& arg = record.Args[i];
+    uint8_t type = 0;
+    if (!ReadByte(type) || type == 0 || type > static_cast<uint8_t>(ArgType::String))
+      return false;
+
+    arg.Type = static_cast<ArgType>(type);
+    switch (arg.Type)
+    {
+    case ArgType::Double:
+    {
+      if (m_Data.size() - m_Position < 8)
+        return false;
+      uint64_t bits = GetFixed(m_Data.data() + m_Position, 8);
+      memcpy(&arg.Double, &bits, sizeof(bits));
+      m_Position += 8;
+      break;
+    }
+    case ArgType::Pointer:
+    {
+      // Pointers of a 32 bit game fit any pointer here
+      uint64_t value;
+      if (!ReadVarint(value))
+        return false;
+      arg.Pointer = reinterpret_cast<const void*>(static_cast<uintptr_t>(value));
+      break;
+    }
+    case ArgType::String:
+    {
+      size_t length;
+      arg.StringOffset = record.TextUsed;
+      if (!ReadString(record.Text + record.TextUsed, g_maxRecordText - record.TextUsed, length))
+        return false;
+      record.TextUsed = static_cast<uint16_t>(std::min(record.TextUsed + length + 1, g_maxRecordText - 1));
+      break;
+    }
+    default:
+    {
+      int64_t value;
+      if (!ReadSigned(value))
+        return false;
+      arg.Integer = value;
+      break;
+    }
+    }
+  }
+
+  return IsConsistent(record);
+}
@@ -0,0 +1,122 @@
+#pragma once
+#include "LogRecord.h"
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Binary form of the log, written by the log thread instead of CT.log
+// when Binary is set in the [Log] section of the config, and turned
+// back into text or JSON by LogDecoder/.
+//
+// The file is a header followed by entries that each start with an
+// EntryType byte. Integers are LEB128 varints, signed ones zigzag
+// encoded. A call site's format string is written once, the first time
+// it logs, and its messages refer to it by id:
+//
+//   Header   "CTBL", uint16 version, uint16 reserved, int64 ticks per
+//            second, int64 base ticks, int64 local time at base ticks
+//            as a FILETIME
+//   Format   varint id, varint length, bytes
+//   Message  uint8 level, signed tick delta, varint format id,
+//            uint8 arg count, then per arg a uint8 ArgType and its value
+//   Text     uint8 level, signed tick delta, varint length, bytes
+//   Dropped  signed tick delta, varint count
+//
+// Ticks are QueryPerformanceCounter ticks and every delta is to the
+// previous entry. Deltas can be negative, threads take their timestamp
+// after claiming a slot in the queue.
+//
+// Argument values are varints for integers and pointers, 8 raw bytes
+// for doubles and a varint length followed by the bytes for strings.
+
+namespace util
+{
+  namespace log
+  {
+    const uint16_t g_binaryLogVersion = 1;
+
+    enum class EntryType : uint8_t
+    {
+      Format = 1,
+      Message,
+      Text,
+      Dropped
+    };
+
+    struct BinaryLogHeader
+    {
+      int64_t TicksPerSecond;
+      int64_t BaseTicks;
+      int64_t BaseLocalTime;
+    };
+
+    // Local time as a FILETIME for a tick count
+    int64_t TicksToLocalTime(BinaryLogHeader const& clock, int64_t ticks);
+
+    class BinaryLogWriter
+    {
+    public:
+      BinaryLogWriter();
+
+      // Appends the header of a new file to out and forgets the
+      // format strings written so far
+      void Begin(BinaryLogHeader const& header, std::string& out);
+      void Write(LogRecord const& record, std::string& out);
+      void WriteDropped(int64_t time, uint32_t count, std::string& out);
+
+    private:
+      void WriteTime(int64_t time, std::string& out);
+
+    private:
+      std::unordered_map<const char*, uint32_t> m_FormatIds;
+      int64_t m_LastTime;
+    };
+
+    // One Message, Text or Dropped entry. Record is filled like the log
+    // thread's own records, so FormatRecord turns it into the message.
+    // Its Format points into the reader and stays valid until the next
+    // call to Next.
+    struct BinaryLogEntry
+    {
+      EntryType Type;
+      int64_t Time;
+      uint32_t FormatId;
+      uint32_t Dropped;
+      LogRecord Record;
+    };
+
+    class BinaryLogReader
+    {
+    public:
+      BinaryLogReader();
+
+      // False if data isn't a binary log of this version
+      bool Open(std::vector<uint8_t> data);
+
+      // False at the end of the file, or where the rest of it can't be
+      // read, which IsCorrupt() tells apart
+      bool Next(BinaryLogEntry& entry);
+      bool IsCorrupt() const { return m_Corrupt; }
+
+      BinaryLogHeader const& GetHeader() const { return m_Header; }
+      std::vector<std::string> const& GetFormats() const { return m_Formats; }
+
+    private:
+      bool ReadByte(uint8_t& value);
+      bool ReadVarint(uint64_t& value);
+      bool ReadSigned(int64_t& value);
+      bool ReadTime(int64_t& time);
+      bool ReadString(char* pOut, size_t capacity, size_t& length);
+      bool ReadMessage(BinaryLogEntry& entry);
+
+    private:
+      std::vector<uint8_t> m_Data;
+      size_t m_Position;
+      int64_t m_LastTime;
+      BinaryLogHeader m_Header;
+      std::vector<std::string> m_Formats;
+      bool m_Corrupt;
+    };
+  }
+}
@@ -0,0 +1,277 @@
+#include "LogRecord.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+using util::log::ArgType;
+
+namespace
+{
+  // Longest single conversion, like "%-20s", that's deferred
+  const size_t g_maxSpecLength = 31;
+
+  enum class LengthModifier
+  {
+    None,
+    Short,
+    Long,
+    LongLong,
+    SizeT,
+    IntMax,
+    PtrDiff,
+    Unsupported
+  };
+
+  const char* ParseLength(const char* p, LengthModifier& length)
+  {
+    length = LengthModifier::None;
+    switch (*p)
+    {
+    case 'h':
+      length = LengthModifier::Short;
+      return p[1] == 'h' ? p + 2 : p + 1;
+    case 'l':
+      if (p[1] == 'l')
+      {
+        length = LengthModifier::LongLong;
+        return p + 2;
+      }
+      length = LengthModifier::Long;
+      return p + 1;
+    case 'z': length = LengthModifier::SizeT; return p + 1;
+    case 'j': length = LengthModifier::IntMax; return p + 1;
+    case 't': length = LengthModifier::PtrDiff; return p + 1;
+    case 'L':
+    case 'w':
+      length = LengthModifier::Unsupported;
+      return p + 1;
+    case 'I':
+      // MSVC's %I64d, %I32d and %Id
+      if (p[1] == '6' && p[2] == '4')
+      {
+        length = LengthModifier::LongLong;
+        return p + 3;
+      }
+      if (p[1] == '3' && p[2] == '2')
+        return p + 3;
+      length = LengthModifier::SizeT;
+      return p + 1;
+    default:
+      return p;
+    }
+  }
+
+  ArgType IntegerType(LengthModifier length)
+  {
+    switch (length)
+    {
+    case LengthModifier::None:
+    case LengthModifier::Short:
+      return ArgType::Int;
+    case LengthModifier::Long: return ArgType::Long;
+    case LengthModifier::LongLong: return ArgType::LongLong;
+    case LengthModifier::SizeT: return ArgType::SizeT;
+    case LengthModifier::IntMax: return ArgType::IntMax;
+    case LengthModifier::PtrDiff: return ArgType::PtrDiff;
+    default: return ArgType::None;
+    }
+  }
+
+  // Parses the conversion starting at the '%' at p. Returns the end of
+  // it and what argument it reads, ArgType::None for "%%", or nullptr if
+  // it can't be deferred.
+  const char* ParseConversion(const char* p, ArgType& type)
+  {
+    const char* start = p++;
+    while (*p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0')
+      ++p;
+    while (*p >= '0' && *p <= '9')
+      ++p;
+    if (*p == '.')
+    {
+      ++p;
+      while (*p >= '0' && *p <= '9')
+        ++p;
+    }
+
+    LengthModifier length;
+    p = ParseLength(p, length);
+
+    switch (*p)
+    {
+    case '%':
+      type = ArgType::None;
+      break;
+    case 'd': case 'i': case 'u': case 'x': case 'X': case 'o':
+      type = IntegerType(length);
+      break;
+    case 'c':
+      type = length == LengthModifier::None ? ArgType::Int : ArgType::None;
+      break;
+    case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+      type = length == LengthModifier::None || length == LengthModifier::Long ? ArgType::Double : ArgType::None;
+      break;
+    case 'p':
+      type = ArgType::Pointer;
+      break;
+    case 's':
+      type = length == LengthModifier::None || length == LengthModifier::Short ? ArgType::String : ArgType::None;
+      break;
+    default:
+      // '*' widths, %n, wide %S and %C and anything unknown
+      return nullptr;
+    }
+
+    if (type == ArgType::None && *p != '%')
+      return nullptr;
+
+    ++p;
+    if (static_cast<size_t>(p - start) > g_maxSpecLength)
+      return nullptr;
+    return p;
+  }
+
+  bool CaptureArgs(util::log::LogRecord& record, const char* format, va_list args)
+  {
+    for (const char* p = strchr(format, '%'); p; p = strchr(p, '%'))
+    {
+      ArgType type;
+      const char* end = ParseConversion(p, type);
+      if (!end)
+        return false;
+      p = end;
+
+      if (type == ArgType::None)
+        continue;
+      if (record.ArgCount == util::log::g_maxRecordArgs)
+        return false;
+
+      util::log::LogArg& arg = record.Args[record.ArgCount++];
+      arg.Type = type;
+      switch (type)
+      {
+      case ArgType::Int: arg.Integer = va_arg(args, int); break;
+      case ArgType::Long: arg.Integer = va_arg(args, long); break;
+      case ArgType::LongLong: arg.Integer = va_arg(args, long long); break;
+      case ArgType::SizeT: arg.Integer = static_cast<long long>(va_arg(args, size_t)); break;
+      case ArgType::IntMax: arg.Integer = static_cast<long long>(va_arg(args, intmax_t)); break;
+      case ArgType::PtrDiff: arg.Integer = va_arg(args, ptrdiff_t); break;
+      case ArgType::Double: arg.Double = va_arg(args, double); break;
+      case ArgType::Pointer: arg.Pointer = va_arg(args, void*); break;
+      case ArgType::String:
+      {
+        const char* s = va_arg(args, const char*);
+        if (!s)
+          s = "(null)";
+
+        // The last byte of Text is always left for a terminator, so a
+        // string that doesn't fit anymore becomes an empty one
+        size_t room = util::log::g_maxRecordText - 1 - record.TextUsed;
+        size_t length = std::min(strlen(s), room);
+        memcpy(record.Text + record.TextUsed, s, length);
+        record.Text[record.TextUsed + length] = '\0';
+        arg.StringOffset = record.TextUsed;
+        record.TextUsed = static_cast<uint16_t>(std::min(record.TextUsed + length + 1, util::log::g_maxRecordText - 1));
+        break;
+      }
+      default: break;
+      }
+    }
+    return true;
+  }
+
+  template<typename T>
+  void AppendFormatted(std::string& out, const char* spec, T value)
+  {
+    char buffer[512];
+    int written = snprintf(buffer, sizeof(buffer), spec, value);
+    if (written > 0)
+      out.append(buffer, std::min(static_cast<size_t>(written), sizeof(buffer) - 1));
+  }
+}
+
+void util::log::Capture(LogRecord& record, const char* format, va_list args)
+{
+  record.Format = format;
+  record.ArgCount = 0;
+  record.TextUsed = 0;
+
+  va_list argsCopy;
+  va_copy(argsCopy, args);
+  bool deferred = CaptureArgs(record, format, argsCopy);
+  va_end(argsCopy);
+
+  if (!deferred)
+  {
+    record.Format = nullptr;
+    record.ArgCount = 0;
+    int written = vsnprintf(record.Text, g_maxRecordText, format, args);
+    record.TextUsed = static_cast<uint16_t>(written < 0 ? 0 : std::min(static_cast<size_t>(written), g_maxRecordText - 1));
+  }
+}
+
+void util::log::FormatRecord(LogRecord const& record, std::string& out)
+{
+  if (!record.Format)
+  {
+    out.append(record.Text, record.TextUsed);
+    return;
+  }
+
+  char spec[g_maxSpecLength + 1];
+  uint8_t argIndex = 0;
+  const char* p = record.Format;
+  while (const char* percent = strchr(p, '%'))
+  {
+    out.append(p, percent);
+
+    // Capture already checked every conversion
+    ArgType type;
+    p = ParseConversion(percent, type);
+    if (type == ArgType::None)
+    {
+      out += '%';
+      continue;
+    }
+
+    size_t specLength = p - percent;
+    memcpy(spec, percent, specLength);
+    spec[specLength] = '\0';
+
+    LogArg const& arg = record.Args[argIndex++];
+    switch (arg.Type)
+    {
+    case ArgType::Int: AppendFormatted(out, spec, static_cast<int>(arg.Integer)); break;
+    case ArgType::Long: AppendFormatted(out, spec, static_cast<long>(arg.Integer)); break;
+    case ArgType::LongLong: AppendFormatted(out, spec, arg.Integer); break;
+    case ArgType::SizeT: AppendFormatted(out, spec, static_cast<size_t>(arg.Integer)); break;
+    case ArgType::IntMax: AppendFormatted(out, spec, static_cast<intmax_t>(arg.Integer)); break;
+    case ArgType::PtrDiff: AppendFormatted(out, spec, static_cast<ptrdiff_t>(arg.Integer)); break;
+    case ArgType::Double: AppendFormatted(out, spec, arg.Double); break;
+    case ArgType::Pointer: AppendFormatted(out, spec, arg.Pointer); break;
+    case ArgType::String: AppendFormatted(out, spec, record.Text + arg.StringOffset); break;
+    default: break;
+    }
+  }
+  out += p;
+}
+
+bool util::log::IsConsistent(LogRecord const& record)
+{
+  if (!record.Format)
+    return record.ArgCount == 0;
+
+  uint8_t argIndex = 0;
+  for (const char* p = strchr(record.Format, '%'); p; p = strchr(p, '%'))
+  {
+    ArgType type;
+    p = ParseConversion(p, type);
+    if (!p)
+      return false;
+    if (type == ArgType::None)
+      continue;
+    if (argIndex == record.ArgCount || record.Args[argIndex++].Type != type)
+      return false;
+  }
+  return argIndex == record.ArgCount;
+}
@@ -0,0 +1,178 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Kept free of Windows headers so the log queue can be benchmarked
+// anywhere, see LogBench/
+
+namespace util
+{
+  namespace log
+  {
+    enum class LogLevel : uint8_t
+    {
+      Info,
+      Warning,
+      Error,
+      Ok
+    };
+
+    // What a conversion reads from the arguments, after the usual
+    // promotions. Integers are stored as long long and cast back to
+    // their own type when formatted.
+    enum class ArgType : uint8_t
+    {
+      None,
+      Int,
+      Long,
+      LongLong,
+      SizeT,
+      IntMax,
+      PtrDiff,
+      Double,
+      Pointer,
+      String
+    };
+
+    struct LogArg
+    {
+      ArgType Type;
+      union
+      {
+        long long Integer;
+        double Double;
+        const void* Pointer;
+        // Start of a null terminated copy in LogRecord::Text
+        uint16_t StringOffset;
+      };
+    };
+
+    const size_t g_maxRecordArgs = 12;
+    const size_t g_maxRecordText = 256;
+
+    // One message as the calling thread left it. Only the arguments are
+    // copied, the format has to be a string literal or otherwise outlive
+    // the record. Copies of %s arguments go to Text and get cut off
+    // when it runs out.
+    struct LogRecord
+    {
+      // nullptr if Text already holds the whole message
+      const char* Format;
+      // QueryPerformanceCounter ticks
+      int64_t Time;
+      LogLevel Level;
+      uint8_t ArgCount;
+      uint16_t TextUsed;
+      LogArg Args[g_maxRecordArgs];
+      char Text[g_maxRecordText];
+    };
+
+    // Copies the arguments format refers to out of args. Formats that
+    // can't be deferred, like * widths, %n, wide strings or more than
+    // g_maxRecordArgs arguments, are formatted into Text right away.
+    void Capture(LogRecord& record, const char* format, va_list args);
+
+    // Appends the message to out, without a level prefix or newline
+    void FormatRecord(LogRecord const& record, std::string& out);
+
+    // True if Capture would have deferred Format with exactly these
+    // argument types, for records read back from a file
+    bool IsConsistent(LogRecord const& record);
+
+    // Bounded multi producer / single consumer queue of log records,
+    // after Dmitry Vyukov's bounded MPMC queue. A producer claims a slot
+    // with one CAS, fills the record in place and commits it. When the
+    // queue is full the message is dropped and counted rather than
+    // making the game wait for the log thread.
+    template <size_t Capacity>
+    class LogQueue
+    {
+      static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+    public:
+      LogQueue() :
+        m_EnqueuePos(0),
+        m_DequeuePos(0),
+        m_Dropped(0)
+      {
+        for (size_t i = 0; i < Capacity; ++i)
+          m_Cells[i].Sequence.store(i, std::memory_order_relaxed);
+      }
+
+      // Producers. Returns nullptr if the queue is full, otherwise the
+      // record has to be passed to Commit once filled.
+      LogRecord* Claim(size_t& position)
+      {
+        size_t pos = m_EnqueuePos.load(std::memory_order_relaxed);
+        for (;;)
+        {
+          Cell& cell = m_Cells[pos & (Capacity - 1)];
+          size_t sequence = cell.Sequence.load(std::memory_order_acquire);
+          intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+
+          if (difference == 0)
+          {
+            if (m_EnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+              position = pos;
+              return &cell.Record;
+            }
+          }
+          else if (difference < 0)
+          {
+            m_Dropped.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+          }
+          else
+            pos = m_EnqueuePos.load(std::memory_order_relaxed);
+        }
+      }
+
+      void Commit(size_t position)
+      {
+        m_Cells[position & (Capacity - 1)].Sequence.store(position + 1, std::memory_order_release);
+      }
+
+      // Consumer. The next committed record in order, or nullptr
+      LogRecord* Peek()
+      {
+        Cell& cell = m_Cells[m_DequeuePos & (Capacity - 1)];
+        size_t sequence = cell.Sequence.load(std::memory_order_acquire);
+        return sequence == m_DequeuePos + 1 ? &cell.Record : nullptr;
+      }
+
+      void Pop()
+      {
+        m_Cells[m_DequeuePos & (Capacity - 1)].Sequence.store(m_DequeuePos + Capacity, std::memory_order_release);
+        m_DequeuePos += 1;
+      }
+
+      // Messages dropped since the last call
+      uint32_t TakeDropped()
+      {
+        return m_Dropped.exchange(0, std::memory_order_relaxed);
+      }
+
+    private:
+      struct Cell
+      {
+        std::atomic<size_t> Sequence;
+        LogRecord Record;
+      };
+
+      std::array<Cell, Capacity> m_Cells;
+
+      alignas(64) std::atomic<size_t> m_EnqueuePos;
+      alignas(64) size_t m_DequeuePos;
+      std::atomic<uint32_t> m_Dropped;
+
+    public:
+      LogQueue(LogQueue const&) = delete;
+      void operator=(LogQueue const&) = delete;
+    };
+  }
+}
@@ -0,0 +1,80 @@
+#include "OffsetCache.h"
+#include "PEImage.h"
+#include <fstream>
+
+static const int g_offsetCacheVersion = 2;
+
+bool util::offsets::ImageFingerprint::operator==(ImageFingerprint const& other) const
+{
+  return TimeDateStamp == other.TimeDateStamp
+    && CheckSum == other.CheckSum
+    && SizeOfImage == other.SizeOfImage
+    && FileSize == other.FileSize
+    && LastWriteTime == other.LastWriteTime;
+}
+
+void util::offsets::GetFingerprint(PEImage const& image, uint64_t fileSize, uint64_t lastWriteTime, ImageFingerprint& fingerprint)
+{
+  fingerprint.TimeDateStamp = image.GetTimeDateStamp();
+  fingerprint.CheckSum = image.GetCheckSum();
+  fingerprint.SizeOfImage = image.GetSizeOfImage();
+  fingerprint.FileSize = fileSize;
+  fingerprint.LastWriteTime = lastWriteTime;
+}
+
+bool util::offsets::OffsetCache::Load(std::string const& path, ImageFingerprint const& fingerprint)
+{
+  m_MatchRvas.clear();
+
+  std::ifstream file(path);
+  if (!file.is_open())
+    return false;
+
+  std::string magic;
+  int version = 0;
+  ImageFingerprint stored;
+  file >> magic >> version;
+  file >> std::hex >> stored.TimeDateStamp >> stored.CheckSum >> stored.SizeOfImage >> stored.FileSize >> stored.LastWriteTime;
+  if (!file || magic != "CTOC" || version != g_offsetCacheVersion || stored != fingerprint)
+    return false;
+
+  std::string name;
+  uint32_t rva = 0;
+  while (file >> name >> rva)
+    m_MatchRvas[name] = rva;
+
+  // Stopped on something other than the end of the file
+  if (!file.eof())
+  {
+    m_MatchRvas.clear();
+    return false;
+  }
+
+  return !m_MatchRvas.empty();
+}
+
+bool util::offsets::OffsetCache::Save(std::string const& path, ImageFingerprint const& fingerprint) const
+{
+  std::ofstream file(path, std::ios::trunc);
+  if (!file.is_open())
+    return false;
+
+  file << "CTOC " << g_offsetCacheVersion << "\n" << std::hex
+    << fingerprint.TimeDateStamp << " " << fingerprint.CheckSum << " "
+    << fingerprint.SizeOfImage << " " << fingerprint.FileSize << " " << fingerprint.LastWriteTime << "\n";
+
+  for (auto const& kv : m_MatchRvas)
+    file << kv.first << " " << kv.second << "\n";
+
+  return file.good();
+}
+
+bool util::offsets::OffsetCache::Get(std::string const& name, uint32_t& rva) const
+{
+  auto it = m_MatchRvas.find(name);
+  if (it == m_MatchRvas.end())
+    return false;
+
+  rva = it->second;
+  return true;
+}
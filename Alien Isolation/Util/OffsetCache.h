@@ -0,0 +1,57 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+
+namespace util
+{
+  class PEImage;
+
+  namespace offsets
+  {
+    // Identifies one build of the game binary by its PE headers and
+    // the file it was loaded from, without reading the file. The code
+    // isn't hashed, every cached match is checked against its signature
+    // on load anyway.
+    struct ImageFingerprint
+    {
+      uint32_t TimeDateStamp{ 0 };
+      uint32_t CheckSum{ 0 };
+      uint32_t SizeOfImage{ 0 };
+      uint64_t FileSize{ 0 };
+      // FILETIME of the last write, 100 ns intervals since 1601
+      uint64_t LastWriteTime{ 0 };
+
+      bool operator==(ImageFingerprint const& other) const;
+      bool operator!=(ImageFingerprint const& other) const { return !(*this == other); }
+    };
+
+    // The header fields are the same in the file and the loaded module,
+    // so image can be either
+    void GetFingerprint(PEImage const& image, uint64_t fileSize, uint64_t lastWriteTime, ImageFingerprint& fingerprint);
+
+    // Signature match positions (RVAs) from the last full scan of a
+    // binary. Stored as text next to the config:
+    //
+    //   CTOC <version>
+    //   <timestamp> <checksum> <size of image> <file size> <last write time>
+    //   <signature name> <match rva>
+    //   ...
+    class OffsetCache
+    {
+    public:
+      // Returns false if the file is missing, broken or from another binary
+      bool Load(std::string const& path, ImageFingerprint const& fingerprint);
+      bool Save(std::string const& path, ImageFingerprint const& fingerprint) const;
+
+      void Clear() { m_MatchRvas.clear(); }
+      void Set(std::string const& name, uint32_t rva) { m_MatchRvas[name] = rva; }
+      bool Get(std::string const& name, uint32_t& rva) const;
+      size_t GetCount() const { return m_MatchRvas.size(); }
+
+    private:
+      std::map<std::string, uint32_t> m_MatchRvas;
+    };
+  }
+}
@@ -0,0 +1,229 @@
+#include "OffsetTable.h"
+#include "PEImage.h"
+#include "StaticSig.h"
+#include <cstring>
+
+namespace
+{
+  // In the same order as OffsetId
+  const char* g_offsetNames[] = {
+    "OFFSET_D3D",
+    "OFFSET_MAIN",
+
+    "OFFSET_CAMERAUPDATE",
+    "OFFSET_GETCAMERAMATRIX",
+    "OFFSET_POSTPROCESSUPDATE",
+    "OFFSET_TONEMAPUPDATE",
+
+    "OFFSET_INPUTUPDATE",
+    "OFFSET_GAMEPADUPDATE",
+    "OFFSET_COMBATMANAGERUPDATE",
+
+    "OFFSET_SHOWMOUSE",
+    "OFFSET_DRAWUI",
+    "OFFSET_FREEZETIME",
+    "OFFSET_SCALEFORM",
+    "OFFSET_TIMESCALE",
+    "OFFSET_POSTPROCESS"
+  };
+
+  // Used for anything that isn't scanned or when scanning fails.
+  // These are relative to the module base, in the same order as OffsetId.
+  const uint32_t g_hardcodedOffsets[] = {
+    0x17DF5CC, // OFFSET_D3D
+    0x12F0C88, // OFFSET_MAIN
+
+    0x32300,   // OFFSET_CAMERAUPDATE
+    0x5B0B40,  // OFFSET_GETCAMERAMATRIX
+    0x608C50,  // OFFSET_POSTPROCESSUPDATE
+    0x208490,  // OFFSET_TONEMAPUPDATE
+
+    0x57D6C0,  // OFFSET_INPUTUPDATE
+    0x60EE30,  // OFFSET_GAMEPADUPDATE
+    0x37A800,  // OFFSET_COMBATMANAGERUPDATE
+
+    0x1359B44, // OFFSET_SHOWMOUSE
+    0x1240F27, // OFFSET_DRAWUI
+    0x12F194C, // OFFSET_FREEZETIME
+    0x134A78C, // OFFSET_SCALEFORM
+    0x0DC6EA0, // OFFSET_TIMESCALE
+    0x15D0970  // OFFSET_POSTPROCESS
+  };
+
+  static_assert(sizeof(g_offsetNames) / sizeof(g_offsetNames[0]) == util::offsets::OffsetCount,
+    "g_offsetNames has to have an entry for every OffsetId");
+  static_assert(sizeof(g_hardcodedOffsets) / sizeof(g_hardcodedOffsets[0]) == util::offsets::OffsetCount,
+    "g_hardcodedOffsets has to have an entry for every OffsetId");
+
+
+  // Gameplay/update hooks
+  CT_STATIC_SIG(g_sigCameraUpdate,
+    "55 8B EC 83 E4 F0 81 EC 74 01 00 00 53 56 8B F1 "
+    "8B 86 D8 01 00 00 33 DB 57 85 C0 74 12 38 98 4D 01 00 00 74 0A "
+    "38 98 4F 01 00 00 75 02 8B D8 "
+    "80 BE 21 02 00 00 00 74 0C "
+    "8B 86 F0 01 00 00 85 C0 74 02 8B D8 "
+    "85 DB 0F 84 ?? ?? ?? ?? "
+    "F3 0F 10 43 44 F3 0F 10 4B 40 F3 0F 10 53 3C F3 0F 10 5B 2C "
+    "F3 0F 11 44 24 48 0F 57 C0 "
+    "E8 ?? ?? ?? ?? "
+    "F3 0F 7E 00 "
+    "F3 0F 10 35 [ ?? ?? ?? ?? ]");
+
+  CT_STATIC_SIG(g_sigGetCameraMatrix,
+    "8B 44 24 04 56 8B F1 "
+    "8D 96 4B 03 00 00 2B D0 90 "
+    "8A 08 88 0C 02 40 84 C9 75 F6 "
+    "8B 44 24 0C 89 86 14 03 00 00 "
+    "83 F8 01 75 4E "
+    "A1 [ ?? ?? ?? ?? ] "
+    "50 E8 ?? ?? ?? ?? 6A 01 50 "
+    "89 86 70 03 00 00 "
+    "E8 ?? ?? ?? ??");
+
+  CT_STATIC_SIG(g_sigPostProcessUpdate,
+    "83 EC 08 53 8B 5C 24 10 55 56 57 "
+    "8B 7C 24 20 8B CF 2B CB "
+    "B8 AB AA AA 2A F7 E9 D1 FA 8B C2 C1 E8 1F 03 C2 "
+    "83 F8 20 0F 8E ?? ?? ?? ?? "
+    "8B 74 24 24 85 F6 0F 8E ?? ?? ?? ?? "
+    "57 8D 44 24 14 53 50 E8 ?? ?? ?? ?? "
+    "8B 6C 24 20 8B C6 99 2B C2 D1 F8 "
+    "8B F0 99 2B C2 D1 F8 03 F0 "
+    "8B CF 2B CD B8 AB AA AA 2A F7 E9 "
+    "8B 4C 24 1C D1 FA 8B C2 C1 E8 1F 03 C2 "
+    "2B CB 89 44 24 2C");
+
+  CT_STATIC_SIG(g_sigTonemapUpdate,
+    "83 EC 20 53 56 8B F1 "
+    "E8 ?? ?? ?? ?? "
+    "8B 98 74 03 00 00 85 DB 0F 84 ?? ?? ?? ?? "
+    "57 8D 4C 24 0C E8 ?? ?? ?? ?? "
+    "8B 7C 24 30 57 8B CE E8 ?? ?? ?? ?? D9 5C 24 10 "
+    "57 8B CE E8 ?? ?? ?? ?? D9 5C 24 18 "
+    "57 8B CE E8 ?? ?? ?? ?? D9 5C 24 1C "
+    "F3 0F 10 44 24 10 0F 2E 43 10 9F F6 C4 44 7A ?? "
+    "F3 0F 10 44 24 14 0F 2E 43 14 9F F6 C4 44 7A ?? "
+    "F3 0F 10 44 24 18 0F 2E 43 18 9F F6 C4 44 7A ?? "
+    "F3 0F 10 44 24 1C 0F 2E 43 1C 9F F6 C4 44");
+
+  CT_STATIC_SIG(g_sigInputUpdate,
+    "0F 57 ED 56 8B B1 40 10 00 00 85 F6 74 32 "
+    "80 7E 10 00 74 2C 80 7E 11 00 74 26 "
+    "33 C0 39 81 58 10 00 00 76 1C "
+    "8D 91 80 0A 00 00 F3 0F 11 2A 40 83 C2 44 "
+    "3B 81 58 10 00 00 72 F0 "
+    "F3 0F 10 35 [ ?? ?? ?? ?? ] "
+    "B0 02 84 41 3C 74 08 F3 0F 11 B1 C4 0A 00 00");
+
+  CT_STATIC_SIG(g_sigGamepadUpdate,
+    "8B 44 24 04 F6 44 08 14 80 74 15 "
+    "F3 0F 10 05 [ ?? ?? ?? ?? ] F3 0F 11 44 24 04 D9 44 24 04 C2 04 00 "
+    "0F 57 C0 F3 0F 11 44 24 04 D9 44 24 04 C2 04 00 "
+    "80 7C 24 08 00 74 0A "
+    "F3 0F 10 05 [ ?? ?? ?? ?? ] EB 08 "
+    "F3 0F 10 05 [ ?? ?? ?? ?? ] "
+    "8B 44 24 04 F6 44 08 14 80");
+
+  CT_STATIC_SIG(g_sigCombatManagerUpdate,
+    "55 8B EC 83 E4 F0 F3 0F 10 55 0C 83 EC 64 53 56 8B F1 "
+    "F3 0F 10 86 A0 01 00 00 F3 0F 59 C2 F3 0F 58 86 74 01 00 00 "
+    "0F 28 C8 "
+    "F3 0F 59 0D [ ?? ?? ?? ?? ] "
+    "0F 2F 0D [ ?? ?? ?? ?? ] "
+    "57 76 15 "
+    "F3 0F 58 0D [ ?? ?? ?? ?? ] "
+    "F3 0F 2C C1 0F 57 C9 F3 0F 2A C8 "
+    "F3 0F 59 0D [ ?? ?? ?? ?? ]");
+
+  // Globals / data pointers
+  CT_STATIC_SIG(g_sigPostProcess,
+    "A1 [ ?? ?? ?? ?? ] 85 C0 74 ?? 8B 48 ??");
+
+  CT_STATIC_SIG(g_sigScaleform,
+    "8B 0D [ ?? ?? ?? ?? ] 85 C9 74 ?? 8B 01 FF 50 ??");
+
+  CT_STATIC_SIG(g_sigFreezeTime,
+    "F6 05 [ ?? ?? ?? ?? ] 00 75 ??");
+
+  CT_STATIC_SIG(g_sigTimescale,
+    "F3 0F 10 05 [ ?? ?? ?? ?? ] F3 0F 59 ?? ??");
+
+  const util::offsets::OffsetSignature g_offsetSignatures[] = {
+    // Gameplay/update hooks
+    { util::offsets::OFFSET_CAMERAUPDATE, g_sigCameraUpdate.View(), 0 },
+    { util::offsets::OFFSET_GETCAMERAMATRIX, g_sigGetCameraMatrix.View(), 0 },
+    { util::offsets::OFFSET_POSTPROCESSUPDATE, g_sigPostProcessUpdate.View(), 0 },
+    { util::offsets::OFFSET_TONEMAPUPDATE, g_sigTonemapUpdate.View(), 0 },
+    { util::offsets::OFFSET_INPUTUPDATE, g_sigInputUpdate.View(), 0 },
+    { util::offsets::OFFSET_GAMEPADUPDATE, g_sigGamepadUpdate.View(), 0 },
+    { util::offsets::OFFSET_COMBATMANAGERUPDATE, g_sigCombatManagerUpdate.View(), 0 },
+
+    // Globals / data pointers
+    { util::offsets::OFFSET_POSTPROCESS, g_sigPostProcess.View(), 0 },
+    { util::offsets::OFFSET_SCALEFORM, g_sigScaleform.View(), 0 },
+    { util::offsets::OFFSET_FREEZETIME, g_sigFreezeTime.View(), 0 },
+    { util::offsets::OFFSET_TIMESCALE, g_sigTimescale.View(), 0 }
+  };
+}
+
+const char* util::offsets::GetName(OffsetId id)
+{
+  return g_offsetNames[id];
+}
+
+uint32_t util::offsets::GetHardcoded(OffsetId id)
+{
+  return g_hardcodedOffsets[id];
+}
+
+util::offsets::OffsetSignature const* util::offsets::GetSignatures(size_t& count)
+{
+  count = sizeof(g_offsetSignatures) / sizeof(g_offsetSignatures[0]);
+  return g_offsetSignatures;
+}
+
+const char* util::offsets::ToString(ResolveStatus status)
+{
+  switch (status)
+  {
+  case ResolveStatus::Ok: return "Ok";
+  case ResolveStatus::NotFound: return "Not found";
+  case ResolveStatus::BadReferenceSize: return "Reference isn't 4 bytes";
+  case ResolveStatus::ReferenceOutsideData: return "Reference outside data sections";
+  }
+  return "Unknown";
+}
+
+util::offsets::ResolveStatus util::offsets::ResolveMatch(PEImage const& image, uint8_t const* pImage, uintptr_t moduleBase,
+  uint8_t const* pMatch, OffsetSignature const& sig, uintptr_t& result)
+{
+  result = 0;
+  if (!pMatch)
+    return ResolveStatus::NotFound;
+
+  SigView const& pattern = sig.Pattern;
+  if (pattern.refStart < 0)
+  {
+    result = moduleBase + static_cast<uintptr_t>(pMatch - pImage) + sig.AddOffset;
+    return ResolveStatus::Ok;
+  }
+
+  if (pattern.refSize != 4)
+    return ResolveStatus::BadReferenceSize;
+
+  uint32_t addr = 0;
+  memcpy(&addr, pMatch + pattern.refStart, sizeof(addr));
+
+  // References point at globals, anything outside the data
+  // sections means the pattern matched the wrong code
+  PESection const* pSection = addr >= moduleBase ? image.FindSectionByRva(static_cast<uint32_t>(addr - moduleBase)) : nullptr;
+  if (!image.GetSections().empty() && (!pSection || !pSection->IsData()))
+  {
+    result = addr;
+    return ResolveStatus::ReferenceOutsideData;
+  }
+
+  result = static_cast<uintptr_t>(addr) + sig.AddOffset;
+  return ResolveStatus::Ok;
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include "SigScan.h"
+
+// The offsets the tools use, their hardcoded values and the signatures
+// that find them. Kept free of Windows headers so the offline resolver
+// (OffsetResolver/ in the repository root) scans with the exact same
+// table as the injected tools.
+namespace util
+{
+  class PEImage;
+
+  namespace offsets
+  {
+    // Every offset the tools use. The names match the ones
+    // written to the log and the offset cache.
+    enum OffsetId
+    {
+      OFFSET_D3D,
+      OFFSET_MAIN,
+
+      OFFSET_CAMERAUPDATE,
+      OFFSET_GETCAMERAMATRIX,
+      OFFSET_POSTPROCESSUPDATE,
+      OFFSET_TONEMAPUPDATE,
+
+      OFFSET_INPUTUPDATE,
+      OFFSET_GAMEPADUPDATE,
+      OFFSET_COMBATMANAGERUPDATE,
+
+      OFFSET_SHOWMOUSE,
+      OFFSET_DRAWUI,
+      OFFSET_FREEZETIME,
+      OFFSET_SCALEFORM,
+      OFFSET_TIMESCALE,
+      OFFSET_POSTPROCESS,
+
+      OffsetCount
+    };
+
+    const char* GetName(OffsetId id);
+    // Relative to the module base
+    uint32_t GetHardcoded(OffsetId id);
+
+    struct OffsetSignature
+    {
+      OffsetId Id;
+      SigView Pattern;
+      int AddOffset;
+    };
+
+    // Offsets that can be scanned for. The rest only have hardcoded values.
+    OffsetSignature const* GetSignatures(size_t& count);
+
+    enum class ResolveStatus
+    {
+      Ok,
+      NotFound,
+      BadReferenceSize,
+      ReferenceOutsideData
+    };
+
+    const char* ToString(ResolveStatus status);
+
+    // Turns a signature match into an address. pImage is the image laid
+    // out by the loader and moduleBase is the address its code expects
+    // to run at: the same as pImage for the loaded module, the preferred
+    // image base for a file that hasn't been relocated. Bracketed
+    // references have to point into a data section of the image.
+    ResolveStatus ResolveMatch(PEImage const& image, uint8_t const* pImage, uintptr_t moduleBase,
+      uint8_t const* pMatch, OffsetSignature const& sig, uintptr_t& result);
+  }
+}
@@ -1,212 +1,102 @@
 #include "Util.h"
+#include "OffsetCache.h"
+#include "OffsetTable.h"
+#include "PEImage.h"
+#include "SigScan.h"
 #include "../Main.h"
 
-#include <fstream>
-#include <unordered_map>
 #include <vector>
 #include <memory>
-#include <stdexcept>
 #include <Psapi.h>
 
-namespace util::offsets
-{
-  struct CompiledSig {
-    std::vector<BYTE> bytes;   // compact: only actual bytes (no spaces)
-    std::string       mask;    // same length as bytes, 'x' or '?'
-    int refStart = -1;         // index in bytes where [ ... ] begins (first '?')
-    int refSize  = 0;          // number of bytes inside brackets
-  };
-}
-
 namespace
 {
-  using util::offsets::CompiledSig;
-
-  bool m_UseScannedResults = false;
-  std::unordered_map<std::string, util::offsets::Signature> m_Signatures;
-
-  // Fill with hardcoded offsets if you don't want to use scanning
-  // These should be relative to the module base.
-  std::unordered_map<std::string, int> m_HardcodedOffsets = {
-    {"OFFSET_D3D", 0x17DF5CC},
-    {"OFFSET_MAIN", 0x12F0C88},
-
-    {"OFFSET_CAMERAUPDATE", 0x32300},
-    {"OFFSET_GETCAMERAMATRIX", 0x5B0B40},
-    {"OFFSET_POSTPROCESSUPDATE", 0x608C50},
-    {"OFFSET_TONEMAPUPDATE", 0x208490},
-
-    {"OFFSET_INPUTUPDATE", 0x57D6C0},
-    {"OFFSET_GAMEPADUPDATE", 0x60EE30},
-    {"OFFSET_COMBATMANAGERUPDATE", 0x37A800},
-
-    {"OFFSET_SHOWMOUSE", 0x1359B44},
-    {"OFFSET_DRAWUI", 0x1240F27},
-    {"OFFSET_FREEZETIME", 0x12F194C},
-    {"OFFSET_SCALEFORM", 0x134A78C},
-    {"OFFSET_TIMESCALE", 0x0DC6EA0},
-    {"OFFSET_POSTPROCESS", 0x15D0970}
-  };
-
-  static CompiledSig Compile(std::string const& sig) {
-    CompiledSig out;
-    bool inRef = false;
-    for (size_t i = 0; i < sig.size();) {
-      char c = sig[i];
-      if (c == ' ') { ++i; continue; }
-      if (c == '[') { inRef = true; ++i; continue; }
-      if (c == ']') { inRef = false; ++i; continue; }
-
-      if (c == '?') {
-        // accept "?" or "??"
-        if (i + 1 < sig.size() && sig[i+1] == '?') ++i;
-        out.bytes.push_back(0x00);
-        out.mask.push_back('?');
-        if (inRef) {
-          if (out.refStart < 0) out.refStart = (int)out.bytes.size() - 1;
-          out.refSize++;
-        }
-        ++i;
-      } else {
-        // read two hex chars -> one byte
-        auto hex = [](char h)->int {
-          if (h >= '0' && h <= '9') return h - '0';
-          if (h >= 'A' && h <= 'F') return 10 + (h - 'A');
-          if (h >= 'a' && h <= 'f') return 10 + (h - 'a');
-          return -1;
-        };
-        if (i + 1 >= sig.size()) throw std::runtime_error("Odd hex length");
-        int hi = hex(sig[i]), lo = hex(sig[i+1]);
-        if (hi < 0 || lo < 0)   throw std::runtime_error("Bad hex in signature");
-        out.bytes.push_back((BYTE)((hi << 4) | lo));
-        out.mask.push_back('x');
-        i += 2;
+  util::offsets::OffsetSource m_Sources[util::offsets::OffsetCount] = {};
+
+  void ResolveHardcoded()
+  {
+    uintptr_t base = reinterpret_cast<uintptr_t>(g_gameHandle);
+    for (int i = 0; i < util::offsets::OffsetCount; ++i)
+    {
+      util::offsets::OffsetId id = static_cast<util::offsets::OffsetId>(i);
+      util::offsets::g_resolvedOffsets[i] = base + util::offsets::GetHardcoded(id);
+      m_Sources[i] = util::offsets::OffsetSource::Hardcoded;
+    }
+  }
+
+  bool FindOffsetId(std::string const& name, util::offsets::OffsetId& id)
+  {
+    for (int i = 0; i < util::offsets::OffsetCount; ++i)
+    {
+      if (name == util::offsets::GetName(static_cast<util::offsets::OffsetId>(i)))
+      {
+        id = static_cast<util::offsets::OffsetId>(i);
+        return true;
       }
     }
-    return out;
+    return false;
   }
 
-  static BYTE* FindPattern(BYTE* base, size_t size, CompiledSig const& s) {
-    size_t n = s.bytes.size();
-    if (n == 0 || n > size) return nullptr;
-    BYTE* end = base + (size - n);
-    for (BYTE* p = base; p <= end; ++p) {
-      size_t j = 0;
-      for (; j < n; ++j) {
-        if (s.mask[j] == 'x' && p[j] != s.bytes[j]) break;
+  const char* g_offsetCacheFile = "./Cinematic Tools/offsets.cache";
+
+  // Headers from the loaded module, size and write time from the file
+  // system. Reading the whole file to hash it took longer than the scan
+  // the cache saves.
+  bool ReadGameFingerprint(util::PEImage const& image, util::offsets::ImageFingerprint& fingerprint)
+  {
+    char path[MAX_PATH];
+    DWORD length = GetModuleFileNameA(g_gameHandle, path, MAX_PATH);
+    if (length == 0 || length == MAX_PATH)
+      return false;
+
+    WIN32_FILE_ATTRIBUTE_DATA attributes;
+    if (!GetFileAttributesExA(path, GetFileExInfoStandard, &attributes))
+      return false;
+
+    uint64_t fileSize = (static_cast<uint64_t>(attributes.nFileSizeHigh) << 32) | attributes.nFileSizeLow;
+    uint64_t lastWriteTime = (static_cast<uint64_t>(attributes.ftLastWriteTime.dwHighDateTime) << 32) | attributes.ftLastWriteTime.dwLowDateTime;
+    util::offsets::GetFingerprint(image, fileSize, lastWriteTime, fingerprint);
+    return true;
+  }
+
+  // Checks every cached position still matches its signature, so a
+  // stale or edited cache falls back to a full scan
+  bool MatchCached(util::offsets::OffsetCache const& cache,
+    util::offsets::OffsetSignature const* pSigs, size_t sigCount,
+    std::vector<util::offsets::SigScanner::Range> const& ranges,
+    uint8_t const* pImage, std::vector<uint8_t const*>& matches)
+  {
+    matches.clear();
+    for (size_t i = 0; i < sigCount; ++i)
+    {
+      util::offsets::SigView const& pattern = pSigs[i].Pattern;
+      uint32_t rva = 0;
+      if (!cache.Get(util::offsets::GetName(pSigs[i].Id), rva))
+        return false;
+
+      bool inRange = false;
+      for (auto const& range : ranges)
+      {
+        if (rva >= range.Offset && rva - range.Offset + pattern.length <= range.Size)
+          inRange = true;
       }
-      if (j == n) return p;
+
+      if (!inRange || !util::offsets::MatchesAt(pImage + rva, pattern))
+        return false;
+
+      matches.push_back(pImage + rva);
     }
-    return nullptr;
+    return true;
   }
 }
 
-util::offsets::Signature::Signature(std::string const& sig, int offset /* = 0 */)
-{
-  AddOffset = offset;
-  Compiled = std::make_unique<CompiledSig>(Compile(sig));
-  HasReference = (Compiled->refStart >= 0);
-  ReferenceSize = Compiled->refSize;
-}
+uintptr_t util::offsets::g_resolvedOffsets[util::offsets::OffsetCount] = {};
 
 void util::offsets::Scan()
 {
-  m_Signatures.clear();
-
-  // Gameplay/update hooks
-  m_Signatures.emplace("OFFSET_CAMERAUPDATE", Signature(
-    "55 8B EC 83 E4 F0 81 EC 74 01 00 00 53 56 8B F1 "
-    "8B 86 D8 01 00 00 33 DB 57 85 C0 74 12 38 98 4D 01 00 00 74 0A "
-    "38 98 4F 01 00 00 75 02 8B D8 "
-    "80 BE 21 02 00 00 00 74 0C "
-    "8B 86 F0 01 00 00 85 C0 74 02 8B D8 "
-    "85 DB 0F 84 ?? ?? ?? ?? "
-    "F3 0F 10 43 44 F3 0F 10 4B 40 F3 0F 10 53 3C F3 0F 10 5B 2C "
-    "F3 0F 11 44 24 48 0F 57 C0 "
-    "E8 ?? ?? ?? ?? "
-    "F3 0F 7E 00 "
-    "F3 0F 10 35 [ ?? ?? ?? ?? ]", 0));
-
-  m_Signatures.emplace("OFFSET_GETCAMERAMATRIX", Signature(
-    "8B 44 24 04 56 8B F1 "
-    "8D 96 4B 03 00 00 2B D0 90 "
-    "8A 08 88 0C 02 40 84 C9 75 F6 "
-    "8B 44 24 0C 89 86 14 03 00 00 "
-    "83 F8 01 75 4E "
-    "A1 [ ?? ?? ?? ?? ] "
-    "50 E8 ?? ?? ?? ?? 6A 01 50 "
-    "89 86 70 03 00 00 "
-    "E8 ?? ?? ?? ??", 0));
-
-  m_Signatures.emplace("OFFSET_POSTPROCESSUPDATE", Signature(
-    "83 EC 08 53 8B 5C 24 10 55 56 57 "
-    "8B 7C 24 20 8B CF 2B CB "
-    "B8 AB AA AA 2A F7 E9 D1 FA 8B C2 C1 E8 1F 03 C2 "
-    "83 F8 20 0F 8E ?? ?? ?? ?? "
-    "8B 74 24 24 85 F6 0F 8E ?? ?? ?? ?? "
-    "57 8D 44 24 14 53 50 E8 ?? ?? ?? ?? "
-    "8B 6C 24 20 8B C6 99 2B C2 D1 F8 "
-    "8B F0 99 2B C2 D1 F8 03 F0 "
-    "8B CF 2B CD B8 AB AA AA 2A F7 E9 "
-    "8B 4C 24 1C D1 FA 8B C2 C1 E8 1F 03 C2 "
-    "2B CB 89 44 24 2C", 0));
-
-  m_Signatures.emplace("OFFSET_TONEMAPUPDATE", Signature(
-    "83 EC 20 53 56 8B F1 "
-    "E8 ?? ?? ?? ?? "
-    "8B 98 74 03 00 00 85 DB 0F 84 ?? ?? ?? ?? "
-    "57 8D 4C 24 0C E8 ?? ?? ?? ?? "
-    "8B 7C 24 30 57 8B CE E8 ?? ?? ?? ?? D9 5C 24 10 "
-    "57 8B CE E8 ?? ?? ?? ?? D9 5C 24 18 "
-    "57 8B CE E8 ?? ?? ?? ?? D9 5C 24 1C "
-    "F3 0F 10 44 24 10 0F 2E 43 10 9F F6 C4 44 7A ?? "
-    "F3 0F 10 44 24 14 0F 2E 43 14 9F F6 C4 44 7A ?? "
-    "F3 0F 10 44 24 18 0F 2E 43 18 9F F6 C4 44 7A ?? "
-    "F3 0F 10 44 24 1C 0F 2E 43 1C 9F F6 C4 44", 0));
-
-  m_Signatures.emplace("OFFSET_INPUTUPDATE", Signature(
-    "0F 57 ED 56 8B B1 40 10 00 00 85 F6 74 32 "
-    "80 7E 10 00 74 2C 80 7E 11 00 74 26 "
-    "33 C0 39 81 58 10 00 00 76 1C "
-    "8D 91 80 0A 00 00 F3 0F 11 2A 40 83 C2 44 "
-    "3B 81 58 10 00 00 72 F0 "
-    "F3 0F 10 35 [ ?? ?? ?? ?? ] "
-    "B0 02 84 41 3C 74 08 F3 0F 11 B1 C4 0A 00 00", 0));
-
-  m_Signatures.emplace("OFFSET_GAMEPADUPDATE", Signature(
-    "8B 44 24 04 F6 44 08 14 80 74 15 "
-    "F3 0F 10 05 [ ?? ?? ?? ?? ] F3 0F 11 44 24 04 D9 44 24 04 C2 04 00 "
-    "0F 57 C0 F3 0F 11 44 24 04 D9 44 24 04 C2 04 00 "
-    "80 7C 24 08 00 74 0A "
-    "F3 0F 10 05 [ ?? ?? ?? ?? ] EB 08 "
-    "F3 0F 10 05 [ ?? ?? ?? ?? ] "
-    "8B 44 24 04 F6 44 08 14 80", 0));
-
-  m_Signatures.emplace("OFFSET_COMBATMANAGERUPDATE", Signature(
-    "55 8B EC 83 E4 F0 F3 0F 10 55 0C 83 EC 64 53 56 8B F1 "
-    "F3 0F 10 86 A0 01 00 00 F3 0F 59 C2 F3 0F 58 86 74 01 00 00 "
-    "0F 28 C8 "
-    "F3 0F 59 0D [ ?? ?? ?? ?? ] "
-    "0F 2F 0D [ ?? ?? ?? ?? ] "
-    "57 76 15 "
-    "F3 0F 58 0D [ ?? ?? ?? ?? ] "
-    "F3 0F 2C C1 0F 57 C9 F3 0F 2A C8 "
-    "F3 0F 59 0D [ ?? ?? ?? ?? ]", 0));
-
-  // Globals / data pointers
-  m_Signatures.emplace("OFFSET_POSTPROCESS", Signature(
-    "A1 [ ?? ?? ?? ?? ] 85 C0 74 ?? 8B 48 ??", 0));
-
-  m_Signatures.emplace("OFFSET_SCALEFORM", Signature(
-    "8B 0D [ ?? ?? ?? ?? ] 85 C9 74 ?? 8B 01 FF 50 ??", 0));
-
-  m_Signatures.emplace("OFFSET_FREEZETIME", Signature(
-    "F6 05 [ ?? ?? ?? ?? ] 00 75 ??", 0));
-
-  m_Signatures.emplace("OFFSET_TIMESCALE", Signature(
-    "F3 0F 10 05 [ ?? ?? ?? ?? ] F3 0F 59 ?? ??", 0));
-
-  util::log::Write("Scanning for offsets...");
+  // Everything starts out hardcoded and scanned results replace
+  // them once all signatures are found
+  ResolveHardcoded();
 
   MODULEINFO info;
   if (!GetModuleInformation(GetCurrentProcess(), g_gameHandle, &info, sizeof(MODULEINFO)))
@@ -220,84 +110,118 @@ void util::offsets::Scan()
   bool foundAny = false;
   uintptr_t moduleBase = reinterpret_cast<uintptr_t>(info.lpBaseOfDll);
 
-  for (auto& kv : m_Signatures)
+  // All signatures are found in one pass over the image
+  size_t sigCount = 0;
+  OffsetSignature const* pSigs = GetSignatures(sigCount);
+  SigScanner scanner;
+  for (size_t i = 0; i < sigCount; ++i)
+    scanner.Add(pSigs[i].Pattern);
+
+  // Signatures are all code, so only executable sections are searched
+  uint8_t const* pImage = static_cast<uint8_t const*>(info.lpBaseOfDll);
+  PEImage image;
+  std::vector<SigScanner::Range> ranges;
+  bool hasHeaders = image.Parse(pImage, info.SizeOfImage, true);
+  if (hasHeaders)
   {
-    auto& sig = kv.second;
-    auto* cs = sig.Compiled.get();
-    if (!cs)
+    for (PESection const& section : image.GetSections())
     {
-      util::log::Error("Signature %s has no compiled data", kv.first.c_str());
-      allFound = false;
-      sig.Result = 0;
-      continue;
+      if (section.IsExecutable())
+        ranges.push_back({ section.VirtualAddress, section.VirtualSize });
     }
+  }
+  else
+    util::log::Warning("Could not parse the PE headers, scanning the whole image");
+
+  if (ranges.empty())
+    ranges.push_back({ 0, info.SizeOfImage });
+
+  // A binary that was scanned before doesn't need to be scanned again
+  ImageFingerprint fingerprint;
+  OffsetCache cache;
+  std::vector<uint8_t const*> matches;
+  bool hasFingerprint = hasHeaders && ReadGameFingerprint(image, fingerprint);
+  bool fromCache = hasFingerprint
+    && cache.Load(g_offsetCacheFile, fingerprint)
+    && MatchCached(cache, pSigs, sigCount, ranges, pImage, matches);
+
+  if (fromCache)
+    util::log::Write("Offsets loaded from cache");
+  else
+  {
+    util::log::Write("Scanning for offsets...");
+    scanner.ScanRanges(pImage, ranges, matches);
+  }
 
-    BYTE* p = FindPattern((BYTE*)info.lpBaseOfDll, info.SizeOfImage, *cs);
-    if (!p) {
-      util::log::Error("Could not find pattern for %s", kv.first.c_str());
-      allFound = false;
-      sig.Result = 0;
-      continue;
-    }
+  std::vector<uintptr_t> results(sigCount, 0);
+  for (size_t i = 0; i < sigCount; ++i)
+  {
+    const char* name = GetName(pSigs[i].Id);
+    ResolveStatus status = ResolveMatch(image, pImage, moduleBase, matches[i], pSigs[i], results[i]);
 
-    if (sig.HasReference)
-    {
-      if (cs->refSize != 4)
-      {
-        util::log::Error("Signature %s expected 4-byte reference, got %d", kv.first.c_str(), cs->refSize);
-        allFound = false;
-        sig.Result = 0;
-        continue;
-      }
+    if (status == ResolveStatus::NotFound)
+      util::log::Error("Could not find pattern for %s", name);
+    else if (status == ResolveStatus::BadReferenceSize)
+      util::log::Error("Signature %s expected 4-byte reference, got %d", name, pSigs[i].Pattern.refSize);
+    else if (status == ResolveStatus::ReferenceOutsideData)
+      util::log::Error("Signature %s references 0x%08X which isn't in a data section", name, static_cast<unsigned int>(results[i]));
 
-      BYTE* ref = p + cs->refStart;
-      uint32_t addr = *reinterpret_cast<uint32_t*>(ref);
-      sig.Result = static_cast<uintptr_t>(addr) + sig.AddOffset;
-    }
-    else
+    if (status != ResolveStatus::Ok)
     {
-      sig.Result = reinterpret_cast<uintptr_t>(p) + sig.AddOffset;
+      allFound = false;
+      results[i] = 0;
+      continue;
     }
 
     foundAny = true;
-    uintptr_t rva = sig.Result >= moduleBase ? sig.Result - moduleBase : 0;
-    util::log::Write("%s resolved at 0x%08X (RVA 0x%X)", kv.first.c_str(), static_cast<unsigned int>(sig.Result), static_cast<unsigned int>(rva));
+    uintptr_t rva = results[i] >= moduleBase ? results[i] - moduleBase : 0;
+    util::log::Write("%s resolved at 0x%08X (RVA 0x%X)", name, static_cast<unsigned int>(results[i]), static_cast<unsigned int>(rva));
+  }
+
+  // Only complete results are cached, after a game update the
+  // fingerprint changes and the next start scans again
+  if (allFound && foundAny && hasFingerprint && !fromCache)
+  {
+    cache.Clear();
+    for (size_t i = 0; i < sigCount; ++i)
+      cache.Set(GetName(pSigs[i].Id), static_cast<uint32_t>(matches[i] - pImage));
+
+    if (!cache.Save(g_offsetCacheFile, fingerprint))
+      util::log::Warning("Could not write %s", g_offsetCacheFile);
   }
 
   if (allFound && foundAny)
+  {
     util::log::Ok("All offsets found");
+
+    OffsetSource source = fromCache ? OffsetSource::Cached : OffsetSource::Scanned;
+    for (size_t i = 0; i < sigCount; ++i)
+    {
+      g_resolvedOffsets[pSigs[i].Id] = results[i];
+      m_Sources[pSigs[i].Id] = source;
+    }
+  }
   else
     util::log::Warning("All offsets could not be found, this might result in a crash");
-
-  m_UseScannedResults = (allFound && foundAny);
 }
 
-int util::offsets::GetOffset(std::string const& name)
+uintptr_t util::offsets::GetRel(OffsetId id)
 {
-  // If a scan was done, prefer those results.
-  // If something couldn't be found or there was no scan,
-  // use the hardcoded offsets.
-
-  if (m_UseScannedResults)
-  {
-    auto result = m_Signatures.find(name);
-    if (result != m_Signatures.end())
-    {
-      if (result->second.Result)
-        return static_cast<int>(result->second.Result);
-    }
-  }
+  // Hardcoded offsets are stored as absolute addresses too, because
+  // it's not 100% guaranteed the module loads at the same address
+  return g_resolvedOffsets[id] - reinterpret_cast<uintptr_t>(g_gameHandle);
+}
 
-  // If the offsets were scanned, their absolute position is known.
-  // With hardcoded offsets, use relative offset because it's not
-  // 100% guaranteed the game module will load at the same address space.
+util::offsets::OffsetSource util::offsets::GetSource(OffsetId id)
+{
+  return m_Sources[id];
+}
 
-  auto hardcodedResult = m_HardcodedOffsets.find(name);
-  if (hardcodedResult != m_HardcodedOffsets.end())
-  {
-    uintptr_t base = reinterpret_cast<uintptr_t>(g_gameHandle);
-    return static_cast<int>(base + hardcodedResult->second);
-  }
+int util::offsets::GetOffset(std::string const& name)
+{
+  OffsetId id;
+  if (FindOffsetId(name, id))
+    return static_cast<int>(Get(id));
 
   util::log::Error("Offset %s does not exist", name.c_str());
   return 0;
@@ -305,19 +229,9 @@ int util::offsets::GetOffset(std::string const& name)
 
 int util::offsets::GetRelOffset(std::string const& name)
 {
-  if (m_UseScannedResults)
-  {
-    auto result = m_Signatures.find(name);
-    if (result != m_Signatures.end())
-    {
-      if (result->second.Result)
-        return static_cast<int>(result->second.Result - reinterpret_cast<uintptr_t>(g_gameHandle));
-    }
-  }
-
-  auto hardcodedResult = m_HardcodedOffsets.find(name);
-  if (hardcodedResult != m_HardcodedOffsets.end())
-    return hardcodedResult->second;
+  OffsetId id;
+  if (FindOffsetId(name, id))
+    return static_cast<int>(GetRel(id));
 
   util::log::Error("Relative offset %s does not exist", name.c_str());
   return 0;
@@ -0,0 +1,182 @@
+#include "PEImage.h"
+#include <cstring>
+
+namespace
+{
+  // Same values as the IMAGE_* constants in winnt.h
+  const uint16_t g_dosSignature = 0x5A4D;        // MZ
+  const uint32_t g_ntSignature = 0x00004550;     // PE\0\0
+  const uint16_t g_optionalMagic32 = 0x10B;
+  const uint16_t g_optionalMagic64 = 0x20B;
+
+  const uint32_t g_scnCntCode = 0x00000020;
+  const uint32_t g_scnCntInitializedData = 0x00000040;
+  const uint32_t g_scnCntUninitializedData = 0x00000080;
+  const uint32_t g_scnMemExecute = 0x20000000;
+
+  const size_t g_fileHeaderSize = 20;
+  const size_t g_sectionHeaderSize = 40;
+
+  template<typename T>
+  bool Read(uint8_t const* pData, size_t size, size_t offset, T& value)
+  {
+    if (offset > size || size - offset < sizeof(T))
+      return false;
+
+    memcpy(&value, pData + offset, sizeof(T));
+    return true;
+  }
+}
+
+bool util::PESection::IsExecutable() const
+{
+  return (Characteristics & (g_scnMemExecute | g_scnCntCode)) != 0;
+}
+
+bool util::PESection::IsData() const
+{
+  return !IsExecutable() && (Characteristics & (g_scnCntInitializedData | g_scnCntUninitializedData)) != 0;
+}
+
+util::PEImage::PEImage() :
+  m_Is64Bit(false),
+  m_ImageBase(0),
+  m_SizeOfImage(0),
+  m_SizeOfHeaders(0),
+  m_TimeDateStamp(0),
+  m_CheckSum(0)
+{
+}
+
+bool util::PEImage::Parse(uint8_t const* pData, size_t size, bool isMapped)
+{
+  m_Sections.clear();
+
+  uint16_t dosMagic = 0;
+  uint32_t ntOffset = 0;
+  if (!Read(pData, size, 0, dosMagic) || dosMagic != g_dosSignature)
+    return false;
+  if (!Read(pData, size, 0x3C, ntOffset))
+    return false;
+
+  uint32_t ntSignature = 0;
+  if (!Read(pData, size, ntOffset, ntSignature) || ntSignature != g_ntSignature)
+    return false;
+
+  // IMAGE_FILE_HEADER
+  size_t fileHeader = static_cast<size_t>(ntOffset) + 4;
+  uint16_t sectionCount = 0;
+  uint16_t optionalSize = 0;
+  if (!Read(pData, size, fileHeader + 2, sectionCount)
+    || !Read(pData, size, fileHeader + 4, m_TimeDateStamp)
+    || !Read(pData, size, fileHeader + 16, optionalSize))
+    return false;
+
+  // IMAGE_OPTIONAL_HEADER32/64, the fields used here are at the same
+  // offsets in both except ImageBase
+  size_t optional = fileHeader + g_fileHeaderSize;
+  uint16_t optionalMagic = 0;
+  if (!Read(pData, size, optional, optionalMagic))
+    return false;
+
+  if (optionalMagic == g_optionalMagic64)
+  {
+    m_Is64Bit = true;
+    if (!Read(pData, size, optional + 24, m_ImageBase))
+      return false;
+  }
+  else if (optionalMagic == g_optionalMagic32)
+  {
+    m_Is64Bit = false;
+    uint32_t imageBase = 0;
+    if (!Read(pData, size, optional + 28, imageBase))
+      return false;
+    m_ImageBase = imageBase;
+  }
+  else
+    return false;
+
+  if (!Read(pData, size, optional + 56, m_SizeOfImage)
+    || !Read(pData, size, optional + 60, m_SizeOfHeaders)
+    || !Read(pData, size, optional + 64, m_CheckSum))
+    return false;
+
+  size_t sectionTable = optional + optionalSize;
+  for (uint16_t i = 0; i < sectionCount; ++i)
+  {
+    size_t header = sectionTable + i * g_sectionHeaderSize;
+    if (header > size || size - header < g_sectionHeaderSize)
+      return false;
+
+    PESection section;
+    char name[9] = { 0 };
+    memcpy(name, pData + header, 8);
+    section.Name = name;
+
+    Read(pData, size, header + 8, section.VirtualSize);
+    Read(pData, size, header + 12, section.VirtualAddress);
+    Read(pData, size, header + 16, section.RawSize);
+    Read(pData, size, header + 20, section.RawOffset);
+    Read(pData, size, header + 36, section.Characteristics);
+
+    // Linkers sometimes leave VirtualSize at 0
+    if (section.VirtualSize == 0)
+      section.VirtualSize = section.RawSize;
+
+    // Truncated image
+    uint64_t start = isMapped ? section.VirtualAddress : section.RawOffset;
+    uint64_t length = isMapped ? section.VirtualSize : section.RawSize;
+    if (start + length > size)
+      return false;
+
+    m_Sections.push_back(section);
+  }
+
+  return true;
+}
+
+bool util::PEImage::Map(uint8_t const* pFile, size_t size, std::vector<uint8_t>& mapped) const
+{
+  mapped.clear();
+  if (m_SizeOfImage == 0 || m_SizeOfHeaders > size || m_SizeOfHeaders > m_SizeOfImage)
+    return false;
+
+  mapped.assign(m_SizeOfImage, 0);
+  memcpy(mapped.data(), pFile, m_SizeOfHeaders);
+
+  for (PESection const& section : m_Sections)
+  {
+    // Raw data past VirtualSize is file alignment padding, and
+    // anything past the raw data is zero filled by the loader
+    uint64_t length = section.RawSize < section.VirtualSize ? section.RawSize : section.VirtualSize;
+    if (section.VirtualAddress > m_SizeOfImage || length > m_SizeOfImage - section.VirtualAddress)
+      return false;
+    if (static_cast<uint64_t>(section.RawOffset) + length > size)
+      return false;
+
+    if (length > 0)
+      memcpy(mapped.data() + section.VirtualAddress, pFile + section.RawOffset, static_cast<size_t>(length));
+  }
+
+  return true;
+}
+
+util::PESection const* util::PEImage::FindSection(std::string const& name) const
+{
+  for (PESection const& section : m_Sections)
+  {
+    if (section.Name == name)
+      return &section;
+  }
+  return nullptr;
+}
+
+util::PESection const* util::PEImage::FindSectionByRva(uint32_t rva) const
+{
+  for (PESection const& section : m_Sections)
+  {
+    if (rva >= section.VirtualAddress && rva - section.VirtualAddress < section.VirtualSize)
+      return &section;
+  }
+  return nullptr;
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace util
+{
+  struct PESection
+  {
+    std::string Name;
+    uint32_t VirtualAddress{ 0 };
+    uint32_t VirtualSize{ 0 };
+    uint32_t RawOffset{ 0 };
+    uint32_t RawSize{ 0 };
+    uint32_t Characteristics{ 0 };
+
+    bool IsExecutable() const;
+    // Initialized or uninitialized data that isn't executable
+    bool IsData() const;
+  };
+
+  // Reads the headers of a PE image without going through the Windows
+  // loader, so it works on the loaded module as well as on a file
+  // read from disk (on any platform).
+  class PEImage
+  {
+  public:
+    PEImage();
+
+    // isMapped is true for an image laid out by the loader (sections
+    // at their RVAs) and false for the raw file. Returns false if the
+    // headers are missing or truncated.
+    bool Parse(uint8_t const* pData, size_t size, bool isMapped);
+
+    // Lays out a raw file that was parsed with isMapped false the way
+    // the loader would: headers at 0, every section at its RVA and
+    // zeros everywhere else. Relocations aren't applied.
+    bool Map(uint8_t const* pFile, size_t size, std::vector<uint8_t>& mapped) const;
+
+    std::vector<PESection> const& GetSections() const { return m_Sections; }
+    PESection const* FindSection(std::string const& name) const;
+    // Section containing the RVA, nullptr if it's in the headers or outside
+    PESection const* FindSectionByRva(uint32_t rva) const;
+
+    bool Is64Bit() const { return m_Is64Bit; }
+    uint64_t GetImageBase() const { return m_ImageBase; }
+    uint32_t GetSizeOfImage() const { return m_SizeOfImage; }
+    uint32_t GetSizeOfHeaders() const { return m_SizeOfHeaders; }
+    uint32_t GetTimeDateStamp() const { return m_TimeDateStamp; }
+    uint32_t GetCheckSum() const { return m_CheckSum; }
+
+  private:
+    std::vector<PESection> m_Sections;
+    bool m_Is64Bit;
+    uint64_t m_ImageBase;
+    uint32_t m_SizeOfImage;
+    uint32_t m_SizeOfHeaders;
+    uint32_t m_TimeDateStamp;
+    uint32_t m_CheckSum;
+  };
+}
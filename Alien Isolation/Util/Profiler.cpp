@@ -0,0 +1,310 @@
+#include "Profiler.h"
+#include "Util.h"
+#include "../imgui/imgui.h"
+
+#include <atomic>
+#include <Windows.h>
+
+namespace
+{
+  const char* g_hookNames[] = {
+    "Present",
+    "CameraUpdate",
+    "InputUpdate",
+    "GamepadUpdate",
+    "SetCursorPos",
+    "PostProcessUpdate",
+    "CombatManagerUpdate",
+    "TonemapUpdate"
+  };
+
+  static_assert(sizeof(g_hookNames) / sizeof(g_hookNames[0]) == util::profiler::ProfiledHookCount,
+    "g_hookNames has to have an entry for every ProfiledHook");
+
+  const ULONGLONG g_profileDumpInterval = 60;
+
+  // 8 buckets per power of two up to 2^40 cycles, longer
+  // calls all land in the last bucket
+  const int g_subBucketBits = 3;
+  const int g_subBucketCount = 1 << g_subBucketBits;
+  const int g_maxExponent = 40;
+  const int g_bucketCount = (g_maxExponent - 2) * g_subBucketCount + g_subBucketCount;
+
+  // Threads past the first g_maxShards - 1 share the last shard
+  const int g_maxShards = 8;
+  const int g_sharedShard = g_maxShards - 1;
+
+  struct alignas(64) HookCounters
+  {
+    std::atomic<uint64_t> Calls;
+    std::atomic<uint64_t> Cycles;
+    std::atomic<uint32_t> Buckets[g_bucketCount];
+  };
+
+  struct Shard
+  {
+    HookCounters Hooks[util::profiler::ProfiledHookCount];
+  };
+
+  Shard g_shards[g_maxShards];
+  std::atomic<int> g_nextShard{ 0 };
+  thread_local int t_shardIndex = -1;
+
+  struct Totals
+  {
+    uint64_t Calls;
+    uint64_t Cycles;
+    uint64_t Buckets[g_bucketCount];
+  };
+
+  // Counters are never cleared because the recording threads don't
+  // lock, Reset() moves this baseline instead
+  Totals g_baseline[util::profiler::ProfiledHookCount];
+
+  uint64_t g_calibrationTsc = 0;
+  LARGE_INTEGER g_calibrationQpc{};
+  ULONGLONG g_lastDump = 0;
+
+  int HighestBit(uint64_t value)
+  {
+#ifdef _MSC_VER
+    unsigned long index = 0;
+    if (_BitScanReverse(&index, static_cast<unsigned long>(value >> 32)))
+      return static_cast<int>(index) + 32;
+    _BitScanReverse(&index, static_cast<unsigned long>(value));
+    return static_cast<int>(index);
+#else
+    return 63 - __builtin_clzll(value);
+#endif
+  }
+
+  int BucketIndex(uint64_t cycles)
+  {
+    if (cycles < g_subBucketCount)
+      return static_cast<int>(cycles);
+
+    int exponent = HighestBit(cycles);
+    if (exponent > g_maxExponent)
+      return g_bucketCount - 1;
+
+    int sub = static_cast<int>(cycles >> (exponent - g_subBucketBits)) & (g_subBucketCount - 1);
+    return (exponent - 2) * g_subBucketCount + sub;
+  }
+
+  // Middle of the range of cycle counts a bucket holds
+  double BucketValue(int index)
+  {
+    if (index < g_subBucketCount)
+      return index;
+
+    int exponent = index / g_subBucketCount + 2;
+    int sub = index % g_subBucketCount;
+    double width = static_cast<double>(1ull << (exponent - g_subBucketBits));
+    return (g_subBucketCount + sub) * width + width * 0.5;
+  }
+
+  int AssignShard()
+  {
+    int index = g_nextShard.fetch_add(1, std::memory_order_relaxed);
+    return index < g_sharedShard ? index : g_sharedShard;
+  }
+
+  // A shard owned by one thread only needs plain loads and stores
+  template<typename T>
+  void Add(std::atomic<T>& counter, T value, bool shared)
+  {
+    if (shared)
+      counter.fetch_add(value, std::memory_order_relaxed);
+    else
+      counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+  }
+
+  void Sum(Totals* pTotals)
+  {
+    memset(pTotals, 0, sizeof(Totals) * util::profiler::ProfiledHookCount);
+    for (Shard const& shard : g_shards)
+    {
+      for (int h = 0; h < util::profiler::ProfiledHookCount; ++h)
+      {
+        HookCounters const& counters = shard.Hooks[h];
+        Totals& totals = pTotals[h];
+        totals.Calls += counters.Calls.load(std::memory_order_relaxed);
+        totals.Cycles += counters.Cycles.load(std::memory_order_relaxed);
+        for (int b = 0; b < g_bucketCount; ++b)
+          totals.Buckets[b] += counters.Buckets[b].load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // Measured against the performance counter since the first call,
+  // 0 until a millisecond has passed
+  double CyclesPerUs()
+  {
+    LARGE_INTEGER now, frequency;
+    QueryPerformanceCounter(&now);
+    QueryPerformanceFrequency(&frequency);
+    uint64_t tsc = __rdtsc();
+
+    if (g_calibrationTsc == 0)
+    {
+      g_calibrationTsc = tsc;
+      g_calibrationQpc = now;
+      return 0;
+    }
+
+    double elapsedUs = (now.QuadPart - g_calibrationQpc.QuadPart) * 1e6 / frequency.QuadPart;
+    if (elapsedUs < 1000)
+      return 0;
+
+    return (tsc - g_calibrationTsc) / elapsedUs;
+  }
+
+  double Percentile(Totals const& totals, double fraction)
+  {
+    uint64_t target = static_cast<uint64_t>(totals.Calls * fraction);
+    uint64_t seen = 0;
+    for (int b = 0; b < g_bucketCount; ++b)
+    {
+      seen += totals.Buckets[b];
+      if (seen > target)
+        return BucketValue(b);
+    }
+    return 0;
+  }
+}
+
+void util::profiler::Record(ProfiledHook hook, uint64_t cycles)
+{
+  int shard = t_shardIndex;
+  if (shard < 0)
+    shard = t_shardIndex = AssignShard();
+
+  bool shared = (shard == g_sharedShard);
+  HookCounters& counters = g_shards[shard].Hooks[hook];
+  Add<uint64_t>(counters.Calls, 1, shared);
+  Add<uint64_t>(counters.Cycles, cycles, shared);
+  Add<uint32_t>(counters.Buckets[BucketIndex(cycles)], 1, shared);
+}
+
+std::vector<util::profiler::HookStats> util::profiler::GetStats(uint64_t& frames)
+{
+  static Totals totals[ProfiledHookCount];
+  Sum(totals);
+
+  double cyclesPerUs = CyclesPerUs();
+  double toUs = cyclesPerUs > 0 ? 1.0 / cyclesPerUs : 0;
+
+  std::vector<HookStats> stats;
+  for (int h = 0; h < ProfiledHookCount; ++h)
+  {
+    Totals& current = totals[h];
+    Totals const& baseline = g_baseline[h];
+    current.Calls -= baseline.Calls;
+    current.Cycles -= baseline.Cycles;
+    for (int b = 0; b < g_bucketCount; ++b)
+      current.Buckets[b] -= baseline.Buckets[b];
+
+    int highest = 0;
+    for (int b = 0; b < g_bucketCount; ++b)
+    {
+      if (current.Buckets[b])
+        highest = b;
+    }
+
+    HookStats hookStats;
+    hookStats.Name = g_hookNames[h];
+    hookStats.Calls = current.Calls;
+    hookStats.TotalUs = current.Cycles * toUs;
+    hookStats.MeanUs = current.Calls ? hookStats.TotalUs / current.Calls : 0;
+    hookStats.P50Us = Percentile(current, 0.5) * toUs;
+    hookStats.P99Us = Percentile(current, 0.99) * toUs;
+    hookStats.MaxUs = current.Calls ? BucketValue(highest) * toUs : 0;
+    stats.push_back(hookStats);
+  }
+
+  frames = stats[Hook_Present].Calls;
+  return stats;
+}
+
+void util::profiler::Reset()
+{
+  Sum(g_baseline);
+}
+
+void util::profiler::Update()
+{
+#if CT_HOOK_PROFILING
+  ULONGLONG now = GetTickCount64();
+  if (g_lastDump == 0)
+  {
+    // Starts the clock calibration
+    CyclesPerUs();
+    g_lastDump = now;
+    return;
+  }
+
+  if (now - g_lastDump < g_profileDumpInterval * 1000)
+    return;
+
+  g_lastDump = now;
+
+  uint64_t frames = 0;
+  std::vector<HookStats> stats = GetStats(frames);
+  util::log::Write("Hook timings over %llu frames (us per frame, mean / p50 / p99 / max us per call)", frames);
+  for (HookStats const& hook : stats)
+  {
+    if (hook.Calls == 0)
+      continue;
+
+    util::log::Write("  %-20s %10llu calls %8.2f us/frame %7.2f / %7.2f / %7.2f / %8.2f",
+      hook.Name, hook.Calls, frames ? hook.TotalUs / frames : 0.0,
+      hook.MeanUs, hook.P50Us, hook.P99Us, hook.MaxUs);
+  }
+#endif
+}
+
+void util::profiler::DrawUI(bool* pOpen)
+{
+  if (!*pOpen)
+    return;
+
+  ImGui::SetNextWindowSize(ImVec2(640, 260), ImGuiCond_FirstUseEver);
+  ImGui::Begin("Hook timings", pOpen);
+  {
+#if CT_HOOK_PROFILING
+    uint64_t frames = 0;
+    std::vector<HookStats> stats = GetStats(frames);
+
+    ImGui::Text("%llu frames", frames);
+    ImGui::SameLine(540);
+    if (ImGui::Button("Reset"))
+      Reset();
+
+    const char* headers[] = { "Hook", "Calls", "us/frame", "Mean", "P50", "P99", "Max" };
+    ImGui::Columns(7, "hookTimingColumns", false);
+    ImGui::SetColumnWidth(0, 160);
+    for (const char* header : headers)
+    {
+      ImGui::Text("%s", header);
+      ImGui::NextColumn();
+    }
+    ImGui::Separator();
+
+    for (HookStats const& hook : stats)
+    {
+      ImGui::Text("%s", hook.Name); ImGui::NextColumn();
+      ImGui::Text("%llu", hook.Calls); ImGui::NextColumn();
+      ImGui::Text("%.2f", frames ? hook.TotalUs / frames : 0.0); ImGui::NextColumn();
+      ImGui::Text("%.2f", hook.MeanUs); ImGui::NextColumn();
+      ImGui::Text("%.2f", hook.P50Us); ImGui::NextColumn();
+      ImGui::Text("%.2f", hook.P99Us); ImGui::NextColumn();
+      ImGui::Text("%.2f", hook.MaxUs); ImGui::NextColumn();
+    }
+    ImGui::Columns(1);
+
+    ImGui::Text("Times exclude the game's own functions, percentiles are within 12.5%%.");
+#else
+    ImGui::Text("Hook profiling is compiled out, build with CT_HOOK_PROFILING 1.");
+#endif
+  } ImGui::End();
+}
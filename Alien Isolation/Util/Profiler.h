@@ -0,0 +1,113 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+
+// Set to 0 to compile the hook timers out completely
+#ifndef CT_HOOK_PROFILING
+#define CT_HOOK_PROFILING 1
+#endif
+
+// Call counts and latency histograms of the game hooks.
+//
+// Hooks time themselves with CT_PROFILE_HOOK, which reads the cycle
+// counter on entry and exit. Calls into the game's original function
+// are wrapped in CT_PROFILE_ORIGINAL so only the time the tools add is
+// counted. Every thread records into its own shard, so recording is a
+// few relaxed atomic adds with no contention; shards are only summed
+// when the panel or the periodic log dump reads them.
+//
+// Histograms are log-linear like HDR histograms: 8 buckets per power of
+// two, so any percentile is within 12.5% of the real value.
+namespace util
+{
+  namespace profiler
+  {
+    enum ProfiledHook
+    {
+      Hook_Present,
+      Hook_CameraUpdate,
+      Hook_InputUpdate,
+      Hook_GamepadUpdate,
+      Hook_SetCursorPos,
+      Hook_PostProcessUpdate,
+      Hook_CombatManagerUpdate,
+      Hook_TonemapUpdate,
+
+      ProfiledHookCount
+    };
+
+    struct HookStats
+    {
+      const char* Name;
+      uint64_t Calls;
+      double TotalUs;
+      double MeanUs;
+      double P50Us;
+      double P99Us;
+      double MaxUs;
+    };
+
+    void Record(ProfiledHook hook, uint64_t cycles);
+
+    // Presents counted so far, for per-frame numbers
+    std::vector<HookStats> GetStats(uint64_t& frames);
+    void Reset();
+
+    // Writes the stats to the log every g_profileDumpInterval
+    // seconds, called once per frame
+    void Update();
+    void DrawUI(bool* pOpen);
+
+    class ScopedHookTimer
+    {
+    public:
+      explicit ScopedHookTimer(ProfiledHook hook) :
+        m_Hook(hook),
+        m_Excluded(0),
+        m_Start(__rdtsc())
+      {
+      }
+
+      ~ScopedHookTimer()
+      {
+        Record(m_Hook, __rdtsc() - m_Start - m_Excluded);
+      }
+
+      // Runs fn without counting its time
+      template<typename Fn>
+      auto Exclude(Fn const& fn) -> decltype(fn())
+      {
+        struct Pause
+        {
+          uint64_t& Excluded;
+          uint64_t Start;
+          ~Pause() { Excluded += __rdtsc() - Start; }
+        } pause{ m_Excluded, __rdtsc() };
+
+        return fn();
+      }
+
+      ScopedHookTimer(ScopedHookTimer const&) = delete;
+      void operator=(ScopedHookTimer const&) = delete;
+
+    private:
+      ProfiledHook m_Hook;
+      uint64_t m_Excluded;
+      uint64_t m_Start;
+    };
+  }
+}
+
+#if CT_HOOK_PROFILING
+#define CT_PROFILE_HOOK(hook) util::profiler::ScopedHookTimer ctHookTimer(util::profiler::hook)
+#define CT_PROFILE_ORIGINAL(call) ctHookTimer.Exclude([&]() { return call; })
+#else
+#define CT_PROFILE_HOOK(hook) ((void)0)
+#define CT_PROFILE_ORIGINAL(call) (call)
+#endif
@@ -0,0 +1,85 @@
+#include "RegionCache.h"
+#include <algorithm>
+
+namespace
+{
+  const ULONGLONG g_regionLifetimeMs = 250;
+  // Regions beyond this start the cache over, the tools only
+  // ever check a handful of game structures
+  const size_t g_maxRegions = 256;
+}
+
+util::RegionCache::RegionCache() :
+  m_Generation(0),
+  m_GenerationStart(0)
+{
+  InitializeSRWLock(&m_Lock);
+}
+
+bool util::RegionCache::Contains(uintptr_t begin, uintptr_t end)
+{
+  bool found = false;
+  AcquireSRWLockShared(&m_Lock);
+
+  if (!IsExpired())
+  {
+    // Last region starting at or before begin
+    auto it = std::upper_bound(m_Regions.begin(), m_Regions.end(), begin,
+      [](uintptr_t address, Region const& region) { return address < region.Begin; });
+
+    if (it != m_Regions.begin())
+    {
+      --it;
+      found = it->Generation == m_Generation && end >= begin && end <= it->End;
+    }
+  }
+
+  ReleaseSRWLockShared(&m_Lock);
+  return found;
+}
+
+void util::RegionCache::Add(uintptr_t begin, uintptr_t end)
+{
+  if (end <= begin)
+    return;
+
+  AcquireSRWLockExclusive(&m_Lock);
+
+  if (IsExpired())
+    StartGeneration();
+
+  // Old generations go away here, along with anything overlapping the
+  // new region because the memory layout has changed under it
+  uint32_t generation = m_Generation;
+  m_Regions.erase(std::remove_if(m_Regions.begin(), m_Regions.end(),
+    [=](Region const& region) {
+      return region.Generation != generation || (region.Begin < end && begin < region.End);
+    }), m_Regions.end());
+
+  if (m_Regions.size() >= g_maxRegions)
+    m_Regions.clear();
+
+  auto it = std::lower_bound(m_Regions.begin(), m_Regions.end(), begin,
+    [](Region const& region, uintptr_t address) { return region.Begin < address; });
+  m_Regions.insert(it, { begin, end, generation });
+
+  ReleaseSRWLockExclusive(&m_Lock);
+}
+
+void util::RegionCache::Invalidate()
+{
+  AcquireSRWLockExclusive(&m_Lock);
+  StartGeneration();
+  ReleaseSRWLockExclusive(&m_Lock);
+}
+
+bool util::RegionCache::IsExpired() const
+{
+  return GetTickCount64() - m_GenerationStart >= g_regionLifetimeMs;
+}
+
+void util::RegionCache::StartGeneration()
+{
+  m_Generation += 1;
+  m_GenerationStart = GetTickCount64();
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <Windows.h>
+
+namespace util
+{
+  // Memory ranges recently found to be committed and readable, so
+  // checking the same game structures every frame doesn't need a
+  // VirtualQuery each time.
+  //
+  // Regions are kept sorted by address and stamped with the generation
+  // they were validated in. A new generation starts every
+  // g_regionLifetimeMs or on Invalidate(), which drops every region at
+  // once, so memory the game frees or reprotects is noticed again soon.
+  // Failed queries aren't remembered.
+  class RegionCache
+  {
+  public:
+    RegionCache();
+
+    // True if [begin, end) is inside one region of the current generation
+    bool Contains(uintptr_t begin, uintptr_t end);
+    void Add(uintptr_t begin, uintptr_t end);
+    void Invalidate();
+
+  private:
+    struct Region
+    {
+      uintptr_t Begin;
+      uintptr_t End;
+      uint32_t Generation;
+    };
+
+    bool IsExpired() const;
+    void StartGeneration();
+
+  private:
+    SRWLOCK m_Lock;
+    std::vector<Region> m_Regions;
+    uint32_t m_Generation;
+    ULONGLONG m_GenerationStart;
+  };
+}
@@ -0,0 +1,491 @@
+#include "SigScan.h"
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#include <immintrin.h>
+#define SIGSCAN_SSE2
+#define SIGSCAN_AVX2
+#ifdef _MSC_VER
+#include <intrin.h>
+#define SIGSCAN_TARGET_AVX2
+#else
+#include <cpuid.h>
+#define SIGSCAN_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace
+{
+  using util::offsets::CompiledSig;
+  using util::offsets::SigView;
+
+  // Bytes that show up the most in x86 code and data, most common
+  // first. Anything not listed is considered rare.
+  const uint8_t g_commonBytes[] = {
+    0x00, 0xFF, 0x8B, 0x89, 0x0F, 0x24, 0x44, 0xE8, 0x04, 0x01, 0x08, 0x85,
+    0x74, 0x75, 0x83, 0xC0, 0x10, 0x4C, 0x50, 0x56, 0x57, 0x8D, 0x33, 0xCC,
+    0x02, 0x0C, 0xF3, 0x45, 0x4E, 0xC7, 0x14, 0x55, 0x5E, 0x5F, 0xC3, 0x18,
+    0x1C, 0x20, 0x40, 0x80, 0x03, 0x3B, 0xEB, 0x51, 0x52, 0x53, 0xE9
+  };
+
+  int Commonness(uint8_t b)
+  {
+    const int count = sizeof(g_commonBytes);
+    for (int i = 0; i < count; ++i)
+    {
+      if (g_commonBytes[i] == b)
+        return count - i;
+    }
+    return 0;
+  }
+
+  bool Matches(uint8_t const* p, SigView const& s)
+  {
+    for (size_t j = 0; j < s.length; ++j)
+    {
+      if ((p[j] ^ s.bytes[j]) & s.mask[j])
+        return false;
+    }
+    return true;
+  }
+
+  // Signature prepared for the vector search
+  struct PatternSearch
+  {
+    uint8_t const* Bytes;
+    uint8_t const* Mask;
+    size_t Length;
+    int AnchorOffset;
+    uint8_t Anchor0;
+    uint8_t Anchor1;
+    // False if the second anchor byte is a wildcard
+    bool HasAnchor1;
+  };
+
+#ifdef SIGSCAN_SSE2
+  bool MatchesMasked(uint8_t const* p, PatternSearch const& ps)
+  {
+    size_t j = 0;
+    for (; j + 16 <= ps.Length; j += 16)
+    {
+      __m128i data = _mm_loadu_si128(reinterpret_cast<__m128i const*>(p + j));
+      __m128i bytes = _mm_loadu_si128(reinterpret_cast<__m128i const*>(ps.Bytes + j));
+      __m128i mask = _mm_loadu_si128(reinterpret_cast<__m128i const*>(ps.Mask + j));
+      __m128i diff = _mm_and_si128(_mm_xor_si128(data, bytes), mask);
+      if (_mm_movemask_epi8(_mm_cmpeq_epi8(diff, _mm_setzero_si128())) != 0xFFFF)
+        return false;
+    }
+    for (; j < ps.Length; ++j)
+    {
+      if ((p[j] ^ ps.Bytes[j]) & ps.Mask[j])
+        return false;
+    }
+    return true;
+  }
+
+  // Returns the first verified match among the candidate bits. Bit b
+  // stands for the anchor at q + b.
+  uint8_t const* CheckCandidates(uint32_t bits, uint8_t const* q, uint8_t const* last, PatternSearch const& ps)
+  {
+    for (; bits; bits &= bits - 1)
+    {
+      int bit = 0;
+      while (!(bits & (1u << bit)))
+        ++bit;
+
+      uint8_t const* start = q + bit - ps.AnchorOffset;
+      if (start > last)
+        return nullptr;
+      if (MatchesMasked(start, ps))
+        return start;
+    }
+    return nullptr;
+  }
+
+  uint8_t const* FindSSE2(uint8_t const* base, size_t size, PatternSearch const& ps, uint8_t const*& q)
+  {
+    uint8_t const* end = base + size;
+    uint8_t const* last = end - ps.Length;
+    __m128i a0 = _mm_set1_epi8(static_cast<char>(ps.Anchor0));
+    __m128i a1 = _mm_set1_epi8(static_cast<char>(ps.Anchor1));
+
+    // Second load reads q + 1 .. q + 16
+    for (; end - q >= 17 && q - ps.AnchorOffset <= last; q += 16)
+    {
+      __m128i eq = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<__m128i const*>(q)), a0);
+      if (ps.HasAnchor1)
+        eq = _mm_and_si128(eq, _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<__m128i const*>(q + 1)), a1));
+
+      uint32_t bits = static_cast<uint32_t>(_mm_movemask_epi8(eq));
+      if (bits)
+      {
+        uint8_t const* result = CheckCandidates(bits, q, last, ps);
+        if (result)
+          return result;
+      }
+    }
+    return nullptr;
+  }
+#endif
+
+#ifdef SIGSCAN_AVX2
+  bool HasAVX2()
+  {
+    // AVX2 needs both the CPU flag and the OS saving the YMM registers
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+      return false;
+    __cpuid(info, 1);
+    if (!(info[2] & (1 << 27)) || !(info[2] & (1 << 28)))
+      return false;
+    if ((_xgetbv(0) & 6) != 6)
+      return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    unsigned int eax, ebx, ecx, edx;
+    if (__get_cpuid_max(0, nullptr) < 7)
+      return false;
+    __cpuid(1, eax, ebx, ecx, edx);
+    if (!(ecx & (1u << 27)) || !(ecx & (1u << 28)))
+      return false;
+    unsigned int xcr0Lo, xcr0Hi;
+    __asm__("xgetbv" : "=a"(xcr0Lo), "=d"(xcr0Hi) : "c"(0));
+    if ((xcr0Lo & 6) != 6)
+      return false;
+    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+    return (ebx & (1u << 5)) != 0;
+#endif
+  }
+
+  const bool g_hasAVX2 = HasAVX2();
+
+  SIGSCAN_TARGET_AVX2 uint8_t const* FindAVX2(uint8_t const* base, size_t size, PatternSearch const& ps, uint8_t const*& q)
+  {
+    uint8_t const* end = base + size;
+    uint8_t const* last = end - ps.Length;
+    __m256i a0 = _mm256_set1_epi8(static_cast<char>(ps.Anchor0));
+    __m256i a1 = _mm256_set1_epi8(static_cast<char>(ps.Anchor1));
+
+    for (; end - q >= 33 && q - ps.AnchorOffset <= last; q += 32)
+    {
+      __m256i eq = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<__m256i const*>(q)), a0);
+      if (ps.HasAnchor1)
+        eq = _mm256_and_si256(eq, _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<__m256i const*>(q + 1)), a1));
+
+      uint32_t bits = static_cast<uint32_t>(_mm256_movemask_epi8(eq));
+      if (bits)
+      {
+        uint8_t const* result = CheckCandidates(bits, q, last, ps);
+        if (result)
+          return result;
+      }
+    }
+    return nullptr;
+  }
+#endif
+}
+
+util::offsets::CompiledSig util::offsets::Compile(std::string const& sig)
+{
+  CompiledSig out;
+  bool inRef = false;
+  int refBytes = 0;
+  for (size_t i = 0; i < sig.size();) {
+    char c = sig[i];
+    if (c == ' ') { ++i; continue; }
+    if (c == '[') {
+      if (inRef) throw std::runtime_error("Nested [ in signature");
+      inRef = true;
+      refBytes = 0;
+      ++i;
+      continue;
+    }
+    if (c == ']') {
+      if (!inRef) throw std::runtime_error("Unmatched ] in signature");
+      if (refBytes == 0) throw std::runtime_error("Empty [ ] in signature");
+      inRef = false;
+      ++i;
+      continue;
+    }
+
+    if (c == '?') {
+      // accept "?" or "??"
+      if (i + 1 < sig.size() && sig[i+1] == '?') ++i;
+      out.bytes.push_back(0x00);
+      out.mask.push_back(0x00);
+      if (inRef) {
+        if (out.refStart < 0) out.refStart = (int)out.bytes.size() - 1;
+        out.refSize++;
+      }
+      ++i;
+    } else {
+      // read two hex chars -> one byte
+      auto hex = [](char h)->int {
+        if (h >= '0' && h <= '9') return h - '0';
+        if (h >= 'A' && h <= 'F') return 10 + (h - 'A');
+        if (h >= 'a' && h <= 'f') return 10 + (h - 'a');
+        return -1;
+      };
+      if (i + 1 >= sig.size()) throw std::runtime_error("Odd hex length");
+      int hi = hex(sig[i]), lo = hex(sig[i+1]);
+      if (hi < 0 || lo < 0)   throw std::runtime_error("Bad hex in signature");
+      out.bytes.push_back((uint8_t)((hi << 4) | lo));
+      out.mask.push_back(0xFF);
+      i += 2;
+    }
+
+    if (inRef) ++refBytes;
+  }
+
+  if (inRef) throw std::runtime_error("Unterminated [ in signature");
+  if (out.bytes.empty()) throw std::runtime_error("Empty signature");
+  return out;
+}
+
+uint8_t const* util::offsets::FindPattern(uint8_t const* base, size_t size, SigView const& s)
+{
+  size_t n = s.length;
+  int anchor = FindAnchor(s);
+  if (n == 0 || n > size || anchor < 0)
+    return FindPatternScalar(base, size, s);
+
+  PatternSearch ps;
+  ps.Bytes = s.bytes;
+  ps.Mask = s.mask;
+  ps.Length = n;
+
+  // Look for the fixed byte of the anchor first
+  ps.AnchorOffset = anchor;
+  if (!s.mask[anchor])
+    ps.AnchorOffset += 1;
+  ps.Anchor0 = s.bytes[ps.AnchorOffset];
+  ps.HasAnchor1 = ps.AnchorOffset == anchor && s.mask[anchor + 1];
+  ps.Anchor1 = ps.HasAnchor1 ? s.bytes[anchor + 1] : 0;
+
+  uint8_t const* q = base + ps.AnchorOffset;
+  uint8_t const* last = base + (size - n);
+
+#ifdef SIGSCAN_AVX2
+  if (g_hasAVX2)
+  {
+    uint8_t const* result = FindAVX2(base, size, ps, q);
+    if (result)
+      return result;
+  }
+#endif
+#ifdef SIGSCAN_SSE2
+  {
+    uint8_t const* result = FindSSE2(base, size, ps, q);
+    if (result)
+      return result;
+  }
+#endif
+
+  // Whatever the vector loops left at the end
+  for (; q - ps.AnchorOffset <= last; ++q)
+  {
+    uint8_t const* start = q - ps.AnchorOffset;
+    if (*q == ps.Anchor0 && Matches(start, s))
+      return start;
+  }
+  return nullptr;
+}
+
+uint8_t const* util::offsets::FindPatternScalar(uint8_t const* base, size_t size, SigView const& s)
+{
+  size_t n = s.length;
+  if (n == 0 || n > size) return nullptr;
+  uint8_t const* end = base + (size - n);
+  for (uint8_t const* p = base; p <= end; ++p) {
+    size_t j = 0;
+    for (; j < n; ++j) {
+      if (s.mask[j] && p[j] != s.bytes[j]) break;
+    }
+    if (j == n) return p;
+  }
+  return nullptr;
+}
+
+bool util::offsets::MatchesAt(uint8_t const* p, SigView const& s)
+{
+  return Matches(p, s);
+}
+
+int util::offsets::FindAnchor(SigView const& s)
+{
+  size_t n = s.length;
+  int bestOffset = -1;
+  int bestScore = 0;
+  for (size_t i = 0; i + 1 < n && i <= 0xFFFF; ++i)
+  {
+    bool fixed0 = s.mask[i] != 0;
+    bool fixed1 = s.mask[i + 1] != 0;
+    if (!fixed0 && !fixed1)
+      continue;
+
+    int score = (fixed0 ? Commonness(s.bytes[i]) : 256)
+      + (fixed1 ? Commonness(s.bytes[i + 1]) : 256);
+    if (bestOffset < 0 || score < bestScore)
+    {
+      bestOffset = static_cast<int>(i);
+      bestScore = score;
+    }
+  }
+  return bestOffset;
+}
+
+util::offsets::SigScanner::SigScanner() :
+  m_MaxLength(0),
+  m_PairFilter(65536 / 64, 0)
+{
+}
+
+size_t util::offsets::SigScanner::Add(SigView const& sig)
+{
+  uint32_t index = static_cast<uint32_t>(m_Sigs.size());
+  m_Sigs.push_back(sig);
+  m_MaxLength = (std::max)(m_MaxLength, sig.length);
+  AddAnchors(index);
+  return index;
+}
+
+void util::offsets::SigScanner::AddAnchors(uint32_t sigIndex)
+{
+  SigView const& s = m_Sigs[sigIndex];
+
+  // A pair with one wildcard is expanded to all 256 values of that byte
+  int bestOffset = FindAnchor(s);
+  if (bestOffset < 0)
+  {
+    m_Unanchored.push_back(sigIndex);
+    return;
+  }
+
+  bool fixed0 = s.mask[bestOffset] != 0;
+  bool fixed1 = s.mask[bestOffset + 1] != 0;
+  for (int lo = 0; lo < 256; ++lo)
+  {
+    if (fixed0 && lo != s.bytes[bestOffset])
+      continue;
+
+    for (int hi = 0; hi < 256; ++hi)
+    {
+      if (fixed1 && hi != s.bytes[bestOffset + 1])
+        continue;
+
+      Anchor anchor;
+      anchor.Pair = static_cast<uint16_t>(lo | (hi << 8));
+      anchor.Offset = static_cast<uint16_t>(bestOffset);
+      anchor.SigIndex = sigIndex;
+
+      auto it = std::upper_bound(m_Anchors.begin(), m_Anchors.end(), anchor,
+        [](Anchor const& a, Anchor const& b) { return a.Pair < b.Pair; });
+      m_Anchors.insert(it, anchor);
+      m_PairFilter[anchor.Pair >> 6] |= (1ull << (anchor.Pair & 63));
+    }
+  }
+}
+
+void util::offsets::SigScanner::Scan(uint8_t const* base, size_t size, std::vector<uint8_t const*>& results) const
+{
+  results.assign(m_Sigs.size(), nullptr);
+
+  for (uint32_t sigIndex : m_Unanchored)
+    results[sigIndex] = FindPattern(base, size, m_Sigs[sigIndex]);
+
+  size_t remaining = m_Sigs.size() - m_Unanchored.size();
+  if (remaining == 0 || size < 2)
+    return;
+
+  // Every signature start is checked in increasing address order, so
+  // the first verified match is the same one FindPattern returns.
+  uint64_t const* pFilter = m_PairFilter.data();
+  for (size_t i = 0; i + 1 < size; ++i)
+  {
+    uint32_t pair = base[i] | (base[i + 1] << 8);
+    if (!(pFilter[pair >> 6] & (1ull << (pair & 63))))
+      continue;
+
+    Anchor key{ static_cast<uint16_t>(pair), 0, 0 };
+    auto it = std::lower_bound(m_Anchors.begin(), m_Anchors.end(), key,
+      [](Anchor const& a, Anchor const& b) { return a.Pair < b.Pair; });
+
+    for (; it != m_Anchors.end() && it->Pair == pair; ++it)
+    {
+      if (results[it->SigIndex] || it->Offset > i)
+        continue;
+
+      SigView const& s = m_Sigs[it->SigIndex];
+      size_t start = i - it->Offset;
+      if (s.length > size - start)
+        continue;
+
+      if (Matches(base + start, s))
+      {
+        results[it->SigIndex] = base + start;
+        if (--remaining == 0)
+          return;
+      }
+    }
+  }
+}
+
+void util::offsets::SigScanner::ScanRanges(uint8_t const* base, std::vector<Range> const& ranges,
+  std::vector<uint8_t const*>& results, unsigned int threadCount) const
+{
+  // Small enough to spread a big section over all cores, big enough
+  // that the overlap and thread handoff don't matter
+  const size_t chunkSize = 1024 * 1024;
+  size_t overlap = m_MaxLength > 0 ? m_MaxLength - 1 : 0;
+
+  std::vector<Range> chunks;
+  for (Range const& range : ranges)
+  {
+    for (size_t offset = 0; offset < range.Size; offset += chunkSize)
+    {
+      size_t size = (std::min)(chunkSize + overlap, range.Size - offset);
+      chunks.push_back({ range.Offset + offset, size });
+    }
+  }
+
+  results.assign(m_Sigs.size(), nullptr);
+  if (chunks.empty())
+    return;
+
+  if (threadCount == 0)
+    threadCount = (std::max)(1u, std::thread::hardware_concurrency());
+  threadCount = (std::min)(threadCount, static_cast<unsigned int>(chunks.size()));
+
+  // Every chunk has its own results, the lowest address per
+  // signature wins so the outcome doesn't depend on timing.
+  std::vector<std::vector<uint8_t const*>> chunkResults(chunks.size());
+  std::atomic<size_t> nextChunk(0);
+
+  auto worker = [&]()
+  {
+    for (size_t i = nextChunk++; i < chunks.size(); i = nextChunk++)
+      Scan(base + chunks[i].Offset, chunks[i].Size, chunkResults[i]);
+  };
+
+  std::vector<std::thread> threads;
+  for (unsigned int i = 1; i < threadCount; ++i)
+    threads.emplace_back(worker);
+  worker();
+  for (std::thread& thread : threads)
+    thread.join();
+
+  for (std::vector<uint8_t const*> const& chunkResult : chunkResults)
+  {
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+      if (chunkResult[i] && (!results[i] || chunkResult[i] < results[i]))
+        results[i] = chunkResult[i];
+    }
+  }
+}
@@ -0,0 +1,107 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Signature compiling and scanning. Kept free of Windows headers so
+// it can be used on a file image as well as the loaded module.
+namespace util
+{
+  namespace offsets
+  {
+    // Non-owning view of a parsed signature. Mask bytes are 0xFF for
+    // fixed bytes and 0x00 for wildcards.
+    struct SigView
+    {
+      uint8_t const* bytes;
+      uint8_t const* mask;
+      size_t length;
+      int refStart;                // index in bytes where [ ... ] begins, -1 if none
+      int refSize;                 // number of bytes inside brackets
+    };
+
+    // Signature parsed at runtime, see StaticSig.h for ones parsed at compile time
+    struct CompiledSig
+    {
+      std::vector<uint8_t> bytes;  // compact: only actual bytes (no spaces)
+      std::vector<uint8_t> mask;   // same length as bytes, 0xFF or 0x00
+      int refStart = -1;           // index in bytes where [ ... ] begins (first '?')
+      int refSize  = 0;            // number of bytes inside brackets
+
+      SigView View() const { return { bytes.data(), mask.data(), bytes.size(), refStart, refSize }; }
+    };
+
+    // Parses "8B 44 24 ?? [ ?? ?? ?? ?? ]", throws std::runtime_error on
+    // anything CountSigBytes() in StaticSig.h rejects
+    CompiledSig Compile(std::string const& sig);
+
+    // First match of one signature, nullptr if there's none. Candidates
+    // for the rarest fixed byte pair are found 16 or 32 bytes at a time
+    // with SSE2 or AVX2 (picked at runtime) and verified with a masked
+    // compare.
+    uint8_t const* FindPattern(uint8_t const* base, size_t size, SigView const& sig);
+    // Byte by byte reference version
+    uint8_t const* FindPatternScalar(uint8_t const* base, size_t size, SigView const& sig);
+    // True if the signature matches at p, which has to have room for all of it
+    bool MatchesAt(uint8_t const* p, SigView const& sig);
+
+    // Position of the pair of adjacent bytes to look for first, picked so
+    // it has as many fixed bytes as possible and those are rare in x86
+    // code. Returns -1 if the signature has no fixed bytes or is shorter
+    // than two bytes.
+    int FindAnchor(SigView const& sig);
+
+    // Finds many signatures in one pass over the image.
+    //
+    // Every signature is anchored on its rarest pair of adjacent fixed
+    // bytes. The scan reads each byte pair of the image once, checks it
+    // against a 64k bit filter of all anchors and only verifies the
+    // signatures anchored on that pair. Results are the same as calling
+    // FindPattern for each signature.
+    class SigScanner
+    {
+    public:
+      SigScanner();
+
+      // Signature data has to stay alive until the scanner is done
+      size_t Add(SigView const& sig);
+      size_t GetCount() const { return m_Sigs.size(); }
+
+      // results[i] is the first match of signature i or nullptr
+      void Scan(uint8_t const* base, size_t size, std::vector<uint8_t const*>& results) const;
+
+      struct Range
+      {
+        size_t Offset;
+        size_t Size;
+      };
+
+      // Same as Scan() but only looks inside the ranges. They're split
+      // into chunks overlapping by the longest signature and scanned on
+      // threadCount threads, 0 uses one per core.
+      void ScanRanges(uint8_t const* base, std::vector<Range> const& ranges,
+        std::vector<uint8_t const*>& results, unsigned int threadCount = 0) const;
+
+    private:
+      struct Anchor
+      {
+        uint16_t Pair;       // first byte in the low bits
+        uint16_t Offset;     // position of the pair in the signature
+        uint32_t SigIndex;
+      };
+
+      void AddAnchors(uint32_t sigIndex);
+
+    private:
+      std::vector<SigView> m_Sigs;
+      size_t m_MaxLength;
+      // Sorted by Pair
+      std::vector<Anchor> m_Anchors;
+      std::vector<uint64_t> m_PairFilter;
+      // Signatures that can't be anchored (shorter than two bytes
+      // or without fixed bytes) go through FindPattern
+      std::vector<uint32_t> m_Unanchored;
+    };
+  }
+}
@@ -0,0 +1,143 @@
+#pragma once
+#include "SigScan.h"
+
+// Signatures parsed at compile time. Same syntax as Compile(), e.g.
+// "8B 44 24 ?? [ ?? ?? ?? ?? ]", but a malformed pattern is a
+// compile error instead of an exception at startup, and the parsed
+// bytes live in static storage instead of on the heap.
+//
+//   CT_STATIC_SIG(g_sigExample, "A1 [ ?? ?? ?? ?? ] 85 C0");
+//   scanner.Add(g_sigExample.View());
+
+namespace util
+{
+  namespace offsets
+  {
+    template<size_t N>
+    struct StaticSig
+    {
+      uint8_t Bytes[N]{};
+      uint8_t Mask[N]{};
+      size_t Length{ 0 };
+      int RefStart{ -1 };
+      int RefSize{ 0 };
+
+      constexpr SigView View() const { return { Bytes, Mask, Length, RefStart, RefSize }; }
+    };
+
+    namespace detail
+    {
+      constexpr int SigHexValue(char c)
+      {
+        return (c >= '0' && c <= '9') ? c - '0'
+          : (c >= 'A' && c <= 'F') ? 10 + (c - 'A')
+          : (c >= 'a' && c <= 'f') ? 10 + (c - 'a')
+          : -1;
+      }
+    }
+
+    // Number of bytes in the pattern, or -1 if it's malformed: bad or
+    // odd hex, unknown characters, nested, unmatched or empty brackets.
+    // Stops at length or the first null.
+    constexpr int CountSigBytes(const char* sig, size_t length)
+    {
+      int count = 0;
+      bool inRef = false;
+      int refBytes = 0;
+
+      for (size_t i = 0; i < length && sig[i] != '\0';)
+      {
+        char c = sig[i];
+        if (c == ' ') { ++i; continue; }
+        if (c == '[')
+        {
+          if (inRef) return -1;
+          inRef = true;
+          refBytes = 0;
+          ++i;
+          continue;
+        }
+        if (c == ']')
+        {
+          if (!inRef || refBytes == 0) return -1;
+          inRef = false;
+          ++i;
+          continue;
+        }
+
+        if (c == '?')
+        {
+          if (i + 1 < length && sig[i + 1] == '?') ++i;
+          ++i;
+        }
+        else
+        {
+          if (i + 1 >= length || detail::SigHexValue(c) < 0 || detail::SigHexValue(sig[i + 1]) < 0)
+            return -1;
+          i += 2;
+        }
+
+        ++count;
+        if (inRef)
+          ++refBytes;
+      }
+
+      return (inRef || count == 0) ? -1 : count;
+    }
+
+    template<size_t L>
+    constexpr int CountSigBytes(const char (&sig)[L])
+    {
+      return CountSigBytes(sig, L - 1);
+    }
+
+    // Only call on a pattern CountSigBytes accepted, N is its byte count
+    template<size_t N>
+    constexpr StaticSig<N> ParseStaticSig(const char* sig, size_t length)
+    {
+      StaticSig<N> out{};
+      bool inRef = false;
+
+      for (size_t i = 0; i < length && sig[i] != '\0' && out.Length < N;)
+      {
+        char c = sig[i];
+        if (c == ' ') { ++i; continue; }
+        if (c == '[') { inRef = true; ++i; continue; }
+        if (c == ']') { inRef = false; ++i; continue; }
+
+        if (c == '?')
+        {
+          if (i + 1 < length && sig[i + 1] == '?') ++i;
+          out.Bytes[out.Length] = 0x00;
+          out.Mask[out.Length] = 0x00;
+          if (inRef)
+          {
+            if (out.RefStart < 0) out.RefStart = static_cast<int>(out.Length);
+            out.RefSize++;
+          }
+          ++i;
+        }
+        else
+        {
+          out.Bytes[out.Length] = static_cast<uint8_t>((detail::SigHexValue(c) << 4) | detail::SigHexValue(sig[i + 1]));
+          out.Mask[out.Length] = 0xFF;
+          i += 2;
+        }
+        out.Length++;
+      }
+
+      return out;
+    }
+
+    template<size_t N, size_t L>
+    constexpr StaticSig<N> ParseStaticSig(const char (&sig)[L])
+    {
+      return ParseStaticSig<N>(sig, L - 1);
+    }
+  }
+}
+
+#define CT_STATIC_SIG(name, pattern) \
+  static_assert(util::offsets::CountSigBytes(pattern) > 0, "Malformed signature " #name); \
+  static constexpr util::offsets::StaticSig<(util::offsets::CountSigBytes(pattern) > 0 ? util::offsets::CountSigBytes(pattern) : 1)> \
+    name = util::offsets::ParseStaticSig<(util::offsets::CountSigBytes(pattern) > 0 ? util::offsets::CountSigBytes(pattern) : 1)>(pattern)
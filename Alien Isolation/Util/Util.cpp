@@ -1,4 +1,5 @@
 #include "Util.h"
+#include "RegionCache.h"
 #include "../Main.h"
 
 #include <codecvt>
@@ -13,6 +14,52 @@ namespace {
     return (prot & PAGE_READONLY) || (prot & PAGE_READWRITE) || (prot & PAGE_WRITECOPY) ||
            (prot & PAGE_EXECUTE_READ) || (prot & PAGE_EXECUTE_READWRITE) || (prot & PAGE_EXECUTE_WRITECOPY);
   }
+
+  util::RegionCache g_readableRegions;
+
+  // Image ranges don't change while a module is loaded,
+  // so each one is only looked up once
+  struct ModuleRange
+  {
+    HMODULE Module;
+    uintptr_t Begin;
+    uintptr_t End;
+  };
+
+  SRWLOCK g_moduleLock = SRWLOCK_INIT;
+  std::vector<ModuleRange> g_moduleRanges;
+
+  bool GetModuleRange(HMODULE hModule, uintptr_t& begin, uintptr_t& end)
+  {
+    bool found = false;
+    AcquireSRWLockShared(&g_moduleLock);
+    for (ModuleRange const& range : g_moduleRanges)
+    {
+      if (range.Module == hModule)
+      {
+        begin = range.Begin;
+        end = range.End;
+        found = true;
+        break;
+      }
+    }
+    ReleaseSRWLockShared(&g_moduleLock);
+
+    if (found)
+      return true;
+
+    MODULEINFO info{ 0 };
+    if (!GetModuleInformation(GetCurrentProcess(), hModule, &info, sizeof(info)))
+      return false;
+
+    begin = reinterpret_cast<uintptr_t>(info.lpBaseOfDll);
+    end = begin + info.SizeOfImage;
+
+    AcquireSRWLockExclusive(&g_moduleLock);
+    g_moduleRanges.push_back({ hModule, begin, end });
+    ReleaseSRWLockExclusive(&g_moduleLock);
+    return true;
+  }
 }
 
 // Loads resource data from the .dll file based on resource IDs in resource.h
@@ -140,12 +187,23 @@ BOOL util::WriteMemory(DWORD_PTR dwAddress, const void* cpvPatch, DWORD dwSize)
   memcpy(reinterpret_cast<void*>(dwAddress), cpvPatch, dwSize);
 
   DWORD unused = 0;
-  return VirtualProtect(reinterpret_cast<LPVOID>(dwAddress), dwSize, oldProtect, &unused);
+  BOOL result = VirtualProtect(reinterpret_cast<LPVOID>(dwAddress), dwSize, oldProtect, &unused);
+
+  // Changing protections splits regions
+  InvalidateReadableRegions();
+  return result;
 }
 
 bool util::IsPtrReadable(const void* ptr, size_t bytes)
 {
   if (!ptr) return false;
+  const uintptr_t begin = reinterpret_cast<uintptr_t>(ptr);
+  const uintptr_t end = begin + bytes;
+  if (end < begin)
+    return false;
+  if (g_readableRegions.Contains(begin, end))
+    return true;
+
   MEMORY_BASIC_INFORMATION mbi{ 0 };
   if (!VirtualQuery(ptr, &mbi, sizeof(mbi)))
     return false;
@@ -153,22 +211,27 @@ bool util::IsPtrReadable(const void* ptr, size_t bytes)
     return false;
   if (!IsReadableProtection(mbi.Protect))
     return false;
+  const uintptr_t regionBegin = reinterpret_cast<uintptr_t>(mbi.BaseAddress);
+  const uintptr_t regionEnd = regionBegin + mbi.RegionSize;
+  g_readableRegions.Add(regionBegin, regionEnd);
+
   // Ensure the requested size fits in this region
-  const uintptr_t begin = reinterpret_cast<uintptr_t>(ptr);
-  const uintptr_t end = begin + bytes;
-  const uintptr_t regionEnd = reinterpret_cast<uintptr_t>(mbi.BaseAddress) + mbi.RegionSize;
   return end <= regionEnd;
 }
 
+void util::InvalidateReadableRegions()
+{
+  g_readableRegions.Invalidate();
+}
+
 bool util::IsAddressInModule(HMODULE hModule, const void* addr, size_t size)
 {
   if (!hModule || !addr) return false;
-  MODULEINFO info{ 0 };
-  if (!GetModuleInformation(GetCurrentProcess(), hModule, &info, sizeof(info)))
+  uintptr_t base = 0;
+  uintptr_t end = 0;
+  if (!GetModuleRange(hModule, base, end))
     return false;
 
-  const uintptr_t base = reinterpret_cast<uintptr_t>(info.lpBaseOfDll);
-  const uintptr_t end = base + info.SizeOfImage;
   const uintptr_t a = reinterpret_cast<uintptr_t>(addr);
   const uintptr_t b = a + size;
   return (a >= base) && (b <= end);
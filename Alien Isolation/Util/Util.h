@@ -1,6 +1,9 @@
 #pragma once
 
+#include "OffsetTable.h"
+#include "SigScan.h"
 #include <DirectXMath.h>
+#include <atomic>
 #include <string>
 #include <vector>
 #include <memory>
@@ -37,29 +40,114 @@ namespace util
   namespace log
   {
     void Init();
+    // Writes out everything still queued and stops the log thread,
+    // later messages are written directly
+    void Shutdown();
+
+    // Writes the rest of the log to CT.ctlog instead of CT.log, in the
+    // format described in LogBinary.h. The console still gets text.
+    void SetBinarySink(bool enable);
+    bool IsBinarySinkEnabled();
 
     void Write(const char* format, ...);
     void Warning(const char* format, ...);
     void Error(const char* format, ...);
     void Ok(const char* format, ...);
+
+    // Defaults of CT_LOG_LIMITED: a burst of g_logLimitBurst messages,
+    // then one every g_logLimitIntervalMs
+    const uint32_t g_logLimitBurst = 5;
+    const uint64_t g_logLimitIntervalMs = 60000;
+
+    // Limits how often one call site can log, for messages that could
+    // otherwise repeat every frame. This is the generic cell rate
+    // algorithm: a message goes through unless the site is further
+    // ahead of one message per interval than the burst allows.
+    //
+    // Allowing or suppressing a message is one atomic operation.
+    // Suppressed messages are counted, and the count is logged after
+    // the next message that goes through and at Shutdown().
+    class RateLimit
+    {
+    public:
+      constexpr RateLimit(const char* format, uint64_t intervalMs, uint32_t burst) :
+        m_Format(format),
+        m_IntervalMs(intervalMs),
+        m_ToleranceMs(intervalMs * (burst - 1)),
+        m_TheoreticalArrival(0),
+        m_Suppressed(0),
+        m_Registered(false),
+        m_pNext(nullptr)
+      {
+      }
+
+      // suppressed is set to how many messages were held back since
+      // the last one that went through
+      bool Allow(uint32_t& suppressed)
+      {
+        uint64_t now = GetTickCount64();
+        uint64_t arrival = m_TheoreticalArrival.load(std::memory_order_relaxed);
+        do
+        {
+          if (arrival > now + m_ToleranceMs)
+          {
+            Suppress();
+            return false;
+          }
+        } while (!m_TheoreticalArrival.compare_exchange_weak(arrival,
+          (arrival > now ? arrival : now) + m_IntervalMs, std::memory_order_relaxed));
+
+        suppressed = m_Suppressed.load(std::memory_order_relaxed) ? m_Suppressed.exchange(0) : 0;
+        return true;
+      }
+
+      // Logs the counts of every site that has suppressed messages
+      static void ReportSuppressed();
+
+    private:
+      void Suppress()
+      {
+        if (m_Suppressed.fetch_add(1, std::memory_order_relaxed) == 0 && !m_Registered.exchange(true))
+          Register(this);
+      }
+
+      static void Register(RateLimit* pLimit);
+
+    private:
+      const char* m_Format;
+      uint64_t m_IntervalMs;
+      uint64_t m_ToleranceMs;
+      std::atomic<uint64_t> m_TheoreticalArrival;
+      std::atomic<uint32_t> m_Suppressed;
+      std::atomic<bool> m_Registered;
+      RateLimit* m_pNext;
+
+    public:
+      RateLimit(RateLimit const&) = delete;
+      void operator=(RateLimit const&) = delete;
+    };
   };
 
   namespace offsets
   {
-    struct CompiledSig;
-
-    struct Signature
+    enum class OffsetSource
     {
-      std::unique_ptr<CompiledSig> Compiled;
-      int AddOffset{ 0 };
-      bool HasReference{ false };
-      int ReferenceSize{ 0 };
-      uintptr_t Result{ 0 };
-
-      Signature(std::string const& sig, int offset = 0);
+      None,
+      Hardcoded,
+      Scanned,
+      Cached
     };
 
+    // Absolute addresses of every offset, filled once by Scan()
+    extern uintptr_t g_resolvedOffsets[OffsetCount];
+
+    inline uintptr_t Get(OffsetId id) { return g_resolvedOffsets[id]; }
+    uintptr_t GetRel(OffsetId id);
+    OffsetSource GetSource(OffsetId id);
+
     void Scan();
+
+    // Name based lookups, prefer Get() / GetRel()
     int GetOffset(std::string const& name);
     int GetRelOffset(std::string const& name);
   }
@@ -73,7 +161,10 @@ namespace util
 
   // Memory safety helpers
   // Returns true if the pointer appears to be readable for at least `bytes` bytes.
+  // Readable regions are cached for a short while, see RegionCache.h.
   bool IsPtrReadable(const void* ptr, size_t bytes = 1);
+  // Forgets the cached regions, call after changing memory protections.
+  void InvalidateReadableRegions();
   // Returns true if [addr, addr+size) lies within the specified module's image range.
   bool IsAddressInModule(HMODULE hModule, const void* addr, size_t size);
   // Returns true if the game appears to be a Steam build.
@@ -84,4 +175,19 @@ namespace util
     float CatmullRomInterpolate(float y0, float y1, float y2, float y3, float mu);
     DirectX::XMVECTOR ExtractYaw(DirectX::XMVECTOR quat);
   }
-}
\ No newline at end of file
+}
+// Logs through util::log::level, but at most g_logLimitBurst times at
+// once and then once a minute from this call site. The format has to
+// be a string literal.
+#define CT_LOG_LIMITED(level, format, ...) \
+  do \
+  { \
+    static util::log::RateLimit ctRateLimit(format, util::log::g_logLimitIntervalMs, util::log::g_logLimitBurst); \
+    uint32_t ctSuppressed = 0; \
+    if (ctRateLimit.Allow(ctSuppressed)) \
+    { \
+      util::log::level(format, ##__VA_ARGS__); \
+      if (ctSuppressed) \
+        util::log::level("  %u more like this were suppressed", ctSuppressed); \
+    } \
+  } while (0)
@@ -0,0 +1,238 @@
+// Times reading the tools' config and camera profiles on Linux, with
+// the old INIReader and with util::IniFile from
+// Alien Isolation/Util/IniFile.h. See README.md for building.
+
+#include "ActionIds.h"
+#include "IniFile.h"
+#include "INIReader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+  // Analog keys with response curves, LeftThumb_XPos to RightTrigger
+  const int g_analogKeyCount = RightTrigger - LeftThumb_XPos + 1;
+
+  const char* g_curveSettings[] = { "Deadzone", "AntiDeadzone", "Exponent", "SCurve", "Sensitivity" };
+
+  struct Options
+  {
+    std::string ConfigPath;
+    unsigned int Profiles{ 1000 };
+    unsigned int Repeats{ 200 };
+    std::string WorkDir{ "/tmp/inibench" };
+  };
+
+  std::string ActionName(int action)
+  {
+    return "Action" + std::to_string(action);
+  }
+
+  std::string AxisName(int key)
+  {
+    return "Axis" + std::to_string(key);
+  }
+
+  void WriteFile(std::string const& path, std::string const& content)
+  {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file << content;
+  }
+
+  // Shaped like what Main::SaveConfig writes
+  std::string MakeConfig()
+  {
+    std::string config = "[Camera]\nSelectedProfile = Profile 0\nAutoReset = 0\n";
+
+    std::string keyboard = "[KeyboardMap]\n";
+    std::string gamepad = "[GamepadMap]\n";
+    std::string chords = "[ChordMap]\n";
+    for (int action = 0; action < ActionCount; ++action)
+    {
+      keyboard += ActionName(action) + " = " + std::to_string(65 + action) + "\n";
+      gamepad += ActionName(action) + " = " + std::to_string(action % 26) + "\n";
+      if (action % 4 == 0)
+        chords += ActionName(action) + " = 17+" + std::to_string(65 + action) + ", 275\n";
+    }
+    for (int key = 0; key < g_analogKeyCount; ++key)
+    {
+      for (const char* setting : g_curveSettings)
+        gamepad += AxisName(key) + "." + setting + " = 0.250000\n";
+    }
+
+    return config + keyboard + gamepad + chords + "[Log]\nBinary = 0\n";
+  }
+
+  // Shaped like what CameraManager::SaveProfiles writes
+  std::string MakeProfile(unsigned int index)
+  {
+    std::string name = "Profile " + std::to_string(index);
+    return "[CameraProfile]\nName = " + name + "\nFieldOfView = 50.000000\nMovementSpeed = 1.000000\n"
+      "RotationSpeed = 0.785398\nRollSpeed = 0.392699\nFovSpeed = 5.000000\nDofScale = 1.000000\n"
+      "DofStrength = 0.040000\nFocusDistance = 2.000000\nIsProfile = true\n";
+  }
+
+  // The lookups CameraManager::ReadConfig and InputSystem::ReadConfig do
+  template<typename Reader>
+  double ReadConfig(Reader const& reader)
+  {
+    double sum = reader.GetBoolean("Camera", "AutoReset", false);
+    sum += reader.Get("Camera", "SelectedProfile", "").size();
+    for (int action = 0; action < ActionCount; ++action)
+    {
+      std::string name = ActionName(action);
+      sum += reader.GetInteger("KeyboardMap", name, 0);
+      sum += reader.GetInteger("GamepadMap", name, 0);
+      sum += reader.Get("ChordMap", name, "").size();
+    }
+    for (int key = 0; key < g_analogKeyCount; ++key)
+    {
+      std::string name = AxisName(key);
+      for (const char* setting : g_curveSettings)
+        sum += reader.GetReal("GamepadMap", name + "." + setting, 0);
+    }
+    return sum + reader.GetBoolean("Log", "Binary", false);
+  }
+
+  // The lookups CameraManager::LoadProfiles does per file
+  template<typename Reader>
+  double ReadProfile(Reader const& reader)
+  {
+    if (!reader.GetBoolean("CameraProfile", "IsProfile", false))
+      return 0;
+
+    double sum = reader.Get("CameraProfile", "Name", "UNKNOWN").size();
+    const char* names[] = { "MovementSpeed", "RotationSpeed", "RollSpeed", "FovSpeed",
+      "FieldOfView", "FocusDistance", "DofStrength", "DofScale" };
+    for (const char* name : names)
+      sum += reader.GetReal("CameraProfile", name, 1.0);
+    return sum;
+  }
+
+  template<typename Fn>
+  double TimeUs(unsigned int repeats, Fn fn, double& checksum)
+  {
+    std::vector<double> times;
+    for (unsigned int i = 0; i < repeats; ++i)
+    {
+      Clock::time_point start = Clock::now();
+      checksum += fn();
+      times.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+    }
+    std::sort(times.begin(), times.end());
+    return times[times.size() / 2];
+  }
+
+  void PrintRow(const char* name, double inireader, double inifile)
+  {
+    printf("%-24s INIReader %10.1f us   IniFile %10.1f us   %5.1fx\n", name, inireader, inifile, inireader / inifile);
+  }
+
+  bool ParseArgs(int argc, char** argv, Options& options)
+  {
+    for (int i = 1; i < argc; ++i)
+    {
+      std::string arg = argv[i];
+      bool hasValue = i + 1 < argc;
+      if (arg == "--config" && hasValue)
+        options.ConfigPath = argv[++i];
+      else if (arg == "--profiles" && hasValue)
+        options.Profiles = static_cast<unsigned int>(strtoul(argv[++i], nullptr, 10));
+      else if (arg == "--repeats" && hasValue)
+        options.Repeats = static_cast<unsigned int>(strtoul(argv[++i], nullptr, 10));
+      else if (arg == "--dir" && hasValue)
+        options.WorkDir = argv[++i];
+      else
+        return false;
+    }
+    return options.Repeats > 0;
+  }
+}
+
+int main(int argc, char** argv)
+{
+  Options options;
+  if (!ParseArgs(argc, argv, options))
+  {
+    printf("Usage: IniBench [--config file] [--profiles N] [--repeats N] [--dir path]\n");
+    printf("  --config file   config.ini to read (default: one generated like the tools write)\n");
+    printf("  --profiles N    Camera profiles to generate and read (default 1000)\n");
+    printf("  --repeats N     Times each case is run, the median is printed (default 200)\n");
+    printf("  --dir path      Where generated files go (default /tmp/inibench)\n");
+    return 2;
+  }
+
+  std::string profileDir = options.WorkDir + "/Profiles";
+  mkdir(options.WorkDir.c_str(), 0755);
+  mkdir(profileDir.c_str(), 0755);
+
+  std::string configPath = options.ConfigPath;
+  if (configPath.empty())
+  {
+    configPath = options.WorkDir + "/config.ini";
+    WriteFile(configPath, MakeConfig());
+  }
+
+  std::vector<std::string> profilePaths;
+  for (unsigned int i = 0; i < options.Profiles; ++i)
+  {
+    profilePaths.push_back(profileDir + "/Profile " + std::to_string(i) + ".ini");
+    WriteFile(profilePaths.back(), MakeProfile(i));
+  }
+
+  printf("%s, %u profiles, median of %u runs\n", configPath.c_str(), options.Profiles, options.Repeats);
+
+  // Both readers have to agree, this also keeps the reads from being
+  // optimized away
+  double oldSum = 0, newSum = 0;
+
+  double oldConfig = TimeUs(options.Repeats, [&] { INIReader reader(configPath); return ReadConfig(reader); }, oldSum);
+  double newConfig = TimeUs(options.Repeats, [&] { util::IniFile reader(configPath); return ReadConfig(reader); }, newSum);
+  PrintRow("config load + read", oldConfig, newConfig);
+
+  INIReader oldLoaded(configPath);
+  util::IniFile newLoaded(configPath);
+  double oldLookups = TimeUs(options.Repeats, [&] { return ReadConfig(oldLoaded); }, oldSum);
+  double newLookups = TimeUs(options.Repeats, [&] { return ReadConfig(newLoaded); }, newSum);
+  PrintRow("config lookups only", oldLookups, newLookups);
+
+  unsigned int profileRepeats = std::max(1u, options.Repeats / 20);
+  double oldProfiles = TimeUs(profileRepeats, [&]
+  {
+    double sum = 0;
+    for (std::string const& path : profilePaths)
+    {
+      INIReader reader(path);
+      sum += ReadProfile(reader);
+    }
+    return sum;
+  }, oldSum);
+  double newProfiles = TimeUs(profileRepeats, [&]
+  {
+    double sum = 0;
+    util::IniFile reader;
+    for (std::string const& path : profilePaths)
+    {
+      reader.Load(path);
+      sum += ReadProfile(reader);
+    }
+    return sum;
+  }, newSum);
+  PrintRow("profiles load + read", oldProfiles, newProfiles);
+
+  if (oldSum != newSum)
+  {
+    printf("The readers disagree (%f vs %f)\n", oldSum, newSum);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,267 @@
+// Times the calling side of the tools' logger on Linux. Compares the
+// queue in Alien Isolation/Util/LogRecord.h, where the caller only
+// copies its arguments, with the old logger that formatted and flushed
+// every line under a mutex. See README.md for building.
+
+#include "LogRecord.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+  const size_t g_queueSize = 1024;
+  const int g_drainIntervalMs = 20;
+
+  struct Options
+  {
+    unsigned int Threads{ 2 };
+    uint32_t Messages{ 200000 };
+    uint32_t Rate{ 0 };
+    std::string OutPath{ "/tmp/logbench.log" };
+  };
+
+  // Calls that dropped their message return right after a failed
+  // claim, so they're timed apart from the ones that were queued
+  struct Result
+  {
+    std::vector<uint32_t> AcceptedNs;
+    std::vector<uint32_t> DroppedNs;
+    double Seconds{ 0 };
+  };
+
+  util::log::LogQueue<g_queueSize> g_queue;
+  std::atomic<bool> g_running{ false };
+  std::mutex g_mutex;
+  FILE* g_pFile = nullptr;
+  FILE* g_pConsole = nullptr;
+
+  // The old logger: timestamp string, two vfprintf and a flush per line
+  bool LogLocked(const char* format, ...)
+  {
+    std::lock_guard<std::mutex> lock(g_mutex);
+
+    char timeStamp[32];
+    time_t now = time(nullptr);
+    strftime(timeStamp, sizeof(timeStamp), "[%Y-%b-%d %H:%M:%S] ", localtime(&now));
+    std::string stamp = timeStamp;
+    fputs(stamp.c_str(), g_pConsole);
+    fputs(stamp.c_str(), g_pFile);
+
+    std::string finalFormat = std::string("[WARNING] ") + format + "\n";
+    va_list args;
+    va_start(args, format);
+    va_list argsCopy;
+    va_copy(argsCopy, args);
+    vfprintf(g_pConsole, finalFormat.c_str(), args);
+    vfprintf(g_pFile, finalFormat.c_str(), argsCopy);
+    va_end(argsCopy);
+    va_end(args);
+    fflush(g_pFile);
+    return true;
+  }
+
+  bool LogQueued(const char* format, ...)
+  {
+    size_t position;
+    util::log::LogRecord* pRecord = g_queue.Claim(position);
+    if (!pRecord)
+      return false;
+
+    pRecord->Time = Clock::now().time_since_epoch().count();
+    pRecord->Level = util::log::LogLevel::Warning;
+    va_list args;
+    va_start(args, format);
+    util::log::Capture(*pRecord, format, args);
+    va_end(args);
+    g_queue.Commit(position);
+    return true;
+  }
+
+  void Drain(std::string& line)
+  {
+    bool wrote = false;
+    while (util::log::LogRecord* pRecord = g_queue.Peek())
+    {
+      line = "[WARNING] ";
+      util::log::FormatRecord(*pRecord, line);
+      line += '\n';
+      fputs(line.c_str(), g_pConsole);
+      fputs(line.c_str(), g_pFile);
+      g_queue.Pop();
+      wrote = true;
+    }
+    if (wrote)
+      fflush(g_pFile);
+  }
+
+  void LogThread()
+  {
+    std::string line;
+    while (g_running.load(std::memory_order_acquire))
+    {
+      std::this_thread::sleep_for(std::chrono::milliseconds(g_drainIntervalMs));
+      Drain(line);
+    }
+    Drain(line);
+  }
+
+  // Formats like the ones the tools log most
+  template<typename LogFn>
+  bool LogOne(LogFn log, uint32_t i)
+  {
+    switch (i & 3)
+    {
+    case 0: return log("Exception in hPostProcessUpdate, likely bad offset for PostProcess struct. Skipping update.");
+    case 1: return log("Captured ID3D11Device from Present hook (0x%p)", reinterpret_cast<void*>(static_cast<uintptr_t>(i)));
+    case 2: return log("Hook %s took %7.2f us, %u calls", "CameraUpdate", i * 0.25, i);
+    default: return log("Offset %s resolved to 0x%X (%s)", "OFFSET_MAIN", i, "scanned");
+    }
+  }
+
+  template<typename LogFn>
+  Result Run(Options const& options, LogFn log)
+  {
+    Result result;
+    std::vector<Result> perThread(options.Threads);
+    std::vector<std::thread> threads;
+
+    // With a rate, each thread spaces its calls evenly instead of
+    // logging as fast as it can
+    Clock::duration interval = options.Rate
+      ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / options.Rate))
+      : Clock::duration::zero();
+
+    Clock::time_point start = Clock::now();
+    for (unsigned int t = 0; t < options.Threads; ++t)
+    {
+      threads.emplace_back([&, t]
+      {
+        Result& own = perThread[t];
+        own.AcceptedNs.reserve(options.Messages);
+        Clock::time_point next = Clock::now();
+        for (uint32_t i = 0; i < options.Messages; ++i)
+        {
+          if (options.Rate)
+          {
+            while (Clock::now() < next)
+              std::this_thread::yield();
+            next += interval;
+          }
+
+          Clock::time_point before = Clock::now();
+          bool accepted = LogOne(log, i);
+          uint32_t ns = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - before).count());
+          (accepted ? own.AcceptedNs : own.DroppedNs).push_back(ns);
+        }
+      });
+    }
+    for (std::thread& thread : threads)
+      thread.join();
+    result.Seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    for (Result const& own : perThread)
+    {
+      result.AcceptedNs.insert(result.AcceptedNs.end(), own.AcceptedNs.begin(), own.AcceptedNs.end());
+      result.DroppedNs.insert(result.DroppedNs.end(), own.DroppedNs.begin(), own.DroppedNs.end());
+    }
+    std::sort(result.AcceptedNs.begin(), result.AcceptedNs.end());
+    std::sort(result.DroppedNs.begin(), result.DroppedNs.end());
+    return result;
+  }
+
+  uint32_t Percentile(std::vector<uint32_t> const& sorted, double fraction)
+  {
+    if (sorted.empty())
+      return 0;
+    return sorted[std::min(sorted.size() - 1, static_cast<size_t>(sorted.size() * fraction))];
+  }
+
+  void PrintLatencies(const char* name, std::vector<uint32_t> const& ns, double seconds)
+  {
+    printf("%-8s %8zu calls %10.0f calls/s  p50 %6u  p99 %7u  p99.9 %8u  max %9u ns\n",
+      name, ns.size(), ns.size() / seconds, Percentile(ns, 0.5), Percentile(ns, 0.99),
+      Percentile(ns, 0.999), ns.empty() ? 0 : ns.back());
+  }
+
+  void PrintResult(const char* name, Result const& result)
+  {
+    PrintLatencies(name, result.AcceptedNs, result.Seconds);
+    if (!result.DroppedNs.empty())
+      PrintLatencies("  dropped", result.DroppedNs, result.Seconds);
+  }
+
+  bool ParseArgs(int argc, char** argv, Options& options)
+  {
+    for (int i = 1; i < argc; ++i)
+    {
+      std::string arg = argv[i];
+      bool hasValue = i + 1 < argc;
+      if (arg == "--threads" && hasValue)
+        options.Threads = static_cast<unsigned int>(strtoul(argv[++i], nullptr, 10));
+      else if (arg == "--messages" && hasValue)
+        options.Messages = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+      else if (arg == "--rate" && hasValue)
+        options.Rate = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+      else if (arg == "--out" && hasValue)
+        options.OutPath = argv[++i];
+      else
+        return false;
+    }
+    return options.Threads > 0 && options.Messages > 0;
+  }
+}
+
+int main(int argc, char** argv)
+{
+  Options options;
+  if (!ParseArgs(argc, argv, options))
+  {
+    printf("Usage: LogBench [--threads N] [--messages N] [--rate N] [--out file]\n");
+    printf("  --threads N     Threads logging at once (default 2)\n");
+    printf("  --messages N    Messages per thread (default 200000)\n");
+    printf("  --rate N        Messages per second per thread, 0 logs as fast as possible (default 0)\n");
+    printf("  --out file      Log file written by both loggers (default /tmp/logbench.log)\n");
+    return 2;
+  }
+
+  g_pFile = fopen(options.OutPath.c_str(), "w");
+  g_pConsole = fopen("/dev/null", "w");
+  if (!g_pFile || !g_pConsole)
+  {
+    printf("Could not open %s\n", options.OutPath.c_str());
+    return 2;
+  }
+
+  if (options.Rate)
+    printf("%u threads, %u messages each at %u/s, latency per call\n", options.Threads, options.Messages, options.Rate);
+  else
+    printf("%u threads, %u messages each, latency per call\n", options.Threads, options.Messages);
+
+  Result locked = Run(options, [](const char* format, auto... args) { return LogLocked(format, args...); });
+  PrintResult("mutex", locked);
+
+  g_running = true;
+  std::thread logThread(&LogThread);
+  Result queued = Run(options, [](const char* format, auto... args) { return LogQueued(format, args...); });
+  g_running = false;
+  logThread.join();
+  g_queue.TakeDropped();
+  PrintResult("queue", queued);
+
+  fclose(g_pFile);
+  fclose(g_pConsole);
+  return 0;
+}
@@ -0,0 +1,264 @@
+// Turns a CT.ctlog written by the tools' binary log sink back into
+// text or JSON Lines. The format is described in
+// Alien Isolation/Util/LogBinary.h. See README.md for building.
+
+#include "LogBinary.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <string>
+#include <vector>
+
+using util::log::BinaryLogEntry;
+using util::log::BinaryLogReader;
+using util::log::EntryType;
+using util::log::LogLevel;
+
+namespace
+{
+  // FILETIME of 1970-01-01, in 100ns units
+  const int64_t g_unixEpochFileTime = 116444736000000000LL;
+  const int64_t g_fileTimePerSecond = 10000000;
+
+  const char* g_levelNames[] = { "INFO", "WARNING", "ERROR", "OK" };
+
+  struct Options
+  {
+    std::string Path;
+    bool Json{ false };
+    bool Stats{ false };
+  };
+
+  struct SiteStats
+  {
+    std::string Name;
+    uint64_t Count{ 0 };
+  };
+
+  bool ReadFile(std::string const& path, std::vector<uint8_t>& data)
+  {
+    FILE* pFile = fopen(path.c_str(), "rb");
+    if (!pFile)
+      return false;
+
+    uint8_t buffer[65536];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), pFile)) > 0)
+      data.insert(data.end(), buffer, buffer + read);
+
+    fclose(pFile);
+    return true;
+  }
+
+  // The game's local time, as "2024-Mar-05 21:14:09.123456"
+  std::string FormatTime(int64_t localTime)
+  {
+    static const char* monthNames[] = {
+      "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
+    };
+
+    int64_t unixTime = localTime - g_unixEpochFileTime;
+    time_t seconds = static_cast<time_t>(unixTime / g_fileTimePerSecond);
+    int64_t micros = (unixTime % g_fileTimePerSecond) / 10;
+    if (micros < 0)
+    {
+      seconds -= 1;
+      micros += 1000000;
+    }
+
+    // Already local, so it's only split up and not converted
+    tm parts;
+    gmtime_r(&seconds, &parts);
+
+    char text[48];
+    snprintf(text, sizeof(text), "%04d-%s-%02d %02d:%02d:%02d.%06lld", parts.tm_year + 1900,
+      monthNames[parts.tm_mon], parts.tm_mday, parts.tm_hour, parts.tm_min, parts.tm_sec,
+      static_cast<long long>(micros));
+    return text;
+  }
+
+  void AppendJsonString(std::string const& value, std::string& out)
+  {
+    out += '"';
+    for (char c : value)
+    {
+      switch (c)
+      {
+      case '"': out += "\\\""; break;
+      case '\\': out += "\\\\"; break;
+      case '\n': out += "\\n"; break;
+      case '\r': out += "\\r"; break;
+      case '\t': out += "\\t"; break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20)
+        {
+          char escaped[8];
+          snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned char>(c));
+          out += escaped;
+        }
+        else
+          out += c;
+      }
+    }
+    out += '"';
+  }
+
+  void PrintText(BinaryLogEntry const& entry, std::string const& time, std::string const& message)
+  {
+    if (entry.Type == EntryType::Dropped)
+      printf("[%s] [DROPPED] %s\n", time.c_str(), message.c_str());
+    else
+      printf("[%s] [%s] %s\n", time.c_str(), g_levelNames[static_cast<int>(entry.Record.Level)], message.c_str());
+  }
+
+  void PrintJson(BinaryLogEntry const& entry, std::string const& time, double seconds,
+    std::string const& message, std::string const* pFormat)
+  {
+    std::string line = "{\"time\":";
+    AppendJsonString(time, line);
+
+    char number[32];
+    snprintf(number, sizeof(number), ",\"seconds\":%.6f", seconds);
+    line += number;
+
+    if (entry.Type == EntryType::Dropped)
+    {
+      snprintf(number, sizeof(number), ",\"dropped\":%u", entry.Dropped);
+      line += number;
+    }
+    else
+    {
+      line += ",\"level\":";
+      AppendJsonString(g_levelNames[static_cast<int>(entry.Record.Level)], line);
+      if (pFormat)
+      {
+        snprintf(number, sizeof(number), ",\"site\":%u,\"format\":", entry.FormatId);
+        line += number;
+        AppendJsonString(*pFormat, line);
+      }
+      line += ",\"message\":";
+      AppendJsonString(message, line);
+    }
+
+    line += "}\n";
+    fputs(line.c_str(), stdout);
+  }
+
+  void PrintStats(std::vector<SiteStats> sites)
+  {
+    std::stable_sort(sites.begin(), sites.end(), [](SiteStats const& a, SiteStats const& b)
+    {
+      return a.Count > b.Count;
+    });
+
+    printf("%10s  %s\n", "messages", "call site");
+    for (SiteStats const& site : sites)
+    {
+      if (site.Count)
+        printf("%10llu  %s\n", static_cast<unsigned long long>(site.Count), site.Name.c_str());
+    }
+  }
+
+  bool ParseArgs(int argc, char** argv, Options& options)
+  {
+    for (int i = 1; i < argc; ++i)
+    {
+      std::string arg = argv[i];
+      if (arg == "--json")
+        options.Json = true;
+      else if (arg == "--stats")
+        options.Stats = true;
+      else if (options.Path.empty() && arg[0] != '-')
+        options.Path = arg;
+      else
+        return false;
+    }
+    return !options.Path.empty();
+  }
+}
+
+int main(int argc, char** argv)
+{
+  Options options;
+  if (!ParseArgs(argc, argv, options))
+  {
+    printf("Usage: LogDecoder <CT.ctlog> [--json] [--stats]\n");
+    printf("  --json     One JSON object per line instead of text\n");
+    printf("  --stats    Only count the messages of each call site\n");
+    return 2;
+  }
+
+  std::vector<uint8_t> data;
+  if (!ReadFile(options.Path, data))
+  {
+    fprintf(stderr, "Could not open %s\n", options.Path.c_str());
+    return 2;
+  }
+
+  BinaryLogReader reader;
+  if (!reader.Open(std::move(data)))
+  {
+    fprintf(stderr, "%s is not a binary log of version %u\n", options.Path.c_str(), util::log::g_binaryLogVersion);
+    return 2;
+  }
+
+  util::log::BinaryLogHeader const& header = reader.GetHeader();
+
+  // Sites 0 and 1 are messages formatted up front and dropped ones, the
+  // rest are the format dictionary shifted by two
+  std::vector<SiteStats> sites(2);
+  sites[0].Name = "(formatted by the caller)";
+  sites[1].Name = "(dropped)";
+
+  BinaryLogEntry entry;
+  std::string message;
+  while (reader.Next(entry))
+  {
+    if (options.Stats)
+    {
+      if (entry.Type == EntryType::Message)
+      {
+        std::vector<std::string> const& formats = reader.GetFormats();
+        while (sites.size() < formats.size() + 2)
+          sites.emplace_back();
+        SiteStats& site = sites[entry.FormatId + 2];
+        if (site.Name.empty())
+          site.Name = formats[entry.FormatId];
+        site.Count += 1;
+      }
+      else if (entry.Type == EntryType::Dropped)
+        sites[1].Count += entry.Dropped;
+      else
+        sites[0].Count += 1;
+      continue;
+    }
+
+    message.clear();
+    if (entry.Type == EntryType::Dropped)
+      message = std::to_string(entry.Dropped) + " log messages were dropped, the log thread fell behind";
+    else
+      util::log::FormatRecord(entry.Record, message);
+
+    std::string time = FormatTime(util::log::TicksToLocalTime(header, entry.Time));
+    if (options.Json)
+    {
+      double seconds = static_cast<double>(entry.Time - header.BaseTicks) / header.TicksPerSecond;
+      std::string const* pFormat = entry.Type == EntryType::Message ? &reader.GetFormats()[entry.FormatId] : nullptr;
+      PrintJson(entry, time, seconds, message, pFormat);
+    }
+    else
+      PrintText(entry, time, message);
+  }
+
+  if (options.Stats)
+    PrintStats(sites);
+
+  if (reader.IsCorrupt())
+  {
+    fprintf(stderr, "%s ends in an entry that can't be read, the game may have been closed while writing it\n",
+      options.Path.c_str());
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,308 @@
+#include "Commands.h"
+#include "OffsetTable.h"
+#include "PEImage.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+using util::offsets::SigView;
+using util::offsets::SigScanner;
+
+namespace
+{
+  // Most common bytes in x86 code, most common first
+  const uint8_t g_codeBytes[] = {
+    0x00, 0xFF, 0x8B, 0x89, 0x0F, 0x24, 0x44, 0xE8, 0x04, 0x01, 0x08, 0x85,
+    0x74, 0x75, 0x83, 0xC0, 0x10, 0x4C, 0x50, 0x56, 0x57, 0x8D, 0x33, 0xCC
+  };
+
+  typedef std::vector<uint8_t const*> Results;
+
+  struct DataSet
+  {
+    explicit DataSet(const char* name) : Name(name) {}
+
+    const char* Name;
+    std::vector<uint8_t> Image;
+    // Where each signature was planted, the first match can't be later
+    std::vector<size_t> Planted;
+  };
+
+  struct Timing
+  {
+    double BestMs{ 0 };
+    bool Identical{ true };
+  };
+
+  double NowMs()
+  {
+    using namespace std::chrono;
+    return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+  }
+
+  // Copies the signature to p with random bytes in the wildcards
+  void Plant(uint8_t* p, SigView const& sig, std::mt19937& rng)
+  {
+    for (size_t i = 0; i < sig.length; ++i)
+      p[i] = sig.mask[i] ? sig.bytes[i] : static_cast<uint8_t>(rng());
+  }
+
+  void PlantAll(DataSet& set, std::vector<SigView> const& sigs, std::mt19937& rng)
+  {
+    // Late in the image so every engine has to go through most of it
+    size_t size = set.Image.size();
+    for (SigView const& sig : sigs)
+    {
+      size_t position = size / 2 + rng() % (size / 2 - sig.length);
+      Plant(set.Image.data() + position, sig, rng);
+      set.Planted.push_back(position);
+    }
+  }
+
+  // Every 64 bytes holds a copy of some signature with its last fixed
+  // byte changed, so each one passes the anchor filter and fails only
+  // at the end of the full compare
+  void PlantNearMisses(DataSet& set, std::vector<SigView> const& sigs, std::mt19937& rng)
+  {
+    size_t maxLength = 0;
+    for (SigView const& sig : sigs)
+      maxLength = std::max(maxLength, sig.length);
+
+    for (size_t position = 0; position + maxLength < set.Image.size(); position += 64)
+    {
+      SigView const& sig = sigs[rng() % sigs.size()];
+      uint8_t* p = set.Image.data() + position;
+      Plant(p, sig, rng);
+
+      for (size_t i = sig.length; i-- > 0;)
+      {
+        if (sig.mask[i])
+        {
+          p[i] = static_cast<uint8_t>(~sig.bytes[i]);
+          break;
+        }
+      }
+    }
+  }
+
+  bool LoadCodeSections(std::string const& path, std::vector<uint8_t>& code)
+  {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+      return false;
+
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    util::PEImage image;
+    if (!image.Parse(data.data(), data.size(), false))
+      return false;
+
+    for (util::PESection const& section : image.GetSections())
+    {
+      if (section.IsExecutable())
+      {
+        uint32_t length = std::min(section.RawSize, section.VirtualSize);
+        code.insert(code.end(), data.begin() + section.RawOffset, data.begin() + section.RawOffset + length);
+      }
+    }
+    return !code.empty();
+  }
+
+  template<typename Fn>
+  Timing Time(int repeats, Results const& reference, Fn const& scan)
+  {
+    Timing timing;
+    for (int i = 0; i < repeats; ++i)
+    {
+      Results results;
+      double start = NowMs();
+      scan(results);
+      double elapsed = NowMs() - start;
+
+      if (i == 0 || elapsed < timing.BestMs)
+        timing.BestMs = elapsed;
+      if (results != reference)
+        timing.Identical = false;
+    }
+    return timing;
+  }
+
+  void PrintTiming(const char* set, size_t size, const char* engine, Timing const& timing)
+  {
+    double mbPerSecond = timing.BestMs > 0 ? (size / (1024.0 * 1024.0)) / (timing.BestMs / 1000.0) : 0;
+    printf("%-10s %5u MB  %-18s %9.2f ms %9.1f MB/s  %s\n", set, static_cast<unsigned int>(size >> 20),
+      engine, timing.BestMs, mbPerSecond, timing.Identical ? "identical" : "MISMATCH");
+  }
+
+  bool BenchDataSet(DataSet const& set, std::vector<SigView> const& sigs, BenchOptions const& options)
+  {
+    uint8_t const* base = set.Image.data();
+    size_t size = set.Image.size();
+
+    SigScanner scanner;
+    for (SigView const& sig : sigs)
+      scanner.Add(sig);
+
+    // Everything is compared against the byte by byte search
+    Results reference;
+    Timing scalar;
+    for (int i = 0; i < options.Repeats; ++i)
+    {
+      Results results;
+      double start = NowMs();
+      for (SigView const& sig : sigs)
+        results.push_back(util::offsets::FindPatternScalar(base, size, sig));
+      double elapsed = NowMs() - start;
+
+      if (i == 0 || elapsed < scalar.BestMs)
+        scalar.BestMs = elapsed;
+      reference = results;
+    }
+
+    for (size_t i = 0; i < set.Planted.size(); ++i)
+    {
+      if (!reference[i] || static_cast<size_t>(reference[i] - base) > set.Planted[i])
+        scalar.Identical = false;
+    }
+    PrintTiming(set.Name, size, "FindPatternScalar", scalar);
+
+    Timing vector = Time(options.Repeats, reference, [&](Results& results) {
+      for (SigView const& sig : sigs)
+        results.push_back(util::offsets::FindPattern(base, size, sig));
+    });
+    PrintTiming(set.Name, size, "FindPattern", vector);
+
+    Timing single = Time(options.Repeats, reference, [&](Results& results) {
+      scanner.Scan(base, size, results);
+    });
+    PrintTiming(set.Name, size, "SigScanner::Scan", single);
+
+    std::vector<SigScanner::Range> ranges = { { 0, size } };
+    Timing threaded = Time(options.Repeats, reference, [&](Results& results) {
+      scanner.ScanRanges(base, ranges, results, options.Threads);
+    });
+    PrintTiming(set.Name, size, "ScanRanges", threaded);
+
+    // What a start with a valid offsets.cache does instead of a scan:
+    // check every cached match against its signature
+    Timing cached = Time(options.Repeats, reference, [&](Results& results) {
+      for (size_t i = 0; i < sigs.size(); ++i)
+        results.push_back(reference[i] && util::offsets::MatchesAt(reference[i], sigs[i]) ? reference[i] : nullptr);
+    });
+    printf("%-10s %5u MB  %-18s %9.2f us %14s  %s\n", set.Name, static_cast<unsigned int>(size >> 20),
+      "cached", cached.BestMs * 1000.0, "", cached.Identical ? "identical" : "MISMATCH");
+
+    return scalar.Identical && vector.Identical && single.Identical && threaded.Identical && cached.Identical;
+  }
+
+  void BenchCompile(std::vector<SigView> const& sigs)
+  {
+    std::vector<std::string> strings;
+    for (SigView const& sig : sigs)
+      strings.push_back(FormatSig(sig));
+
+    const int iterations = 20000;
+    size_t bytes = 0;
+    double start = NowMs();
+    for (int i = 0; i < iterations; ++i)
+    {
+      for (std::string const& s : strings)
+        bytes += util::offsets::Compile(s).bytes.size();
+    }
+    double elapsed = NowMs() - start;
+
+    printf("Compile: %.0f ns per signature (%u signatures, %u bytes)\n\n",
+      elapsed * 1e6 / (static_cast<double>(iterations) * strings.size()),
+      static_cast<unsigned int>(strings.size()), static_cast<unsigned int>(bytes / iterations));
+  }
+}
+
+void FillCodeLike(uint8_t* pData, size_t size, std::mt19937& rng)
+{
+  // Half the bytes come from the common list, weighted towards its start
+  const uint32_t count = sizeof(g_codeBytes);
+  for (size_t i = 0; i < size; ++i)
+  {
+    uint32_t r = rng();
+    if (r & 1)
+    {
+      uint32_t a = (r >> 8) % count;
+      uint32_t b = (r >> 16) % count;
+      pData[i] = g_codeBytes[std::min(a, b)];
+    }
+    else
+      pData[i] = static_cast<uint8_t>(r >> 24);
+  }
+}
+
+int RunBench(BenchOptions const& options)
+{
+  size_t sigCount = 0;
+  util::offsets::OffsetSignature const* pSigs = util::offsets::GetSignatures(sigCount);
+  std::vector<SigView> sigs;
+  for (size_t i = 0; i < sigCount; ++i)
+    sigs.push_back(pSigs[i].Pattern);
+
+  std::vector<uint8_t> realCode;
+  if (!options.Path.empty() && !LoadCodeSections(options.Path, realCode))
+  {
+    fprintf(stderr, "Could not read code sections from %s\n", options.Path.c_str());
+    return 2;
+  }
+
+  BenchCompile(sigs);
+
+  std::vector<size_t> sizes;
+  if (options.SizeMB)
+    sizes.push_back(options.SizeMB);
+  else
+    sizes = { 16, 32, 64 };
+
+  bool identical = true;
+  for (size_t sizeMB : sizes)
+  {
+    std::mt19937 rng(options.Seed);
+    size_t size = sizeMB << 20;
+    std::vector<DataSet> sets;
+
+    DataSet uniform("uniform");
+    uniform.Image.resize(size);
+    for (uint8_t& b : uniform.Image)
+      b = static_cast<uint8_t>(rng());
+    sets.push_back(std::move(uniform));
+
+    DataSet code("code-like");
+    code.Image.resize(size);
+    FillCodeLike(code.Image.data(), size, rng);
+    sets.push_back(std::move(code));
+
+    DataSet nearMiss("near-miss");
+    nearMiss.Image.resize(size);
+    FillCodeLike(nearMiss.Image.data(), size, rng);
+    PlantNearMisses(nearMiss, sigs, rng);
+    sets.push_back(std::move(nearMiss));
+
+    // The binary's code repeated up to the size
+    if (!realCode.empty())
+    {
+      DataSet real("real");
+      real.Image.resize(size);
+      for (size_t offset = 0; offset < size; offset += realCode.size())
+        std::copy_n(realCode.begin(), std::min(realCode.size(), size - offset), real.Image.begin() + offset);
+      sets.push_back(std::move(real));
+    }
+
+    for (DataSet& set : sets)
+    {
+      PlantAll(set, sigs, rng);
+      identical &= BenchDataSet(set, sigs, options);
+    }
+    printf("\n");
+  }
+
+  printf(identical ? "All engines found identical matches\n" : "Engines disagree, see MISMATCH above\n");
+  return identical ? 0 : 1;
+}
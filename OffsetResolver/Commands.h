@@ -0,0 +1,44 @@
+#pragma once
+#include "SigScan.h"
+
+#include <cstdint>
+#include <random>
+#include <string>
+
+// Diagnostic modes of the resolver, for working on the scanner itself
+
+struct BenchOptions
+{
+  // Binary whose executable sections are used as the real-world
+  // data set, optional
+  std::string Path;
+  // 0 runs 16, 32 and 64 MB
+  size_t SizeMB{ 0 };
+  int Repeats{ 3 };
+  unsigned int Threads{ 0 };
+  uint32_t Seed{ 1 };
+};
+
+struct FuzzOptions
+{
+  uint32_t Seed{ 1 };
+  uint32_t Iterations{ 200000 };
+};
+
+// Times Compile, FindPatternScalar, FindPattern, SigScanner::Scan and
+// ScanRanges and checks they all find the same matches. Returns 1 if
+// any engine disagrees.
+int RunBench(BenchOptions const& options);
+
+// Feeds random and mutated signature strings to Compile and the
+// compile time parser and checks they agree, then scans for every
+// accepted signature with each engine. Returns 1 on the first mismatch.
+int RunFuzz(FuzzOptions const& options);
+
+// Back to the "8B ?? [ ?? ]" form. Reference brackets are assumed to
+// hold one run of wildcards, which is how all the tools' signatures
+// are written.
+std::string FormatSig(util::offsets::SigView const& sig);
+
+// Random bytes with roughly the distribution of x86 code
+void FillCodeLike(uint8_t* pData, size_t size, std::mt19937& rng);
@@ -0,0 +1,275 @@
+#include "Commands.h"
+#include "OffsetTable.h"
+#include "StaticSig.h"
+
+#include <cstdio>
+#include <map>
+#include <stdexcept>
+#include <vector>
+
+using util::offsets::CompiledSig;
+using util::offsets::SigView;
+
+namespace
+{
+  // Largest pattern compared against the compile time parser
+  const size_t g_maxStaticBytes = 256;
+
+  // Pieces random signatures are built from. Besides valid tokens there
+  // are lone hex digits for odd lengths, extra brackets and bad hex.
+  const char* g_tokens[] = {
+    "8B", "00", "ff", "E8", "A1", "0F", "?", "??", "???",
+    "[", "]", "[ ", " ]", "[]", "[ ]", " ", "  ",
+    "8", "F", "G1", "zz", "0x", "-", "\t", "8B8B", "?8", "8?"
+  };
+
+  // Characters inserted by mutations
+  const char g_alphabet[] = " []?0123456789ABCDEFabcdefGxz,";
+
+  std::string RandomTokens(std::mt19937& rng)
+  {
+    const size_t tokenCount = sizeof(g_tokens) / sizeof(g_tokens[0]);
+    std::string s;
+    uint32_t count = rng() % 24;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+      // Mostly valid bytes so a good share of inputs is accepted
+      uint32_t r = rng() % 100;
+      if (r < 60)
+      {
+        char hex[4];
+        snprintf(hex, sizeof(hex), "%02X ", static_cast<unsigned int>(rng() & 0xFF));
+        s += hex;
+      }
+      else if (r < 80)
+        s += "?? ";
+      else
+        s += g_tokens[rng() % tokenCount];
+    }
+    return s;
+  }
+
+  std::string Mutate(std::string s, std::mt19937& rng)
+  {
+    const size_t alphabetSize = sizeof(g_alphabet) - 1;
+    uint32_t mutations = 1 + rng() % 4;
+    for (uint32_t i = 0; i < mutations; ++i)
+    {
+      size_t position = s.empty() ? 0 : rng() % (s.size() + 1);
+      switch (rng() % 4)
+      {
+      case 0:
+        if (position < s.size())
+          s.erase(position, 1);
+        break;
+      case 1:
+        s.insert(position, 1, g_alphabet[rng() % alphabetSize]);
+        break;
+      case 2:
+        if (position < s.size())
+          s[position] = g_alphabet[rng() % alphabetSize];
+        break;
+      default:
+        s.insert(position, rng() & 1 ? "[ " : " ]");
+        break;
+      }
+    }
+    return s;
+  }
+
+  std::string Escape(std::string const& s)
+  {
+    std::string out;
+    for (char c : s)
+    {
+      if (c == '\t')
+        out += "\\t";
+      else
+        out += c;
+    }
+    return out;
+  }
+
+  bool Fail(std::string const& input, const char* what)
+  {
+    printf("FAIL: %s\n  input \"%s\"\n", what, Escape(input).c_str());
+    return false;
+  }
+
+  bool SameView(SigView const& a, SigView const& b, bool compareRefSize)
+  {
+    if (a.length != b.length || a.refStart != b.refStart)
+      return false;
+    if (compareRefSize && a.refSize != b.refSize)
+      return false;
+
+    for (size_t i = 0; i < a.length; ++i)
+    {
+      if (a.bytes[i] != b.bytes[i] || a.mask[i] != b.mask[i])
+        return false;
+    }
+    return true;
+  }
+
+  // Plants the signature in a small code-like buffer and checks every
+  // engine finds the same first match
+  bool CheckScan(std::string const& input, SigView const& sig, std::mt19937& rng)
+  {
+    std::vector<uint8_t> buffer(sig.length + 512 + rng() % 1024);
+    FillCodeLike(buffer.data(), buffer.size(), rng);
+
+    size_t position = rng() % (buffer.size() - sig.length + 1);
+    for (size_t i = 0; i < sig.length; ++i)
+    {
+      if (sig.mask[i])
+        buffer[position + i] = sig.bytes[i];
+    }
+
+    uint8_t const* base = buffer.data();
+    uint8_t const* scalar = util::offsets::FindPatternScalar(base, buffer.size(), sig);
+    if (!scalar || scalar > base + position)
+      return Fail(input, "FindPatternScalar missed the planted match");
+
+    if (util::offsets::FindPattern(base, buffer.size(), sig) != scalar)
+      return Fail(input, "FindPattern differs from FindPatternScalar");
+
+    util::offsets::SigScanner scanner;
+    scanner.Add(sig);
+    std::vector<uint8_t const*> results;
+    scanner.Scan(base, buffer.size(), results);
+    if (results.size() != 1 || results[0] != scalar)
+      return Fail(input, "SigScanner::Scan differs from FindPatternScalar");
+
+    std::vector<util::offsets::SigScanner::Range> ranges = { { 0, buffer.size() } };
+    scanner.ScanRanges(base, ranges, results, 2);
+    if (results.size() != 1 || results[0] != scalar)
+      return Fail(input, "SigScanner::ScanRanges differs from FindPatternScalar");
+
+    return true;
+  }
+
+  bool CheckInput(std::string const& input, std::mt19937& rng,
+    std::map<std::string, uint32_t>& rejected, uint32_t& accepted)
+  {
+    int count = util::offsets::CountSigBytes(input.c_str(), input.size());
+
+    CompiledSig compiled;
+    bool ok = true;
+    try
+    {
+      compiled = util::offsets::Compile(input);
+    }
+    catch (std::runtime_error const& e)
+    {
+      ok = false;
+      rejected[e.what()] += 1;
+    }
+
+    if (ok != (count > 0))
+      return Fail(input, ok ? "Compile accepted what CountSigBytes rejects" : "Compile rejected what CountSigBytes accepts");
+    if (!ok)
+      return true;
+
+    accepted += 1;
+    SigView view = compiled.View();
+    if (static_cast<size_t>(count) != view.length || compiled.mask.size() != view.length)
+      return Fail(input, "CountSigBytes and Compile disagree on the length");
+
+    if (view.length <= g_maxStaticBytes)
+    {
+      util::offsets::StaticSig<g_maxStaticBytes> parsed =
+        util::offsets::ParseStaticSig<g_maxStaticBytes>(input.c_str(), input.size());
+      if (!SameView(view, parsed.View(), true))
+        return Fail(input, "ParseStaticSig differs from Compile");
+    }
+
+    // Brackets around separate wildcard runs don't survive formatting,
+    // so only the reference start has to come back the same
+    std::string formatted = FormatSig(view);
+    CompiledSig again = util::offsets::Compile(formatted);
+    if (!SameView(view, again.View(), false))
+      return Fail(input, "Compile(FormatSig()) doesn't round trip");
+
+    return CheckScan(input, view, rng);
+  }
+}
+
+std::string FormatSig(SigView const& sig)
+{
+  std::string s;
+  int refLeft = 0;
+  for (size_t i = 0; i < sig.length; ++i)
+  {
+    if (static_cast<int>(i) == sig.refStart && sig.refSize > 0)
+    {
+      s += "[ ";
+      refLeft = sig.refSize;
+    }
+
+    if (sig.mask[i])
+    {
+      char hex[4];
+      snprintf(hex, sizeof(hex), "%02X ", sig.bytes[i]);
+      s += hex;
+    }
+    else
+    {
+      s += "?? ";
+      if (refLeft > 0 && --refLeft == 0)
+        s += "] ";
+    }
+  }
+
+  if (!s.empty())
+    s.pop_back();
+  return s;
+}
+
+int RunFuzz(FuzzOptions const& options)
+{
+  std::mt19937 rng(options.Seed);
+
+  size_t sigCount = 0;
+  util::offsets::OffsetSignature const* pSigs = util::offsets::GetSignatures(sigCount);
+  std::vector<std::string> seeds;
+  for (size_t i = 0; i < sigCount; ++i)
+    seeds.push_back(FormatSig(pSigs[i].Pattern));
+
+  std::map<std::string, uint32_t> rejected;
+  uint32_t accepted = 0;
+
+  // The real signatures first, they all have to be accepted
+  for (std::string const& seed : seeds)
+  {
+    if (!CheckInput(seed, rng, rejected, accepted))
+      return 1;
+  }
+  if (accepted != seeds.size())
+  {
+    printf("FAIL: a signature of the tools was rejected\n");
+    return 1;
+  }
+
+  for (uint32_t i = 0; i < options.Iterations; ++i)
+  {
+    std::string input;
+    switch (rng() % 3)
+    {
+    case 0: input = RandomTokens(rng); break;
+    case 1: input = Mutate(seeds[rng() % seeds.size()], rng); break;
+    default: input = Mutate(RandomTokens(rng), rng); break;
+    }
+
+    if (!CheckInput(input, rng, rejected, accepted))
+    {
+      printf("  seed %u, iteration %u\n", options.Seed, i);
+      return 1;
+    }
+  }
+
+  printf("%u inputs, %u accepted\n", options.Iterations + static_cast<uint32_t>(seeds.size()), accepted);
+  for (auto const& kv : rejected)
+    printf("  %-32s %u\n", kv.first.c_str(), kv.second);
+  printf("Compile, CountSigBytes, ParseStaticSig and all scan engines agree\n");
+  return 0;
+}
@@ -0,0 +1,231 @@
+// Resolves the tools' offsets from an AI.exe on disk, without running
+// the game. Uses the signature table, scanner and reference checks of
+// the tools themselves, so what it prints is what the injected DLL
+// would find. See README.md for building.
+
+#include "Commands.h"
+#include "OffsetCache.h"
+#include "OffsetTable.h"
+#include "PEImage.h"
+#include "SigScan.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace
+{
+  enum class Command
+  {
+    Resolve,
+    Bench,
+    Fuzz
+  };
+
+  struct Options
+  {
+    Command Run{ Command::Resolve };
+    std::string Path;
+    bool Diff{ false };
+    unsigned int Threads{ 0 };
+    size_t SizeMB{ 0 };
+    int Repeats{ 3 };
+    uint32_t Seed{ 1 };
+    uint32_t Iterations{ 200000 };
+  };
+
+  void PrintUsage()
+  {
+    printf("Usage: OffsetResolver <AI.exe> [--diff] [--threads N]\n");
+    printf("       OffsetResolver --bench [AI.exe] [--size MB] [--repeats N] [--threads N] [--seed N]\n");
+    printf("       OffsetResolver --fuzz [--iterations N] [--seed N]\n");
+    printf("  --diff          Only list offsets that don't match the hardcoded ones\n");
+    printf("  --threads N     Scanner threads, 0 uses one per core (default)\n");
+    printf("  --bench         Time every scan engine on synthetic images, and on\n");
+    printf("                  the code of AI.exe if given, and compare their results\n");
+    printf("  --size MB       Image size for --bench, 16, 32 and 64 MB by default\n");
+    printf("  --fuzz          Check Compile against the compile time parser and\n");
+    printf("                  the scan engines with random signatures\n");
+  }
+
+  bool ParseArgs(int argc, char** argv, Options& options)
+  {
+    for (int i = 1; i < argc; ++i)
+    {
+      std::string arg = argv[i];
+      bool hasValue = i + 1 < argc;
+      if (arg == "--diff")
+        options.Diff = true;
+      else if (arg == "--bench")
+        options.Run = Command::Bench;
+      else if (arg == "--fuzz")
+        options.Run = Command::Fuzz;
+      else if (arg == "--threads" && hasValue)
+        options.Threads = static_cast<unsigned int>(strtoul(argv[++i], nullptr, 10));
+      else if (arg == "--size" && hasValue)
+        options.SizeMB = strtoul(argv[++i], nullptr, 10);
+      else if (arg == "--repeats" && hasValue)
+        options.Repeats = static_cast<int>(strtol(argv[++i], nullptr, 10));
+      else if (arg == "--seed" && hasValue)
+        options.Seed = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+      else if (arg == "--iterations" && hasValue)
+        options.Iterations = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+      else if (!arg.empty() && arg[0] != '-' && options.Path.empty())
+        options.Path = arg;
+      else
+        return false;
+    }
+
+    if (options.Repeats < 1 || (options.SizeMB && options.SizeMB < 1))
+      return false;
+    return options.Run != Command::Resolve || !options.Path.empty();
+  }
+
+  bool ReadFile(std::string const& path, std::vector<uint8_t>& data)
+  {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+      return false;
+
+    data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return true;
+  }
+
+  struct Resolved
+  {
+    util::offsets::OffsetId Id;
+    bool Scanned{ false };
+    util::offsets::ResolveStatus Status{ util::offsets::ResolveStatus::NotFound };
+    uint32_t Rva{ 0 };
+  };
+}
+
+int main(int argc, char** argv)
+{
+  using namespace util::offsets;
+
+  Options options;
+  if (!ParseArgs(argc, argv, options))
+  {
+    PrintUsage();
+    return 2;
+  }
+
+  if (options.Run == Command::Bench)
+  {
+    BenchOptions bench;
+    bench.Path = options.Path;
+    bench.SizeMB = options.SizeMB;
+    bench.Repeats = options.Repeats;
+    bench.Threads = options.Threads;
+    bench.Seed = options.Seed;
+    return RunBench(bench);
+  }
+
+  if (options.Run == Command::Fuzz)
+  {
+    FuzzOptions fuzz;
+    fuzz.Seed = options.Seed;
+    fuzz.Iterations = options.Iterations;
+    return RunFuzz(fuzz);
+  }
+
+  std::vector<uint8_t> file;
+  if (!ReadFile(options.Path, file))
+  {
+    fprintf(stderr, "Could not read %s\n", options.Path.c_str());
+    return 2;
+  }
+
+  util::PEImage image;
+  std::vector<uint8_t> mapped;
+  if (!image.Parse(file.data(), file.size(), false) || !image.Map(file.data(), file.size(), mapped))
+  {
+    fprintf(stderr, "%s isn't a valid PE image\n", options.Path.c_str());
+    return 2;
+  }
+
+  if (image.Is64Bit())
+    fprintf(stderr, "Warning: %s is a 64-bit image, the signatures are for the 32-bit game\n", options.Path.c_str());
+
+  // The file isn't relocated, so its code refers to the preferred base
+  uintptr_t moduleBase = static_cast<uintptr_t>(image.GetImageBase());
+
+  std::vector<SigScanner::Range> ranges;
+  for (util::PESection const& section : image.GetSections())
+  {
+    if (section.IsExecutable())
+      ranges.push_back({ section.VirtualAddress, section.VirtualSize });
+  }
+  if (ranges.empty())
+    ranges.push_back({ 0, mapped.size() });
+
+  size_t sigCount = 0;
+  OffsetSignature const* pSigs = GetSignatures(sigCount);
+  SigScanner scanner;
+  for (size_t i = 0; i < sigCount; ++i)
+    scanner.Add(pSigs[i].Pattern);
+
+  std::vector<uint8_t const*> matches;
+  scanner.ScanRanges(mapped.data(), ranges, matches, options.Threads);
+
+  std::vector<Resolved> offsets(OffsetCount);
+  for (int i = 0; i < OffsetCount; ++i)
+    offsets[i].Id = static_cast<OffsetId>(i);
+
+  for (size_t i = 0; i < sigCount; ++i)
+  {
+    Resolved& offset = offsets[pSigs[i].Id];
+    uintptr_t result = 0;
+    offset.Scanned = true;
+    offset.Status = ResolveMatch(image, mapped.data(), moduleBase, matches[i], pSigs[i], result);
+    offset.Rva = result >= moduleBase ? static_cast<uint32_t>(result - moduleBase) : 0;
+  }
+
+  // The last write time depends on where the file was copied to, so
+  // only the parts that identify the build are printed
+  ImageFingerprint fingerprint;
+  GetFingerprint(image, file.size(), 0, fingerprint);
+  printf("Image       %s\n", options.Path.c_str());
+  printf("Fingerprint %08X %08X %08X %llX\n", fingerprint.TimeDateStamp, fingerprint.CheckSum,
+    fingerprint.SizeOfImage, static_cast<unsigned long long>(fingerprint.FileSize));
+  printf("Image base  0x%llX\n\n", static_cast<unsigned long long>(image.GetImageBase()));
+
+  int failed = 0;
+  int differing = 0;
+  printf("%-28s %-10s %-10s %s\n", "Offset", "Resolved", "Hardcoded", "Status");
+  for (Resolved const& offset : offsets)
+  {
+    uint32_t hardcoded = GetHardcoded(offset.Id);
+    bool ok = offset.Scanned && offset.Status == ResolveStatus::Ok;
+    bool differs = ok && offset.Rva != hardcoded;
+
+    failed += (offset.Scanned && !ok);
+    differing += differs;
+
+    if (options.Diff && !differs && ok)
+      continue;
+    if (options.Diff && !offset.Scanned)
+      continue;
+
+    char resolved[16] = "-";
+    if (ok)
+      snprintf(resolved, sizeof(resolved), "0x%X", offset.Rva);
+
+    const char* status = !offset.Scanned ? "Not scanned"
+      : !ok ? ToString(offset.Status)
+      : differs ? "Differs"
+      : "Matches";
+
+    printf("%-28s %-10s 0x%-8X %s\n", GetName(offset.Id), resolved, hardcoded, status);
+  }
+
+  printf("\n%d scanned, %d not found, %d differ from the hardcoded offsets\n",
+    static_cast<int>(sigCount), failed, differing);
+
+  return (failed || (options.Diff && differing)) ? 1 : 0;
+}
@@ -0,0 +1,430 @@
+#include "Bench.h"
+#include "Check.h"
+
+#include "ActionPipeline.h"
+#include "VirtualInputBackend.h"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+namespace
+{
+  // Virtual key codes, the tests don't include Windows.h
+  const int g_vkShift = 0x10;
+  const int g_vkControl = 0x11;
+  const int g_vkSpace = 0x20;
+  const int g_vkA = 'A';
+  const int g_vkD = 'D';
+  const int g_vkS = 'S';
+  const int g_vkW = 'W';
+
+  // 1/64 s, exact in binary so the repeat timing can be checked to the tick
+  const float g_dt = 1.f / 64;
+
+  KeyMask Keys(std::initializer_list<int> codes)
+  {
+    KeyMask mask;
+    for (int code : codes)
+      mask.Set(code);
+    return mask;
+  }
+
+  // What InputSystem::UpdateActions does each tick, on a virtual backend
+  struct Rig
+  {
+    VirtualInputBackend Backend;
+    BindingTable Bindings{ Action::ActionCount };
+    ActionPipeline Pipeline;
+    std::array<uint32_t, 8> Latched{};
+    std::array<AxisResponse, GamepadKey::GamepadKey_Count> Responses;
+    std::array<GamepadKey, Action::ActionCount> PadBindings{};
+    bool UsePad{ false };
+    bool IsActive{ false };
+
+    void Latch(int vkey)
+    {
+      Latched[vkey >> 5] |= 1u << (vkey & 31);
+    }
+
+    std::vector<ActionEvent> const& Tick()
+    {
+      Backend.Advance();
+
+      KeyMask down;
+      ActionPipeline::ReadKeyboard(Backend, Bindings.GetUsedKeys(), Latched.data(), down);
+      Latched.fill(0);
+
+      float padKeyStates[GamepadKey::GamepadKey_Count] = {};
+      GamepadState state;
+      if (UsePad && Backend.PollGamepad(state))
+      {
+        ActionPipeline::ShapeGamepad(state, Responses.data(), padKeyStates);
+        ActionPipeline::AddPadKeys(padKeyStates, down);
+      }
+
+      IsActive = Pipeline.Update(g_dt, Bindings, down,
+        UsePad ? PadBindings.data() : nullptr, UsePad ? padKeyStates : nullptr);
+      return Pipeline.GetEvents();
+    }
+
+    float Wanted(Action action) const { return Pipeline.GetWantedStates()[action]; }
+  };
+
+  int CountEvents(std::vector<ActionEvent> const& events, Action action, ActionEventType type)
+  {
+    return static_cast<int>(std::count_if(events.begin(), events.end(),
+      [&](ActionEvent const& e) { return e.ActionId == action && e.Type == type; }));
+  }
+}
+
+TEST(Pipeline_BindingResolution)
+{
+  Rig rig;
+  rig.Bindings.Add(Action::Camera_Forward, Keys({ g_vkW }));
+  rig.Bindings.Add(Action::Camera_Left, Keys({ g_vkA }));
+  // Two bindings for one action, either one triggers it
+  rig.Bindings.Add(Action::Camera_Up, Keys({ g_vkSpace }));
+  rig.Bindings.Add(Action::Camera_Up, Keys({ g_vkD }));
+  CHECK(rig.Bindings.Finalize().empty());
+  CHECK(rig.Bindings.GetBindingCount(Action::Camera_Up) == 2);
+
+  KeyMask used = rig.Bindings.GetUsedKeys();
+  CHECK(used.Test(g_vkW) && used.Test(g_vkA) && used.Test(g_vkSpace) && used.Test(g_vkD));
+  CHECK(used.Count() == 4);
+
+  rig.Backend.PressKey(1, g_vkW);
+  rig.Backend.PressKey(2, g_vkD);
+  rig.Backend.ReleaseKey(3, g_vkW);
+  rig.Backend.ReleaseKey(3, g_vkD);
+  // Not bound, must not be polled or trigger anything
+  rig.Backend.PressKey(4, g_vkS);
+
+  rig.Tick();
+  CHECK(rig.Wanted(Action::Camera_Forward) == 0.f);
+  CHECK(!rig.IsActive);
+
+  rig.Tick();
+  CHECK(rig.Wanted(Action::Camera_Forward) == 1.f);
+  CHECK(rig.Wanted(Action::Camera_Left) == 0.f);
+  CHECK(rig.Wanted(Action::Camera_Up) == 0.f);
+
+  rig.Tick();
+  CHECK(rig.Wanted(Action::Camera_Forward) == 1.f);
+  CHECK(rig.Wanted(Action::Camera_Up) == 1.f);
+
+  rig.Tick();
+  CHECK(rig.Wanted(Action::Camera_Forward) == 0.f);
+  CHECK(rig.Wanted(Action::Camera_Up) == 0.f);
+
+  rig.Tick();
+  for (int i = 0; i < Action::ActionCount; ++i)
+    CHECK(rig.Wanted(static_cast<Action>(i)) == 0.f);
+}
+
+TEST(Pipeline_BindingConflicts)
+{
+  BindingTable bindings(Action::ActionCount);
+  CHECK(bindings.Add(Action::Track_Play, Keys({ g_vkControl, g_vkSpace })));
+  CHECK(bindings.Add(Action::Track_CreateNode, Keys({ g_vkSpace, g_vkControl })));
+  CHECK(!bindings.Add(Action::Track_DeleteNode, KeyMask()));
+  for (int i = 0; i < BindingTable::MaxBindingsPerAction; ++i)
+    CHECK(bindings.Add(Action::ToggleHUD, Keys({ 'H', 'J' + i })));
+  CHECK(!bindings.Add(Action::ToggleHUD, Keys({ 'Z' })));
+
+  std::vector<BindingConflict> conflicts = bindings.Finalize();
+  CHECK(conflicts.size() == 1);
+  if (conflicts.size() == 1)
+  {
+    int a = (std::min)(conflicts[0].ActionA, conflicts[0].ActionB);
+    int b = (std::max)(conflicts[0].ActionA, conflicts[0].ActionB);
+    CHECK(a == Action::Track_CreateNode && b == Action::Track_Play);
+    CHECK(conflicts[0].Keys == Keys({ g_vkControl, g_vkSpace }));
+  }
+}
+
+TEST(Pipeline_ChordSuppression)
+{
+  Rig rig;
+  rig.Bindings.Add(Action::Camera_Forward, Keys({ g_vkW }));
+  rig.Bindings.Add(Action::ToggleCamera, Keys({ g_vkControl, g_vkW }));
+  rig.Bindings.Add(Action::ToggleHUD, Keys({ g_vkControl, g_vkShift, g_vkW }));
+  rig.Bindings.Add(Action::Camera_Left, Keys({ g_vkA }));
+  CHECK(rig.Bindings.Finalize().empty());
+
+  // W alone
+  rig.Backend.PressKey(0, g_vkW);
+  rig.Tick();
+  CHECK(rig.Wanted(Action::Camera_Forward) == 1.f);
+  CHECK(rig.Wanted(Action::ToggleCamera) == 0.f);
+
+  // Ctrl + W hides plain W
+  rig.Backend.PressKey(1, g_vkControl);
+  std::vector<ActionEvent> events = rig.Tick();
+  CHECK(rig.Wanted(Action::Camera_Forward) == 0.f);
+  CHECK(rig.Wanted(Action::ToggleCamera) == 1.f);
+  CHECK(CountEvents(events, Action::Camera_Forward, ActionEventType::Released) == 1);
+  CHECK(CountEvents(events, Action::ToggleCamera, ActionEventType::Pressed) == 1);
+
+  // An unrelated key held with the chord isn't suppressed
+  rig.Backend.PressKey(2, g_vkA);
+  rig.Tick();
+  CHECK(rig.Wanted(Action::ToggleCamera) == 1.f);
+  CHECK(rig.Wanted(Action::Camera_Left) == 1.f);
+
+  // Ctrl + Shift + W hides both smaller chords
+  rig.Backend.PressKey(3, g_vkShift);
+  rig.Tick();
+  CHECK(rig.Wanted(Action::ToggleHUD) == 1.f);
+  CHECK(rig.Wanted(Action::ToggleCamera) == 0.f);
+  CHECK(rig.Wanted(Action::Camera_Forward) == 0.f);
+  CHECK(rig.Wanted(Action::Camera_Left) == 1.f);
+
+  // Ctrl + Shift without W matches nothing
+  rig.Backend.ReleaseKey(4, g_vkW);
+  rig.Tick();
+  CHECK(rig.Wanted(Action::ToggleHUD) == 0.f);
+  CHECK(rig.Wanted(Action::ToggleCamera) == 0.f);
+  CHECK(rig.Wanted(Action::Camera_Forward) == 0.f);
+
+  // Back to W alone once the modifiers are let go
+  rig.Backend.ReleaseKey(5, g_vkControl);
+  rig.Backend.ReleaseKey(5, g_vkShift);
+  rig.Backend.PressKey(5, g_vkW);
+  rig.Tick();
+  CHECK(rig.Wanted(Action::Camera_Forward) == 1.f);
+}
+
+TEST(Pipeline_HotkeyEdges)
+{
+  Rig rig;
+  rig.Bindings.Add(Action::Track_Play, Keys({ g_vkSpace }));
+  rig.Bindings.Finalize();
+
+  // Held for two seconds
+  const int holdTicks = 128;
+  rig.Backend.PressKey(0, g_vkSpace);
+  rig.Backend.ReleaseKey(holdTicks, g_vkSpace);
+
+  std::vector<int> repeatTicks;
+  int pressed = 0;
+  for (int tick = 0; tick < holdTicks; ++tick)
+  {
+    std::vector<ActionEvent> const& events = rig.Tick();
+    CHECK(events.size() <= 1);
+    pressed += CountEvents(events, Action::Track_Play, ActionEventType::Pressed);
+    CHECK(CountEvents(events, Action::Track_Play, ActionEventType::Released) == 0);
+    if (CountEvents(events, Action::Track_Play, ActionEventType::Repeat))
+      repeatTicks.push_back(tick);
+    if (tick == 0)
+      CHECK(pressed == 1);
+  }
+  CHECK(pressed == 1);
+
+  // First repeat after 0.5 s, then one every 0.1 s. 0.1 isn't a whole
+  // number of ticks, so the gaps are 6 or 7 ticks.
+  CHECK(!repeatTicks.empty());
+  if (!repeatTicks.empty())
+    CHECK(repeatTicks[0] == 32);
+  for (size_t i = 1; i < repeatTicks.size(); ++i)
+  {
+    int gap = repeatTicks[i] - repeatTicks[i - 1];
+    CHECK(gap == 6 || gap == 7);
+  }
+  CHECK(repeatTicks.size() == 15);
+
+  // Released once, then the smoothed state fades out over 0.2 s
+  std::vector<ActionEvent> events = rig.Tick();
+  CHECK(events.size() == 1);
+  CHECK(CountEvents(events, Action::Track_Play, ActionEventType::Released) == 1);
+  CHECK(rig.IsActive);
+
+  int fadeTicks = 1;
+  while (rig.IsActive && fadeTicks < 64)
+  {
+    CHECK(rig.Tick().empty());
+    ++fadeTicks;
+  }
+  CHECK(!rig.IsActive);
+  // 0.2 s is 12.8 ticks
+  CHECK(fadeTicks == 13);
+
+  // A new press starts a new repeat delay
+  rig.Backend.PressKey(rig.Backend.GetTick(), g_vkSpace);
+  events = rig.Tick();
+  CHECK(CountEvents(events, Action::Track_Play, ActionEventType::Pressed) == 1);
+  for (int tick = 1; tick < 32; ++tick)
+    CHECK(rig.Tick().empty());
+  CHECK(CountEvents(rig.Tick(), Action::Track_Play, ActionEventType::Repeat) == 1);
+}
+
+TEST(Pipeline_LatchedPress)
+{
+  // A key pressed and released between two ticks still counts once
+  Rig rig;
+  rig.Bindings.Add(Action::ToggleUI, Keys({ g_vkD }));
+  rig.Bindings.Add(Action::ToggleHUD, Keys({ g_vkControl, g_vkD }));
+  rig.Bindings.Finalize();
+
+  rig.Tick();
+  rig.Latch(g_vkD);
+  std::vector<ActionEvent> events = rig.Tick();
+  CHECK(CountEvents(events, Action::ToggleUI, ActionEventType::Pressed) == 1);
+
+  events = rig.Tick();
+  CHECK(CountEvents(events, Action::ToggleUI, ActionEventType::Released) == 1);
+
+  // A latched key completes a chord with a held one
+  rig.Backend.SetKey(g_vkControl, true);
+  rig.Latch(g_vkD);
+  events = rig.Tick();
+  CHECK(CountEvents(events, Action::ToggleHUD, ActionEventType::Pressed) == 1);
+  CHECK(CountEvents(events, Action::ToggleUI, ActionEventType::Pressed) == 0);
+
+  // Latched keys no binding uses are ignored
+  rig.Backend.SetKey(g_vkControl, false);
+  rig.Latch(g_vkS);
+  rig.Tick();
+  CHECK(rig.Tick().empty());
+}
+
+TEST(Pipeline_Gamepad)
+{
+  Rig rig;
+  rig.UsePad = true;
+  rig.Bindings.Add(Action::Track_CreateNode, Keys({ KeyMask::PadKeyBase + GamepadKey::Button1 }));
+  rig.Bindings.Add(Action::Track_DeleteNode, Keys({ KeyMask::PadKeyBase + GamepadKey::LeftShoulder, KeyMask::PadKeyBase + GamepadKey::Button1 }));
+  rig.Bindings.Finalize();
+  rig.PadBindings[Action::Camera_Forward] = GamepadKey::LeftThumb_YPos;
+  rig.PadBindings[Action::Camera_Right] = GamepadKey::LeftThumb_XPos;
+
+  AxisResponseSettings stick;
+  stick.Deadzone = 0.25f;
+  for (int key = GamepadKey::LeftThumb_XPos; key <= GamepadKey::LeftThumb_YNeg; ++key)
+    rig.Responses[key].Build(stick);
+
+  // No pad yet
+  rig.Tick();
+  CHECK(!rig.IsActive);
+
+  // Inside the radial deadzone
+  GamepadState state;
+  state.LeftX = 0.15f;
+  state.LeftY = 0.15f;
+  rig.Backend.SetGamepadAt(1, state);
+  rig.Tick();
+  CHECK(rig.Wanted(Action::Camera_Forward) == 0.f);
+  CHECK(rig.Wanted(Action::Camera_Right) == 0.f);
+
+  // Full up stays analog
+  state.LeftX = 0.f;
+  state.LeftY = 1.f;
+  rig.Backend.SetGamepadAt(2, state);
+  rig.Tick();
+  CHECK(rig.Wanted(Action::Camera_Forward) == 1.f);
+  CHECK(rig.Wanted(Action::Camera_Right) == 0.f);
+
+  // Diagonal, split by direction
+  state.LeftX = 0.6f;
+  state.LeftY = 0.6f;
+  rig.Backend.SetGamepadAt(3, state);
+  rig.Tick();
+  float forward = rig.Wanted(Action::Camera_Forward);
+  CHECK(forward > 0.f && forward < 1.f);
+  CHECK(forward == rig.Wanted(Action::Camera_Right));
+
+  // Buttons go through the binding table, with chords
+  state = GamepadState();
+  state.SetButton(GamepadKey::Button1, true);
+  rig.Backend.SetGamepadAt(4, state);
+  rig.Tick();
+  CHECK(rig.Wanted(Action::Track_CreateNode) == 1.f);
+  CHECK(rig.Wanted(Action::Camera_Forward) == 0.f);
+
+  state.SetButton(GamepadKey::LeftShoulder, true);
+  rig.Backend.SetGamepadAt(5, state);
+  rig.Tick();
+  CHECK(rig.Wanted(Action::Track_DeleteNode) == 1.f);
+  CHECK(rig.Wanted(Action::Track_CreateNode) == 0.f);
+}
+
+namespace
+{
+  // Every action bound to a key, plus a chord on every fourth action,
+  // which is about what a heavily customized config looks like
+  void BindAll(Rig& rig)
+  {
+    for (int action = 0; action < Action::ActionCount; ++action)
+    {
+      rig.Bindings.Add(action, Keys({ 0x30 + action }));
+      if (action % 4 == 0)
+        rig.Bindings.Add(action, Keys({ g_vkControl, 0x30 + (action + 1) % Action::ActionCount }));
+      rig.PadBindings[action] = static_cast<GamepadKey>(action % GamepadKey::GamepadKey_Count);
+    }
+    rig.Bindings.Finalize();
+    rig.UsePad = true;
+  }
+
+  // Random presses, releases and stick movement every few ticks
+  void Script(Rig& rig, uint32_t ticks, uint32_t seed)
+  {
+    std::mt19937 rng(seed);
+    for (uint32_t tick = 0; tick < ticks; tick += 1 + rng() % 8)
+    {
+      int vkey = rng() % 3 == 0 ? g_vkControl : 0x30 + static_cast<int>(rng() % Action::ActionCount);
+      if (rng() % 2)
+        rig.Backend.PressKey(tick, vkey);
+      else
+        rig.Backend.ReleaseKey(tick, vkey);
+
+      if (rng() % 4 == 0)
+      {
+        GamepadState state;
+        state.LeftX = static_cast<float>(rng() % 2001) / 1000.f - 1.f;
+        state.LeftY = static_cast<float>(rng() % 2001) / 1000.f - 1.f;
+        state.Triggers = static_cast<float>(rng() % 2001) / 1000.f - 1.f;
+        state.Buttons = rng() & (((1u << GamepadKey::GamepadKey_Count) - 1) & ~((1u << GamepadKey::LeftThumb) - 1));
+        rig.Backend.SetGamepadAt(tick, state);
+      }
+    }
+  }
+}
+
+int RunPipelineBench(BenchOptions const& options)
+{
+  printf("%u ticks per run, %d actions, median of %d runs\n", options.Ticks, static_cast<int>(Action::ActionCount), options.Repeats);
+
+  std::vector<double> rates;
+  uint64_t expectedEvents = 0;
+  bool mismatch = false;
+  for (int run = 0; run < options.Repeats; ++run)
+  {
+    Rig rig;
+    BindAll(rig);
+    Script(rig, options.Ticks, options.Seed);
+
+    uint64_t events = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t tick = 0; tick < options.Ticks; ++tick)
+      events += rig.Tick().size();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    rates.push_back(options.Ticks / seconds);
+    if (run == 0)
+      expectedEvents = events;
+    else if (events != expectedEvents)
+      mismatch = true;
+  }
+
+  std::sort(rates.begin(), rates.end());
+  double median = rates[rates.size() / 2];
+  printf("ActionPipeline tick      %12.0f ticks/s   %8.1f ns/tick   %llu events\n",
+    median, 1e9 / median, static_cast<unsigned long long>(expectedEvents));
+
+  if (mismatch)
+  {
+    printf("Runs produced different events, the pipeline isn't deterministic\n");
+    return 1;
+  }
+  return 0;
+}
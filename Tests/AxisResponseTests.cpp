@@ -0,0 +1,269 @@
+#include "Check.h"
+
+#include "ActionPipeline.h"
+#include "AxisResponse.h"
+
+#include <cmath>
+#include <limits>
+
+namespace
+{
+  const int g_steps = 20000;
+
+  const float g_deadzones[] = { 0.f, 0.239f, 0.5f, 0.9f };
+  const float g_exponents[] = { 0.1f, 0.5f, 1.f, 1.5f, 2.f, 3.f, 4.f, 10.f };
+  const float g_sCurves[] = { 0.f, 0.5f, 1.f };
+  const float g_antiDeadzones[] = { 0.f, 0.2f, 1.f };
+
+  // Calls fn for every combination of the settings above
+  template<typename Fn>
+  void ForEachSettings(Fn fn)
+  {
+    for (float deadzone : g_deadzones)
+    {
+      for (float exponent : g_exponents)
+      {
+        for (float sCurve : g_sCurves)
+        {
+          for (float antiDeadzone : g_antiDeadzones)
+          {
+            AxisResponseSettings settings;
+            settings.Deadzone = deadzone;
+            settings.Exponent = exponent;
+            settings.SCurve = sCurve;
+            settings.AntiDeadzone = antiDeadzone;
+            settings.Sensitivity = 1.5f;
+            fn(settings);
+          }
+        }
+      }
+    }
+  }
+
+  // Worst case of the linear interpolation between table entries. The
+  // error grows with the curvature, so with the exponent.
+  float TableTolerance(float exponent)
+  {
+    if (exponent <= 2.f)
+      return 0.0015f;
+    if (exponent <= 4.f)
+      return 0.006f;
+    return 0.03f;
+  }
+
+  float Above(float x)
+  {
+    return std::nextafter(x, 2.f);
+  }
+}
+
+TEST(Axis_TableMatchesEvaluate)
+{
+  ForEachSettings([](AxisResponseSettings const& settings)
+  {
+    AxisResponse response(settings);
+    float tolerance = TableTolerance(settings.Exponent) * settings.Sensitivity;
+
+    float worst = 0.f;
+    for (int i = 0; i <= g_steps; ++i)
+    {
+      float input = static_cast<float>(i) / g_steps;
+      float error = std::fabs(response.Apply(input) - AxisResponse::Evaluate(response.GetSettings(), input));
+      worst = (std::max)(worst, error);
+    }
+
+    // Below 1 the curve is evaluated directly
+    if (settings.Exponent < 1.f)
+      CHECK(worst == 0.f);
+    else
+      CHECK(worst <= tolerance);
+  });
+}
+
+TEST(Axis_DeadzoneEdge)
+{
+  ForEachSettings([](AxisResponseSettings const& settings)
+  {
+    AxisResponse response(settings);
+    float deadzone = response.GetSettings().Deadzone;
+
+    // The edge itself is still inside
+    CHECK(response.Apply(deadzone) == 0.f);
+    CHECK(AxisResponse::Evaluate(response.GetSettings(), deadzone) == 0.f);
+    if (deadzone > 0.f)
+      CHECK(response.Apply(deadzone * 0.5f) == 0.f);
+
+    // Right outside it the output jumps to the anti-deadzone, not a ramp
+    float step = settings.AntiDeadzone * settings.Sensitivity;
+    float outside = response.Apply(Above(deadzone));
+    CHECK(outside >= step);
+    if (settings.Exponent >= 1.f)
+      CHECK(outside - step < 1e-4f);
+  });
+}
+
+TEST(Axis_RadialDeadzoneEdge)
+{
+  // Sticks use the distance from the center, not each axis on its own.
+  // 0.375, 0.5 is exactly 0.625 from the center.
+  std::array<AxisResponse, GamepadKey::GamepadKey_Count> responses;
+  AxisResponseSettings stick;
+  stick.Deadzone = 0.625f;
+  for (int key = GamepadKey::LeftThumb_XPos; key <= GamepadKey::RightThumb_YNeg; ++key)
+    responses[key].Build(stick);
+
+  float states[GamepadKey::GamepadKey_Count] = {};
+  GamepadState state;
+  state.LeftX = 0.375f;
+  state.LeftY = 0.5f;
+  state.RightX = -0.625f;
+  ActionPipeline::ShapeGamepad(state, responses.data(), states);
+  for (int key = GamepadKey::LeftThumb_XPos; key <= GamepadKey::RightThumb_YNeg; ++key)
+    CHECK(states[key] == 0.f);
+
+  // Each axis alone is inside the deadzone, together they're outside
+  float statesOut[GamepadKey::GamepadKey_Count] = {};
+  state.LeftX = 0.45f;
+  state.LeftY = 0.45f;
+  state.RightX = -0.63f;
+  ActionPipeline::ShapeGamepad(state, responses.data(), statesOut);
+  CHECK(statesOut[GamepadKey::LeftThumb_XPos] > 0.f);
+  CHECK(statesOut[GamepadKey::LeftThumb_YPos] > 0.f);
+  CHECK(statesOut[GamepadKey::LeftThumb_XPos] == statesOut[GamepadKey::LeftThumb_YPos]);
+  CHECK(statesOut[GamepadKey::LeftThumb_XNeg] == 0.f);
+  CHECK(statesOut[GamepadKey::RightThumb_XNeg] > 0.f);
+  CHECK(statesOut[GamepadKey::RightThumb_XPos] == 0.f);
+}
+
+TEST(Axis_AntiDeadzone)
+{
+  AxisResponseSettings settings;
+  settings.Deadzone = 0.2f;
+  settings.AntiDeadzone = 0.3f;
+  settings.Exponent = 2.f;
+  settings.Sensitivity = 2.f;
+  AxisResponse response(settings);
+
+  // The output range outside the deadzone is AntiDeadzone - 1, scaled
+  // by the sensitivity
+  CHECK(std::fabs(response.Apply(Above(0.2f)) - 0.6f) < 1e-4f);
+  CHECK(response.Apply(1.f) == 2.f);
+  for (int i = 1; i <= g_steps; ++i)
+  {
+    float input = 0.2f + 0.8f * i / g_steps;
+    CHECK(response.Apply(input) >= 0.6f - 1e-6f);
+  }
+
+  // Halfway through the rest, 0.3 + 0.7 * 0.5^2
+  CHECK(std::fabs(AxisResponse::Evaluate(response.GetSettings(), 0.6f) - 2.f * 0.475f) < 1e-5f);
+  CHECK(std::fabs(response.Apply(0.6f) - 2.f * 0.475f) < 1e-3f);
+
+  // A full anti-deadzone makes the axis a button
+  settings.AntiDeadzone = 1.f;
+  response.Build(settings);
+  CHECK(response.Apply(0.2f) == 0.f);
+  CHECK(response.Apply(Above(0.2f)) == 2.f);
+  CHECK(response.Apply(0.5f) == 2.f);
+}
+
+TEST(Axis_Monotonic)
+{
+  ForEachSettings([](AxisResponseSettings const& settings)
+  {
+    AxisResponse response(settings);
+
+    // Where the S-curve flattens out near full input, float rounding
+    // can make it dip by an ulp
+    float slack = 2.f * std::numeric_limits<float>::epsilon() * settings.Sensitivity;
+
+    bool tableMonotonic = true;
+    bool curveMonotonic = true;
+    bool nonNegative = true;
+    float lastTable = 0.f;
+    float lastCurve = 0.f;
+    for (int i = 0; i <= g_steps; ++i)
+    {
+      float input = static_cast<float>(i) / g_steps;
+      float table = response.Apply(input);
+      float curve = AxisResponse::Evaluate(response.GetSettings(), input);
+      tableMonotonic &= table >= lastTable - slack;
+      curveMonotonic &= curve >= lastCurve - slack;
+      nonNegative &= table >= 0.f && curve >= 0.f;
+      lastTable = table;
+      lastCurve = curve;
+    }
+    CHECK(tableMonotonic);
+    CHECK(curveMonotonic);
+    CHECK(nonNegative);
+
+    // Every curve ends at the sensitivity
+    CHECK(std::fabs(lastTable - settings.Sensitivity) < 1e-5f);
+  });
+
+  // The S-curve is flatter than linear near both ends and steeper in
+  // the middle
+  AxisResponseSettings settings;
+  settings.SCurve = 1.f;
+  CHECK(AxisResponse::Evaluate(settings, 0.1f) < 0.1f);
+  CHECK(AxisResponse::Evaluate(settings, 0.9f) > 0.9f);
+  CHECK(std::fabs(AxisResponse::Evaluate(settings, 0.5f) - 0.5f) < 1e-6f);
+}
+
+TEST(Axis_Clamping)
+{
+  AxisResponseSettings settings;
+  settings.Deadzone = 0.1f;
+  settings.AntiDeadzone = 0.1f;
+  settings.Exponent = 3.f;
+  settings.SCurve = 0.5f;
+  settings.Sensitivity = 1.25f;
+  AxisResponse response(settings);
+
+  // Past full deflection the output stays at the end of the curve
+  CHECK(response.Apply(1.f) == 1.25f);
+  CHECK(response.Apply(1.5f) == 1.25f);
+  CHECK(response.Apply(std::numeric_limits<float>::infinity()) == 1.25f);
+  CHECK(AxisResponse::Evaluate(response.GetSettings(), 4.f) == 1.25f);
+
+  // Negative input and NaN are treated as centered
+  CHECK(response.Apply(-1.f) == 0.f);
+  CHECK(response.Apply(std::numeric_limits<float>::quiet_NaN()) == 0.f);
+  CHECK(AxisResponse::Evaluate(response.GetSettings(), std::numeric_limits<float>::quiet_NaN()) == 0.f);
+
+  // Hand edited settings are pulled back into range
+  AxisResponseSettings wild;
+  wild.Deadzone = 2.f;
+  wild.AntiDeadzone = -1.f;
+  wild.Exponent = 0.f;
+  wild.SCurve = 3.f;
+  response.Build(wild);
+  CHECK(response.GetSettings().Deadzone == 0.99f);
+  CHECK(response.GetSettings().AntiDeadzone == 0.f);
+  CHECK(response.GetSettings().Exponent == 0.1f);
+  CHECK(response.GetSettings().SCurve == 1.f);
+  CHECK(response.Apply(1.f) == 1.f);
+
+  // Sticks pushed past the rim and triggers past ±1 give full output
+  std::array<AxisResponse, GamepadKey::GamepadKey_Count> responses;
+  for (AxisResponse& key : responses)
+    key.Build(settings);
+
+  float states[GamepadKey::GamepadKey_Count] = {};
+  GamepadState state;
+  state.LeftX = 3.f;
+  state.RightY = -1.2f;
+  state.Triggers = -1.5f;
+  ActionPipeline::ShapeGamepad(state, responses.data(), states);
+  CHECK(states[GamepadKey::LeftThumb_XPos] == 1.25f);
+  CHECK(states[GamepadKey::LeftThumb_YPos] == 0.f);
+  CHECK(states[GamepadKey::RightThumb_YNeg] == 1.25f);
+  CHECK(states[GamepadKey::LeftTrigger] == 1.25f);
+  CHECK(states[GamepadKey::RightTrigger] == 0.f);
+
+  float triggerStates[GamepadKey::GamepadKey_Count] = {};
+  state = GamepadState();
+  state.Triggers = 1.f;
+  ActionPipeline::ShapeGamepad(state, responses.data(), triggerStates);
+  CHECK(triggerStates[GamepadKey::RightTrigger] == 1.25f);
+  CHECK(triggerStates[GamepadKey::LeftTrigger] == 0.f);
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include <cstdint>
+
+struct BenchOptions
+{
+  uint32_t Ticks{ 2000000 };
+  int Repeats{ 5 };
+  uint32_t Seed{ 1 };
+};
+
+// Runs ActionPipeline ticks on a VirtualInputBackend with a full set of
+// bindings and scripted key and gamepad input, and prints ticks per
+// second. Returns 1 if the runs don't all produce the same events.
+int RunPipelineBench(BenchOptions const& options);
@@ -0,0 +1,29 @@
+#pragma once
+#include <cstdio>
+#include <vector>
+
+// Just enough of a test framework for the portable parts of the tools.
+// TEST(Name) registers a function that main() runs, CHECK(expr) records
+// a failure and keeps going so one run lists everything that's wrong.
+
+struct TestCase
+{
+  const char* Name;
+  void(*Run)();
+};
+
+std::vector<TestCase>& GetTests();
+void ReportFailure(const char* file, int line, const char* expression);
+
+struct TestRegistrar
+{
+  TestRegistrar(const char* name, void(*run)()) { GetTests().push_back(TestCase{ name, run }); }
+};
+
+#define TEST(name) \
+  static void name(); \
+  static TestRegistrar name##_registrar(#name, name); \
+  static void name()
+
+#define CHECK(expression) \
+  do { if (!(expression)) ReportFailure(__FILE__, __LINE__, #expression); } while (0)
@@ -0,0 +1,231 @@
+#include "Check.h"
+
+#include "IniFile.h"
+#include "INIReader.h"
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+namespace
+{
+  const char* g_iniPath = "IniFileTests.ini";
+
+  struct Query
+  {
+    const char* Section;
+    const char* Name;
+  };
+
+  void WriteFile(std::string const& content)
+  {
+    std::ofstream file(g_iniPath, std::ios::binary | std::ios::trunc);
+    file << content;
+  }
+
+  // Loads the content with both readers and compares every getter for
+  // every query, with defaults that can't be mistaken for a parsed value
+  bool MatchesINIReader(std::string const& content, std::initializer_list<Query> queries)
+  {
+    WriteFile(content);
+    util::IniFile ini(g_iniPath);
+    INIReader reader(g_iniPath);
+    std::remove(g_iniPath);
+
+    bool same = ini.ParseError() == reader.ParseError();
+    for (Query const& query : queries)
+    {
+      same &= ini.Get(query.Section, query.Name, "<none>") == reader.Get(query.Section, query.Name, "<none>");
+      same &= ini.GetInteger(query.Section, query.Name, -77) == reader.GetInteger(query.Section, query.Name, -77);
+      same &= ini.GetReal(query.Section, query.Name, -0.5) == reader.GetReal(query.Section, query.Name, -0.5);
+      same &= ini.GetBoolean(query.Section, query.Name, true) == reader.GetBoolean(query.Section, query.Name, true);
+      same &= ini.GetBoolean(query.Section, query.Name, false) == reader.GetBoolean(query.Section, query.Name, false);
+    }
+    return same;
+  }
+}
+
+TEST(Ini_Values)
+{
+  std::string content =
+    "[Camera]\n"
+    "Name = Default\n"
+    "FieldOfView = 50.5\n"
+    "MovementSpeed=1.000000\n"
+    "RotationSpeed   =   0.785398  \n"
+    "Count = 1234\n"
+    "Negative = -1234\n"
+    "Hex = 0x4d2\n"
+    "Partial = 12abc\n"
+    "NotANumber = abc\n"
+    "Empty =\n"
+    "Colon: with colon\n"
+    "Spaced Name = two words\n"
+    "[Flags]\n"
+    "a = true\nb = YES\nc = On\nd = 1\ne = false\nf = no\ng = OFF\nh = 0\ni = maybe\nj = 2\n";
+
+  CHECK(MatchesINIReader(content, {
+    { "Camera", "Name" }, { "Camera", "FieldOfView" }, { "Camera", "MovementSpeed" },
+    { "Camera", "RotationSpeed" }, { "Camera", "Count" }, { "Camera", "Negative" },
+    { "Camera", "Hex" }, { "Camera", "Partial" }, { "Camera", "NotANumber" },
+    { "Camera", "Empty" }, { "Camera", "Colon" }, { "Camera", "Spaced Name" },
+    { "Flags", "a" }, { "Flags", "b" }, { "Flags", "c" }, { "Flags", "d" }, { "Flags", "e" },
+    { "Flags", "f" }, { "Flags", "g" }, { "Flags", "h" }, { "Flags", "i" }, { "Flags", "j" } }));
+
+  // Sections and names are matched without regard to case
+  CHECK(MatchesINIReader(content, {
+    { "camera", "name" }, { "CAMERA", "FIELDOFVIEW" }, { "cAmErA", "hex" }, { "flags", "B" } }));
+
+  // Missing sections and names give the defaults
+  CHECK(MatchesINIReader(content, {
+    { "Camera", "Missing" }, { "Missing", "Name" }, { "", "Name" }, { "Flags", "" }, { "Camera", "Name " } }));
+}
+
+TEST(Ini_Comments)
+{
+  std::string content =
+    "; comment at the start\n"
+    "# hash comment\n"
+    "   ; indented comment\n"
+    "Global = outside any section\n"
+    "[Section] ; comment after a section\n"
+    "Inline = value ; comment\n"
+    "NoSpace = value;not a comment\n"
+    "Tab = value\t; comment after a tab\n"
+    "Hash = value # not a comment\n"
+    "OnlyComment = ; everything is a comment\n"
+    "Touching =; not a comment\n"
+    "\n"
+    "   \n"
+    "After = blank lines\n";
+
+  CHECK(MatchesINIReader(content, {
+    { "", "Global" }, { "Section", "Inline" }, { "Section", "NoSpace" }, { "Section", "Tab" },
+    { "Section", "Hash" }, { "Section", "OnlyComment" }, { "Section", "Touching" }, { "Section", "After" } }));
+}
+
+TEST(Ini_Encoding)
+{
+  // A UTF-8 byte order mark is skipped, and CRLF and a missing newline
+  // at the end are the same as LF
+  CHECK(MatchesINIReader("\xEF\xBB\xBF[Bom]\nKey = 1\n", { { "Bom", "Key" } }));
+  CHECK(MatchesINIReader("[Crlf]\r\nKey = value\r\nNumber = 0x10\r\nFlag = on\r\n",
+    { { "Crlf", "Key" }, { "Crlf", "Number" }, { "Crlf", "Flag" } }));
+  CHECK(MatchesINIReader("[NoNewline]\nKey = last", { { "NoNewline", "Key" } }));
+  CHECK(MatchesINIReader("", { { "", "Key" } }));
+}
+
+TEST(Ini_Errors)
+{
+  // ParseError is the first bad line, the lines around it still count
+  CHECK(MatchesINIReader("[Good]\nA = 1\nno separator\nB = 2\n[Bad\nC = 3\n",
+    { { "Good", "A" }, { "Good", "B" }, { "Good", "C" }, { "Bad", "C" } }));
+  CHECK(MatchesINIReader("[Unclosed\nA = 1\n", { { "Unclosed", "A" }, { "", "A" } }));
+  CHECK(MatchesINIReader("= no name\n[S]\nA = 1\n", { { "", "" }, { "S", "A" } }));
+
+  // A comment before the separator or the closing bracket ends the line
+  CHECK(MatchesINIReader("[S]\nName ; comment = 1\nB = 2\n", { { "S", "Name" }, { "S", "Name ; comment" }, { "S", "B" } }));
+  CHECK(MatchesINIReader("[S ; comment]\nA = 1\n", { { "S ; comment", "A" }, { "S", "A" }, { "", "A" } }));
+
+  // A file that can't be opened
+  util::IniFile ini;
+  CHECK(!ini.Load("IniFileTests.missing.ini"));
+  CHECK(ini.ParseError() == -1);
+  CHECK(ini.Get("A", "B", "default") == "default");
+  CHECK(INIReader("IniFileTests.missing.ini").ParseError() == -1);
+}
+
+TEST(Ini_LargeSection)
+{
+  // Enough keys to grow the index many times over
+  std::string content = "[Big]\n";
+  for (int i = 0; i < 2000; ++i)
+    content += "Key" + std::to_string(i) + " = " + std::to_string(i * 3) + "\n";
+  content += "[Other]\nKey5 = other\n";
+
+  WriteFile(content);
+  util::IniFile ini(g_iniPath);
+  INIReader reader(g_iniPath);
+  std::remove(g_iniPath);
+
+  bool same = true;
+  for (int i = 0; i < 2100; ++i)
+  {
+    std::string name = "key" + std::to_string(i);
+    same &= ini.GetInteger("BIG", name, -1) == reader.GetInteger("BIG", name, -1);
+  }
+  CHECK(same);
+  CHECK(ini.GetInteger("Big", "Key1999", 0) == 5997);
+  CHECK(ini.Get("Other", "Key5", "") == "other");
+  CHECK(ini.GetInteger("Big", "Key2000", -1) == -1);
+}
+
+TEST(Ini_Reload)
+{
+  // One reader is reused for every camera profile, nothing of the
+  // previous file may be left over
+  util::IniFile ini;
+  WriteFile("[CameraProfile]\nName = First\nIsProfile = true\nFovSpeed = 5\n");
+  CHECK(ini.Load(g_iniPath));
+  CHECK(ini.Get("CameraProfile", "Name", "") == "First");
+  CHECK(ini.GetReal("CameraProfile", "FovSpeed", 0) == 5.0);
+
+  WriteFile("[CameraProfile]\nName = Second\n");
+  CHECK(ini.Load(g_iniPath));
+  std::remove(g_iniPath);
+  CHECK(ini.Get("CameraProfile", "Name", "") == "Second");
+  CHECK(!ini.GetBoolean("CameraProfile", "IsProfile", false));
+  CHECK(ini.GetReal("CameraProfile", "FovSpeed", 1.5) == 1.5);
+
+  // Typed values are cached per entry, one type doesn't hide another
+  WriteFile("[S]\nValue = 1\n");
+  CHECK(ini.Load(g_iniPath));
+  std::remove(g_iniPath);
+  CHECK(ini.GetInteger("S", "Value", 0) == 1);
+  CHECK(ini.GetReal("S", "Value", 0) == 1.0);
+  CHECK(ini.GetBoolean("S", "Value", false));
+  CHECK(ini.GetInteger("S", "Value", 0) == 1);
+}
+
+TEST(Ini_Differences)
+{
+  // The documented differences from INIReader, in files the tools never
+  // write themselves
+
+  // A repeated name replaces the earlier value, INIReader joins them
+  WriteFile("[S]\nKey = first\nKey = second\n");
+  util::IniFile ini(g_iniPath);
+  INIReader reader(g_iniPath);
+  CHECK(ini.Get("S", "Key", "") == "second");
+  CHECK(reader.Get("S", "Key", "") == "first\nsecond");
+  CHECK(ini.ParseError() == 0);
+
+  // An indented line after a value isn't a continuation, it's a line
+  // without a separator
+  WriteFile("[S]\nKey = first\n  more\nNext = 1\n");
+  ini.Load(g_iniPath);
+  INIReader continued(g_iniPath);
+  CHECK(ini.Get("S", "Key", "") == "first");
+  CHECK(ini.ParseError() == 3);
+  CHECK(continued.Get("S", "Key", "") == "first\nmore");
+  CHECK(continued.ParseError() == 0);
+  CHECK(ini.GetInteger("S", "Next", 0) == 1);
+
+  // Even an indented name = value line continues the value before it
+  // in INIReader, IniFile reads it as its own entry
+  WriteFile("[S]\nKey = first\n  Indented = 2\n");
+  ini.Load(g_iniPath);
+  INIReader indented(g_iniPath);
+  CHECK(ini.Get("S", "Key", "") == "first");
+  CHECK(ini.GetInteger("S", "Indented", 0) == 2);
+  CHECK(indented.Get("S", "Key", "") == "first\nIndented = 2");
+  CHECK(indented.GetInteger("S", "Indented", 0) == 0);
+
+  // Lines have no length limit
+  std::string longValue(500, 'x');
+  WriteFile("[S]\nLong = " + longValue + "\n");
+  ini.Load(g_iniPath);
+  std::remove(g_iniPath);
+  CHECK(ini.Get("S", "Long", "") == longValue);
+  CHECK(ini.ParseError() == 0);
+}
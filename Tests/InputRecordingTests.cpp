@@ -0,0 +1,234 @@
+#include "Check.h"
+
+#include "InputRecording.h"
+
+#include <cstring>
+#include <random>
+
+namespace
+{
+  const uint16_t g_valueCount = 40;
+
+  struct Frame
+  {
+    uint32_t Dt;
+    std::vector<uint32_t> Values;
+  };
+
+  std::vector<uint8_t> Write(std::vector<Frame> const& frames, uint16_t valueCount = g_valueCount)
+  {
+    InputRecordWriter writer;
+    writer.Begin(valueCount);
+    for (Frame const& frame : frames)
+      writer.AddFrame(frame.Dt, frame.Values.data());
+    return writer.Finish();
+  }
+
+  // Reads frames until NextFrame fails and returns how many of them
+  // matched the expected ones in order
+  size_t ReadMatching(InputRecordReader& reader, std::vector<Frame> const& expected, uint16_t valueCount = g_valueCount)
+  {
+    std::vector<uint32_t> values(valueCount);
+    uint32_t dt = 0;
+    size_t matched = 0;
+    while (reader.NextFrame(dt, values.data()))
+    {
+      if (matched >= expected.size() || dt != expected[matched].Dt || values != expected[matched].Values)
+        return matched;
+      matched += 1;
+    }
+    return matched;
+  }
+
+  // Mostly idle frames like a real take, a few values change at a time
+  // and the frame time wanders around 60 fps
+  std::vector<Frame> RandomFrames(uint32_t seed, size_t count)
+  {
+    std::mt19937 random(seed);
+    std::vector<Frame> frames;
+    Frame frame{ 16667, std::vector<uint32_t>(g_valueCount, 0) };
+    for (size_t i = 0; i < count; ++i)
+    {
+      if (random() % 4 == 0)
+        frame.Dt = 16667 + random() % 2000 - 1000;
+
+      if (random() % 3 == 0)
+      {
+        uint32_t changes = 1 + random() % 5;
+        for (uint32_t c = 0; c < changes; ++c)
+          frame.Values[random() % g_valueCount] = random() % 2 ? random() : 0;
+      }
+      frames.push_back(frame);
+    }
+    return frames;
+  }
+}
+
+TEST(Record_RoundTrip)
+{
+  std::vector<Frame> frames = RandomFrames(1, 5000);
+  std::vector<uint8_t> data = Write(frames);
+
+  InputRecordReader reader;
+  CHECK(reader.Open(data, g_valueCount));
+  CHECK(reader.GetFrameCount() == 5000);
+  CHECK(ReadMatching(reader, frames) == 5000);
+  CHECK(reader.GetFramesRead() == 5000);
+
+  // Nothing after the end
+  uint32_t dt = 0;
+  std::vector<uint32_t> values(g_valueCount);
+  CHECK(!reader.NextFrame(dt, values.data()));
+
+  // Every value changing at once, including the first and last index
+  std::vector<Frame> full;
+  for (uint32_t i = 0; i < 10; ++i)
+  {
+    Frame frame{ 1000 * i, std::vector<uint32_t>(g_valueCount) };
+    for (uint32_t v = 0; v < g_valueCount; ++v)
+      frame.Values[v] = (i + 1) * 0x01010101u + v;
+    full.push_back(frame);
+  }
+  CHECK(reader.Open(Write(full), g_valueCount));
+  CHECK(ReadMatching(reader, full) == 10);
+}
+
+TEST(Record_ZigZagDeltas)
+{
+  // The frame time is stored as the difference to the previous one, so
+  // it has to survive going down, jumping across the whole range and
+  // wrapping around
+  const uint32_t dts[] = { 0, 1, 0, 16667, 16666, 16668, 100, 0x7FFFFFFF, 0x80000000, 0xFFFFFFFF, 0, 0xFFFFFFFF, 1, 5, 5 };
+
+  std::vector<Frame> frames;
+  for (uint32_t dt : dts)
+    frames.push_back(Frame{ dt, std::vector<uint32_t>(g_valueCount, 7) });
+
+  InputRecordReader reader;
+  CHECK(reader.Open(Write(frames), g_valueCount));
+  CHECK(ReadMatching(reader, frames) == frames.size());
+}
+
+TEST(Record_Repeats)
+{
+  // 1000 identical frames are one full frame and one repeat record with
+  // a single byte per frame for the unchanged frame time
+  std::vector<Frame> frames(1000, Frame{ 16667, std::vector<uint32_t>(g_valueCount, 0) });
+  std::vector<uint8_t> data = Write(frames);
+
+  // Frame: type, zigzag dt in 3 bytes, 0 changes. Repeat: type, 999 in
+  // 2 bytes, 999 deltas. Then the end marker.
+  CHECK(data.size() == g_inputRecordHeaderSize + 5 + 3 + 999 + 1);
+
+  InputRecordReader reader;
+  CHECK(reader.Open(data, g_valueCount));
+  CHECK(ReadMatching(reader, frames) == 1000);
+
+  // A change ends the run, and a new run starts after it
+  std::vector<Frame> broken = frames;
+  broken[500].Values[39] = 1;
+  for (size_t i = 501; i < broken.size(); ++i)
+    broken[i].Values[39] = 1;
+  broken[700].Dt = 20000;
+
+  CHECK(reader.Open(Write(broken), g_valueCount));
+  CHECK(ReadMatching(reader, broken) == 1000);
+}
+
+TEST(Record_Header)
+{
+  std::vector<Frame> frames = RandomFrames(2, 100);
+  std::vector<uint8_t> data = Write(frames);
+
+  InputRecordReader reader;
+  CHECK(reader.Open(data, g_valueCount));
+
+  // A different value count means a different version of the tools
+  CHECK(!reader.Open(data, g_valueCount + 1));
+
+  std::vector<uint8_t> bad = data;
+  bad[0] = 'X';
+  CHECK(!reader.Open(bad, g_valueCount));
+
+  bad = data;
+  bad[4] += 1;
+  CHECK(!reader.Open(bad, g_valueCount));
+
+  CHECK(!reader.Open(std::vector<uint8_t>(), g_valueCount));
+
+  // An unknown record type stops the reader
+  bad = data;
+  bad[g_inputRecordHeaderSize] = 0x7F;
+  CHECK(reader.Open(bad, g_valueCount));
+  CHECK(ReadMatching(reader, frames) == 0);
+
+  // So does a value index past the value count, here a log of 4 values
+  // whose header claims 3
+  std::vector<Frame> small(1, Frame{ 1, std::vector<uint32_t>(4, 0) });
+  small[0].Values[3] = 9;
+  bad = Write(small, 4);
+  bad[6] = 3;
+  CHECK(reader.Open(bad, 3));
+  CHECK(ReadMatching(reader, small, 3) == 0);
+}
+
+TEST(Record_Truncated)
+{
+  std::vector<Frame> frames = RandomFrames(3, 300);
+  std::vector<uint8_t> data = Write(frames);
+
+  // Every prefix either fails to open or gives back a prefix of the
+  // frames before it stops, never a wrong frame
+  size_t lastMatched = 0;
+  bool grows = true;
+  for (size_t size = 0; size < data.size(); ++size)
+  {
+    std::vector<uint8_t> prefix(data.begin(), data.begin() + size);
+    InputRecordReader reader;
+    if (!reader.Open(prefix, g_valueCount))
+    {
+      CHECK(size < g_inputRecordHeaderSize);
+      continue;
+    }
+
+    std::vector<uint32_t> values(g_valueCount);
+    uint32_t dt = 0;
+    size_t matched = 0;
+    bool correct = true;
+    while (reader.NextFrame(dt, values.data()))
+    {
+      correct &= matched < frames.size() && dt == frames[matched].Dt && values == frames[matched].Values;
+      matched += 1;
+    }
+    CHECK(correct);
+    grows &= matched >= lastMatched;
+    lastMatched = matched;
+  }
+  CHECK(grows);
+
+  // Only the end marker missing still gives every frame
+  CHECK(lastMatched == frames.size());
+}
+
+TEST(Record_Mutated)
+{
+  // Random damage must not make the reader run past its data. Run under
+  // -fsanitize=address to catch that.
+  std::vector<uint8_t> data = Write(RandomFrames(4, 200));
+  std::mt19937 random(5);
+  std::vector<uint32_t> values(g_valueCount);
+  for (int i = 0; i < 2000; ++i)
+  {
+    std::vector<uint8_t> bad = data;
+    for (int b = 0; b < 4; ++b)
+      bad[g_inputRecordHeaderSize + random() % (bad.size() - g_inputRecordHeaderSize)] = static_cast<uint8_t>(random());
+
+    InputRecordReader reader;
+    CHECK(reader.Open(bad, g_valueCount));
+    uint32_t dt = 0;
+    uint32_t frameCount = 0;
+    while (reader.NextFrame(dt, values.data()) && frameCount < 1000000)
+      frameCount += 1;
+    CHECK(frameCount < 1000000);
+  }
+}
@@ -0,0 +1,350 @@
+#include "Check.h"
+
+#include "LogBinary.h"
+
+#include <climits>
+#include <cstdarg>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+using util::log::BinaryLogEntry;
+using util::log::BinaryLogHeader;
+using util::log::BinaryLogReader;
+using util::log::BinaryLogWriter;
+using util::log::EntryType;
+using util::log::LogLevel;
+using util::log::LogRecord;
+
+namespace
+{
+  const BinaryLogHeader g_header{ 10000000, 123456789, 132000000000000000 };
+
+  // What the reader has to give back for one Message, Text or Dropped entry
+  struct Expected
+  {
+    EntryType Type;
+    int64_t Time;
+    LogLevel Level;
+    uint32_t Dropped;
+    std::string Text;
+  };
+
+  // Captures the message like the log functions do and writes it
+  void Log(BinaryLogWriter& writer, std::string& out, std::vector<Expected>& expected,
+    int64_t time, LogLevel level, const char* format, ...)
+  {
+    LogRecord record;
+    va_list args;
+    va_start(args, format);
+    util::log::Capture(record, format, args);
+    va_end(args);
+    record.Time = time;
+    record.Level = level;
+
+    Expected entry{ record.Format ? EntryType::Message : EntryType::Text, time, level, 0, "" };
+    util::log::FormatRecord(record, entry.Text);
+    expected.push_back(entry);
+    writer.Write(record, out);
+  }
+
+  void Dropped(BinaryLogWriter& writer, std::string& out, std::vector<Expected>& expected, int64_t time, uint32_t count)
+  {
+    expected.push_back(Expected{ EntryType::Dropped, time, LogLevel::Info, count, "" });
+    writer.WriteDropped(time, count, out);
+  }
+
+  std::vector<uint8_t> ToData(std::string const& out)
+  {
+    return std::vector<uint8_t>(out.begin(), out.end());
+  }
+
+  bool Matches(BinaryLogEntry const& entry, Expected const& expected)
+  {
+    if (entry.Type != expected.Type || entry.Time != expected.Time)
+      return false;
+    if (entry.Type == EntryType::Dropped)
+      return entry.Dropped == expected.Dropped;
+
+    std::string text;
+    util::log::FormatRecord(entry.Record, text);
+    return entry.Record.Level == expected.Level && text == expected.Text;
+  }
+
+  // Reads entries until Next fails and returns how many of them matched
+  // the expected ones in order
+  size_t ReadMatching(BinaryLogReader& reader, std::vector<Expected> const& expected)
+  {
+    BinaryLogEntry entry;
+    size_t matched = 0;
+    while (reader.Next(entry))
+    {
+      if (matched >= expected.size() || !Matches(entry, expected[matched]))
+        return matched;
+      matched += 1;
+    }
+    return matched;
+  }
+
+  // A bit of everything, with the tick deltas going both ways
+  std::string WriteMixed(BinaryLogWriter& writer, std::vector<Expected>& expected)
+  {
+    std::string out;
+    writer.Begin(g_header, out);
+
+    int64_t time = g_header.BaseTicks;
+    for (int i = 0; i < 20; ++i)
+    {
+      time += (i % 3 == 2) ? -40 : 1000;
+      Log(writer, out, expected, time, LogLevel::Info, "Frame %d took %.3f ms", i, i * 0.25);
+      if (i % 5 == 0)
+        Log(writer, out, expected, time + 1, LogLevel::Warning, "Profile \"%s\" has no %s", "Default", "FieldOfView");
+      if (i % 7 == 3)
+        Dropped(writer, out, expected, time + 2, i);
+      if (i % 4 == 1)
+        Log(writer, out, expected, time + 3, LogLevel::Error, "Width %*d", 8, i);
+    }
+    return out;
+  }
+}
+
+TEST(Log_ArgTypes)
+{
+  BinaryLogWriter writer;
+  std::string out;
+  std::vector<Expected> expected;
+  writer.Begin(g_header, out);
+
+  int64_t time = g_header.BaseTicks + 10;
+  const char* format = "%d %ld %lld %zu %jd %td %f %p %s 100%%";
+  Log(writer, out, expected, time, LogLevel::Info, format,
+    -7, -70000L, -7000000000LL, static_cast<size_t>(7), static_cast<intmax_t>(-77), static_cast<ptrdiff_t>(-777),
+    1.5, reinterpret_cast<void*>(static_cast<uintptr_t>(0x1234abcd)), "string");
+
+  // The extremes of every type, and the same format again so it's only
+  // written once
+  Log(writer, out, expected, time, LogLevel::Ok, format,
+    INT_MIN, LONG_MAX, LLONG_MIN, SIZE_MAX, INTMAX_MAX, PTRDIFF_MIN,
+    -1e300, reinterpret_cast<void*>(UINTPTR_MAX), "");
+  Log(writer, out, expected, time, LogLevel::Error, format,
+    INT_MAX, LONG_MIN, LLONG_MAX, static_cast<size_t>(0), INTMAX_MIN, PTRDIFF_MAX,
+    -0.0, static_cast<void*>(nullptr), "x");
+
+  // Flags, widths and precisions, %c, %u, %x and %hd read an int, %a
+  // shows every bit of a double
+  Log(writer, out, expected, time, LogLevel::Warning, "[%-6d|%+05i|%c|%u|%#x|%hd|%10.4f|%a|%e|%g|%-8s|%.2s]",
+    42, 42, 'A', 3000000000u, 255, -2, 3.14159265, 0.1, 6.02e23, 1e-300, "left", "cut");
+
+  // Formats that can't be deferred arrive as Text
+  Log(writer, out, expected, time, LogLevel::Info, "%*d", 6, 1);
+  Log(writer, out, expected, time, LogLevel::Info, "No arguments at all");
+
+  BinaryLogReader reader;
+  CHECK(reader.Open(ToData(out)));
+  CHECK(reader.GetHeader().TicksPerSecond == g_header.TicksPerSecond);
+  CHECK(reader.GetHeader().BaseTicks == g_header.BaseTicks);
+  CHECK(reader.GetHeader().BaseLocalTime == g_header.BaseLocalTime);
+  CHECK(ReadMatching(reader, expected) == expected.size());
+  CHECK(!reader.IsCorrupt());
+  CHECK(reader.GetFormats().size() == 3);
+
+  CHECK(expected[0].Text == "-7 -70000 -7000000000 7 -77 -777 1.500000 0x1234abcd string 100%");
+  CHECK(expected[4].Type == EntryType::Text && expected[4].Text == "     1");
+}
+
+TEST(Log_LongStrings)
+{
+  BinaryLogWriter writer;
+  std::string out;
+  std::vector<Expected> expected;
+  writer.Begin(g_header, out);
+
+  // Copies of %s arguments share the record's text, a string that
+  // doesn't fit is cut off and the ones after it come out empty
+  std::string longText(400, 'a');
+  std::string almost(util::log::g_maxRecordText - 2, 'b');
+  Log(writer, out, expected, 1, LogLevel::Info, "%s", longText.c_str());
+  Log(writer, out, expected, 2, LogLevel::Info, "<%s|%s|%s>", "first", longText.c_str(), "last");
+  Log(writer, out, expected, 3, LogLevel::Info, "%s%s", almost.c_str(), "c");
+  Log(writer, out, expected, 4, LogLevel::Info, "%s%s", almost.substr(1).c_str(), "c");
+
+  // Text entries are cut off the same way
+  Log(writer, out, expected, 5, LogLevel::Info, "%*s", 1, longText.c_str());
+
+  CHECK(expected[0].Text.size() == util::log::g_maxRecordText - 1);
+  CHECK(expected[1].Text == "<first|" + longText.substr(0, util::log::g_maxRecordText - 7) + "|>");
+  CHECK(expected[2].Text == almost);
+  CHECK(expected[3].Text == almost.substr(1) + "c");
+  CHECK(expected[4].Text.size() == util::log::g_maxRecordText - 1);
+
+  BinaryLogReader reader;
+  CHECK(reader.Open(ToData(out)));
+  CHECK(ReadMatching(reader, expected) == expected.size());
+  CHECK(!reader.IsCorrupt());
+}
+
+TEST(Log_TickDeltas)
+{
+  // Threads take their timestamp after claiming a slot, so a record can
+  // be older than the one before it
+  const int64_t times[] = { 0, 1, -1, 1000, 999, 123456789, 1, INT64_MAX / 4, -(INT64_MAX / 4), 5, 5, -5 };
+
+  BinaryLogWriter writer;
+  std::string out;
+  std::vector<Expected> expected;
+  writer.Begin(g_header, out);
+  for (int64_t time : times)
+  {
+    Log(writer, out, expected, time, LogLevel::Info, "At %lld", static_cast<long long>(time));
+    Dropped(writer, out, expected, time - 3, 1);
+  }
+
+  BinaryLogReader reader;
+  CHECK(reader.Open(ToData(out)));
+  CHECK(ReadMatching(reader, expected) == expected.size());
+  CHECK(!reader.IsCorrupt());
+
+  // A new file starts over from its own base ticks and formats
+  std::vector<Expected> second;
+  BinaryLogHeader later{ g_header.TicksPerSecond, 5000, g_header.BaseLocalTime };
+  out.clear();
+  writer.Begin(later, out);
+  Log(writer, out, second, 4000, LogLevel::Ok, "At %lld", 4000LL);
+  CHECK(reader.Open(ToData(out)));
+  CHECK(ReadMatching(reader, second) == 1);
+  CHECK(reader.GetFormats().size() == 1);
+}
+
+TEST(Log_Dropped)
+{
+  BinaryLogWriter writer;
+  std::string out;
+  std::vector<Expected> expected;
+  writer.Begin(g_header, out);
+  Dropped(writer, out, expected, g_header.BaseTicks + 5, 1);
+  Log(writer, out, expected, g_header.BaseTicks + 6, LogLevel::Info, "After %d", 1);
+  Dropped(writer, out, expected, g_header.BaseTicks + 4, 0xFFFFFFFF);
+  Dropped(writer, out, expected, g_header.BaseTicks + 4, 0);
+
+  BinaryLogReader reader;
+  CHECK(reader.Open(ToData(out)));
+  CHECK(ReadMatching(reader, expected) == 4);
+  CHECK(!reader.IsCorrupt());
+}
+
+TEST(Log_Header)
+{
+  BinaryLogWriter writer;
+  std::vector<Expected> expected;
+  std::vector<uint8_t> data = ToData(WriteMixed(writer, expected));
+
+  BinaryLogReader reader;
+  CHECK(reader.Open(data));
+
+  std::vector<uint8_t> bad = data;
+  bad[0] = 'X';
+  CHECK(!reader.Open(bad));
+
+  bad = data;
+  bad[4] += 1;
+  CHECK(!reader.Open(bad));
+
+  // Zero ticks per second
+  bad = data;
+  for (int i = 8; i < 16; ++i)
+    bad[i] = 0;
+  CHECK(!reader.Open(bad));
+
+  CHECK(!reader.Open(std::vector<uint8_t>(data.begin(), data.begin() + 31)));
+  CHECK(reader.Open(std::vector<uint8_t>(data.begin(), data.begin() + 32)));
+  BinaryLogEntry entry;
+  CHECK(!reader.Next(entry));
+  CHECK(!reader.IsCorrupt());
+
+  // An unknown entry type is corrupt
+  bad = data;
+  bad[32] = 0x7F;
+  CHECK(reader.Open(bad));
+  CHECK(ReadMatching(reader, expected) == 0);
+  CHECK(reader.IsCorrupt());
+}
+
+TEST(Log_Truncated)
+{
+  BinaryLogWriter writer;
+  std::vector<Expected> expected;
+  std::string out = WriteMixed(writer, expected);
+
+  // The last entry cut off anywhere is corrupt, everything before it
+  // still reads. Its format was written before, so it's one entry.
+  size_t entryStart = out.size();
+  Log(writer, out, expected, g_header.BaseTicks + 100000, LogLevel::Info, "Frame %d took %.3f ms", -1, 2.0);
+
+  BinaryLogReader reader;
+  CHECK(reader.Open(ToData(out)));
+  CHECK(ReadMatching(reader, expected) == expected.size());
+  CHECK(!reader.IsCorrupt());
+
+  bool corrupt = true;
+  bool rest = true;
+  for (size_t size = entryStart + 1; size < out.size(); ++size)
+  {
+    CHECK(reader.Open(std::vector<uint8_t>(out.begin(), out.begin() + size)));
+    rest &= ReadMatching(reader, expected) == expected.size() - 1;
+    corrupt &= reader.IsCorrupt();
+  }
+  CHECK(corrupt);
+  CHECK(rest);
+
+  // Every prefix gives back a prefix of the entries, never a wrong one,
+  // and the last partial one is reported as corrupt
+  size_t lastMatched = 0;
+  bool grows = true;
+  for (size_t size = 32; size <= out.size(); ++size)
+  {
+    CHECK(reader.Open(std::vector<uint8_t>(out.begin(), out.begin() + size)));
+    BinaryLogEntry entry;
+    size_t matched = 0;
+    bool correct = true;
+    while (reader.Next(entry))
+    {
+      correct &= matched < expected.size() && Matches(entry, expected[matched]);
+      matched += 1;
+    }
+    CHECK(correct);
+    grows &= matched >= lastMatched;
+    lastMatched = matched;
+  }
+  CHECK(grows);
+  CHECK(lastMatched == expected.size());
+}
+
+TEST(Log_Mutated)
+{
+  // Random damage must not make the reader run past its data. Run under
+  // -fsanitize=address to catch that.
+  BinaryLogWriter writer;
+  std::vector<Expected> expected;
+  std::vector<uint8_t> data = ToData(WriteMixed(writer, expected));
+  std::mt19937 random(6);
+  for (int i = 0; i < 2000; ++i)
+  {
+    std::vector<uint8_t> bad = data;
+    for (int b = 0; b < 4; ++b)
+      bad[32 + random() % (bad.size() - 32)] = static_cast<uint8_t>(random());
+
+    BinaryLogReader reader;
+    CHECK(reader.Open(bad));
+    BinaryLogEntry entry;
+    size_t count = 0;
+    while (reader.Next(entry) && count < 1000000)
+    {
+      std::string text;
+      if (entry.Type != EntryType::Dropped)
+        util::log::FormatRecord(entry.Record, text);
+      count += 1;
+    }
+    CHECK(count < 1000000);
+  }
+}
@@ -0,0 +1,222 @@
+#include "Check.h"
+
+#include "MouseEventQueue.h"
+
+#include <atomic>
+#include <thread>
+
+namespace
+{
+  MouseEvent Event(int64_t timestamp, int32_t x, int32_t y, int32_t z = 0)
+  {
+    MouseEvent mouseEvent;
+    mouseEvent.Timestamp = timestamp;
+    mouseEvent.X = x;
+    mouseEvent.Y = y;
+    mouseEvent.Z = z;
+    return mouseEvent;
+  }
+}
+
+TEST(MouseQueue_PushDrain)
+{
+  MouseEventQueue<16> queue;
+  CHECK(queue.Drain().Count == 0);
+
+  for (int i = 1; i <= 10; ++i)
+    queue.Push(Event(i * 100, i, -i, i % 2 ? 120 : 0));
+
+  std::vector<int64_t> seen;
+  MouseDelta delta = queue.Drain((std::numeric_limits<int64_t>::max)(),
+    [&](MouseEvent const& mouseEvent) { seen.push_back(mouseEvent.Timestamp); });
+
+  CHECK(delta.Count == 10);
+  CHECK(delta.X == 55);
+  CHECK(delta.Y == -55);
+  CHECK(delta.Z == 600);
+  CHECK(delta.FirstTimestamp == 100);
+  CHECK(delta.LastTimestamp == 1000);
+
+  // In push order
+  CHECK(seen.size() == 10);
+  for (size_t i = 0; i < seen.size(); ++i)
+    CHECK(seen[i] == static_cast<int64_t>(i + 1) * 100);
+
+  CHECK(queue.Drain().Count == 0);
+
+  // The ring wraps around many times without losing anything
+  int64_t sumX = 0;
+  for (int round = 0; round < 100; ++round)
+  {
+    for (int i = 0; i < 11; ++i)
+      queue.Push(Event(round * 100 + i, round + i, 1));
+
+    MouseDelta roundDelta = queue.Drain();
+    CHECK(roundDelta.Count == 11);
+    CHECK(roundDelta.Y == 11);
+    sumX += roundDelta.X;
+  }
+  // 100 * 55 from i, 11 * 4950 from round
+  CHECK(sumX == 5500 + 11 * 4950);
+}
+
+TEST(MouseQueue_Overflow)
+{
+  MouseEventQueue<8> queue;
+
+  // 8 fit, the next 5 are folded into the overflow sum
+  for (int i = 1; i <= 13; ++i)
+    queue.Push(Event(i, i, 2 * i, -1));
+
+  std::vector<MouseEvent> seen;
+  MouseDelta delta = queue.Drain((std::numeric_limits<int64_t>::max)(),
+    [&](MouseEvent const& mouseEvent) { seen.push_back(mouseEvent); });
+
+  // Nothing is lost, the overflow comes last as one event
+  CHECK(delta.X == 91);
+  CHECK(delta.Y == 182);
+  CHECK(delta.Z == -13);
+  CHECK(delta.Count == 9);
+  CHECK(delta.FirstTimestamp == 1);
+  CHECK(delta.LastTimestamp == 13);
+
+  CHECK(seen.size() == 9);
+  if (seen.size() == 9)
+  {
+    for (int i = 0; i < 8; ++i)
+      CHECK(seen[i].X == i + 1);
+
+    // 9 + 10 + 11 + 12 + 13, stamped with the newest event
+    CHECK(seen[8].X == 55);
+    CHECK(seen[8].Y == 110);
+    CHECK(seen[8].Z == -5);
+    CHECK(seen[8].Timestamp == 13);
+  }
+
+  // The overflow sum is cleared with the drain
+  CHECK(queue.Drain().Count == 0);
+
+  queue.Push(Event(20, 7, 0));
+  delta = queue.Drain();
+  CHECK(delta.Count == 1);
+  CHECK(delta.X == 7);
+}
+
+TEST(MouseQueue_OverflowWaitsForRing)
+{
+  // Overflowed events are newer than everything in the ring, so they
+  // aren't taken while a window leaves ring events behind
+  MouseEventQueue<4> queue;
+  for (int i = 1; i <= 6; ++i)
+    queue.Push(Event(i * 10, 1, 0));
+
+  MouseDelta delta = queue.Drain(25);
+  CHECK(delta.Count == 2);
+  CHECK(delta.X == 2);
+
+  delta = queue.Drain(40);
+  CHECK(delta.Count == 2);
+  CHECK(delta.X == 2);
+
+  // The ring is empty now, but the overflow is stamped 60
+  delta = queue.Drain(55);
+  CHECK(delta.Count == 0);
+
+  delta = queue.Drain(60);
+  CHECK(delta.Count == 1);
+  CHECK(delta.X == 2);
+  CHECK(delta.LastTimestamp == 60);
+}
+
+TEST(MouseQueue_Window)
+{
+  MouseEventQueue<64> queue;
+  for (int i = 0; i < 30; ++i)
+    queue.Push(Event(1000 + i * 10, 1, i));
+
+  // Up to and including the window's end
+  MouseDelta first = queue.Drain(1090);
+  CHECK(first.Count == 10);
+  CHECK(first.FirstTimestamp == 1000);
+  CHECK(first.LastTimestamp == 1090);
+  CHECK(first.Y == 45);
+
+  // An empty window leaves everything queued
+  MouseDelta empty = queue.Drain(1095);
+  CHECK(empty.Count == 0);
+  CHECK(empty.X == 0);
+
+  // Events pushed after a window was cut are kept in order
+  queue.Push(Event(1300, 100, 0));
+
+  MouseDelta second = queue.Drain(1199);
+  CHECK(second.Count == 10);
+  CHECK(second.FirstTimestamp == 1100);
+  CHECK(second.LastTimestamp == 1190);
+
+  MouseDelta rest = queue.Drain();
+  CHECK(rest.Count == 11);
+  CHECK(rest.X == 110);
+  CHECK(rest.FirstTimestamp == 1200);
+  CHECK(rest.LastTimestamp == 1300);
+
+  // Every event was counted exactly once
+  CHECK(first.X + second.X + rest.X == 130);
+}
+
+TEST(MouseQueue_Threads)
+{
+  // One producer, one consumer, the way WM_INPUT and the input thread
+  // use it. The totals have to match whatever the interleaving was.
+  MouseEventQueue<32> queue;
+  const int eventCount = 200000;
+
+  // Stands in for QueryPerformanceCounter, every event is stamped with
+  // the time it was pushed at
+  std::atomic<int64_t> now(0);
+
+  std::thread producer([&]
+  {
+    for (int i = 1; i <= eventCount; ++i)
+    {
+      queue.Push(Event(i, 1, i % 7 - 3, i % 3));
+      now.store(i, std::memory_order_release);
+    }
+  });
+
+  int64_t x = 0, y = 0, z = 0;
+  int64_t lastTimestamp = 0;
+  bool ordered = true;
+  while (x < eventCount)
+  {
+    // A drain racing with an overflowing push can split the overflow
+    // sum in two, both stamped with the same time
+    MouseDelta delta = queue.Drain(now.load(std::memory_order_acquire), [&](MouseEvent const& mouseEvent)
+    {
+      ordered &= mouseEvent.Timestamp >= lastTimestamp;
+      lastTimestamp = mouseEvent.Timestamp;
+    });
+    x += delta.X;
+    y += delta.Y;
+    z += delta.Z;
+  }
+  producer.join();
+
+  // The rest of a split overflow sum
+  MouseDelta rest = queue.Drain();
+  x += rest.X;
+  y += rest.Y;
+  z += rest.Z;
+
+  int64_t expectedY = 0, expectedZ = 0;
+  for (int i = 1; i <= eventCount; ++i)
+  {
+    expectedY += i % 7 - 3;
+    expectedZ += i % 3;
+  }
+
+  CHECK(x == eventCount);
+  CHECK(y == expectedY);
+  CHECK(z == expectedZ);
+  CHECK(ordered);
+}
@@ -0,0 +1,344 @@
+#include "Check.h"
+
+#include "PEImage.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <random>
+
+using util::PEImage;
+using util::PESection;
+
+namespace
+{
+  // The checked in binaries, relative to Tests/
+  const char* g_dllPath = "../Build/CT_AlienIsolation.dll";
+  const char* g_injectorPath = "../Build/Injector.exe";
+
+  struct ExpectedSection
+  {
+    const char* Name;
+    uint32_t VirtualAddress;
+    uint32_t VirtualSize;
+    uint32_t RawOffset;
+    uint32_t RawSize;
+    bool IsExecutable;
+  };
+
+  struct ExpectedImage
+  {
+    const char* Path;
+    uint64_t ImageBase;
+    uint32_t SizeOfImage;
+    uint32_t TimeDateStamp;
+    uint32_t CheckSum;
+    std::vector<ExpectedSection> Sections;
+  };
+
+  // As listed by objdump -h and -p
+  ExpectedImage Dll()
+  {
+    return ExpectedImage{ g_dllPath, 0x10000000, 0x190000, 0x6234DE79, 0, {
+      { ".text",  0x00001000, 0x00084C73, 0x00000400, 0x00084E00, true },
+      { ".rdata", 0x00086000, 0x00043ABE, 0x00085200, 0x00043C00, false },
+      { ".data",  0x000CA000, 0x00002F0C, 0x000C8E00, 0x00001E00, false },
+      { ".gfids", 0x000CD000, 0x0000003C, 0x000CAC00, 0x00000200, false },
+      { ".tls",   0x000CE000, 0x00000009, 0x000CAE00, 0x00000200, false },
+      { ".rsrc",  0x000CF000, 0x000B94C8, 0x000CB000, 0x000B9600, false },
+      { ".reloc", 0x00189000, 0x000067F8, 0x00184600, 0x00006800, false } } };
+  }
+
+  ExpectedImage Injector()
+  {
+    return ExpectedImage{ g_injectorPath, 0x400000, 0x74000, 0x5D5AC28D, 0x7C004, {
+      { ".text",  0x00001000, 0x000505A9, 0x00000400, 0x00050600, true },
+      { ".rdata", 0x00052000, 0x000146B8, 0x00050A00, 0x00014800, false },
+      { ".data",  0x00067000, 0x00002A28, 0x00065200, 0x00001C00, false },
+      { ".rsrc",  0x0006A000, 0x00004138, 0x00066E00, 0x00004200, false },
+      { ".reloc", 0x0006F000, 0x000040E4, 0x0006B000, 0x00004200, false } } };
+  }
+
+  std::vector<uint8_t> ReadFile(const char* path)
+  {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+    {
+      printf("  Can't open %s, run the tests from Tests/\n", path);
+      return std::vector<uint8_t>();
+    }
+    return std::vector<uint8_t>((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  }
+
+  bool Parse(std::vector<uint8_t> const& data, bool isMapped, PEImage& image)
+  {
+    return image.Parse(data.data(), data.size(), isMapped);
+  }
+
+  bool Parses(std::vector<uint8_t> const& data, bool isMapped)
+  {
+    PEImage image;
+    return Parse(data, isMapped, image);
+  }
+
+  template<typename T>
+  void Patch(std::vector<uint8_t>& data, size_t offset, T value)
+  {
+    memcpy(&data[offset], &value, sizeof(T));
+  }
+
+  uint32_t NtOffset(std::vector<uint8_t> const& data)
+  {
+    uint32_t offset = 0;
+    memcpy(&offset, &data[0x3C], sizeof(offset));
+    return offset;
+  }
+
+  // IMAGE_FILE_HEADER is 20 bytes and the 32 bit optional header 224
+  size_t SectionTable(std::vector<uint8_t> const& data)
+  {
+    return NtOffset(data) + 4 + 20 + 224;
+  }
+
+  void CheckImage(PEImage const& image, ExpectedImage const& expected)
+  {
+    CHECK(!image.Is64Bit());
+    CHECK(image.GetImageBase() == expected.ImageBase);
+    CHECK(image.GetSizeOfImage() == expected.SizeOfImage);
+    CHECK(image.GetSizeOfHeaders() == 0x400);
+    CHECK(image.GetTimeDateStamp() == expected.TimeDateStamp);
+    CHECK(image.GetCheckSum() == expected.CheckSum);
+
+    std::vector<PESection> const& sections = image.GetSections();
+    CHECK(sections.size() == expected.Sections.size());
+    if (sections.size() != expected.Sections.size())
+      return;
+
+    for (size_t i = 0; i < sections.size(); ++i)
+    {
+      PESection const& section = sections[i];
+      ExpectedSection const& want = expected.Sections[i];
+      CHECK(section.Name == want.Name);
+      CHECK(section.VirtualAddress == want.VirtualAddress);
+      CHECK(section.VirtualSize == want.VirtualSize);
+      CHECK(section.RawOffset == want.RawOffset);
+      CHECK(section.RawSize == want.RawSize);
+      CHECK(section.IsExecutable() == want.IsExecutable);
+      CHECK(section.IsData() == !want.IsExecutable);
+      CHECK(image.FindSection(want.Name) == &section);
+    }
+  }
+
+  void CheckFindByRva(PEImage const& image, ExpectedImage const& expected)
+  {
+    // Headers
+    CHECK(image.FindSectionByRva(0) == nullptr);
+    CHECK(image.FindSectionByRva(0x3FF) == nullptr);
+
+    for (size_t i = 0; i < expected.Sections.size(); ++i)
+    {
+      ExpectedSection const& want = expected.Sections[i];
+      PESection const* pSection = &image.GetSections()[i];
+      uint32_t end = want.VirtualAddress + want.VirtualSize;
+
+      CHECK(image.FindSectionByRva(want.VirtualAddress) == pSection);
+      CHECK(image.FindSectionByRva(want.VirtualAddress + want.VirtualSize / 2) == pSection);
+      CHECK(image.FindSectionByRva(end - 1) == pSection);
+
+      // Padding up to the next section's alignment belongs to none
+      CHECK(image.FindSectionByRva(end) == nullptr);
+    }
+
+    CHECK(image.FindSectionByRva(expected.SizeOfImage) == nullptr);
+    CHECK(image.FindSectionByRva(0xFFFFFFFF) == nullptr);
+    CHECK(image.FindSection(".bss") == nullptr);
+  }
+
+  void CheckParseAndMap(ExpectedImage const& expected)
+  {
+    std::vector<uint8_t> file = ReadFile(expected.Path);
+    CHECK(!file.empty());
+    if (file.empty())
+      return;
+
+    PEImage raw;
+    CHECK(Parse(file, false, raw));
+    CheckImage(raw, expected);
+    CheckFindByRva(raw, expected);
+
+    std::vector<uint8_t> mapped;
+    CHECK(raw.Map(file.data(), file.size(), mapped));
+    CHECK(mapped.size() == expected.SizeOfImage);
+    if (mapped.size() != expected.SizeOfImage)
+      return;
+
+    CHECK(memcmp(mapped.data(), file.data(), 0x400) == 0);
+    for (ExpectedSection const& want : expected.Sections)
+    {
+      // Raw data up to VirtualSize at the RVA, zeros after it
+      uint32_t copied = (std::min)(want.RawSize, want.VirtualSize);
+      CHECK(memcmp(&mapped[want.VirtualAddress], &file[want.RawOffset], copied) == 0);
+
+      uint32_t end = want.VirtualAddress + want.VirtualSize;
+      uint32_t aligned = (end + 0xFFF) & ~0xFFFu;
+      bool zeroed = true;
+      for (uint32_t rva = want.VirtualAddress + copied; rva < aligned; ++rva)
+        zeroed &= mapped[rva] == 0;
+      CHECK(zeroed);
+    }
+
+    // The mapped copy parses to the same image
+    PEImage loaded;
+    CHECK(Parse(mapped, true, loaded));
+    CheckImage(loaded, expected);
+
+    // A raw file isn't a valid mapped image, its sections end past the
+    // file's size once they're at their RVAs
+    CHECK(!Parses(file, true));
+  }
+}
+
+TEST(PE_ParseDll)
+{
+  CheckParseAndMap(Dll());
+}
+
+TEST(PE_ParseInjector)
+{
+  CheckParseAndMap(Injector());
+}
+
+TEST(PE_Truncated)
+{
+  std::vector<uint8_t> file = ReadFile(g_dllPath);
+  CHECK(!file.empty());
+  if (file.empty())
+    return;
+
+  size_t ntOffset = NtOffset(file);
+  size_t sectionTable = SectionTable(file);
+  ExpectedImage dll = Dll();
+  ExpectedSection const& last = dll.Sections.back();
+
+  const size_t cuts[] = {
+    0, 1,
+    0x3E,                            // in e_lfanew
+    ntOffset + 2,                    // in the PE signature
+    ntOffset + 10,                   // in IMAGE_FILE_HEADER
+    ntOffset + 24 + 60,              // in the optional header
+    sectionTable + 40 * 3 + 17,      // in the fourth section header
+    last.RawOffset + last.RawSize / 2,
+    file.size() - 1
+  };
+  for (size_t cut : cuts)
+  {
+    std::vector<uint8_t> truncated(file.begin(), file.begin() + cut);
+    CHECK(!Parses(truncated, false));
+  }
+
+  // A mapped image one byte short of its last section
+  PEImage image;
+  std::vector<uint8_t> mapped;
+  CHECK(Parse(file, false, image));
+  CHECK(image.Map(file.data(), file.size(), mapped));
+  mapped.resize(last.VirtualAddress + last.VirtualSize - 1);
+  CHECK(!Parses(mapped, true));
+
+  // Map needs all of the raw data, even if Parse was given more
+  std::vector<uint8_t> out;
+  CHECK(!image.Map(file.data(), last.RawOffset + 16, out));
+  CHECK(!image.Map(file.data(), 0x200, out));
+}
+
+TEST(PE_Corrupted)
+{
+  std::vector<uint8_t> file = ReadFile(g_dllPath);
+  CHECK(!file.empty());
+  if (file.empty())
+    return;
+
+  size_t ntOffset = NtOffset(file);
+  size_t optional = ntOffset + 24;
+  size_t sectionTable = SectionTable(file);
+  CHECK(Parses(file, false));
+
+  // Each corruption on a fresh copy
+  auto rejects = [&](void(*corrupt)(std::vector<uint8_t>&, size_t, size_t, size_t))
+  {
+    std::vector<uint8_t> copy = file;
+    corrupt(copy, ntOffset, optional, sectionTable);
+    return !Parses(copy, false);
+  };
+
+  // MZ
+  CHECK(rejects([](std::vector<uint8_t>& d, size_t, size_t, size_t) { d[1] = 'X'; }));
+  // e_lfanew past the end of the file, and right at the end
+  CHECK(rejects([](std::vector<uint8_t>& d, size_t, size_t, size_t) { Patch<uint32_t>(d, 0x3C, 0xFFFFFFF0u); }));
+  CHECK(rejects([](std::vector<uint8_t>& d, size_t, size_t, size_t) { Patch<uint32_t>(d, 0x3C, static_cast<uint32_t>(d.size() - 2)); }));
+  // PE\0\0
+  CHECK(rejects([](std::vector<uint8_t>& d, size_t nt, size_t, size_t) { d[nt + 1] = 'F'; }));
+  // Optional header magic that's neither PE32 nor PE32+
+  CHECK(rejects([](std::vector<uint8_t>& d, size_t, size_t opt, size_t) { Patch<uint16_t>(d, opt, 0x107); }));
+  // A section count that runs the table past the end of the file
+  CHECK(rejects([](std::vector<uint8_t>& d, size_t nt, size_t, size_t) { Patch<uint16_t>(d, nt + 6, 0xFFFF); }));
+  // Raw data of .text past the end of the file
+  CHECK(rejects([](std::vector<uint8_t>& d, size_t, size_t, size_t table) { Patch<uint32_t>(d, table + 20, 0x7FFFFFFF); }));
+  CHECK(rejects([](std::vector<uint8_t>& d, size_t, size_t, size_t table) { Patch<uint32_t>(d, table + 16, 0xFFFFFFFF); }));
+
+  // Headers that parse, but can't be laid out
+  auto mapRejects = [&](void(*corrupt)(std::vector<uint8_t>&, size_t, size_t))
+  {
+    std::vector<uint8_t> copy = file;
+    corrupt(copy, optional, sectionTable);
+    PEImage image;
+    std::vector<uint8_t> mapped;
+    return Parse(copy, false, image) && !image.Map(copy.data(), copy.size(), mapped);
+  };
+
+  // SizeOfHeaders larger than SizeOfImage
+  CHECK(mapRejects([](std::vector<uint8_t>& d, size_t opt, size_t) { Patch<uint32_t>(d, opt + 60, 0x200000); }));
+  // SizeOfImage of 0
+  CHECK(mapRejects([](std::vector<uint8_t>& d, size_t opt, size_t) { Patch<uint32_t>(d, opt + 56, 0); }));
+  // .reloc at an RVA past SizeOfImage, and one that wraps around
+  CHECK(mapRejects([](std::vector<uint8_t>& d, size_t, size_t table) { Patch<uint32_t>(d, table + 40 * 6 + 12, 0x190000); }));
+  CHECK(mapRejects([](std::vector<uint8_t>& d, size_t, size_t table) { Patch<uint32_t>(d, table + 40 * 6 + 12, 0xFFFFF000); }));
+}
+
+TEST(PE_MutatedHeaders)
+{
+  // Random damage to the headers must be rejected or give sections that
+  // lie within the data, never a read past it
+  std::vector<uint8_t> file = ReadFile(g_injectorPath);
+  CHECK(!file.empty());
+  if (file.empty())
+    return;
+
+  std::mt19937 rng(1);
+  bool inBounds = true;
+  int accepted = 0;
+  for (int i = 0; i < 2000; ++i)
+  {
+    std::vector<uint8_t> copy = file;
+    for (uint32_t flips = 1 + rng() % 8; flips; --flips)
+      copy[rng() % 0x400] = static_cast<uint8_t>(rng());
+    if (rng() % 4 == 0)
+      copy.resize(rng() % copy.size());
+
+    PEImage image;
+    if (!Parse(copy, false, image))
+      continue;
+
+    ++accepted;
+    for (PESection const& section : image.GetSections())
+      inBounds &= static_cast<uint64_t>(section.RawOffset) + section.RawSize <= copy.size();
+
+    std::vector<uint8_t> mapped;
+    if (image.GetSizeOfImage() <= 0x1000000 && image.Map(copy.data(), copy.size(), mapped))
+      inBounds &= mapped.size() == image.GetSizeOfImage();
+  }
+  CHECK(inBounds);
+  // Most damage lands in the DOS stub and padding, so some copies still
+  // parse
+  CHECK(accepted > 0);
+}
@@ -0,0 +1,100 @@
+// Unit tests for the parts of the tools that don't need the game or
+// Windows, and a benchmark of the action pipeline. See README.md for
+// building.
+
+#include "Bench.h"
+#include "Check.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace
+{
+  int g_failures = 0;
+
+  struct Options
+  {
+    bool Bench{ false };
+    // Only tests whose name starts with this are run
+    std::string Filter;
+    BenchOptions BenchRun;
+  };
+
+  void PrintUsage()
+  {
+    printf("Usage: Tests [filter]\n");
+    printf("       Tests --bench [--ticks N] [--repeats N] [--seed N]\n");
+    printf("  filter          Only run tests whose name starts with this\n");
+    printf("  --bench         Time ActionPipeline ticks on a virtual backend\n");
+    printf("  --ticks N       Ticks per run (default 2000000)\n");
+    printf("  --repeats N     Runs, the median is printed (default 5)\n");
+  }
+
+  bool ParseArgs(int argc, char** argv, Options& options)
+  {
+    for (int i = 1; i < argc; ++i)
+    {
+      std::string arg = argv[i];
+      bool hasValue = i + 1 < argc;
+      if (arg == "--bench")
+        options.Bench = true;
+      else if (arg == "--ticks" && hasValue)
+        options.BenchRun.Ticks = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+      else if (arg == "--repeats" && hasValue)
+        options.BenchRun.Repeats = atoi(argv[++i]);
+      else if (arg == "--seed" && hasValue)
+        options.BenchRun.Seed = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+      else if (arg[0] != '-' && options.Filter.empty())
+        options.Filter = arg;
+      else
+        return false;
+    }
+    return options.BenchRun.Ticks > 0 && options.BenchRun.Repeats > 0;
+  }
+}
+
+std::vector<TestCase>& GetTests()
+{
+  static std::vector<TestCase> tests;
+  return tests;
+}
+
+void ReportFailure(const char* file, int line, const char* expression)
+{
+  printf("  %s:%d: CHECK(%s) failed\n", file, line, expression);
+  ++g_failures;
+}
+
+int main(int argc, char** argv)
+{
+  Options options;
+  if (!ParseArgs(argc, argv, options))
+  {
+    PrintUsage();
+    return 2;
+  }
+
+  if (options.Bench)
+    return RunPipelineBench(options.BenchRun);
+
+  int run = 0;
+  int failed = 0;
+  for (TestCase const& test : GetTests())
+  {
+    if (strncmp(test.Name, options.Filter.c_str(), options.Filter.size()) != 0)
+      continue;
+
+    int failuresBefore = g_failures;
+    test.Run();
+    ++run;
+
+    bool passed = g_failures == failuresBefore;
+    if (!passed)
+      ++failed;
+    printf("%-40s %s\n", test.Name, passed ? "ok" : "FAILED");
+  }
+
+  printf("%d tests, %d failed\n", run, failed);
+  return failed ? 1 : 0;
+}